@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <3rd_party/taywee/args.hpp>
+
+#include <cstdlib>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/analysis/Invariants.hpp>
+#include <behavior_net/analysis/Reachability.hpp>
+#include <utils/Logger.hpp>
+
+using namespace capybot;
+
+struct CmdLineArgs
+{
+    std::string configPath;
+    std::optional<nlohmann::json> initialMarking; // [{"place_id": .., "number_tokens": ..}]
+    bnet::ReachabilityAnalyzer::Options options;
+    log::LogLevel logLevel{log::LogLevel::WARN};
+};
+
+std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
+{
+    args::ArgumentParser parser(
+        "Behavior Net analyzer - computes the net P/T-invariants and place bounds, and explores the net state space "
+        "looking for deadlocks, unbounded places and dead transitions.",
+        "The initial marking is read from `--initial_marking`, or else from the config `initial_marking` list: "
+        "[{\"place_id\": .., \"number_tokens\": ..}].");
+    args::HelpFlag help(parser, "help", "<help menu>", {'h', "help"});
+
+    args::Positional<std::string> configPath(parser, "config_path", "Configuration file path.",
+                                             args::Options::Required);
+    args::ValueFlag<uint64_t> maxStates(parser, "max_states", "Maximum number of explored states.", {"max_states"});
+    args::ValueFlag<uint32_t> threads(parser, "threads", "Number of exploration threads.", {"threads"});
+    args::ValueFlag<std::string> initialMarking(parser, "initial_marking",
+                                                "Comma-separated `place_id=number_tokens` initial marking.",
+                                                {"initial_marking"});
+    args::Flag autoOnly(parser, "auto_only", "Ignore manual transitions.", {"auto_only"});
+    args::ValueFlag<std::string> terminalPlaces(parser, "terminal_places",
+                                                "Comma-separated places in which tokens are expected to end.",
+                                                {"terminal_places"});
+    args::ValueFlag<std::string> logLevel(parser, "log_level", "See capybot::log::LogLevel for options.",
+                                          {"log_level"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return std::nullopt;
+    }
+    catch (const args::Error& e)
+    {
+        std::cerr << "\n==>> Failed to parse command line arguments.\n"
+                  << "==>> error info: " << e.what() << "\n\n"
+                  << "==>> help:\n"
+                  << parser;
+        return std::nullopt;
+    }
+
+    CmdLineArgs cliArgs;
+    cliArgs.configPath = args::get(configPath);
+    if (maxStates)
+    {
+        cliArgs.options.maxStates = args::get(maxStates);
+    }
+    if (threads)
+    {
+        cliArgs.options.numberThreads = args::get(threads);
+    }
+    if (initialMarking)
+    {
+        cliArgs.initialMarking = nlohmann::json::array();
+        std::stringstream ss(args::get(initialMarking));
+        for (std::string entry; std::getline(ss, entry, ',');)
+        {
+            const auto separator = entry.find('=');
+            try
+            {
+                if (separator == std::string::npos)
+                {
+                    throw std::invalid_argument("missing `=`");
+                }
+                cliArgs.initialMarking->push_back({{"place_id", entry.substr(0U, separator)},
+                                                   {"number_tokens", std::stoul(entry.substr(separator + 1U))}});
+            }
+            catch (const std::exception&)
+            {
+                std::cerr << "\n==>> Invalid initial marking entry `" << entry
+                          << "`; expected place_id=number_tokens.\n";
+                return std::nullopt;
+            }
+        }
+    }
+    cliArgs.options.includeManualTransitions = !autoOnly;
+    if (terminalPlaces)
+    {
+        std::stringstream ss(args::get(terminalPlaces));
+        for (std::string placeId; std::getline(ss, placeId, ',');)
+        {
+            cliArgs.options.terminalPlaces.push_back(placeId);
+        }
+    }
+    if (logLevel)
+    {
+        try
+        {
+            cliArgs.logLevel = log::LogLevel::_from_string_nocase(args::get(logLevel).c_str());
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << "\n==>> Failed to cast log level from string.\n"
+                      << "==>> error info: " << e.what() << "\n";
+            return std::nullopt;
+        }
+    }
+    return cliArgs;
+}
+
+int main(int argc, char** argv)
+{
+    auto cliArgs = parseArgs(argc, argv);
+    if (!cliArgs.has_value())
+    {
+        return EXIT_FAILURE;
+    }
+
+    log::Logger::set(std::make_unique<log::DefaultLogger>());
+    log::Logger::get()->setLogLevel(cliArgs->logLevel);
+    log::Logger::get()->enableAutoNewline();
+
+    const auto config = bnet::NetConfig(cliArgs->configPath);
+    const auto net = bnet::NetStructure::fromConfig(config.get());
+    if (!cliArgs->initialMarking.has_value() && !config.get().contains("initial_marking"))
+    {
+        std::cerr << "\n==>> No initial marking: the config has no `initial_marking` list, and `--initial_marking` is "
+                     "not set.\n";
+        return EXIT_FAILURE;
+    }
+    const auto initialMarking = cliArgs->initialMarking.has_value() ? net.getMarking(cliArgs->initialMarking.value())
+                                                                    : net.getInitialMarking(config.get());
+
+    const auto invariants = bnet::InvariantAnalyzer(net).analyze(initialMarking);
+    const auto result = bnet::ReachabilityAnalyzer(net, cliArgs->options).analyze(initialMarking);
+
+    nlohmann::json report;
+    report["invariants"] = invariants.toJson(net);
+    report["reachability"] = result.toJson();
+    std::cout << report.dump(4) << "\n";
+    if (!result.complete)
+    {
+        std::cout << "warning: state space not fully explored; increase `--max_states` for a complete analysis\n";
+    }
+
+    return result.numberDeadlocks == 0U && result.unboundedPlaces.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
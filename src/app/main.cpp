@@ -23,6 +23,7 @@
 #include <stdexcept>
 
 #include <behavior_net/Controller.hpp>
+#include <behavior_net/MultiNetController.hpp>
 #include <utils/Logger.hpp>
 
 class SignalHandler
@@ -45,6 +46,7 @@ struct CmdLineArgs
 {
     std::string configPath{"config_samples/config.json"};
     log::LogLevel logLevel{log::LogLevel::INFO};
+    bool multiNet{false};
 };
 
 std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
@@ -56,6 +58,8 @@ std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
     args::Positional<std::string> configPath(parser, "config_path", "Configuration file path.");
     args::ValueFlag<std::string> logLevel(parser, "log_level", "See capybot::log::LogLevel for options.",
                                           {"log_level"});
+    args::Flag multiNet(parser, "multi_net", "The config is a multi-net host config; see bnet::MultiNetController.",
+                        {"multi_net"});
 
     try
     {
@@ -80,6 +84,7 @@ std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
     {
         cliArgs.configPath = args::get(configPath);
     }
+    cliArgs.multiNet = multiNet;
     if (logLevel)
     {
         try
@@ -119,6 +124,20 @@ int main(int argc, char** argv)
 
     initLogger(cliArgs->logLevel);
 
+    if (cliArgs->multiNet)
+    {
+        bnet::MultiNetController controller(cliArgs->configPath);
+
+        SignalHandler::registerCallback([&controller](int sig) {
+            LOG_TAGGED(INFO, "SignalHandler") << "Received sig " << sig << ". Exiting..." << log::endl;
+            controller.stop();
+        });
+        SignalHandler::registerSignals();
+
+        controller.run();
+        return EXIT_SUCCESS;
+    }
+
     auto config = bnet::NetConfig(cliArgs->configPath);
     auto net = bnet::PetriNet::create(config);
 
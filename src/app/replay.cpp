@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <3rd_party/taywee/args.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/EventTrace.hpp>
+#include <utils/Logger.hpp>
+
+using namespace capybot;
+
+struct CmdLineArgs
+{
+    std::string configPath;
+    std::string tracePath;
+    log::LogLevel logLevel{log::LogLevel::WARN};
+};
+
+std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
+{
+    args::ArgumentParser parser("Behavior Net replay - replays a recorded event trace in virtual time.",
+                                "Traces are recorded by setting `controller/event_trace/record_path` in the config.");
+    args::HelpFlag help(parser, "help", "<help menu>", {'h', "help"});
+
+    args::Positional<std::string> configPath(parser, "config_path", "Configuration file path.",
+                                             args::Options::Required);
+    args::Positional<std::string> tracePath(parser, "trace_path", "Recorded event trace path.",
+                                            args::Options::Required);
+    args::ValueFlag<std::string> logLevel(parser, "log_level", "See capybot::log::LogLevel for options.",
+                                          {"log_level"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return std::nullopt;
+    }
+    catch (const args::Error& e)
+    {
+        std::cerr << "\n==>> Failed to parse command line arguments.\n"
+                  << "==>> error info: " << e.what() << "\n\n"
+                  << "==>> help:\n"
+                  << parser;
+        return std::nullopt;
+    }
+
+    CmdLineArgs cliArgs;
+    cliArgs.configPath = args::get(configPath);
+    cliArgs.tracePath = args::get(tracePath);
+    if (logLevel)
+    {
+        try
+        {
+            cliArgs.logLevel = log::LogLevel::_from_string_nocase(args::get(logLevel).c_str());
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << "\n==>> Failed to cast log level from string.\n"
+                      << "==>> error info: " << e.what() << "\n";
+            return std::nullopt;
+        }
+    }
+    return cliArgs;
+}
+
+int main(int argc, char** argv)
+{
+    auto cliArgs = parseArgs(argc, argv);
+    if (!cliArgs.has_value())
+    {
+        return EXIT_FAILURE;
+    }
+
+    log::Logger::set(std::make_unique<log::DefaultLogger>());
+    log::Logger::get()->setLogLevel(cliArgs->logLevel);
+    log::Logger::get()->enableAutoNewline();
+
+    // replaying must not serve requests nor overwrite the trace being replayed
+    nlohmann::json configJson;
+    std::ifstream(cliArgs->configPath) >> configJson;
+    configJson.at("controller").erase("http_server");
+    configJson.at("controller").erase("event_trace");
+
+    const auto config = bnet::NetConfig::fromJson(configJson);
+    const auto trace = bnet::EventTrace::load(cliArgs->tracePath);
+
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    const auto report = controller.replay(trace);
+
+    const auto wallTimeMs = std::chrono::duration<double, std::milli>(report.wallTime).count();
+    std::cout << "Replayed " << trace.getNumberEvents() << " events over " << report.epochs << " epochs\n"
+              << "\tvirtual time      : " << report.virtualTime.count() << " ms\n"
+              << "\twall time         : " << wallTimeMs << " ms\n"
+              << "\tepochs per second : " << (wallTimeMs > 0. ? report.epochs * 1000. / wallTimeMs : 0.) << "\n"
+              << "\ttransitions fired : " << report.transitionsFired << "\n"
+              << "\tdivergent epochs  : " << report.divergentEpochs << "\n"
+              << "\tfinal marking     : " << controller.getNet().getMarking().at("marking").dump() << "\n";
+
+    return report.divergentEpochs == 0U ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -17,12 +17,20 @@
 
 #pragma once
 
+#include <behavior_net/ActionResultCache.hpp>
+#include <behavior_net/CancellationToken.hpp>
 #include <behavior_net/Common.hpp>
 #include <behavior_net/ThreadPool.hpp>
 #include <behavior_net/Token.hpp>
 #include <behavior_net/Types.hpp>
+#include <utils/RingBuffer.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <list>
+#include <optional>
+#include <memory>
+#include <vector>
 
 namespace capybot
 {
@@ -32,17 +40,51 @@ namespace bnet
 struct ActionExecutionUnit
 {
     using List = std::list<ActionExecutionUnit>;
+    using BatchResults = std::shared_ptr<std::vector<ActionExecutionStatus>>;
 
     Token::SharedPtr tokenPtr;
-    ThreadPool::Task task;
+    std::shared_ptr<ThreadPool::Task> task; // shared by all the tokens of a batch
     uint32_t delayedEpochs;
+    BatchResults batchResults{}; // [batch only] results of all the tokens of the batch, in order
+    size_t batchIndex{0U};
+    CancellationToken cancellation{};
+    std::chrono::steady_clock::time_point dispatchTime{std::chrono::steady_clock::now()};
+    std::optional<ActionResultCache::Key> cacheKey{}; // set if the result is to be cached
 
-    ActionExecutionUnit(Token::SharedPtr const& token, std::function<ActionExecutionStatus()> func, uint32_t delay = 0)
+    ActionExecutionUnit(Token::SharedPtr const& token, std::function<ActionExecutionStatus()> func, uint32_t delay = 0,
+                        ThreadPool::CompletionCounter::SharedPtr const& counter = nullptr,
+                        CancellationToken const& cancellationToken = CancellationToken())
         : tokenPtr(token)
-        , task(func)
+        , task(std::make_shared<ThreadPool::Task>(func, counter))
         , delayedEpochs(delay)
+        , cancellation(cancellationToken)
     {
     }
+
+    ActionExecutionUnit(Token::SharedPtr const& token, std::shared_ptr<ThreadPool::Task> const& batchTask,
+                        BatchResults const& results, size_t index,
+                        CancellationToken const& cancellationToken = CancellationToken())
+        : tokenPtr(token)
+        , task(batchTask)
+        , delayedEpochs(0U)
+        , batchResults(results)
+        , batchIndex(index)
+        , cancellation(cancellationToken)
+    {
+    }
+
+    ActionExecutionStatus getStatus() const
+    {
+        const auto status = task->getStatus();
+        if (!batchResults || status == +ActionExecutionStatus::NOT_STARTED ||
+            status == +ActionExecutionStatus::QUERRY_TIMEOUT)
+        {
+            return status;
+        }
+        // a batch which threw, or returned too few results, is an error for the missing tokens
+        return batchIndex < batchResults->size() ? batchResults->at(batchIndex)
+                                                 : ActionExecutionStatus(ActionExecutionStatus::ERROR);
+    }
 };
 
 struct ActionExecutionResult
@@ -55,7 +97,75 @@ struct ActionExecutionResult
 class IActionImpl
 {
 public:
+    virtual ~IActionImpl() = default;
+
     virtual std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) = 0;
+
+    /// @brief cancellable version of `createCallable()`, used by actions with a timeout; the callable should return
+    /// soon after `cancellation` is cancelled, so its worker is freed. Cancellation is ignored by default.
+    virtual std::function<ActionExecutionStatus()> createCancellableCallable(Token::ConstSharedPtr token,
+                                                                             CancellationToken const& cancellation)
+    {
+        std::ignore = cancellation;
+        return createCallable(token);
+    }
+
+    /// @brief whether the action processes all the tokens of an epoch at once, see `createBatchCallable()`
+    virtual bool supportsBatches() const { return false; }
+
+    /// @brief callable processing `tokens` in one thread pool task, e.g., with a single DB query; used instead of
+    /// `createCallable()` if `supportsBatches()`
+    /// @return callable returning one status per token, in the order of `tokens`
+    virtual std::function<std::vector<ActionExecutionStatus>()>
+    createBatchCallable(std::vector<Token::ConstSharedPtr> const& tokens)
+    {
+        std::ignore = tokens;
+        throw Exception(ExceptionType::NOT_IMPLEMENTED, "IActionImpl::createBatchCallable: batches are not supported.");
+    }
+
+    /// @brief whether the callables block on external calls, e.g., network requests; if so, they run in the
+    /// thread pool blocking IO lane by default
+    virtual bool performsBlockingIo() const { return false; }
+
+    /// @brief called once by the owning `Action`, e.g., for implementations running work of their own in the thread
+    /// pool; `tp` outlives the implementation
+    virtual void setThreadPool(ThreadPool& tp) { std::ignore = tp; }
+};
+
+/**
+ * @brief Action dispatch options, read from the action config, i.e., next to its "type" and "params"
+ *
+ * Config:
+ *    "timeout_ms"      [uint32_t][optional] executions running longer are cancelled, and their tokens get the ERROR
+ *                      status; see `IActionImpl::createCancellableCallable()`
+ *    "max_concurrency" [uint32_t][optional] maximum number of executions in flight; further busy tokens wait in the
+ *                      place until executions complete
+ *    "cache"           [object][optional] memoize the results of an idempotent action, i.e., a pure function of its
+ *                      params and the token content they refer to; see `ActionResultCache`
+ */
+struct ActionOptions
+{
+    std::optional<std::chrono::milliseconds> timeout{};
+    std::optional<uint32_t> maxConcurrency{};
+    std::optional<ActionResultCache::Params> cache{};
+
+    static ActionOptions fromConfig(nlohmann::json const& actionConfig)
+    {
+        ActionOptions options;
+        if (actionConfig.contains("timeout_ms"))
+        {
+            options.timeout = std::chrono::milliseconds(actionConfig.at("timeout_ms").get<uint32_t>());
+        }
+        if (actionConfig.contains("max_concurrency"))
+        {
+            options.maxConcurrency = actionConfig.at("max_concurrency").get<uint32_t>();
+        }
+        if (actionConfig.contains("cache"))
+        {
+            options.cache = ActionResultCache::Params::fromConfig(actionConfig.at("cache"));
+        }
+        return options;
+    }
 };
 
 /// @brief Action object to be associated with a place
@@ -66,45 +176,93 @@ class Action
 public:
     using UniquePtr = std::unique_ptr<Action>;
 
-    Action(ThreadPool& tp, std::unique_ptr<IActionImpl>& impl)
+    using Options = ActionOptions;
+
+    /// @param lane thread pool lane the action tasks are executed in
+    Action(ThreadPool& tp, std::unique_ptr<IActionImpl>& impl, ThreadPool::LaneId lane = ThreadPool::DEFAULT_LANE,
+           Options const& options = Options())
         : m_threadPool(tp)
+        , m_lane(lane)
+        , m_options(options)
         , m_actionImpl(std::move(impl))
     {
+        m_actionImpl->setThreadPool(tp);
     }
 
-    void executeAsync(std::list<Token::SharedPtr> const& tokens)
+    /// @param counter [optional] group the dispatched tasks are added to
+    /// @param maxDispatch maximum number of new executions, e.g., the share of a global limit; the remaining tokens
+    /// wait for a later epoch, in order
+    void executeAsync(RingBuffer<Token::SharedPtr> const& tokens,
+                      ThreadPool::CompletionCounter::SharedPtr const& counter = nullptr,
+                      uint32_t maxDispatch = UINT32_MAX)
     {
-        if (!m_epochExecutions.empty())
+        if (!m_epochExecutions.empty() || !m_cachedResults.empty())
         {
             throw Exception(ExceptionType::LOGIC_ERROR,
                             "Action::executeAsync: `getEpochResults()` must be called for all 'executeAsync' calls.");
         }
 
+        uint32_t remainingDispatch = std::min(maxDispatch, getNumberAdmissible(tokens));
+        if (m_actionImpl->supportsBatches())
+        {
+            executeBatchAsync(tokens, counter, remainingDispatch);
+            return;
+        }
+
         for (auto&& token : tokens)
         {
+            if (remainingDispatch == 0U && !m_resultCache)
+                break;
             if (isInDelayedExecution(token))
                 continue;
+            std::optional<ActionResultCache::Key> cacheKey;
+            if (completeFromCache(token, cacheKey))
+                continue;
+            if (remainingDispatch == 0U)
+                continue; // cached results are still served over the dispatch limit
+            --remainingDispatch;
 
-            m_epochExecutions.emplace_back(token, m_actionImpl->createCallable(token));
-            m_threadPool.executeAsync(m_epochExecutions.back().task);
+            if (m_options.timeout)
+            {
+                const auto cancellation = CancellationToken::create();
+                m_epochExecutions.emplace_back(
+                    token, skipIfCancelled(m_actionImpl->createCancellableCallable(token, cancellation), cancellation),
+                    0U, counter, cancellation);
+            }
+            else
+            {
+                m_epochExecutions.emplace_back(token, m_actionImpl->createCallable(token), 0U, counter);
+            }
+            m_epochExecutions.back().cacheKey = std::move(cacheKey);
+            m_threadPool.executeAsync(*m_epochExecutions.back().task, m_lane);
         }
     }
 
     std::vector<ActionExecutionResult> getEpochResults()
     {
         std::vector<ActionExecutionResult> results;
-        results.reserve(m_delayedExecutions.size() + m_epochExecutions.size());
+        results.reserve(m_cachedResults.size() + m_delayedExecutions.size() + m_epochExecutions.size());
+        results.insert(results.end(), m_cachedResults.begin(), m_cachedResults.end());
+        m_cachedResults.clear();
+        releaseExpiredTasks();
+        const auto now = std::chrono::steady_clock::now();
 
         // let's start with the delayed ones
         {
             ActionExecutionUnit::List::iterator it = m_delayedExecutions.begin();
             while (it != m_delayedExecutions.end())
             {
-                auto status = it->task.getStatus();
+                auto status = it->getStatus();
                 if (status._value != ActionExecutionStatus::NOT_STARTED &&
                     status._value != ActionExecutionStatus::QUERRY_TIMEOUT) // execution is done
                 {
                     results.push_back(ActionExecutionResult{.tokenPtr = it->tokenPtr, .status = status});
+                    cacheResult(*it, status);
+                    m_delayedExecutions.erase(it++);
+                }
+                else if (hasExpired(*it, now))
+                {
+                    results.push_back(expire(*it));
                     m_delayedExecutions.erase(it++);
                 }
                 else
@@ -120,11 +278,17 @@ public:
             while (!m_epochExecutions.empty())
             {
                 auto& unit = m_epochExecutions.front();
-                auto status = unit.task.getStatus();
+                auto status = unit.getStatus();
                 if (status._value != ActionExecutionStatus::NOT_STARTED &&
                     status._value != ActionExecutionStatus::QUERRY_TIMEOUT) // execution is done
                 {
                     results.push_back(ActionExecutionResult{.tokenPtr = unit.tokenPtr, .status = status});
+                    cacheResult(unit, status);
+                    m_epochExecutions.pop_front();
+                }
+                else if (hasExpired(unit, now))
+                {
+                    results.push_back(expire(unit));
                     m_epochExecutions.pop_front();
                 }
                 else
@@ -139,9 +303,164 @@ public:
         return results;
     }
 
+    /// @brief number of `tokens` the next `executeAsync()` would dispatch, given the `max_concurrency` option
+    uint32_t getNumberAdmissible(RingBuffer<Token::SharedPtr> const& tokens) const
+    {
+        // delayed tokens are busy tokens too
+        const uint32_t numberWaiting =
+            tokens.size() > m_delayedExecutions.size() ? tokens.size() - m_delayedExecutions.size() : 0U;
+        if (!m_options.maxConcurrency)
+        {
+            return numberWaiting;
+        }
+        const uint32_t numberInFlight = getNumberInFlight();
+        const uint32_t limit = m_options.maxConcurrency.value();
+        return numberInFlight >= limit ? 0U : std::min(numberWaiting, limit - numberInFlight);
+    }
+
+    /// @brief number of executions dispatched in previous epochs which did not complete yet, incl. expired ones
+    uint32_t getNumberInFlight() const { return m_delayedExecutions.size() + m_expiredTasks.size(); }
+
     uint32_t getNumberDelayedTasks() const { return m_delayedExecutions.size(); }
+    /// @brief number of timed out tasks still holding a worker, e.g., callables ignoring cancellation
+    uint32_t getNumberExpiredTasks() const { return m_expiredTasks.size(); }
+    Options const& getOptions() const { return m_options; }
+    ThreadPool::LaneId getLane() const { return m_lane; }
+
+    /// @brief memoize the action results in `cache`, keyed by `key`; see `Options::cache`
+    void setResultCache(std::shared_ptr<ActionResultCache> const& cache, ActionResultCacheKey const& key)
+    {
+        m_resultCache = cache;
+        m_resultCacheKey = key;
+    }
+    std::shared_ptr<ActionResultCache> const& getResultCache() const { return m_resultCache; }
 
 private:
+    /// @param[out] key cache key of `token`, if its result can be cached
+    /// @return true if the result of `token` was cached, i.e., it completes this epoch without taking a worker
+    bool completeFromCache(Token::SharedPtr const& token, std::optional<ActionResultCache::Key>& key)
+    {
+        if (!m_resultCache)
+        {
+            return false;
+        }
+        key = m_resultCacheKey->get(token);
+        const auto statusOpt = key.has_value() ? m_resultCache->get(key.value()) : std::nullopt;
+        if (!statusOpt.has_value())
+        {
+            return false;
+        }
+        m_cachedResults.push_back(ActionExecutionResult{.tokenPtr = token, .status = statusOpt.value()});
+        return true;
+    }
+
+    void cacheResult(ActionExecutionUnit const& unit, ActionExecutionStatus status)
+    {
+        if (m_resultCache && unit.cacheKey.has_value())
+        {
+            m_resultCache->put(unit.cacheKey.value(), status);
+        }
+    }
+
+    static std::function<ActionExecutionStatus()> skipIfCancelled(std::function<ActionExecutionStatus()> callable,
+                                                                  CancellationToken const& cancellation)
+    {
+        return [callable = std::move(callable), cancellation]() -> ActionExecutionStatus {
+            // queued executions cancelled before starting do not take a worker
+            return cancellation.isCancelled() ? ActionExecutionStatus(ActionExecutionStatus::ERROR) : callable();
+        };
+    }
+
+    bool hasExpired(ActionExecutionUnit const& unit, std::chrono::steady_clock::time_point now) const
+    {
+        return m_options.timeout && now - unit.dispatchTime >= m_options.timeout.value();
+    }
+
+    /// @brief cancel an execution; its task is kept until done, as the thread pool refers to it
+    ActionExecutionResult expire(ActionExecutionUnit const& unit)
+    {
+        LOG(WARN) << "getEpochResults: action execution timed out after " << m_options.timeout.value().count()
+                  << " ms; cancelling it" << log::endl;
+        unit.cancellation.cancel();
+        if (std::find(m_expiredTasks.begin(), m_expiredTasks.end(), unit.task) == m_expiredTasks.end())
+        {
+            m_expiredTasks.push_back(unit.task); // batch units share their task
+        }
+        return ActionExecutionResult{.tokenPtr = unit.tokenPtr, .status = ActionExecutionStatus::ERROR};
+    }
+
+    void releaseExpiredTasks()
+    {
+        m_expiredTasks.remove_if([](std::shared_ptr<ThreadPool::Task> const& task) {
+            const auto status = task->getStatus();
+            return status != +ActionExecutionStatus::NOT_STARTED && status != +ActionExecutionStatus::QUERRY_TIMEOUT;
+        });
+    }
+
+    /// @brief one task for all the tokens which are not in delayed execution
+    void executeBatchAsync(RingBuffer<Token::SharedPtr> const& tokens,
+                           ThreadPool::CompletionCounter::SharedPtr const& counter, uint32_t maxBatchSize)
+    {
+        std::vector<Token::SharedPtr> unitTokens;
+        std::vector<std::optional<ActionResultCache::Key>> unitCacheKeys;
+        unitTokens.reserve(std::min<size_t>(tokens.size(), maxBatchSize));
+        for (auto&& token : tokens)
+        {
+            if (unitTokens.size() == maxBatchSize && !m_resultCache)
+            {
+                break;
+            }
+            if (isInDelayedExecution(token))
+            {
+                continue;
+            }
+            std::optional<ActionResultCache::Key> cacheKey;
+            if (!completeFromCache(token, cacheKey) && unitTokens.size() < maxBatchSize)
+            {
+                unitTokens.push_back(token);
+                unitCacheKeys.push_back(cacheKey);
+            }
+        }
+        const std::vector<Token::ConstSharedPtr> batchTokens(unitTokens.begin(), unitTokens.end());
+        if (batchTokens.empty())
+        {
+            return;
+        }
+
+        auto results = std::make_shared<std::vector<ActionExecutionStatus>>();
+        auto batchCallable = m_actionImpl->createBatchCallable(batchTokens);
+        const auto cancellation = m_options.timeout ? CancellationToken::create() : CancellationToken();
+        const auto numberTokens = batchTokens.size();
+        // the task status only tells whether the batch needs polling again, see `ThreadPool::CompletionCounter`
+        auto task = std::make_shared<ThreadPool::Task>(
+            [results, batchCallable, numberTokens, cancellation]() -> ActionExecutionStatus {
+                if (cancellation.isCancelled())
+                {
+                    return ActionExecutionStatus::ERROR;
+                }
+                *results = batchCallable();
+                if (results->size() != numberTokens)
+                {
+                    LOG(ERROR) << "executeBatchAsync: expected " << numberTokens << " results, got "
+                               << results->size() << log::endl;
+                    return ActionExecutionStatus::ERROR;
+                }
+                const bool inProgress =
+                    std::any_of(results->begin(), results->end(), [](ActionExecutionStatus const& status) {
+                        return status == +ActionExecutionStatus::IN_PROGRESS;
+                    });
+                return inProgress ? ActionExecutionStatus::IN_PROGRESS : ActionExecutionStatus::SUCCESS;
+            },
+            counter);
+
+        for (size_t index = 0U; index < numberTokens; ++index)
+        {
+            m_epochExecutions.emplace_back(unitTokens[index], task, results, index, cancellation);
+            m_epochExecutions.back().cacheKey = std::move(unitCacheKeys[index]);
+        }
+        m_threadPool.executeAsync(*task, m_lane);
+    }
+
     bool isInDelayedExecution(Token::ConstSharedPtr const& tokenPtr) const
     {
         const auto checkPtr = [&tokenPtr](const ActionExecutionUnit& unit) { return unit.tokenPtr == tokenPtr; };
@@ -151,7 +470,13 @@ private:
 
     ActionExecutionUnit::List m_epochExecutions{};
     ActionExecutionUnit::List m_delayedExecutions{};
+    std::list<std::shared_ptr<ThreadPool::Task>> m_expiredTasks{};
+    std::vector<ActionExecutionResult> m_cachedResults{}; // this epoch cache hits
+    std::shared_ptr<ActionResultCache> m_resultCache{};
+    std::optional<ActionResultCacheKey> m_resultCacheKey{};
     ThreadPool& m_threadPool;
+    const ThreadPool::LaneId m_lane;
+    const Options m_options;
 
     std::unique_ptr<IActionImpl> m_actionImpl{};
 };
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/ActionAdmission.hpp>
+#include <behavior_net/Config.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateActionAdmissionConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("max_concurrent_actions"))
+    {
+        return true; // no global limit
+    }
+    const auto limitOpt = getValueAtPath<uint32_t>(netConfig, {"controller", "max_concurrent_actions"}, errorMessages);
+    if (limitOpt.has_value() && limitOpt.value() == 0U)
+    {
+        errorMessages.push_back("Invalid `max_concurrent_actions`; expected a positive integer.");
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateActionAdmissionConfig, "ActionAdmissionConfigValidator");
+
+std::vector<uint32_t> shareFairly(std::vector<uint32_t> const& demands, uint32_t budget, size_t rotation)
+{
+    const size_t numberPlaces = demands.size();
+    std::vector<uint32_t> grants(numberPlaces, 0U);
+    if (numberPlaces == 0U)
+    {
+        return grants;
+    }
+
+    // rotated order, so ties and leftovers do not always favour the same places
+    std::vector<size_t> rotated(numberPlaces);
+    std::iota(rotated.begin(), rotated.end(), 0U);
+    std::rotate(rotated.begin(), rotated.begin() + rotation % numberPlaces, rotated.end());
+
+    // water filling, from the smallest demand up
+    std::vector<size_t> byDemand(rotated);
+    std::stable_sort(byDemand.begin(), byDemand.end(),
+                     [&demands](size_t lhs, size_t rhs) { return demands[lhs] < demands[rhs]; });
+    uint32_t remaining = budget;
+    for (size_t k = 0U; k < numberPlaces; ++k)
+    {
+        const auto index = byDemand[k];
+        const uint32_t evenShare = remaining / static_cast<uint32_t>(numberPlaces - k);
+        grants[index] = std::min(demands[index], evenShare);
+        remaining -= grants[index];
+    }
+
+    return grants;
+}
+
+std::optional<uint32_t> getMaxConcurrentActions(nlohmann::json const& controllerConfig)
+{
+    if (!controllerConfig.contains("max_concurrent_actions"))
+    {
+        return std::nullopt;
+    }
+    return controllerConfig.at("max_concurrent_actions").get<uint32_t>();
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Share of a global action concurrency limit between places
+ *
+ * Max-min fair: places asking for less than an even share get all they ask for, and the rest is split evenly between
+ * the others. Places with equal demands take turns, by `rotation`, for the slots left by the integer division, so no
+ * place is favoured epoch after epoch.
+ *
+ * Config (`controller`, optional):
+ *    "max_concurrent_actions" [uint32_t][optional] maximum number of action executions in flight across all places;
+ *                             busy tokens over the limit wait in their places
+ *
+ * @param demands number of tokens each place would execute
+ * @param budget number of executions that can be dispatched
+ * @param rotation e.g., the epoch number
+ * @return number of executions granted to each place, in the order of `demands`
+ */
+std::vector<uint32_t> shareFairly(std::vector<uint32_t> const& demands, uint32_t budget, size_t rotation);
+
+/// @return the `max_concurrent_actions` limit of a controller config, if any
+std::optional<uint32_t> getMaxConcurrentActions(nlohmann::json const& controllerConfig);
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/ActionCoroutine.hpp>
+#include <utils/Logger.hpp>
+
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+/// @brief Single thread resuming sleeping coroutines at their wake up time
+class CoroutineTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static CoroutineTimer& instance()
+    {
+        static CoroutineTimer timer;
+        return timer;
+    }
+
+    void resumeAt(Clock::time_point wakeUpTime, std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_timers.push(Timer{.wakeUpTime = wakeUpTime, .handle = handle});
+        }
+        m_timersCondition.notify_one();
+    }
+
+private:
+    struct Timer
+    {
+        Clock::time_point wakeUpTime;
+        std::coroutine_handle<> handle;
+
+        bool operator>(Timer const& other) const { return wakeUpTime > other.wakeUpTime; }
+    };
+
+    CoroutineTimer()
+        : m_thread([this] { run(); })
+    {
+    }
+
+    /// @brief coroutines still sleeping at exit are not resumed
+    ~CoroutineTimer()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_stopping = true;
+        }
+        m_timersCondition.notify_one();
+        m_thread.join();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        while (!m_stopping)
+        {
+            if (m_timers.empty())
+            {
+                m_timersCondition.wait(lk);
+                continue;
+            }
+            const auto next = m_timers.top();
+            if (Clock::now() < next.wakeUpTime)
+            {
+                m_timersCondition.wait_until(lk, next.wakeUpTime);
+                continue;
+            }
+            m_timers.pop();
+            lk.unlock();
+            next.handle.resume();
+            lk.lock();
+        }
+    }
+
+    std::mutex m_mtx;
+    std::condition_variable m_timersCondition;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers{};
+    bool m_stopping{false};
+    std::thread m_thread; // last, so it starts after the other members
+};
+
+bool isFinalStatus(ActionExecutionStatus status)
+{
+    return status == +ActionExecutionStatus::SUCCESS || status == +ActionExecutionStatus::FAILURE ||
+           status == +ActionExecutionStatus::ERROR;
+}
+} // namespace
+
+void ActionCoroutine::State::finish()
+{
+    std::coroutine_handle<> awaiting{};
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+        std::swap(awaiting, continuation);
+    }
+    doneCondition.notify_all();
+    if (awaiting)
+    {
+        awaiting.resume();
+    }
+}
+
+void ActionCoroutine::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) const noexcept
+{
+    // the frame is destroyed before signalling, so the action impl may be destroyed once the coroutine is done
+    const auto state = handle.promise().state;
+    handle.destroy();
+    state->finish();
+}
+
+void ActionCoroutine::promise_type::return_value(ActionExecutionStatus status)
+{
+    std::lock_guard<std::mutex> lk(state->mtx);
+    state->status = status;
+}
+
+void ActionCoroutine::promise_type::unhandled_exception()
+{
+    try
+    {
+        std::rethrow_exception(std::current_exception());
+    }
+    catch (std::exception& e)
+    {
+        LOG(ERROR) << "unhandled_exception: returning error action status; error = " << e.what() << log::endl;
+    }
+    catch (...)
+    {
+        LOG(ERROR) << "unhandled_exception: unknown exception; returning error action status." << log::endl;
+    }
+    std::lock_guard<std::mutex> lk(state->mtx);
+    state->status = ActionExecutionStatus::ERROR;
+}
+
+bool ActionCoroutine::isDone() const
+{
+    std::lock_guard<std::mutex> lk(m_state->mtx);
+    return m_state->done;
+}
+
+ActionExecutionStatus ActionCoroutine::getStatus() const
+{
+    std::lock_guard<std::mutex> lk(m_state->mtx);
+    return m_state->done ? m_state->status : ActionExecutionStatus(ActionExecutionStatus::IN_PROGRESS);
+}
+
+void ActionCoroutine::wait() const
+{
+    std::unique_lock<std::mutex> lk(m_state->mtx);
+    m_state->doneCondition.wait(lk, [this] { return m_state->done; });
+}
+
+bool ActionCoroutine::await_suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lk(m_state->mtx);
+    if (m_state->done)
+    {
+        return false; // done in the meantime; resume right away
+    }
+    m_state->continuation = handle;
+    return true;
+}
+
+void SleepAwaitable::await_suspend(std::coroutine_handle<> handle) const
+{
+    CoroutineTimer::instance().resumeAt(CoroutineTimer::Clock::now() + m_duration, handle);
+}
+
+CoroutineActionImpl::~CoroutineActionImpl()
+{
+    waitForCoroutines();
+}
+
+std::function<ActionExecutionStatus()> CoroutineActionImpl::createCallable(Token::ConstSharedPtr token)
+{
+    return createCancellableCallable(std::move(token), CancellationToken());
+}
+
+std::function<ActionExecutionStatus()>
+CoroutineActionImpl::createCancellableCallable(Token::ConstSharedPtr token, CancellationToken const& cancellation)
+{
+    // the callable may never run once cancelled, e.g., if it was still queued
+    cancellation.onCancel([this, token] {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        dropCoroutine(token);
+    });
+    return [this, token, cancellation]() -> ActionExecutionStatus { return checkCoroutine(token, cancellation); };
+}
+
+BlockingExecutor CoroutineActionImpl::getBlockingExecutor() const
+{
+    if (!m_threadPool)
+    {
+        return [](std::function<void()> func) { func(); };
+    }
+    return [tp = m_threadPool](std::function<void()> func) {
+        tp->executeDetached(std::move(func), ThreadPool::BLOCKING_IO_LANE);
+    };
+}
+
+BlockingCallAwaitable<httplib::Result> CoroutineActionImpl::httpGet(std::string host, int port, std::string path) const
+{
+    return runBlocking<httplib::Result>([host = std::move(host), port, path = std::move(path)] {
+        httplib::Client client(host, port);
+        return client.Get(path);
+    });
+}
+
+ActionCoroutine CoroutineActionImpl::awaitAction(IActionImpl& actionImpl, Token::ConstSharedPtr token,
+                                                 std::chrono::milliseconds pollPeriod) const
+{
+    auto callable = actionImpl.createCallable(token);
+    while (true)
+    {
+        const auto status = actionImpl.performsBlockingIo() ? co_await runBlocking<ActionExecutionStatus>(callable)
+                                                             : callable();
+        if (isFinalStatus(status))
+        {
+            co_return status;
+        }
+        co_await sleepFor(pollPeriod);
+    }
+}
+
+void CoroutineActionImpl::waitForCoroutines()
+{
+    std::lock_guard<std::mutex> lk(m_mtx);
+    for (auto&& [_, coroutine] : m_coroutines)
+    {
+        coroutine.wait();
+    }
+    m_coroutines.clear();
+    for (auto&& coroutine : m_droppedCoroutines)
+    {
+        coroutine.wait();
+    }
+    m_droppedCoroutines.clear();
+}
+
+void CoroutineActionImpl::dropCoroutine(Token::ConstSharedPtr const& token)
+{
+    std::erase_if(m_droppedCoroutines, [](ActionCoroutine const& coroutine) { return coroutine.isDone(); });
+    const auto it = m_coroutines.find(token);
+    if (it != m_coroutines.end())
+    {
+        if (!it->second.isDone())
+        {
+            m_droppedCoroutines.push_back(std::move(it->second));
+        }
+        m_coroutines.erase(it);
+    }
+}
+
+ActionExecutionStatus CoroutineActionImpl::checkCoroutine(Token::ConstSharedPtr const& token,
+                                                          CancellationToken const& cancellation)
+{
+    if (cancellation.isCancelled())
+    {
+        return ActionExecutionStatus::ERROR;
+    }
+    std::unique_lock<std::mutex> lk(m_mtx);
+    auto it = m_coroutines.find(token);
+    if (it == m_coroutines.end())
+    {
+        lk.unlock();
+        auto coroutine = run(token); // runs until its first suspension
+        if (coroutine.isDone())
+        {
+            return coroutine.getStatus();
+        }
+        lk.lock();
+        it = m_coroutines.emplace(token, std::move(coroutine)).first;
+        if (cancellation.isCancelled()) // cancelled while starting; the cancellation callback found nothing to drop
+        {
+            dropCoroutine(token);
+            return ActionExecutionStatus::ERROR;
+        }
+    }
+
+    if (!it->second.isDone())
+    {
+        return ActionExecutionStatus::IN_PROGRESS;
+    }
+    const auto status = it->second.getStatus();
+    m_coroutines.erase(it);
+    return status;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/Action.hpp>
+#include <behavior_net/CancellationToken.hpp>
+#include <behavior_net/ThreadPool.hpp>
+#include <behavior_net/Token.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <3rd_party/cpp-httplib/httplib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Coroutine running an action for one token; `co_return` its final status
+ *
+ * The coroutine starts right away, and runs until its first suspension. While suspended, e.g., on `sleepFor()` or
+ * `runBlocking()`, it holds no thread; it is resumed by whatever completes the awaited operation. An exception escaping
+ * the coroutine results in `ActionExecutionStatus::ERROR`.
+ *
+ * A coroutine can `co_await` another `ActionCoroutine`, to get its status once it is done.
+ */
+class ActionCoroutine
+{
+    static constexpr const char* MODULE_TAG{"ActionCoroutine"};
+
+    struct State
+    {
+        void finish();
+
+        mutable std::mutex mtx;
+        std::condition_variable doneCondition;
+        bool done{false};
+        ActionExecutionStatus status{ActionExecutionStatus::ERROR};
+        std::coroutine_handle<> continuation{}; // coroutine awaiting this one
+    };
+
+public:
+    struct promise_type
+    {
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept;
+            void await_resume() const noexcept {}
+        };
+
+        ActionCoroutine get_return_object() { return ActionCoroutine(state); }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_value(ActionExecutionStatus status);
+        void unhandled_exception();
+
+        const std::shared_ptr<State> state{std::make_shared<State>()};
+    };
+
+    bool isDone() const;
+    /// @brief the final status once done, `IN_PROGRESS` before
+    ActionExecutionStatus getStatus() const;
+    /// @brief block until the coroutine is done
+    void wait() const;
+
+    // awaitable
+    bool await_ready() const noexcept { return isDone(); }
+    bool await_suspend(std::coroutine_handle<> handle);
+    ActionExecutionStatus await_resume() const { return getStatus(); }
+
+private:
+    explicit ActionCoroutine(std::shared_ptr<State> state)
+        : m_state(std::move(state))
+    {
+    }
+
+    std::shared_ptr<State> m_state;
+};
+
+/// @brief Awaitable resuming the coroutine on the coroutine timer thread once `duration` elapsed
+class SleepAwaitable
+{
+public:
+    explicit SleepAwaitable(std::chrono::nanoseconds duration)
+        : m_duration(duration)
+    {
+    }
+
+    bool await_ready() const noexcept { return m_duration.count() <= 0; }
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept {}
+
+private:
+    const std::chrono::nanoseconds m_duration;
+};
+
+/// @brief runs a function, e.g., in the thread pool blocking IO lane
+using BlockingExecutor = std::function<void(std::function<void()>)>;
+
+/// @brief Awaitable running a blocking call with an executor; resumes the coroutine on the executor thread with the
+/// call result. Exceptions thrown by the call are rethrown in the coroutine.
+template <typename T>
+class BlockingCallAwaitable
+{
+public:
+    BlockingCallAwaitable(BlockingExecutor executor, std::function<T()> call)
+        : m_executor(std::move(executor))
+        , m_call(std::move(call))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the awaitable lives in the suspended coroutine frame until it is resumed
+        m_executor([this, handle] {
+            try
+            {
+                m_result.emplace(m_call());
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+            handle.resume();
+        });
+    }
+
+    T await_resume()
+    {
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+        return std::move(m_result.value());
+    }
+
+private:
+    BlockingExecutor m_executor;
+    std::function<T()> m_call;
+    std::optional<T> m_result{};
+    std::exception_ptr m_error{};
+};
+
+/// @brief suspend for `duration`; the coroutine is resumed on the coroutine timer thread, so the steps following a
+/// sleep should be short, or run with `runBlocking()`
+inline SleepAwaitable sleepFor(std::chrono::nanoseconds duration)
+{
+    return SleepAwaitable(duration);
+}
+
+/**
+ * @brief Base for actions written as coroutines, see `ActionCoroutine`
+ *
+ * Each epoch, the action callable of a token only checks its coroutine, so a waiting action takes neither a thread pool
+ * worker nor any other thread. The coroutine starts in the first callable of the token. The coroutine of a cancelled
+ * execution, e.g., on timeout, is dropped; it runs to completion, but its status is discarded.
+ *
+ * Blocking calls, see `runBlocking()`, run in the blocking IO lane of the action thread pool; without a thread pool,
+ * i.e., outside an `Action`, they run on the calling thread.
+ *
+ * Coroutines still running are waited for on destruction. Implementations whose coroutines use members after their
+ * first suspension should call `waitForCoroutines()` in their own destructor, as members are destroyed before.
+ */
+class CoroutineActionImpl : public IActionImpl
+{
+public:
+    ~CoroutineActionImpl() override;
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) final;
+    std::function<ActionExecutionStatus()> createCancellableCallable(Token::ConstSharedPtr token,
+                                                                     CancellationToken const& cancellation) final;
+
+    void setThreadPool(ThreadPool& tp) final { m_threadPool = &tp; }
+
+protected:
+    virtual ActionCoroutine run(Token::ConstSharedPtr token) = 0;
+
+    /// @brief run a blocking call without holding an action worker; e.g.,
+    ///        `const auto rows = co_await runBlocking<Rows>([&] { return db.query(...); });`
+    template <typename T>
+    BlockingCallAwaitable<T> runBlocking(std::function<T()> call) const
+    {
+        return BlockingCallAwaitable<T>(getBlockingExecutor(), std::move(call));
+    }
+
+    /// @brief HTTP GET request, see `runBlocking()`
+    BlockingCallAwaitable<httplib::Result> httpGet(std::string host, int port, std::string path) const;
+
+    /// @brief run a polled action to completion; the action callable is called again every `pollPeriod` while it
+    /// returns `IN_PROGRESS`, with `runBlocking()` if the action performs blocking IO
+    ActionCoroutine awaitAction(IActionImpl& actionImpl, Token::ConstSharedPtr token,
+                                std::chrono::milliseconds pollPeriod = std::chrono::milliseconds(1)) const;
+
+    void waitForCoroutines();
+
+private:
+    BlockingExecutor getBlockingExecutor() const;
+
+    ActionExecutionStatus checkCoroutine(Token::ConstSharedPtr const& token, CancellationToken const& cancellation);
+    /// @brief forget the coroutine of `token`, if any; m_mtx must be held
+    void dropCoroutine(Token::ConstSharedPtr const& token);
+
+    ThreadPool* m_threadPool{nullptr};
+    std::mutex m_mtx;
+    // keyed by the token itself rather than its address, which a new token may reuse
+    std::unordered_map<Token::ConstSharedPtr, ActionCoroutine> m_coroutines{};
+    std::vector<ActionCoroutine> m_droppedCoroutines{}; // still running; waited for on destruction
+};
+
+} // namespace bnet
+} // namespace capybot
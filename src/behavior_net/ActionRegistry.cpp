@@ -16,6 +16,9 @@
  */
 
 #include <behavior_net/ActionRegistry.hpp>
+#include <behavior_net/Config.hpp>
+
+#include <map>
 
 namespace capybot
 {
@@ -24,5 +27,86 @@ namespace bnet
 
 ActionRegistry ActionRegistry::s_registry;
 
+namespace
+{
+/// @brief validate the dispatch options of an action config; see `Action::Options`
+/// @param cacheParams [in/out] cache params per action type; the actions of a type share their cache
+void validateActionOptions(nlohmann::json const& actionConfig,
+                           std::map<std::string, ActionResultCache::Params>& cacheParams,
+                           std::vector<std::string>& errorMessages)
+{
+    const auto placeId = actionConfig.value("place_id", "");
+    if (actionConfig.contains("timeout_ms"))
+    {
+        const auto timeoutOpt = getValueAtKey<uint32_t>(actionConfig, "timeout_ms", errorMessages);
+        if (timeoutOpt.has_value() && timeoutOpt.value() == 0U)
+        {
+            errorMessages.push_back("Invalid `timeout_ms` for the action of place `" + placeId +
+                                    "`; expected a positive integer.");
+        }
+    }
+    if (actionConfig.contains("max_concurrency"))
+    {
+        const auto limitOpt = getValueAtKey<uint32_t>(actionConfig, "max_concurrency", errorMessages);
+        if (limitOpt.has_value() && limitOpt.value() == 0U)
+        {
+            errorMessages.push_back("Invalid `max_concurrency` for the action of place `" + placeId +
+                                    "`; expected a positive integer.");
+        }
+    }
+    if (actionConfig.contains("cache"))
+    {
+        if (!actionConfig.at("cache").is_object())
+        {
+            errorMessages.push_back("Invalid `cache` for the action of place `" + placeId + "`; expected an object.");
+        }
+        else
+        {
+            const auto numberErrors = errorMessages.size();
+            validateActionResultCacheConfig(actionConfig.at("cache"), errorMessages);
+            if (errorMessages.size() == numberErrors)
+            {
+                const auto type = actionConfig.value("type", "");
+                const auto params = ActionResultCache::Params::fromConfig(actionConfig.at("cache"));
+                const auto [it, inserted] = cacheParams.emplace(type, params);
+                if (!inserted && !(it->second == params))
+                {
+                    errorMessages.push_back("Conflicting `cache` for the action of place `" + placeId +
+                                            "`; actions of type `" + type + "` share their cache and its config.");
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+bool validateActionsConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    std::map<std::string, ActionResultCache::Params> cacheParams;
+    if (netConfig.contains("controller") && netConfig.at("controller").contains("actions"))
+    {
+        for (auto&& actionConfig : netConfig.at("controller").at("actions"))
+        {
+            validateActionOptions(actionConfig, cacheParams, errorMessages);
+        }
+    }
+    if (netConfig.contains("petri_net") && netConfig.at("petri_net").contains("subnet_templates"))
+    {
+        for (auto&& templateConfig : netConfig.at("petri_net").at("subnet_templates"))
+        {
+            for (auto&& actionConfig : templateConfig.value("actions", nlohmann::json::array()))
+            {
+                validateActionOptions(actionConfig, cacheParams, errorMessages);
+            }
+        }
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateActionsConfig, "ActionsConfigValidator");
+
 } // namespace bnet
 } // namespace capybot
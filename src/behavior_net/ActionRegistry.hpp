@@ -20,6 +20,7 @@
 #include <behavior_net/Action.hpp>
 #include <map>
 #include <memory>
+#include <optional>
 
 #define REGISTER_ACTION_TYPE(actionType)                                                                               \
     static bool _registered_##actionType = ActionRegistry::registerActionType(                                         \
@@ -41,7 +42,14 @@ public:
         return success;
     }
 
-    static Action::UniquePtr create(ThreadPool& tp, std::string const& actionType, nlohmann::json const& parameters)
+    /// @param lane [optional] thread pool lane; if not set, the lane configured for `actionType` is used, or the
+    /// blocking IO lane for actions that perform blocking IO
+    /// @param caches [optional] result caches shared with the other actions of the owner; if not set, an action with a
+    /// `cache` option gets a cache of its own
+    static Action::UniquePtr create(ThreadPool& tp, std::string const& actionType, nlohmann::json const& parameters,
+                                    std::optional<ThreadPool::LaneId> lane = std::nullopt,
+                                    Action::Options const& options = Action::Options(),
+                                    ActionResultCacheRegistry* caches = nullptr)
     {
         if (s_registry.m_createFunctionMap.find(actionType) == s_registry.m_createFunctionMap.end())
         {
@@ -57,7 +65,23 @@ public:
         }
 
         auto actionImpl = s_registry.m_createFunctionMap.at(actionType)(parameters);
-        return std::make_unique<Action>(tp, actionImpl);
+        if (!lane.has_value())
+        {
+            lane = tp.getActionTypeLane(actionType);
+            if (lane.value() == ThreadPool::DEFAULT_LANE && actionImpl->performsBlockingIo())
+            {
+                lane = ThreadPool::BLOCKING_IO_LANE;
+            }
+        }
+        auto action = std::make_unique<Action>(tp, actionImpl, lane.value(), options);
+        if (options.cache.has_value())
+        {
+            // actions of the same type share one cache; their params tell their entries apart
+            action->setResultCache(caches ? caches->get(actionType, options.cache.value())
+                                          : std::make_shared<ActionResultCache>(options.cache.value()),
+                                   ActionResultCacheKey(parameters));
+        }
+        return action;
     }
 
     // static std::map<std::string, Action::UniquePtr> createActionMap(ThreadPool& tp, nlohmann::json const
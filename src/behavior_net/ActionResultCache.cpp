@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/ActionResultCache.hpp>
+#include <behavior_net/Config.hpp>
+
+#include <functional>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+void collectTokenParams(nlohmann::json const& params, std::vector<ConfigParameter<nlohmann::json>>& tokenParams)
+{
+    if (params.is_structured())
+    {
+        for (auto&& item : params)
+        {
+            collectTokenParams(item, tokenParams);
+        }
+    }
+    else if (params.is_string() && params.get<std::string>().find("@token") != std::string::npos)
+    {
+        tokenParams.emplace_back(params);
+    }
+}
+} // namespace
+
+void validateActionResultCacheConfig(nlohmann::json const& config, std::vector<std::string>& errorMessages)
+{
+    for (auto&& key : {"max_entries", "ttl_ms", "number_shards"})
+    {
+        if (config.contains(key))
+        {
+            const auto valueOpt = getValueAtKey<uint32_t>(config, key, errorMessages);
+            if (valueOpt.has_value() && valueOpt.value() == 0U)
+            {
+                errorMessages.push_back(std::string("Invalid cache `") + key + "`; expected a positive integer.");
+            }
+        }
+    }
+}
+
+ActionResultCache::Params ActionResultCache::Params::fromConfig(nlohmann::json const& config)
+{
+    Params params;
+    params.maxEntries = config.value("max_entries", params.maxEntries);
+    params.ttl = std::chrono::milliseconds(config.value("ttl_ms", static_cast<uint32_t>(params.ttl.count())));
+    params.numberShards = config.value("number_shards", params.numberShards);
+    return params;
+}
+
+ActionResultCache::ActionResultCache(Params const& params)
+    : m_params(params)
+    , m_shardCapacity(std::max<size_t>(1U, params.maxEntries / params.numberShards))
+    , m_shards(params.numberShards)
+{
+}
+
+std::optional<ActionExecutionStatus> ActionResultCache::get(Key const& key)
+{
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end())
+    {
+        return std::nullopt;
+    }
+    if (Clock::now() >= it->second->expiry)
+    {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        return std::nullopt;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->status;
+}
+
+void ActionResultCache::put(Key const& key, ActionExecutionStatus status)
+{
+    if (status != +ActionExecutionStatus::SUCCESS && status != +ActionExecutionStatus::FAILURE)
+    {
+        return;
+    }
+
+    auto& shard = getShard(key);
+    const auto expiry = Clock::now() + m_params.ttl;
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    if (const auto it = shard.index.find(key); it != shard.index.end())
+    {
+        it->second->status = status;
+        it->second->expiry = expiry;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    if (shard.lru.size() >= m_shardCapacity)
+    {
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+    }
+    shard.lru.push_front(Entry{.key = key, .status = status, .expiry = expiry});
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+}
+
+size_t ActionResultCache::size() const
+{
+    size_t numberEntries{0U};
+    for (auto&& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        numberEntries += shard.lru.size();
+    }
+    return numberEntries;
+}
+
+std::shared_ptr<ActionResultCache> ActionResultCacheRegistry::get(std::string const& actionType,
+                                                                  ActionResultCache::Params const& params)
+{
+    std::lock_guard<std::mutex> lk(m_mtx);
+    auto& cache = m_caches[actionType];
+    if (!cache)
+    {
+        cache = std::make_shared<ActionResultCache>(params);
+    }
+    else if (!(cache->getParams() == params))
+    {
+        throw Exception(ExceptionType::INVALID_CONFIG_FILE,
+                        "ActionResultCacheRegistry::get: actions of the same type have different `cache` configs.")
+            .appendMetadata("action type", actionType);
+    }
+    return cache;
+}
+
+ActionResultCacheKey::ActionResultCacheKey(nlohmann::json const& params)
+    : m_params(params.dump())
+{
+    collectTokenParams(params, m_tokenParams);
+}
+
+std::optional<ActionResultCache::Key> ActionResultCacheKey::get(Token::ConstSharedPtr const& token) const
+{
+    // dumps are single lines, so the new lines keep the key unambiguous
+    auto key = m_params;
+    for (auto&& tokenParam : m_tokenParams)
+    {
+        try
+        {
+            key += '\n' + tokenParam.get(token).dump();
+        }
+        catch (std::exception const&)
+        {
+            return std::nullopt;
+        }
+    }
+    return key;
+}
+
+} // namespace bnet
+} // namespace capybot
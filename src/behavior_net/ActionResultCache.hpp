@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/ConfigParameter.hpp>
+#include <behavior_net/Token.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Memoized final results of idempotent actions; a sharded LRU cache with a time to live
+ *
+ * Only SUCCESS and FAILURE results are cached; errors are assumed transient. Each shard has its own lock and LRU list,
+ * so concurrent lookups of different keys rarely contend. Entries store their whole key, so hash collisions never
+ * return the result of another input.
+ *
+ * Config (action `cache`, optional):
+ *    "max_entries"     [uint32_t][default: 10000] capacity, split evenly between the shards
+ *    "ttl_ms"          [uint32_t][default: 60000] time to live of an entry
+ *    "number_shards"   [uint32_t][default: 16]
+ */
+class ActionResultCache
+{
+public:
+    using Key = std::string; // canonical input, see `ActionResultCacheKey`
+    using Clock = std::chrono::steady_clock;
+
+    struct Params
+    {
+        uint32_t maxEntries{10000U};
+        std::chrono::milliseconds ttl{60000};
+        uint32_t numberShards{16U};
+
+        /// @param config `cache` config; missing entries keep their defaults
+        static Params fromConfig(nlohmann::json const& config);
+
+        bool operator==(Params const&) const = default;
+    };
+
+    explicit ActionResultCache(Params const& params);
+
+    /// @return the cached result, unless missing or expired
+    std::optional<ActionExecutionStatus> get(Key const& key);
+    /// @brief cache a final result; results other than SUCCESS and FAILURE are ignored
+    void put(Key const& key, ActionExecutionStatus status);
+
+    size_t size() const;
+    Params const& getParams() const { return m_params; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        ActionExecutionStatus status;
+        Clock::time_point expiry;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mtx;
+        std::list<Entry> lru{}; // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index{}; // views of the entry keys
+    };
+
+    Shard& getShard(Key const& key) { return m_shards[std::hash<Key>{}(key) % m_shards.size()]; }
+
+    const Params m_params;
+    const size_t m_shardCapacity;
+    std::vector<Shard> m_shards;
+};
+
+/**
+ * @brief The result caches of the actions created by one owner, e.g., a controller; one cache per action type
+ *
+ * Actions of the same type share their cache, and are told apart by their params, see `ActionResultCacheKey`.
+ */
+class ActionResultCacheRegistry
+{
+public:
+    /// @brief the cache of `actionType`, created with `params` by its first action
+    /// @throw Exception INVALID_CONFIG_FILE if the cache of `actionType` exists with other params
+    std::shared_ptr<ActionResultCache> get(std::string const& actionType, ActionResultCache::Params const& params);
+
+private:
+    std::mutex m_mtx;
+    std::unordered_map<std::string, std::shared_ptr<ActionResultCache>> m_caches{};
+};
+
+/// @brief Cache keys of one action: its params, with the `@token{...}` references resolved for each token
+class ActionResultCacheKey
+{
+public:
+    explicit ActionResultCacheKey(nlohmann::json const& params);
+
+    /// @return nullopt if a referenced token content is missing, i.e., the result is not cached
+    std::optional<ActionResultCache::Key> get(Token::ConstSharedPtr const& token) const;
+
+private:
+    std::string m_params; // dump
+    std::vector<ConfigParameter<nlohmann::json>> m_tokenParams; // in params order
+};
+
+/// @brief validate an action `cache` config; see `ActionResultCache`
+void validateActionResultCacheConfig(nlohmann::json const& config, std::vector<std::string>& errorMessages);
+
+} // namespace bnet
+} // namespace capybot
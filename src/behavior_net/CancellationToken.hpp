@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Cooperative cancellation flag, e.g., set when an action execution times out
+ *
+ * Copies share the flag. A default constructed token is never cancelled, and does not allocate.
+ */
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+
+    static CancellationToken create() { return CancellationToken(std::make_shared<State>()); }
+
+    bool isCancelled() const { return m_state && m_state->cancelled.load(); }
+
+    /// @brief set the flag, and call the `onCancel()` callbacks, once
+    void cancel() const
+    {
+        if (!m_state)
+        {
+            return;
+        }
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lk(m_state->mtx);
+            if (m_state->cancelled.exchange(true))
+            {
+                return;
+            }
+            std::swap(callbacks, m_state->callbacks);
+        }
+        for (auto&& callback : callbacks)
+        {
+            callback();
+        }
+    }
+
+    /// @brief call `callback` on cancellation, on the cancelling thread, or right away if already cancelled; never
+    /// called for default constructed tokens
+    void onCancel(std::function<void()> callback) const
+    {
+        if (!m_state)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_state->mtx);
+            if (!m_state->cancelled.load())
+            {
+                m_state->callbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+private:
+    struct State
+    {
+        std::atomic_bool cancelled{false};
+        std::mutex mtx;
+        std::vector<std::function<void()>> callbacks{};
+    };
+
+    explicit CancellationToken(std::shared_ptr<State> state)
+        : m_state(std::move(state))
+    {
+    }
+
+    std::shared_ptr<State> m_state{};
+};
+
+} // namespace bnet
+} // namespace capybot
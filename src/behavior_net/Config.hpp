@@ -48,6 +48,15 @@ public:
         validateConfig();
     }
 
+    /// @brief create config from an already parsed json object, e.g., a modified copy of another config
+    static NetConfig fromJson(nlohmann::json config)
+    {
+        NetConfig netConfig;
+        netConfig.m_config = std::move(config);
+        netConfig.validateConfig();
+        return netConfig;
+    }
+
     const nlohmann::json& get() const { return m_config; }
 
     /**
@@ -69,6 +78,8 @@ public:
     }
 
 private:
+    NetConfig() = default;
+
     nlohmann::json m_config;
 
     void validateConfig()
@@ -24,27 +24,122 @@ namespace capybot
 namespace bnet
 {
 
+namespace
+{
+Token::UniquePtr createToken(nlohmann::json const& contentBlocks)
+{
+    auto token = Token::makeUnique();
+    for (nlohmann::json::const_iterator it = contentBlocks.begin(); it != contentBlocks.end(); ++it)
+    {
+        token->addContentBlock(it.key(), it.value());
+    }
+    return token;
+}
+
+std::unique_ptr<ThreadPool> createThreadPool(nlohmann::json const& controllerConfig)
+{
+    auto tp = std::make_unique<ThreadPool>(
+        controllerConfig.at("thread_poll_workers").get<uint32_t>(),
+        ElasticWorkerPool::Params::fromConfig(controllerConfig.value("blocking_io_pool", nlohmann::json::object())),
+        CpuPlacement::fromConfig(controllerConfig.value("cpu_affinity", nlohmann::json::object()),
+                                 "thread_pool_workers"));
+    if (controllerConfig.contains("thread_pool_lanes"))
+    {
+        tp->addLanes(controllerConfig.at("thread_pool_lanes"));
+    }
+    return tp;
+}
+} // namespace
+
 Controller::Controller(NetConfig const& config, std::unique_ptr<PetriNet> petriNet)
-    : m_tp(config.get().at("controller").at("thread_poll_workers").get<uint32_t>())
+    : m_ownedTp(createThreadPool(config.get().at("controller")))
+    , m_tp(*m_ownedTp)
     , m_config(config.get().at("controller"))
     , m_net(std::move(petriNet))
-    , m_server(IServer::create(config.get().at("controller"), createCallbacks()))
+    , m_server(IServer::create(config.get().at("controller"), getCallbacks()))
+    , m_scheduler(m_net->getTransitions(), m_config)
+    , m_epochClock(m_config)
 {
-    Place::Factory::createActions(m_tp, config.get().at("controller").at("actions"), m_net->getPlaces());
+    init(config);
+}
+
+Controller::Controller(NetConfig const& config, std::unique_ptr<PetriNet> petriNet, ThreadPool& tp)
+    : m_tp(tp)
+    , m_config(config.get().at("controller"))
+    , m_net(std::move(petriNet))
+    , m_scheduler(m_net->getTransitions(), m_config)
+    , m_epochClock(m_config)
+{
+    if (m_config.contains("http_server"))
+    {
+        LOG(WARN) << "Hosted controller: ignoring `controller/http_server`; requests are routed by the host."
+                  << log::endl;
+    }
+    if (m_config.contains("thread_pool_lanes") || m_config.contains("blocking_io_pool"))
+    {
+        LOG(WARN) << "Hosted controller: ignoring `controller/thread_pool_lanes` and `controller/blocking_io_pool`; "
+                     "lanes are configured by the host."
+                  << log::endl;
+    }
+    init(config);
+}
+
+void Controller::init(NetConfig const& config)
+{
+    m_loopPlacement =
+        CpuPlacement::fromConfig(m_config.value("cpu_affinity", nlohmann::json::object()), "controller_loop");
+    m_maxConcurrentActions = getMaxConcurrentActions(m_config);
+    m_net->setActionThreadPool(m_tp, &m_actionResultCaches);
+    if (m_config.contains("partition"))
+    {
+        m_partition = std::make_unique<NetPartition>(m_config.at("partition"), m_net->getPlaces());
+    }
+    if (m_config.contains("sharding"))
+    {
+        m_shardedScheduler = std::make_unique<ShardedTransitionScheduler>(m_net->getTransitions(), m_config);
+    }
+    Place::Factory::createActions(m_tp, config.get().at("controller").at("actions"), m_net->getPlaces(),
+                                  &m_actionResultCaches);
+
+    if (m_config.contains("event_trace"))
+    {
+        m_recorder = std::make_unique<EventTraceRecorder>(
+            m_config.at("event_trace").at("record_path").get<std::string>(),
+            m_config.at("epoch_period_ms").get<uint32_t>());
+    }
+    m_epochFiredTransitions.reserve(m_net->getTransitions().size());
 }
 
 void Controller::addToken(nlohmann::json const& contentBlocks, std::string_view placeId)
 {
     LOG(DEBUG) << "addToken @ " << placeId << "; content = " << contentBlocks << log::endl;
 
-    auto token = Token::makeUnique();
-    for (nlohmann::json::const_iterator it = contentBlocks.begin(); it != contentBlocks.end(); ++it)
+    auto token = createToken(contentBlocks);
+
     {
-        token->addContentBlock(it.key(), it.value());
+        std::lock_guard<std::mutex> lk(m_netMtx);
+        m_net->addToken(token, placeId);
+        if (m_recorder)
+        {
+            m_recorder->recordAddToken(placeId, contentBlocks);
+        }
+
+        m_net->prettyPrintState();
     }
-    m_net->addToken(token, placeId);
+    m_epochClock.wakeUp();
+}
 
-    m_net->prettyPrintState();
+void Controller::triggerManualTransition(std::string_view id)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_netMtx);
+        m_net->triggerTransition(id, true);
+        if (m_recorder)
+        {
+            m_recorder->recordManualTrigger(id);
+        }
+    }
+    m_epochClock.wakeUp();
 }
 
 void Controller::run()
@@ -63,11 +158,31 @@ void Controller::run()
     {
         m_server->start();
     }
+    if (m_partition)
+    {
+        m_partition->start();
+    }
+    if (m_loopPlacement)
+    {
+        // pinned after starting the server and partition threads, so they do not inherit it
+        m_loopPlacement->applyToCurrentThread("controller loop");
+    }
+    if (m_epochClock.getRealtimePriority())
+    {
+        EpochClock::setCurrentThreadRealtimePriority(m_epochClock.getRealtimePriority().value());
+    }
+
+    m_epochClock.restart();
     while (m_running.load())
     {
         // TODO: cli arg to activate m_net->prettyPrintState();
         runEpoch();
     }
+
+    const auto stats = m_epochClock.getStats();
+    LOG(INFO) << "run: stopped; deadlines = " << stats.deadlines << "; overruns = " << stats.overruns
+              << "; max lateness = " << stats.maxLateness.count() << " us; p99 lateness = " << stats.p99Lateness.count()
+              << " us" << log::endl;
 }
 
 void Controller::runDetached()
@@ -88,6 +203,10 @@ void Controller::stop()
     {
         m_server->stop();
     }
+    if (m_partition)
+    {
+        m_partition->stop();
+    }
     if (m_runDetachedThread.joinable())
     {
         m_runDetachedThread.join();
@@ -98,45 +217,245 @@ void Controller::runEpoch()
 {
     SCOPED_LOG_TRACER("runEpoch");
 
-    const uint32_t periodMs = m_config.at("epoch_period_ms").get<uint32_t>();
-
     // execute all actions
-    for (auto&& [_, place] : m_net->getPlaces())
+    ThreadPool::CompletionCounter::SharedPtr epochCompletion;
+    if (m_epochClock.hasEarlyResultCollection())
+    {
+        epochCompletion = std::make_shared<ThreadPool::CompletionCounter>(
+            [this, generation = m_epochClock.getWaitGeneration()] { m_epochClock.endWait(generation); });
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_netMtx);
+        if (m_partition)
+        {
+            applyPartitionInputs();
+        }
+        dispatchActions(epochCompletion);
+        setEpochPosition(m_epoch, EpochPhase::WAITING);
+    }
+    if (epochCompletion)
+    {
+        epochCompletion->seal();
+    }
+
+    // wait, until the deadline or until all the dispatched actions finished
+    if (!m_epochClock.sleepUntilNextDeadline())
+    {
+        LOG(DEBUG) << "runEpoch: epoch " << m_epoch << " overran its deadline" << log::endl;
+    }
+    if (epochCompletion)
+    {
+        epochCompletion->disarm(); // nobody waits for the group anymore; see `EpochClock::endWait()` too
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(m_netMtx);
+
+        // wait for tasks to complete
+        uint32_t numberCompletedActions{0U};
+        for (auto&& [_, place] : m_net->getPlaces())
+        {
+            numberCompletedActions += place->checkActionResults(m_recorder.get());
+        }
+
+        fireAutoTransitions();
+        m_epochClock.adaptPeriod(numberCompletedActions > 0U || !m_epochFiredTransitions.empty());
+
+        if (m_recorder)
+        {
+            for (auto&& t : m_epochFiredTransitions)
+            {
+                m_recorder->recordTransitionFired(t->getId());
+            }
+            m_recorder->recordEpochPeriod(m_epoch + 1, m_epochClock.getPeriod()); // adapted above
+            m_recorder->flush();
+        }
+        if (m_partition)
+        {
+            m_partition->collectOutgoing();
+        }
+        setEpochPosition(m_epoch + 1, EpochPhase::IDLE);
+    }
+
+    // sent without holding the net, as peers may be slow or down
+    if (m_partition)
     {
-        place->executeActionAsync();
+        m_partition->sendOutgoing();
     }
+}
 
-    // wait
-    std::this_thread::sleep_for(std::chrono::milliseconds(periodMs)); // TODO: sleep until
+void Controller::dispatchActions(ThreadPool::CompletionCounter::SharedPtr const& epochCompletion)
+{
+    if (!m_maxConcurrentActions)
+    {
+        for (auto&& [_, place] : m_net->getPlaces())
+        {
+            place->executeActionAsync(epochCompletion);
+        }
+        return;
+    }
 
-    // wait for tasks to complete
+    // excess tokens stay busy in their places, so the executor queues stay bounded
+    uint32_t numberInFlight{0U};
+    m_admissionDemands.clear();
     for (auto&& [_, place] : m_net->getPlaces())
     {
-        place->checkActionResults();
+        if (!place->isPassive())
+        {
+            numberInFlight += place->getAction()->getNumberInFlight();
+        }
+        m_admissionDemands.push_back(place->getNumberAdmissibleTokens());
     }
+    const uint32_t budget =
+        numberInFlight >= m_maxConcurrentActions.value() ? 0U : m_maxConcurrentActions.value() - numberInFlight;
+    const auto grants = shareFairly(m_admissionDemands, budget, m_epoch);
 
-    // fire all enabled auto transitions
-    for (auto&& t : m_net->getTransitions())
+    size_t index{0U};
+    for (auto&& [_, place] : m_net->getPlaces())
     {
-        if (t.isManual())
-            continue;
+        place->executeActionAsync(epochCompletion, grants[index++]);
+    }
+}
 
-        // current logic is to trigger a transition only once per epoch
-        // TODO: this should be configurable as this logic does not fulfill all use cases
-        if (t.isEnabled())
+void Controller::applyPartitionInputs()
+{
+    auto incoming = m_partition->takeIncoming();
+    while (!incoming.empty())
+    {
+        auto const& transfer = incoming.front();
+        auto token = createToken(transfer.contentBlocks);
+        try
+        {
+            m_net->addToken(token, transfer.placeId);
+        }
+        catch (Exception const& e)
+        {
+            if (e.type() != +ExceptionType::CAPACITY_EXCEEDED)
+            {
+                LOG(ERROR) << "applyPartitionInputs: dropping token for place " << transfer.placeId
+                           << "; error = " << e.what() << log::endl;
+                incoming.pop_front();
+                continue;
+            }
+            // backpressure: the place is full, retry the remaining tokens next epoch, in order
+            m_partition->restoreIncoming(std::move(incoming));
+            return;
+        }
+        if (m_recorder)
         {
-            t.trigger();
+            m_recorder->recordAddToken(transfer.placeId, transfer.contentBlocks);
         }
+        incoming.pop_front();
+    }
+}
+
+ReplayReport Controller::replay(EventTrace const& trace)
+{
+    SCOPED_LOG_TRACER("replay");
+
+    if (m_running.load())
+    {
+        throw Exception(ExceptionType::LOGIC_ERROR, "[Controller::replay] cannot replay while running.");
+    }
+
+    const auto applyInput = [this](TraceEvent const& event) {
+        if (event.type == +TraceEventType::ADD_TOKEN)
+        {
+            auto token = createToken(event.content);
+            m_net->addToken(token, event.id);
+        }
+        else
+        {
+            m_net->triggerTransition(event.id, true);
+        }
+    };
+
+    static const EventTrace::Epoch noEvents{};
+    ReplayReport report;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    auto epochIt = trace.getEpochs().begin();
+    for (uint64_t epoch = 0U; epoch <= trace.getLastEpoch(); ++epoch)
+    {
+        const bool hasEvents = epochIt != trace.getEpochs().end() && epochIt->first == epoch;
+        auto const& events = hasEvents ? epochIt->second : noEvents;
+
+        setEpochPosition(epoch, EpochPhase::IDLE);
+        for (auto&& event : events.idleInputs)
+        {
+            applyInput(event);
+        }
+
+        // actions are not dispatched - their results come from the trace
+        setEpochPosition(epoch, EpochPhase::WAITING);
+        for (auto&& event : events.waitingInputs)
+        {
+            applyInput(event);
+        }
+
+        for (auto&& event : events.actionResults)
+        {
+            m_net->getPlaces().at(event.id)->applyActionResult(event.busyIndex, event.status);
+        }
+
+        fireAutoTransitions();
+        report.transitionsFired += m_epochFiredTransitions.size();
+
+        const bool diverged =
+            !std::equal(m_epochFiredTransitions.begin(), m_epochFiredTransitions.end(),
+                        events.firedTransitions.begin(), events.firedTransitions.end(),
+                        [](Transition const* t, std::string const& id) { return t->getId() == id; });
+        if (diverged)
+        {
+            ++report.divergentEpochs;
+            LOG(WARN) << "replay: fired transitions diverge from trace at epoch " << epoch << log::endl;
+        }
+
+        if (hasEvents)
+        {
+            ++epochIt;
+        }
+    }
+    setEpochPosition(trace.getLastEpoch() + 1, EpochPhase::IDLE);
+
+    report.epochs = trace.getEpochs().empty() ? 0U : trace.getLastEpoch() + 1;
+    report.virtualTime = std::chrono::duration_cast<std::chrono::milliseconds>(trace.getVirtualTime(report.epochs));
+    report.wallTime = std::chrono::steady_clock::now() - start;
+    return report;
+}
+
+void Controller::fireAutoTransitions()
+{
+    if (m_shardedScheduler)
+    {
+        m_shardedScheduler->fireEnabled(m_epochFiredTransitions);
+    }
+    else
+    {
+        m_scheduler.fireEnabled(m_epochFiredTransitions);
+    }
+}
+
+void Controller::setEpochPosition(uint64_t epoch, EpochPhase phase)
+{
+    m_epoch = epoch;
+    if (m_recorder)
+    {
+        m_recorder->setPosition(epoch, phase);
     }
 }
 
-ControllerCallbacks Controller::createCallbacks()
+ControllerCallbacks Controller::getCallbacks()
 {
     return ControllerCallbacks{
         .addToken = [this](nlohmann::json const& contentBlocks,
                            std::string_view placeId) { addToken(contentBlocks, placeId); },
-        .getNetMarking = [this]() -> nlohmann::json { return getNet().getMarking(); },
-        .triggerManualTransition = [this](std::string_view const& id) { getNet().triggerTransition(id, true); }};
+        .getNetMarking = [this]() -> nlohmann::json {
+            std::lock_guard<std::mutex> lk(m_netMtx);
+            return getNet().getMarking();
+        },
+        .triggerManualTransition = [this](std::string_view const& id) { triggerManualTransition(id); }};
 }
 
 } // namespace bnet
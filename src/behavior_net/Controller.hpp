@@ -19,14 +19,24 @@
 
 #include <3rd_party/better_enums/enums.h>
 #include <behavior_net/Action.hpp>
+#include <behavior_net/ActionAdmission.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+#include <behavior_net/EpochClock.hpp>
+#include <behavior_net/EventTrace.hpp>
+#include <behavior_net/NetPartition.hpp>
 #include <behavior_net/PetriNet.hpp>
+#include <behavior_net/ShardedTransitionScheduler.hpp>
+#include <behavior_net/TransitionScheduler.hpp>
 
 #include <3rd_party/cpp-httplib/httplib.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 
 namespace capybot
 {
@@ -50,10 +60,24 @@ public:
     static std::unique_ptr<IServer> create(nlohmann::json const& controllerConfig,
                                            ControllerCallbacks const& controllerCbs);
 
+    /// @brief server routing requests to several nets by net id, e.g., `/nets/<net_id>/add_token`
+    /// @param hostConfig config with an optional `http_server` entry, i.e., the same format as the controller one
+    static std::unique_ptr<IServer> create(nlohmann::json const& hostConfig,
+                                           std::map<std::string, ControllerCallbacks> const& netCbs);
+
     virtual void start() = 0;
     virtual void stop() = 0;
 };
 
+struct ReplayReport
+{
+    uint64_t epochs{0U};
+    uint64_t transitionsFired{0U};
+    uint64_t divergentEpochs{0U}; // epochs in which the fired transitions differ from the recorded ones
+    std::chrono::milliseconds virtualTime{0};
+    std::chrono::nanoseconds wallTime{0};
+};
+
 class Controller
 {
     static constexpr const char* MODULE_TAG{"Controller"};
@@ -61,10 +85,21 @@ class Controller
 public:
     Controller(NetConfig const& config, std::unique_ptr<PetriNet> petriNet);
 
+    /**
+     * @brief Controller of a net hosted along other nets, e.g., by a `MultiNetController`
+     *
+     * Actions run on the shared `tp`, and `controller/thread_poll_workers`, `controller/thread_pool_lanes` and
+     * `controller/blocking_io_pool` are ignored; action `lane` entries refer to the lanes of `tp`. The controller has
+     * no server of its own; the host routes requests to it through `getCallbacks()`.
+     */
+    Controller(NetConfig const& config, std::unique_ptr<PetriNet> petriNet, ThreadPool& tp);
+
     ~Controller() { stop(); }
 
     void addToken(nlohmann::json const& contentBlocks, std::string_view placeId);
 
+    void triggerManualTransition(std::string_view id);
+
     void run();
 
     void runDetached();
@@ -73,20 +108,62 @@ public:
 
     void runEpoch();
 
+    /**
+     * @brief Replay a recorded event trace in virtual time, i.e., as fast as possible
+     *
+     * Actions are not executed; their results are taken from the trace. External inputs are applied at the same epoch
+     * phase they were recorded at, so the net takes the same firing decisions as the recorded run.
+     */
+    ReplayReport replay(EventTrace const& trace);
+
+    /// @brief epoch deadline statistics, e.g., overruns and wake up jitter; thread safe
+    EpochClock::Stats getEpochStats() const { return m_epochClock.getStats(); }
+
     PetriNet const& getNet() const { return *m_net; }
     PetriNet& getNet() { return *m_net; }
 
+    /// @brief callbacks used by servers to interact with the net
+    ControllerCallbacks getCallbacks();
+
 private:
-    ControllerCallbacks createCallbacks();
+    /// @brief set up shared by all constructors, once the thread pool and the net exist
+    void init(NetConfig const& config);
+
+    /// @brief fire enabled auto transitions in `m_scheduler` order, or in parallel shards if sharded; fired transitions
+    /// are stored in `m_epochFiredTransitions`
+    void fireAutoTransitions();
+
+    /// @brief [m_netMtx must be held] add the tokens received from peer partitions to the net
+    void applyPartitionInputs();
+
+    /// @brief [m_netMtx must be held] dispatch the actions of all places, within `max_concurrent_actions` if set
+    void dispatchActions(ThreadPool::CompletionCounter::SharedPtr const& epochCompletion);
+
+    /// @brief [m_netMtx must be held] move to the given epoch and epoch phase
+    void setEpochPosition(uint64_t epoch, EpochPhase phase);
 
-    ThreadPool m_tp;
+    std::unique_ptr<ThreadPool> m_ownedTp; // null if the thread pool is shared with other controllers
+    ThreadPool& m_tp;
     nlohmann::json const& m_config;
 
     std::atomic_bool m_running{false};
     std::thread m_runDetachedThread;
 
+    ActionResultCacheRegistry m_actionResultCaches; // shared by the actions of this controller only
     std::unique_ptr<PetriNet> m_net;
     std::unique_ptr<IServer> m_server;
+    TransitionScheduler m_scheduler;
+    std::unique_ptr<ShardedTransitionScheduler> m_shardedScheduler; // replaces `m_scheduler` if the net is sharded
+
+    std::mutex m_netMtx; // serializes external inputs with the epoch execution; released while waiting for actions
+    EpochClock m_epochClock;
+    uint64_t m_epoch{0U};
+    std::vector<Transition const*> m_epochFiredTransitions;
+    std::unique_ptr<EventTraceRecorder> m_recorder;
+    std::unique_ptr<NetPartition> m_partition; // set if the net is split across several controller processes
+    std::optional<CpuPlacement> m_loopPlacement; // cores the `run()` thread is pinned to
+    std::optional<uint32_t> m_maxConcurrentActions; // global action admission limit, see `shareFairly()`
+    std::vector<uint32_t> m_admissionDemands;
 };
 
 } // namespace bnet
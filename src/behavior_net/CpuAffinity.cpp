@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Config.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+constexpr const char* MODULE_TAG{"CpuAffinity"};
+
+constexpr int MPOL_PREFERRED_MODE{1}; // see `set_mempolicy(2)`; avoids depending on libnuma headers
+constexpr uint32_t MAX_NUMA_NODES{1024U};
+
+std::optional<uint32_t> parseUint(std::string_view str)
+{
+    uint32_t value{0U};
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<std::vector<uint32_t>> getNumaNodeCpus(uint32_t numaNode)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(numaNode) + "/cpulist");
+    std::string cpuList;
+    if (!file || !std::getline(file, cpuList))
+    {
+        return std::nullopt;
+    }
+    return parseCpuList(cpuList);
+}
+} // namespace
+
+std::optional<std::vector<uint32_t>> parseCpuList(std::string_view cpuList)
+{
+    std::vector<uint32_t> cpus;
+    size_t rangeBegin{0U};
+    while (true)
+    {
+        const auto rangeEnd = cpuList.find(',', rangeBegin);
+        const auto range = cpuList.substr(rangeBegin, rangeEnd == std::string_view::npos ? rangeEnd
+                                                                                          : rangeEnd - rangeBegin);
+
+        const auto dash = range.find('-');
+        const auto first = parseUint(range.substr(0U, dash));
+        const auto last = dash == std::string_view::npos ? first : parseUint(range.substr(dash + 1U));
+        if (!first.has_value() || !last.has_value() || last.value() < first.value() ||
+            last.value() >= static_cast<uint32_t>(CPU_SETSIZE))
+        {
+            return std::nullopt;
+        }
+        for (uint32_t cpu = first.value(); cpu <= last.value(); ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+
+        if (rangeEnd == std::string_view::npos)
+        {
+            return cpus;
+        }
+        rangeBegin = rangeEnd + 1U;
+    }
+}
+
+void validateCpuAffinityConfig(nlohmann::json const& config, std::vector<std::string> const& allowedKeys,
+                               std::vector<std::string>& errorMessages)
+{
+    if (!config.is_object())
+    {
+        errorMessages.push_back("Invalid `cpu_affinity`; expected an object.");
+        return;
+    }
+    for (auto&& [key, placement] : config.items())
+    {
+        if (std::find(allowedKeys.begin(), allowedKeys.end(), key) == allowedKeys.end())
+        {
+            errorMessages.push_back("Unknown `cpu_affinity` entry `" + key + "`.");
+            continue;
+        }
+        if (placement.contains("cpus") == placement.contains("numa_node"))
+        {
+            errorMessages.push_back("Expected exactly one of `cpus` and `numa_node` in `cpu_affinity/" + key + "`.");
+            continue;
+        }
+        if (placement.contains("cpus"))
+        {
+            const auto cpusOpt = getValueAtKey<std::string>(placement, "cpus", errorMessages);
+            if (cpusOpt.has_value() && !parseCpuList(cpusOpt.value()).has_value())
+            {
+                errorMessages.push_back("Invalid cpu list `" + cpusOpt.value() + "` in `cpu_affinity/" + key +
+                                        "`; expected e.g. \"0-3,8\".");
+            }
+        }
+        else
+        {
+            std::ignore = getValueAtKey<uint32_t>(placement, "numa_node", errorMessages);
+        }
+    }
+}
+
+bool validateNetCpuAffinityConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (netConfig.contains("controller") && netConfig.at("controller").contains("cpu_affinity"))
+    {
+        validateCpuAffinityConfig(netConfig.at("controller").at("cpu_affinity"),
+                                  {"controller_loop", "http_server", "thread_pool_workers", "shard_workers"},
+                                  errorMessages);
+    }
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateNetCpuAffinityConfig, "CpuAffinityConfigValidator");
+
+std::optional<CpuPlacement> CpuPlacement::fromConfig(nlohmann::json const& config, std::string const& key)
+{
+    if (!config.contains(key))
+    {
+        return std::nullopt;
+    }
+    auto const& placementConfig = config.at(key);
+
+    CpuPlacement placement;
+    if (placementConfig.contains("numa_node"))
+    {
+        placement.numaNode = placementConfig.at("numa_node").get<uint32_t>();
+        if (placement.numaNode.value() >= MAX_NUMA_NODES)
+        {
+            throw Exception(ExceptionType::INVALID_CONFIG_FILE, "CpuPlacement::fromConfig: invalid NUMA node.")
+                .appendMetadata("placement", key)
+                .appendMetadata("numa_node", placement.numaNode.value());
+        }
+        const auto cpusOpt = getNumaNodeCpus(placement.numaNode.value());
+        if (!cpusOpt.has_value())
+        {
+            throw Exception(ExceptionType::INVALID_CONFIG_FILE, "CpuPlacement::fromConfig: NUMA node not found.")
+                .appendMetadata("placement", key)
+                .appendMetadata("numa_node", placement.numaNode.value());
+        }
+        placement.cpus = cpusOpt.value();
+    }
+    else
+    {
+        const auto cpusOpt = parseCpuList(placementConfig.at("cpus").get<std::string>());
+        if (!cpusOpt.has_value())
+        {
+            throw Exception(ExceptionType::INVALID_CONFIG_FILE, "CpuPlacement::fromConfig: invalid cpu list.")
+                .appendMetadata("placement", key)
+                .appendMetadata("cpus", placementConfig.at("cpus"));
+        }
+        placement.cpus = cpusOpt.value();
+    }
+    return placement;
+}
+
+bool CpuPlacement::applyToCurrentThread(std::string_view threadName) const
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto&& cpu : cpus)
+    {
+        CPU_SET(cpu, &cpuSet);
+    }
+    if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet); err != 0)
+    {
+        LOG(ERROR) << "Failed to pin " << threadName << " thread; error = " << err << log::endl;
+        return false;
+    }
+
+    if (numaNode.has_value())
+    {
+        constexpr uint32_t BITS_PER_WORD{8U * sizeof(unsigned long)};
+        std::vector<unsigned long> nodeMask(MAX_NUMA_NODES / BITS_PER_WORD, 0UL);
+        nodeMask[numaNode.value() / BITS_PER_WORD] |= 1UL << (numaNode.value() % BITS_PER_WORD);
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, nodeMask.data(), MAX_NUMA_NODES) != 0)
+        {
+            LOG(WARN) << "Failed to set the preferred NUMA node of " << threadName << " thread; errno = " << errno
+                      << log::endl;
+            return false;
+        }
+    }
+
+    LOG(DEBUG) << "Pinned " << threadName << " thread to " << cpus.size() << " cpus" << log::endl;
+    return true;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Set of cores a thread is pinned to, given either as a cpu list or as a NUMA node
+ *
+ * Placement config, e.g., `{"cpus": "0-3,8"}` or `{"numa_node": 1}`. With a NUMA node, the thread also prefers memory
+ * of that node, so data first touched by the thread, e.g., tokens created by the controller loop, is node local.
+ *
+ * Controller config (`controller/cpu_affinity`, optional; each entry is optional):
+ *    "controller_loop"     [placement] thread running the controller epochs
+ *    "http_server"         [placement] server threads
+ *    "thread_pool_workers" [placement] thread pool workers of all lanes
+ *    "shard_workers"       [placement] sharded transition scheduler workers; default: "controller_loop"
+ */
+struct CpuPlacement
+{
+    std::vector<uint32_t> cpus{};
+    std::optional<uint32_t> numaNode{};
+
+    /// @return the placement at `key` of a `cpu_affinity` config, or nullopt if not configured
+    /// @throw Exception INVALID_CONFIG_FILE if the placement is invalid or the NUMA node does not exist
+    static std::optional<CpuPlacement> fromConfig(nlohmann::json const& config, std::string const& key);
+
+    /// @brief pin the calling thread; failures are logged, as the thread still works unpinned
+    /// @return true on success
+    bool applyToCurrentThread(std::string_view threadName) const;
+};
+
+/// @brief parse a cpu list as in `/sys/devices/system/node/node<N>/cpulist`, e.g., "0-3,8"
+/// @return nullopt if `cpuList` is malformed
+std::optional<std::vector<uint32_t>> parseCpuList(std::string_view cpuList);
+
+/// @brief validate a `cpu_affinity` config; see `CpuPlacement`
+/// @param allowedKeys placements that can be configured
+/// @param errorMessages [output] found errors are appended to it
+void validateCpuAffinityConfig(nlohmann::json const& config, std::vector<std::string> const& allowedKeys,
+                               std::vector<std::string>& errorMessages);
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/ElasticWorkerPool.hpp>
+
+namespace capybot
+{
+namespace bnet
+{
+
+ElasticWorkerPool::Params ElasticWorkerPool::Params::fromConfig(nlohmann::json const& config)
+{
+    Params params;
+    params.maxWorkers = config.value("max_workers", params.maxWorkers);
+    params.idleTimeout =
+        std::chrono::milliseconds(config.value("idle_timeout_ms", static_cast<uint32_t>(params.idleTimeout.count())));
+    return params;
+}
+
+void validateElasticWorkerPoolConfig(nlohmann::json const& config, std::vector<std::string>& errorMessages)
+{
+    if (config.contains("max_workers"))
+    {
+        const auto maxWorkersOpt = getValueAtKey<uint32_t>(config, "max_workers", errorMessages);
+        if (maxWorkersOpt.has_value() && maxWorkersOpt.value() == 0U)
+        {
+            errorMessages.push_back("Invalid `max_workers`; expected at least one worker.");
+        }
+    }
+    if (config.contains("idle_timeout_ms"))
+    {
+        std::ignore = getValueAtKey<uint32_t>(config, "idle_timeout_ms", errorMessages);
+    }
+}
+
+bool validateNetElasticWorkerPoolConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (netConfig.contains("controller") && netConfig.at("controller").contains("blocking_io_pool"))
+    {
+        validateElasticWorkerPoolConfig(netConfig.at("controller").at("blocking_io_pool"), errorMessages);
+    }
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateNetElasticWorkerPoolConfig, "BlockingIoPoolConfigValidator");
+
+ElasticWorkerPool::ElasticWorkerPool(Params const& params)
+    : m_params(params)
+{
+}
+
+ElasticWorkerPool::~ElasticWorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_stopping = true;
+        m_taskCondition.notify_all();
+        m_exitCondition.wait(lk, [this] { return m_workers.empty(); }); // workers drain the queue before exiting
+    }
+    joinExitedWorkers();
+}
+
+void ElasticWorkerPool::execute(std::function<void()> task)
+{
+    joinExitedWorkers();
+
+    std::lock_guard<std::mutex> lk(m_mtx);
+    m_tasks.push_back(std::move(task));
+    if (m_tasks.size() > m_numberIdle && m_workers.size() < m_params.maxWorkers)
+    {
+        std::thread worker(&ElasticWorkerPool::runWorker, this);
+        const auto workerId = worker.get_id();
+        m_workers.emplace(workerId, std::move(worker));
+    }
+    else
+    {
+        m_taskCondition.notify_one();
+    }
+}
+
+size_t ElasticWorkerPool::getNumberWorkers() const
+{
+    std::lock_guard<std::mutex> lk(m_mtx);
+    return m_workers.size();
+}
+
+void ElasticWorkerPool::runWorker()
+{
+    if (m_params.workerPrologue)
+    {
+        m_params.workerPrologue();
+    }
+
+    std::unique_lock<std::mutex> lk(m_mtx);
+    while (true)
+    {
+        ++m_numberIdle;
+        const bool hasTask = m_taskCondition.wait_for(lk, m_params.idleTimeout,
+                                                      [this] { return m_stopping || !m_tasks.empty(); });
+        --m_numberIdle;
+        if (!hasTask || m_tasks.empty()) // idle for too long, or stopping with no tasks left
+        {
+            break;
+        }
+
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lk.unlock();
+        task();
+        lk.lock();
+    }
+
+    // the spawning thread registers the worker while holding the lock, so it is already in the map
+    auto node = m_workers.extract(std::this_thread::get_id());
+    m_exitedWorkers.push_back(std::move(node.mapped()));
+    m_exitCondition.notify_all();
+}
+
+void ElasticWorkerPool::joinExitedWorkers()
+{
+    std::vector<std::thread> exited;
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        exited.swap(m_exitedWorkers);
+    }
+    for (auto&& worker : exited)
+    {
+        worker.join();
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
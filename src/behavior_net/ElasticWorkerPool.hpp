@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Thread pool for blocking calls, e.g., network requests, that grows under load and shrinks when idle
+ *
+ * A new worker is spawned whenever there are more queued tasks than idle workers, up to `maxWorkers`. Workers exit
+ * after being idle for `idleTimeout`. Blocked workers only wait, so they do not take cores from compute workers.
+ *
+ * Config (`controller/blocking_io_pool`, optional):
+ *    "max_workers"     [uint32_t][default: 64] maximum number of workers
+ *    "idle_timeout_ms" [uint32_t][default: 1000] idle time after which a worker exits
+ */
+class ElasticWorkerPool
+{
+    static constexpr const char* MODULE_TAG{"ElasticWorkerPool"};
+
+public:
+    struct Params
+    {
+        uint32_t maxWorkers{64U};
+        std::chrono::milliseconds idleTimeout{1000};
+        std::function<void()> workerPrologue{}; // [optional] called by each new worker, e.g., to pin it
+
+        /// @param config `blocking_io_pool` config; missing entries keep their defaults
+        static Params fromConfig(nlohmann::json const& config);
+    };
+
+    explicit ElasticWorkerPool(Params const& params);
+
+    /// @brief waits for all queued tasks
+    ~ElasticWorkerPool();
+
+    void execute(std::function<void()> task);
+
+    size_t getNumberWorkers() const;
+
+private:
+    void runWorker();
+    void joinExitedWorkers();
+
+    const Params m_params;
+
+    mutable std::mutex m_mtx;
+    std::condition_variable m_taskCondition;
+    std::condition_variable m_exitCondition;
+    std::deque<std::function<void()>> m_tasks{};
+    std::map<std::thread::id, std::thread> m_workers{};
+    std::vector<std::thread> m_exitedWorkers{}; // exited, but not joined yet
+    size_t m_numberIdle{0U};
+    bool m_stopping{false};
+};
+
+/// @brief validate a `blocking_io_pool` config; see `ElasticWorkerPool`
+void validateElasticWorkerPoolConfig(nlohmann::json const& config, std::vector<std::string>& errorMessages);
+
+} // namespace bnet
+} // namespace capybot
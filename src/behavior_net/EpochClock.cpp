@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Config.hpp>
+#include <behavior_net/EpochClock.hpp>
+
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateEpochSchedulingConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("epoch_scheduling"))
+    {
+        return true; // default scheduling
+    }
+    auto const& schedulingConfig = netConfig.at("controller").at("epoch_scheduling");
+
+    if (schedulingConfig.contains("overrun_policy"))
+    {
+        const auto policyStrOpt = getValueAtKey<std::string>(schedulingConfig, "overrun_policy", errorMessages);
+        if (policyStrOpt.has_value() && !EpochOverrunPolicy::_from_string_nocase_nothrow(policyStrOpt.value().c_str()))
+        {
+            errorMessages.push_back("Invalid epoch overrun policy `" + policyStrOpt.value() + "`.");
+        }
+    }
+    if (schedulingConfig.contains("realtime_priority"))
+    {
+        const auto priorityOpt = getValueAtKey<int>(schedulingConfig, "realtime_priority", errorMessages);
+        if (priorityOpt.has_value() && (priorityOpt.value() < 1 || priorityOpt.value() > 99))
+        {
+            errorMessages.push_back("Invalid `realtime_priority`; expected a value in [1, 99].");
+        }
+    }
+    if (schedulingConfig.contains("adaptive"))
+    {
+        auto const& adaptiveConfig = schedulingConfig.at("adaptive");
+        const auto minOpt = getValueAtKey<uint32_t>(adaptiveConfig, "min_period_ms", errorMessages);
+        const auto maxOpt = getValueAtKey<uint32_t>(adaptiveConfig, "max_period_ms", errorMessages);
+        const auto periodOpt = getValueAtPath<uint32_t>(netConfig, {"controller", "epoch_period_ms"}, errorMessages);
+        if (minOpt.has_value() && maxOpt.has_value() && periodOpt.has_value() &&
+            (minOpt.value() == 0U || minOpt.value() > periodOpt.value() || periodOpt.value() > maxOpt.value()))
+        {
+            errorMessages.push_back("Invalid adaptive epoch period bounds; expected 0 < `min_period_ms` <= "
+                                    "`epoch_period_ms` <= `max_period_ms`.");
+        }
+        if (adaptiveConfig.contains("backoff_factor"))
+        {
+            const auto factorOpt = getValueAtKey<double>(adaptiveConfig, "backoff_factor", errorMessages);
+            if (factorOpt.has_value() && factorOpt.value() <= 1.0)
+            {
+                errorMessages.push_back("Invalid `backoff_factor`; expected a value greater than 1.");
+            }
+        }
+    }
+
+    if (schedulingConfig.contains("early_result_collection"))
+    {
+        std::ignore = getValueAtKey<bool>(schedulingConfig, "early_result_collection", errorMessages);
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateEpochSchedulingConfig, "EpochSchedulingConfigValidator");
+
+namespace
+{
+timespec toTimespec(EpochClock::Clock::time_point timePoint)
+{
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count();
+    return timespec{.tv_sec = static_cast<time_t>(ns / 1000000000), .tv_nsec = static_cast<long>(ns % 1000000000)};
+}
+
+EpochOverrunPolicy readOverrunPolicy(nlohmann::json const& controllerConfig)
+{
+    if (!controllerConfig.contains("epoch_scheduling") ||
+        !controllerConfig.at("epoch_scheduling").contains("overrun_policy"))
+    {
+        return EpochOverrunPolicy::SKIP;
+    }
+    return EpochOverrunPolicy::_from_string_nocase(
+        controllerConfig.at("epoch_scheduling").at("overrun_policy").get<std::string>().c_str());
+}
+
+std::optional<EpochClock::AdaptiveParams> readAdaptiveParams(nlohmann::json const& controllerConfig)
+{
+    if (!controllerConfig.contains("epoch_scheduling") || !controllerConfig.at("epoch_scheduling").contains("adaptive"))
+    {
+        return std::nullopt;
+    }
+    auto const& adaptiveConfig = controllerConfig.at("epoch_scheduling").at("adaptive");
+    return EpochClock::AdaptiveParams{
+        .minPeriod = std::chrono::milliseconds(adaptiveConfig.at("min_period_ms").get<uint32_t>()),
+        .maxPeriod = std::chrono::milliseconds(adaptiveConfig.at("max_period_ms").get<uint32_t>()),
+        .backoffFactor = adaptiveConfig.value("backoff_factor", 2.0)};
+}
+
+bool readEarlyResultCollection(nlohmann::json const& controllerConfig)
+{
+    return controllerConfig.contains("epoch_scheduling") &&
+           controllerConfig.at("epoch_scheduling").value("early_result_collection", false);
+}
+} // namespace
+
+EpochClock::EpochClock(std::chrono::nanoseconds period, EpochOverrunPolicy policy,
+                       std::optional<AdaptiveParams> adaptive, bool earlyResultCollection)
+    : m_period(period)
+    , m_policy(policy)
+    , m_adaptive(std::move(adaptive))
+    , m_earlyResultCollection(earlyResultCollection)
+{
+    m_latenessUs.reserve(LATENESS_WINDOW);
+}
+
+EpochClock::EpochClock(nlohmann::json const& controllerConfig)
+    : EpochClock(std::chrono::milliseconds(controllerConfig.at("epoch_period_ms").get<uint32_t>()),
+                 readOverrunPolicy(controllerConfig), readAdaptiveParams(controllerConfig),
+                 readEarlyResultCollection(controllerConfig))
+{
+    if (controllerConfig.contains("epoch_scheduling") &&
+        controllerConfig.at("epoch_scheduling").contains("realtime_priority"))
+    {
+        m_realtimePriority = controllerConfig.at("epoch_scheduling").at("realtime_priority").get<int>();
+    }
+}
+
+void EpochClock::restart()
+{
+    m_deadline = Clock::now() + getPeriod();
+}
+
+bool EpochClock::sleepUntilNextDeadline()
+{
+    const bool onTime = waitForDeadline();
+    {
+        // requests for this wait must not end the next one
+        std::lock_guard<std::mutex> lk(m_wakeUpMtx);
+        ++m_waitGeneration;
+        m_endWaitRequested = false;
+    }
+    return onTime;
+}
+
+bool EpochClock::waitForDeadline()
+{
+    if (!m_deadline)
+    {
+        restart();
+    }
+    auto& deadline = m_deadline.value();
+    const auto period = getPeriod();
+
+    const auto now = Clock::now();
+    if (now > deadline)
+    {
+        const auto missed = period.count() > 0 ? static_cast<uint64_t>((now - deadline) / period) : 0U;
+        {
+            std::lock_guard<std::mutex> lk(m_statsMtx);
+            ++m_stats.overruns;
+            if (m_policy == +EpochOverrunPolicy::SKIP)
+            {
+                m_stats.skippedDeadlines += missed;
+            }
+        }
+        recordLateness(now - deadline);
+        switch (m_policy)
+        {
+        case EpochOverrunPolicy::SKIP:
+            deadline += period * (missed + 1U);
+            break;
+        case EpochOverrunPolicy::CATCH_UP:
+            deadline += period;
+            break;
+        case EpochOverrunPolicy::RESET:
+            deadline = now + period;
+            break;
+        }
+        return false;
+    }
+
+    if (m_adaptive || m_earlyResultCollection)
+    {
+        // interruptible wait, as a backed off period may be long, or the epoch results may be ready early
+        std::unique_lock<std::mutex> lk(m_wakeUpMtx);
+        m_wakeUpCondition.wait_until(lk, deadline, [this] { return m_wakeUpRequested || m_endWaitRequested; });
+        const bool wokenUp = m_wakeUpRequested;
+        const bool endedEarly = m_endWaitRequested;
+        m_wakeUpRequested = false;
+        m_endWaitRequested = false;
+        lk.unlock();
+        if (wokenUp)
+        {
+            {
+                std::lock_guard<std::mutex> statsLk(m_statsMtx);
+                ++m_stats.wakeUps;
+            }
+            m_period.store(m_adaptive->minPeriod);
+            deadline = Clock::now() + m_adaptive->minPeriod;
+            return true;
+        }
+        if (endedEarly)
+        {
+            {
+                std::lock_guard<std::mutex> statsLk(m_statsMtx);
+                ++m_stats.earlyCollections;
+            }
+            deadline = Clock::now() + getPeriod();
+            return true;
+        }
+    }
+    else
+    {
+        const auto deadlineTs = toTimespec(deadline);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadlineTs, nullptr) == EINTR)
+        {
+        }
+    }
+    recordLateness(Clock::now() - deadline);
+    deadline += getPeriod();
+    return true;
+}
+
+void EpochClock::adaptPeriod(bool active)
+{
+    if (!m_adaptive)
+    {
+        return;
+    }
+    const auto period = std::chrono::duration<double, std::nano>(getPeriod());
+    const auto adapted = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        active ? period / m_adaptive->backoffFactor : period * m_adaptive->backoffFactor);
+    setPeriod(std::clamp(adapted, m_adaptive->minPeriod, m_adaptive->maxPeriod));
+}
+
+void EpochClock::wakeUp()
+{
+    if (!m_adaptive)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_wakeUpMtx);
+        m_wakeUpRequested = true;
+    }
+    m_wakeUpCondition.notify_one();
+}
+
+void EpochClock::endWait(uint64_t generation)
+{
+    if (!m_earlyResultCollection)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_wakeUpMtx);
+        if (generation != m_waitGeneration)
+        {
+            return;
+        }
+        m_endWaitRequested = true;
+    }
+    m_wakeUpCondition.notify_one();
+}
+
+uint64_t EpochClock::getWaitGeneration() const
+{
+    std::lock_guard<std::mutex> lk(m_wakeUpMtx);
+    return m_waitGeneration;
+}
+
+void EpochClock::setPeriod(std::chrono::nanoseconds period)
+{
+    if (m_deadline)
+    {
+        m_deadline.value() += period - getPeriod(); // the next deadline is one period after the current period start
+    }
+    m_period.store(period);
+}
+
+EpochClock::Stats EpochClock::getStats() const
+{
+    std::unique_lock<std::mutex> lk(m_statsMtx);
+    auto stats = m_stats;
+    auto samples = m_latenessUs;
+    lk.unlock();
+
+    if (!samples.empty())
+    {
+        const auto p99 = samples.begin() + (samples.size() * 99U) / 100U;
+        std::nth_element(samples.begin(), p99, samples.end());
+        stats.p99Lateness = std::chrono::microseconds(*p99);
+    }
+    return stats;
+}
+
+void EpochClock::recordLateness(Clock::duration lateness)
+{
+    const auto latenessUs = std::chrono::duration_cast<std::chrono::microseconds>(lateness);
+    std::lock_guard<std::mutex> lk(m_statsMtx);
+    ++m_stats.deadlines;
+    m_stats.maxLateness = std::max(m_stats.maxLateness, latenessUs);
+    if (m_latenessUs.size() < LATENESS_WINDOW)
+    {
+        m_latenessUs.push_back(latenessUs.count());
+    }
+    else
+    {
+        m_latenessUs[m_nextLatenessSample] = latenessUs.count();
+    }
+    m_nextLatenessSample = (m_nextLatenessSample + 1U) % LATENESS_WINDOW;
+}
+
+bool EpochClock::setCurrentThreadRealtimePriority(int priority)
+{
+    sched_param param{};
+    param.sched_priority = priority;
+    if (const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+    {
+        LOG(WARN) << "Failed to set SCHED_FIFO priority " << priority << "; running with the default policy; error = "
+                  << err << log::endl;
+        return false;
+    }
+    LOG(INFO) << "Running with SCHED_FIFO priority " << priority << log::endl;
+    return true;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// What the controller does when an epoch misses its deadline - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(EpochOverrunPolicy, uint32_t,
+            SKIP,     // the missed deadlines are skipped; the schedule continues at the next period boundary
+            CATCH_UP, // the missed epochs run back to back until the schedule is met again
+            RESET     // the schedule restarts one period after the overrun
+)
+
+/**
+ * @brief Absolute deadline epoch scheduling on the monotonic clock
+ *
+ * Deadlines are `start + k * period`, so the epoch cadence does not drift with the time spent executing the epoch.
+ * Waits use `clock_nanosleep(TIMER_ABSTIME)`. An epoch whose work ends past its deadline is an overrun; it does not
+ * wait, and the next deadline follows the overrun policy.
+ *
+ * In adaptive mode, the period shrinks by `backoff_factor` after each active epoch, i.e., one that fired transitions or
+ * completed actions, and grows by it after each idle epoch, within `[min_period_ms, max_period_ms]`. `epoch_period_ms`
+ * is the initial period. External inputs end an idle wait right away, see `wakeUp()`, so backing off does not delay
+ * them.
+ *
+ * With early result collection, the controller ends the wait as soon as all the actions dispatched in the epoch
+ * finished, see `endWait()`, instead of sleeping out the remaining period. The schedule then restarts one period later.
+ *
+ * Config (`controller/epoch_scheduling`, optional):
+ *    "overrun_policy"    [string][default: "skip"] see `EpochOverrunPolicy`
+ *    "realtime_priority" [int][range: 1, 99][optional] run the controller loop with `SCHED_FIFO` at this priority
+ *    "adaptive"          [object][optional] adaptive mode; e.g.,
+ *                        {"min_period_ms": 1, "max_period_ms": 1000, "backoff_factor": 2.0 [default: 2.0]}
+ *    "early_result_collection" [bool][default: false] collect the action results once all of them finished
+ */
+class EpochClock
+{
+    static constexpr const char* MODULE_TAG{"EpochClock"};
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t deadlines{0U};
+        uint64_t overruns{0U};
+        uint64_t skippedDeadlines{0U};
+        std::chrono::microseconds maxLateness{0}; // wake up or overrun lateness relative to the deadline
+        std::chrono::microseconds p99Lateness{0}; // over the last `LATENESS_WINDOW` deadlines
+        uint64_t wakeUps{0U};                     // waits ended early by `wakeUp()`
+        uint64_t earlyCollections{0U};            // waits ended early by `endWait()`
+    };
+
+    struct AdaptiveParams
+    {
+        std::chrono::nanoseconds minPeriod;
+        std::chrono::nanoseconds maxPeriod;
+        double backoffFactor{2.0};
+    };
+
+    static constexpr size_t LATENESS_WINDOW{1024U};
+
+    EpochClock(std::chrono::nanoseconds period, EpochOverrunPolicy policy = EpochOverrunPolicy::SKIP,
+               std::optional<AdaptiveParams> adaptive = std::nullopt, bool earlyResultCollection = false);
+
+    /// @param controllerConfig period from `epoch_period_ms`, policy from `epoch_scheduling`
+    explicit EpochClock(nlohmann::json const& controllerConfig);
+
+    /// @brief restart the schedule; the next deadline is one period from now
+    void restart();
+
+    /// @brief sleep until the next deadline; the schedule starts on the first call if not restarted before
+    /// @return false if the deadline was already missed, i.e., on overrun
+    bool sleepUntilNextDeadline();
+
+    /// @brief [adaptive mode] shrink the period after an active epoch, or back off after an idle one
+    void adaptPeriod(bool active);
+
+    /// @brief [adaptive mode] end the current wait, and use the minimum period; no-op otherwise; thread safe
+    void wakeUp();
+
+    /// @brief [early result collection] end the wait of `generation`, keeping the period; no-op otherwise, or if
+    /// that wait already ended, e.g., for tasks finishing after the deadline; thread safe
+    /// @param generation see `getWaitGeneration()`
+    void endWait(uint64_t generation);
+
+    /// @brief generation of the next, or current, wait; incremented whenever `sleepUntilNextDeadline()` returns
+    uint64_t getWaitGeneration() const;
+
+    bool isAdaptive() const { return m_adaptive.has_value(); }
+    bool hasEarlyResultCollection() const { return m_earlyResultCollection; }
+    /// @brief thread safe
+    std::chrono::nanoseconds getPeriod() const { return m_period.load(); }
+    EpochOverrunPolicy getOverrunPolicy() const { return m_policy; }
+    std::optional<int> getRealtimePriority() const { return m_realtimePriority; }
+    /// @brief thread safe, e.g., to monitor a running controller
+    Stats getStats() const;
+
+    /// @brief run the calling thread with `SCHED_FIFO` at `priority`; failures, e.g., missing privileges, are logged
+    /// @return true on success
+    static bool setCurrentThreadRealtimePriority(int priority);
+
+private:
+    /// @brief `sleepUntilNextDeadline()`, without ending the wait generation
+    bool waitForDeadline();
+
+    void recordLateness(Clock::duration lateness);
+
+    /// @brief set the period, keeping the start of the current period
+    void setPeriod(std::chrono::nanoseconds period);
+
+    std::atomic<std::chrono::nanoseconds> m_period;
+    const EpochOverrunPolicy m_policy;
+    const std::optional<AdaptiveParams> m_adaptive;
+    const bool m_earlyResultCollection;
+    std::optional<int> m_realtimePriority{};
+
+    mutable std::mutex m_wakeUpMtx;
+    std::condition_variable m_wakeUpCondition;
+    bool m_wakeUpRequested{false};
+    bool m_endWaitRequested{false};
+    uint64_t m_waitGeneration{0U};
+
+    std::optional<Clock::time_point> m_deadline{};
+
+    mutable std::mutex m_statsMtx;
+    Stats m_stats{};
+    std::vector<int64_t> m_latenessUs{}; // circular window of the last lateness samples
+    size_t m_nextLatenessSample{0U};
+};
+
+} // namespace bnet
+} // namespace capybot
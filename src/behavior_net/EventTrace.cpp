@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/EventTrace.hpp>
+
+namespace capybot
+{
+namespace bnet
+{
+
+static constexpr const char* TRACE_HEADER_KEY{"bnet_event_trace"};
+static constexpr uint32_t TRACE_FORMAT_VERSION{1U};
+
+bool validateEventTraceConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("event_trace"))
+    {
+        return true; // event trace recording not in config
+    }
+    auto traceConfig = getValueAtPath<nlohmann::json>(netConfig, {"controller", "event_trace"}, errorMessages).value();
+
+    std::ignore = getValueAtKey<std::string>(traceConfig, "record_path", errorMessages);
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateEventTraceConfig, "EventTraceConfigValidator");
+
+nlohmann::json TraceEvent::toJson() const
+{
+    nlohmann::json json;
+    json["epoch"] = epoch;
+    json["type"] = type._to_string();
+    json["id"] = id;
+    switch (type)
+    {
+    case TraceEventType::ADD_TOKEN:
+        json["phase"] = phase._to_string();
+        json["content_blocks"] = content;
+        break;
+    case TraceEventType::MANUAL_TRIGGER:
+        json["phase"] = phase._to_string();
+        break;
+    case TraceEventType::ACTION_RESULT:
+        json["busy_index"] = busyIndex;
+        json["status"] = status._to_string();
+        break;
+    case TraceEventType::TRANSITION_FIRED:
+        break;
+    case TraceEventType::EPOCH_PERIOD:
+        json["period_ns"] = periodNs;
+        break;
+    }
+    return json;
+}
+
+TraceEvent TraceEvent::fromJson(nlohmann::json const& json)
+{
+    TraceEvent event;
+    event.epoch = json.at("epoch").get<uint64_t>();
+    event.type = TraceEventType::_from_string(json.at("type").get<std::string>().c_str());
+    event.id = json.at("id").get<std::string>();
+    if (json.contains("phase"))
+    {
+        event.phase = EpochPhase::_from_string(json.at("phase").get<std::string>().c_str());
+    }
+    if (json.contains("content_blocks"))
+    {
+        event.content = json.at("content_blocks");
+    }
+    if (json.contains("busy_index"))
+    {
+        event.busyIndex = json.at("busy_index").get<uint32_t>();
+        event.status = ActionExecutionStatus::_from_string(json.at("status").get<std::string>().c_str());
+    }
+    if (json.contains("period_ns"))
+    {
+        event.periodNs = json.at("period_ns").get<uint64_t>();
+    }
+    return event;
+}
+
+EventTraceRecorder::EventTraceRecorder(std::string const& path, uint32_t epochPeriodMs)
+    : m_file(path, std::ios::out | std::ios::trunc)
+    , m_period(std::chrono::milliseconds(epochPeriodMs))
+{
+    if (!m_file.is_open())
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "EventTraceRecorder: failed to open trace file.")
+            .appendMetadata("path", path);
+    }
+
+    nlohmann::json header;
+    header[TRACE_HEADER_KEY] = TRACE_FORMAT_VERSION;
+    header["epoch_period_ms"] = epochPeriodMs;
+    m_file << header.dump() << "\n";
+
+    LOG(INFO) << "Recording event trace to " << path << log::endl;
+}
+
+void EventTraceRecorder::recordAddToken(std::string_view placeId, nlohmann::json const& contentBlocks)
+{
+    write(TraceEvent{.epoch = m_epoch,
+                     .type = TraceEventType::ADD_TOKEN,
+                     .phase = m_phase,
+                     .id = std::string(placeId),
+                     .content = contentBlocks});
+}
+
+void EventTraceRecorder::recordManualTrigger(std::string_view transitionId)
+{
+    write(TraceEvent{
+        .epoch = m_epoch, .type = TraceEventType::MANUAL_TRIGGER, .phase = m_phase, .id = std::string(transitionId)});
+}
+
+void EventTraceRecorder::recordActionResult(std::string const& placeId, uint32_t busyIndex,
+                                            ActionExecutionStatus status)
+{
+    write(TraceEvent{.epoch = m_epoch,
+                     .type = TraceEventType::ACTION_RESULT,
+                     .id = placeId,
+                     .busyIndex = busyIndex,
+                     .status = status});
+}
+
+void EventTraceRecorder::recordTransitionFired(std::string const& transitionId)
+{
+    write(TraceEvent{.epoch = m_epoch, .type = TraceEventType::TRANSITION_FIRED, .id = transitionId});
+}
+
+void EventTraceRecorder::recordEpochPeriod(uint64_t epoch, std::chrono::nanoseconds period)
+{
+    if (period == m_period)
+    {
+        return;
+    }
+    m_period = period;
+    write(TraceEvent{.epoch = epoch,
+                     .type = TraceEventType::EPOCH_PERIOD,
+                     .periodNs = static_cast<uint64_t>(period.count())});
+}
+
+EventTrace EventTrace::load(std::string const& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "EventTrace::load: failed to open trace file.")
+            .appendMetadata("path", path);
+    }
+
+    EventTrace trace;
+    std::string line;
+    uint32_t lineNumber{0U};
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        if (line.empty())
+        {
+            continue;
+        }
+
+        try
+        {
+            const auto json = nlohmann::json::parse(line);
+            if (lineNumber == 1U)
+            {
+                if (json.value(TRACE_HEADER_KEY, 0U) != TRACE_FORMAT_VERSION)
+                {
+                    throw Exception(ExceptionType::INVALID_VALUE, "EventTrace::load: unsupported trace header.")
+                        .appendMetadata("path", path)
+                        .appendMetadata("header", json);
+                }
+                trace.m_epochPeriodMs = json.at("epoch_period_ms").get<uint32_t>();
+                continue;
+            }
+
+            auto event = TraceEvent::fromJson(json);
+            ++trace.m_numberEvents;
+            if (event.type == +TraceEventType::EPOCH_PERIOD)
+            {
+                // not replayed, i.e., does not add an epoch to replay
+                trace.m_epochPeriods[event.epoch] = std::chrono::nanoseconds(event.periodNs);
+                continue;
+            }
+
+            auto& epoch = trace.m_epochs[event.epoch];
+            switch (event.type)
+            {
+            case TraceEventType::ADD_TOKEN:
+            case TraceEventType::MANUAL_TRIGGER:
+                (event.phase == +EpochPhase::IDLE ? epoch.idleInputs : epoch.waitingInputs).push_back(std::move(event));
+                break;
+            case TraceEventType::ACTION_RESULT:
+                epoch.actionResults.push_back(std::move(event));
+                break;
+            case TraceEventType::TRANSITION_FIRED:
+                epoch.firedTransitions.push_back(std::move(event.id));
+                break;
+            case TraceEventType::EPOCH_PERIOD:
+                break; // see above
+            }
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "EventTrace::load: failed to parse trace line.")
+                .appendMetadata("path", path)
+                .appendMetadata("line", lineNumber)
+                .appendMetadata("error", e.what());
+        }
+        catch (const std::runtime_error& e) // better_enums string conversion
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "EventTrace::load: invalid trace event.")
+                .appendMetadata("path", path)
+                .appendMetadata("line", lineNumber)
+                .appendMetadata("error", e.what());
+        }
+    }
+
+    return trace;
+}
+
+std::chrono::nanoseconds EventTrace::getVirtualTime(uint64_t numberEpochs) const
+{
+    std::chrono::nanoseconds virtualTime{0};
+    std::chrono::nanoseconds period = std::chrono::milliseconds(m_epochPeriodMs);
+    uint64_t epoch{0U};
+    for (auto&& [changeEpoch, changedPeriod] : m_epochPeriods)
+    {
+        if (changeEpoch >= numberEpochs)
+        {
+            break;
+        }
+        virtualTime += period * (changeEpoch - epoch);
+        period = changedPeriod;
+        epoch = changeEpoch;
+    }
+    return virtualTime + period * (numberEpochs - epoch);
+}
+
+} // namespace bnet
+} // namespace capybot
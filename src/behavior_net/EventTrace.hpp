@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// Trace event type - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(TraceEventType, uint32_t,
+            ADD_TOKEN,       // external input: token added, e.g., through `/add_token`
+            MANUAL_TRIGGER,  // external input: manual transition triggered
+            ACTION_RESULT,    // action result collected for a busy token
+            TRANSITION_FIRED, // auto transition fired by the controller; used for detecting replay divergence
+            EPOCH_PERIOD      // epoch period changed, i.e., adaptive epoch period; used for the replay virtual time
+)
+
+/// Point within an epoch in which an external input was applied - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(EpochPhase, uint32_t,
+            IDLE,   // before the epoch actions are dispatched
+            WAITING // after the epoch actions are dispatched, before their results are collected
+)
+
+struct TraceEvent
+{
+    uint64_t epoch{0U};
+    TraceEventType type{TraceEventType::ADD_TOKEN};
+    EpochPhase phase{EpochPhase::IDLE};
+    std::string id{};                                           // place_id or transition_id
+    nlohmann::json content{};                                   // ADD_TOKEN: token content blocks
+    uint32_t busyIndex{0U};                                     // ACTION_RESULT: token index in the place busy list
+    ActionExecutionStatus status{ActionExecutionStatus::ERROR}; // ACTION_RESULT: action result
+    uint64_t periodNs{0U};                                      // EPOCH_PERIOD: period from this epoch on
+
+    nlohmann::json toJson() const;
+    static TraceEvent fromJson(nlohmann::json const& json);
+};
+
+/**
+ * @brief Records the controller non-deterministic inputs (external inputs and action results) to a trace file
+ *
+ * The trace is a JSON-lines file: a header line followed by one line per event. Busy tokens are identified by their
+ * index in the place busy list, which is deterministic as long as the same decisions are taken on replay.
+ *
+ * Not thread-safe; the controller serializes all calls.
+ */
+class EventTraceRecorder
+{
+    static constexpr const char* MODULE_TAG{"EventTraceRecorder"};
+
+public:
+    EventTraceRecorder(std::string const& path, uint32_t epochPeriodMs);
+
+    /// @brief set the epoch and epoch phase attached to the next recorded events
+    void setPosition(uint64_t epoch, EpochPhase phase)
+    {
+        m_epoch = epoch;
+        m_phase = phase;
+    }
+
+    void recordAddToken(std::string_view placeId, nlohmann::json const& contentBlocks);
+    void recordManualTrigger(std::string_view transitionId);
+    void recordActionResult(std::string const& placeId, uint32_t busyIndex, ActionExecutionStatus status);
+    void recordTransitionFired(std::string const& transitionId);
+    /// @brief record the period of the epochs from `epoch` on, if it differs from the last recorded one
+    void recordEpochPeriod(uint64_t epoch, std::chrono::nanoseconds period);
+
+    void flush() { m_file.flush(); }
+
+private:
+    void write(TraceEvent const& event) { m_file << event.toJson().dump() << "\n"; }
+
+    std::ofstream m_file;
+    uint64_t m_epoch{0U};
+    EpochPhase m_phase{EpochPhase::IDLE};
+    std::chrono::nanoseconds m_period; // last recorded, initially the header one
+};
+
+/// @brief Recorded trace loaded in memory, grouped by epoch
+class EventTrace
+{
+    static constexpr const char* MODULE_TAG{"EventTrace"};
+
+public:
+    struct Epoch
+    {
+        std::vector<TraceEvent> idleInputs;
+        std::vector<TraceEvent> waitingInputs;
+        std::vector<TraceEvent> actionResults;
+        std::vector<std::string> firedTransitions;
+    };
+
+    static EventTrace load(std::string const& path);
+
+    /// @return recorded events per epoch; epochs without events are omitted
+    std::map<uint64_t, Epoch> const& getEpochs() const { return m_epochs; }
+
+    uint64_t getLastEpoch() const { return m_epochs.empty() ? 0U : m_epochs.rbegin()->first; }
+    /// @return the initial epoch period; adaptive epoch periods change it, see `getVirtualTime()`
+    uint32_t getEpochPeriodMs() const { return m_epochPeriodMs; }
+    uint64_t getNumberEvents() const { return m_numberEvents; }
+
+    /// @return the sum of the recorded periods of the first `numberEpochs` epochs; epochs shortened or overrun at
+    /// runtime, e.g., woken up by external inputs, count their whole period
+    std::chrono::nanoseconds getVirtualTime(uint64_t numberEpochs) const;
+
+private:
+    std::map<uint64_t, Epoch> m_epochs;
+    std::map<uint64_t, std::chrono::nanoseconds> m_epochPeriods; // period changes, by their first epoch
+    uint32_t m_epochPeriodMs{0U};
+    uint64_t m_numberEvents{0U};
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/MultiNetController.hpp>
+#include <behavior_net/Types.hpp>
+#include <utils/Logger.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+nlohmann::json readConfigFile(std::string const& configFilePath)
+{
+    nlohmann::json config;
+    std::ifstream(configFilePath) >> config;
+    return config;
+}
+} // namespace
+
+MultiNetController::MultiNetController(std::string const& configFilePath)
+    : MultiNetController(readConfigFile(configFilePath))
+{
+}
+
+MultiNetController::MultiNetController(nlohmann::json config)
+    : m_config((validateConfig(config), std::move(config)))
+    , m_tp(m_config.at("thread_pool_workers").get<uint32_t>(),
+           ElasticWorkerPool::Params::fromConfig(m_config.value("blocking_io_pool", nlohmann::json::object())),
+           CpuPlacement::fromConfig(m_config.value("cpu_affinity", nlohmann::json::object()), "thread_pool_workers"))
+{
+    if (m_config.contains("thread_pool_lanes"))
+    {
+        m_tp.addLanes(m_config.at("thread_pool_lanes"));
+    }
+
+    std::map<std::string, ControllerCallbacks> netCbs;
+    for (auto&& netEntry : m_config.at("nets"))
+    {
+        const auto netId = netEntry.at("net_id").get<std::string>();
+
+        HostedNet net;
+        net.config = std::make_unique<NetConfig>(netEntry.contains("config")
+                                                     ? NetConfig::fromJson(netEntry.at("config"))
+                                                     : NetConfig(netEntry.at("config_path").get<std::string>()));
+        net.controller = std::make_unique<Controller>(*net.config, PetriNet::create(*net.config), m_tp);
+        netCbs.emplace(netId, net.controller->getCallbacks());
+        m_nets.emplace(netId, std::move(net));
+    }
+    m_server = IServer::create(m_config, netCbs);
+
+    LOG(INFO) << "Hosting " << m_nets.size() << " nets on " << m_config.at("thread_pool_workers").get<uint32_t>()
+              << " shared workers" << log::endl;
+}
+
+void MultiNetController::validateConfig(nlohmann::json const& config)
+{
+    std::vector<std::string> errors{};
+    std::ignore = getValueAtKey<uint32_t>(config, "thread_pool_workers", errors);
+    if (config.contains("thread_pool_lanes"))
+    {
+        validateThreadPoolLanesConfig(config.at("thread_pool_lanes"), errors);
+    }
+    if (config.contains("blocking_io_pool"))
+    {
+        validateElasticWorkerPoolConfig(config.at("blocking_io_pool"), errors);
+    }
+    if (config.contains("cpu_affinity"))
+    {
+        validateCpuAffinityConfig(config.at("cpu_affinity"), {"http_server", "thread_pool_workers"}, errors);
+    }
+
+    const auto netsOpt = getValueAtKey<nlohmann::json>(config, "nets", errors);
+    if (netsOpt.has_value())
+    {
+        std::vector<std::string> netIds{};
+        for (auto&& netEntry : netsOpt.value())
+        {
+            const auto idOpt = getValueAtKey<std::string>(netEntry, "net_id", errors);
+            if (idOpt.has_value())
+            {
+                if (idOpt.value().empty() || idOpt.value().find('/') != std::string::npos)
+                {
+                    errors.push_back("Invalid `net_id` `" + idOpt.value() + "`; expected a non-empty id without `/`.");
+                }
+                if (std::find(netIds.begin(), netIds.end(), idOpt.value()) != netIds.end())
+                {
+                    errors.push_back("Repeated `net_id`: " + idOpt.value());
+                }
+                netIds.push_back(idOpt.value());
+            }
+            if (netEntry.contains("config") == netEntry.contains("config_path"))
+            {
+                errors.push_back("Expected exactly one of `config` and `config_path` per net.");
+            }
+        }
+        if (netIds.empty() && errors.empty())
+        {
+            errors.push_back("Expected at least one net in `nets`.");
+        }
+    }
+
+    if (!errors.empty())
+    {
+        throw Exception(ExceptionType::INVALID_CONFIG_FILE,
+                        "MultiNetController::validateConfig: Failed to validate configuration. ")
+            .appendMetadata("number of errors found", errors.size())
+            .appendMetadata("errors", errors);
+    }
+}
+
+void MultiNetController::run()
+{
+    SCOPED_LOG_TRACER("run");
+
+    if (m_running.load())
+    {
+        throw Exception(ExceptionType::LOGIC_ERROR, "[MultiNetController::run] controller is already running.");
+    }
+
+    LOG(INFO) << "run: running... " << log::endl;
+
+    m_running.store(true);
+    for (auto&& [_, net] : m_nets)
+    {
+        net.controller->runDetached();
+    }
+    if (m_server)
+    {
+        m_server->start();
+    }
+    std::unique_lock<std::mutex> lk(m_runMtx);
+    m_stopRequested.wait(lk, [this] { return !m_running.load(); });
+}
+
+void MultiNetController::runDetached()
+{
+    if (m_running.load() || m_runDetachedThread.joinable())
+    {
+        throw Exception(ExceptionType::LOGIC_ERROR,
+                        "[MultiNetController::runDetached] controller is already running.");
+    }
+    m_runDetachedThread = std::thread([this] { run(); });
+}
+
+void MultiNetController::stop()
+{
+    SCOPED_LOG_TRACER("stop");
+
+    {
+        std::lock_guard<std::mutex> lk(m_runMtx);
+        m_running.store(false);
+    }
+    m_stopRequested.notify_all();
+    if (m_server)
+    {
+        m_server->stop();
+    }
+    if (m_runDetachedThread.joinable())
+    {
+        m_runDetachedThread.join();
+    }
+    for (auto&& [_, net] : m_nets)
+    {
+        net.controller->stop();
+    }
+}
+
+std::vector<std::string> MultiNetController::getNetIds() const
+{
+    std::vector<std::string> netIds;
+    for (auto&& [id, _] : m_nets)
+    {
+        netIds.push_back(id);
+    }
+    return netIds;
+}
+
+Controller& MultiNetController::getController(std::string const& netId)
+{
+    const auto it = m_nets.find(netId);
+    if (it == m_nets.end())
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "MultiNetController::getController: net does not exist.")
+            .appendMetadata("net_id", netId);
+    }
+    return *it->second.controller;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/ThreadPool.hpp>
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Hosts several isolated nets in one process
+ *
+ * Each net has its own controller and epoch loop, running at its own `controller/epoch_period_ms`. All net actions
+ * run on one shared work-stealing thread pool, and one server routes requests to the nets by net id.
+ *
+ * Config:
+ *  {
+ *    "thread_pool_workers": 8,
+ *    "thread_pool_lanes": [{"lane_id": "bulk", "workers": 4, "action_types": ["TimerAction"]}], // optional
+ *    "blocking_io_pool": {"max_workers": 32}, // optional
+ *    "cpu_affinity": {"http_server": {"cpus": "0"}, "thread_pool_workers": {"numa_node": 1}}, // optional
+ *    "http_server": {"address": "localhost", "port": 8080}, // optional
+ *    "nets": [{"net_id": "line_1", "config_path": "line_1.json"}, {"net_id": "line_2", "config": {...}}]
+ *  }
+ * where each net is either a net config file path or an inline net config. The lanes are shared by all nets; see
+ * `ThreadPool`. The `thread_poll_workers`, `thread_pool_lanes`, `blocking_io_pool` and `http_server` entries of the
+ * net configs are ignored, and so are their `cpu_affinity` entries other than `controller_loop`.
+ */
+class MultiNetController
+{
+    static constexpr const char* MODULE_TAG{"MultiNetController"};
+
+public:
+    explicit MultiNetController(std::string const& configFilePath);
+    explicit MultiNetController(nlohmann::json config);
+
+    ~MultiNetController() { stop(); }
+
+    /// @brief run all nets; blocks until `stop()` is called
+    void run();
+
+    void runDetached();
+
+    void stop();
+
+    std::vector<std::string> getNetIds() const;
+    Controller& getController(std::string const& netId);
+
+private:
+    struct HostedNet
+    {
+        std::unique_ptr<NetConfig> config; // referred to by the controller
+        std::unique_ptr<Controller> controller;
+    };
+
+    /// @throws Exception of type INVALID_CONFIG_FILE listing all config errors
+    static void validateConfig(nlohmann::json const& config);
+
+    nlohmann::json m_config;
+
+    ThreadPool m_tp;
+    std::map<std::string, HostedNet> m_nets;
+    std::unique_ptr<IServer> m_server;
+
+    std::atomic_bool m_running{false};
+    std::mutex m_runMtx;
+    std::condition_variable m_stopRequested; // ends `run()`
+    std::thread m_runDetachedThread;
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,648 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/NetPartition.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+constexpr uint32_t MAX_FRAME_SIZE{64U << 20U};
+constexpr int LISTENER_POLL_PERIOD_MS{100};
+constexpr int DEFAULT_IO_TIMEOUT_MS{100};
+
+bool validateEndpointConfig(nlohmann::json const& config, std::vector<std::string>& errorMessages)
+{
+    if (config.contains("unix_socket"))
+    {
+        return getValueAtKey<std::string>(config, "unix_socket", errorMessages).has_value();
+    }
+    const auto addressOpt = getValueAtKey<std::string>(config, "address", errorMessages);
+    const auto portOpt = getValueAtKey<int>(config, "port", errorMessages);
+    return addressOpt.has_value() && portOpt.has_value();
+}
+
+bool writeAll(int fd, uint8_t const* data, size_t size)
+{
+    while (size > 0U)
+    {
+        const auto written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, uint8_t* data, size_t size)
+{
+    while (size > 0U)
+    {
+        const auto received = ::recv(fd, data, size, 0);
+        if (received <= 0)
+        {
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+uint64_t createSession()
+{
+    std::random_device device;
+    std::mt19937_64 generator(device());
+    return std::uniform_int_distribution<uint64_t>(1U)(generator);
+}
+
+/// @brief read a frame payload, without its length prefix
+bool readFrame(int fd, std::vector<uint8_t>& payload)
+{
+    uint32_t size{0U};
+    if (!readAll(fd, reinterpret_cast<uint8_t*>(&size), sizeof(size)))
+    {
+        return false; // closed by the peer
+    }
+    size = ntohl(size);
+    if (size > MAX_FRAME_SIZE)
+    {
+        LOG_TAGGED(ERROR, "NetPartition") << "readFrame: frame too large (" << size << " bytes); closing connection"
+                                          << log::endl;
+        return false;
+    }
+    payload.resize(size);
+    return readAll(fd, payload.data(), payload.size());
+}
+
+std::vector<uint8_t> prefixLength(std::vector<uint8_t> const& payload)
+{
+    std::vector<uint8_t> frame(sizeof(uint32_t));
+    const uint32_t size = htonl(static_cast<uint32_t>(payload.size()));
+    std::memcpy(frame.data(), &size, sizeof(size));
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+/// @brief make blocking sends and receives on `fd` fail after `timeoutMs`
+bool setIoTimeouts(int fd, int timeoutMs)
+{
+    const timeval timeout{.tv_sec = timeoutMs / 1000, .tv_usec = (timeoutMs % 1000) * 1000};
+    return ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0 &&
+           ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+/// @brief connect without blocking for more than `timeoutMs`; later sends and receives time out after it as well
+bool connectWithTimeout(int fd, sockaddr const* addr, socklen_t addrLength, int timeoutMs)
+{
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        return false;
+    }
+    bool connected = ::connect(fd, addr, addrLength) == 0;
+    if (!connected && errno == EINPROGRESS)
+    {
+        pollfd pfd{.fd = fd, .events = POLLOUT, .revents = 0};
+        int error{0};
+        socklen_t errorLength{sizeof(error)};
+        connected = ::poll(&pfd, 1, timeoutMs) == 1 &&
+                    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0 && error == 0;
+    }
+    return connected && ::fcntl(fd, F_SETFL, flags) == 0 && setIoTimeouts(fd, timeoutMs);
+}
+
+/// @param timeoutMs connection timeout, see `connectWithTimeout()`; unused if `listen`
+/// @return socket fd, or -1 on failure
+int openSocket(PartitionEndpoint const& endpoint, bool listen, int timeoutMs = 0)
+{
+    if (!endpoint.unixSocket.empty())
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (endpoint.unixSocket.size() >= sizeof(addr.sun_path))
+        {
+            return -1;
+        }
+        std::strncpy(addr.sun_path, endpoint.unixSocket.c_str(), sizeof(addr.sun_path) - 1U);
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        if (listen)
+        {
+            ::unlink(endpoint.unixSocket.c_str()); // stale socket of a previous run
+        }
+        const auto* sockAddr = reinterpret_cast<sockaddr const*>(&addr);
+        const bool ok = listen ? ::bind(fd, sockAddr, sizeof(addr)) == 0 && ::listen(fd, SOMAXCONN) == 0
+                               : connectWithTimeout(fd, sockAddr, sizeof(addr), timeoutMs);
+        if (!ok)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listen ? AI_PASSIVE : 0;
+    addrinfo* results{nullptr};
+    if (::getaddrinfo(endpoint.address.c_str(), std::to_string(endpoint.port).c_str(), &hints, &results) != 0)
+    {
+        return -1;
+    }
+
+    int fd{-1};
+    for (auto* ai = results; ai != nullptr && fd < 0; ai = ai->ai_next)
+    {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        bool ok{false};
+        if (listen)
+        {
+            const int reuse{1};
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            ok = ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0;
+        }
+        else
+        {
+            ok = connectWithTimeout(fd, ai->ai_addr, ai->ai_addrlen, timeoutMs);
+        }
+        if (!ok)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(results);
+    return fd;
+}
+} // namespace
+
+bool validatePartitionConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("partition"))
+    {
+        return true; // net not partitioned
+    }
+    auto partitionConfig =
+        getValueAtPath<nlohmann::json>(netConfig, {"controller", "partition"}, errorMessages).value();
+
+    std::ignore = getValueAtKey<std::string>(partitionConfig, "partition_id", errorMessages);
+    if (partitionConfig.contains("io_timeout_ms"))
+    {
+        std::ignore = getValueAtKey<uint32_t>(partitionConfig, "io_timeout_ms", errorMessages);
+    }
+    const auto listenOpt = getValueAtKey<nlohmann::json>(partitionConfig, "listen", errorMessages);
+    if (listenOpt.has_value())
+    {
+        validateEndpointConfig(listenOpt.value(), errorMessages);
+    }
+
+    const auto peersOpt = getValueAtKey<nlohmann::json>(partitionConfig, "peers", errorMessages);
+    if (!peersOpt.has_value())
+    {
+        return false;
+    }
+
+    // proxy places are net places that are output only and passive
+    const auto placeConfigs = netConfig.at("petri_net").value("places", nlohmann::json::array());
+    const auto transitionConfigs = netConfig.at("petri_net").value("transitions", nlohmann::json::array());
+    const auto actionConfigs = netConfig.at("controller").value("actions", nlohmann::json::array());
+    std::vector<std::string> proxyPlaceIds{};
+    for (auto&& peerConfig : peersOpt.value())
+    {
+        std::ignore = getValueAtKey<std::string>(peerConfig, "partition_id", errorMessages);
+        const auto endpointOpt = getValueAtKey<nlohmann::json>(peerConfig, "endpoint", errorMessages);
+        if (endpointOpt.has_value())
+        {
+            validateEndpointConfig(endpointOpt.value(), errorMessages);
+        }
+        const auto placeIdsOpt = getValueAtKey<std::vector<std::string>>(peerConfig, "places", errorMessages);
+        if (!placeIdsOpt.has_value())
+        {
+            continue;
+        }
+        for (auto&& placeId : placeIdsOpt.value())
+        {
+            const auto hasId = [&placeId](nlohmann::json const& config) {
+                return config.value("place_id", "") == placeId;
+            };
+            if (std::none_of(placeConfigs.begin(), placeConfigs.end(), hasId))
+            {
+                errorMessages.push_back("Proxy place `" + placeId + "` not found in `petri_net/places`.");
+            }
+            if (std::any_of(actionConfigs.begin(), actionConfigs.end(), hasId))
+            {
+                errorMessages.push_back("Proxy place `" + placeId + "` cannot have an action.");
+            }
+            for (auto&& transitionConfig : transitionConfigs)
+            {
+                for (auto&& arcConfig : transitionConfig.value("transition_arcs", nlohmann::json::array()))
+                {
+                    if (hasId(arcConfig) && arcConfig.value("type", "") != "output")
+                    {
+                        errorMessages.push_back("Proxy place `" + placeId + "` can only be the output of transitions.");
+                    }
+                }
+            }
+            if (std::find(proxyPlaceIds.begin(), proxyPlaceIds.end(), placeId) != proxyPlaceIds.end())
+            {
+                errorMessages.push_back("Proxy place `" + placeId + "` is assigned to more than one peer.");
+            }
+            proxyPlaceIds.push_back(placeId);
+        }
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validatePartitionConfig, "PartitionConfigValidator");
+
+PartitionEndpoint PartitionEndpoint::fromConfig(nlohmann::json const& config)
+{
+    PartitionEndpoint endpoint;
+    if (config.contains("unix_socket"))
+    {
+        endpoint.unixSocket = config.at("unix_socket").get<std::string>();
+    }
+    else
+    {
+        endpoint.address = config.at("address").get<std::string>();
+        endpoint.port = config.at("port").get<int>();
+    }
+    return endpoint;
+}
+
+std::string PartitionEndpoint::str() const
+{
+    return unixSocket.empty() ? "tcp://" + address + ":" + std::to_string(port) : "unix://" + unixSocket;
+}
+
+NetPartition::NetPartition(nlohmann::json const& partitionConfig, Place::IdMap const& places)
+    : m_id(partitionConfig.at("partition_id").get<std::string>())
+    , m_session(createSession())
+    , m_listenEndpoint(PartitionEndpoint::fromConfig(partitionConfig.at("listen")))
+    , m_ioTimeoutMs(static_cast<int>(partitionConfig.value("io_timeout_ms", DEFAULT_IO_TIMEOUT_MS)))
+{
+    for (auto&& peerConfig : partitionConfig.at("peers"))
+    {
+        Peer peer;
+        peer.id = peerConfig.at("partition_id").get<std::string>();
+        peer.endpoint = PartitionEndpoint::fromConfig(peerConfig.at("endpoint"));
+        for (auto&& placeId : peerConfig.at("places"))
+        {
+            peer.proxyPlaces.push_back(places.at(placeId.get<std::string>()));
+        }
+        m_peers.push_back(std::move(peer));
+    }
+}
+
+void NetPartition::start()
+{
+    if (m_running.load())
+    {
+        return;
+    }
+
+    m_listenFd = openSocket(m_listenEndpoint, true);
+    if (m_listenFd < 0)
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "NetPartition::start: failed to listen.")
+            .appendMetadata("partition_id", m_id)
+            .appendMetadata("endpoint", m_listenEndpoint.str())
+            .appendMetadata("error", std::strerror(errno));
+    }
+    LOG(INFO) << "Partition " << m_id << " listening @ " << m_listenEndpoint.str() << log::endl;
+
+    m_running.store(true);
+    m_listenerThread = std::thread([this] { runListener(); });
+}
+
+void NetPartition::stop()
+{
+    m_running.store(false);
+    if (m_listenerThread.joinable())
+    {
+        m_listenerThread.join();
+    }
+    if (m_listenFd >= 0)
+    {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        if (!m_listenEndpoint.unixSocket.empty())
+        {
+            ::unlink(m_listenEndpoint.unixSocket.c_str());
+        }
+    }
+    for (auto&& peer : m_peers)
+    {
+        if (peer.fd >= 0)
+        {
+            ::close(peer.fd);
+            peer.fd = -1;
+        }
+    }
+}
+
+void NetPartition::collectOutgoing()
+{
+    std::vector<Token::SharedPtr> tokens;
+    std::lock_guard<std::mutex> lk(m_outgoingMtx);
+    for (auto&& peer : m_peers)
+    {
+        for (auto&& place : peer.proxyPlaces)
+        {
+            tokens.clear();
+            place->consumeTokens(place->getNumberTokensAvailable(), 0U, tokens);
+            for (auto&& token : tokens)
+            {
+                peer.outgoing.push_back(
+                    TokenTransfer{.placeId = place->getId(), .contentBlocks = token->getContentBlocks()});
+            }
+        }
+    }
+}
+
+void NetPartition::sendOutgoing()
+{
+    for (auto&& peer : m_peers)
+    {
+        std::vector<TokenTransfer> batch;
+        {
+            std::lock_guard<std::mutex> lk(m_outgoingMtx);
+            batch.swap(peer.outgoing);
+        }
+        if (!batch.empty())
+        {
+            ++peer.lastSequence;
+            auto frame = encodeFrame(
+                Frame{.partitionId = m_id, .session = m_session, .sequence = peer.lastSequence, .tokens = batch});
+            peer.unacked.push_back(
+                PendingFrame{.sequence = peer.lastSequence, .numberTokens = batch.size(), .frame = std::move(frame)});
+        }
+        if (peer.unacked.empty())
+        {
+            continue;
+        }
+
+        if (!sendPending(peer))
+        {
+            if (peer.reachable)
+            {
+                size_t numberTokens{0U};
+                for (auto&& pending : peer.unacked)
+                {
+                    numberTokens += pending.numberTokens;
+                }
+                LOG(WARN) << "sendOutgoing: failed to send " << numberTokens << " tokens to partition " << peer.id
+                          << " @ " << peer.endpoint.str() << "; retrying every epoch" << log::endl;
+                peer.reachable = false;
+            }
+            if (peer.fd >= 0)
+            {
+                ::close(peer.fd);
+                peer.fd = -1;
+            }
+        }
+        else if (!peer.reachable)
+        {
+            LOG(INFO) << "sendOutgoing: partition " << peer.id << " reachable again" << log::endl;
+            peer.reachable = true;
+        }
+    }
+}
+
+bool NetPartition::sendPending(Peer& peer)
+{
+    if (peer.fd < 0)
+    {
+        peer.fd = openSocket(peer.endpoint, false, m_ioTimeoutMs);
+        if (peer.fd < 0)
+        {
+            return false;
+        }
+        peer.sentSequence = 0U; // the frames sent over the previous connection may have been lost
+    }
+
+    pollfd pfd{.fd = peer.fd, .events = POLLIN, .revents = 0};
+    std::vector<uint8_t> payload;
+    while (::poll(&pfd, 1, 0) > 0)
+    {
+        if (!readFrame(peer.fd, payload))
+        {
+            return false;
+        }
+        uint64_t ack{0U};
+        try
+        {
+            ack = decodeAck(payload);
+        }
+        catch (nlohmann::json::exception const& e)
+        {
+            LOG(ERROR) << "sendPending: invalid ack; closing connection. error = " << e.what() << log::endl;
+            return false;
+        }
+        while (!peer.unacked.empty() && peer.unacked.front().sequence <= ack)
+        {
+            peer.unacked.pop_front();
+        }
+    }
+
+    for (auto&& pending : peer.unacked)
+    {
+        if (pending.sequence <= peer.sentSequence)
+        {
+            continue;
+        }
+        if (!writeAll(peer.fd, pending.frame.data(), pending.frame.size()))
+        {
+            return false;
+        }
+        peer.sentSequence = pending.sequence;
+    }
+    return true;
+}
+
+std::deque<NetPartition::TokenTransfer> NetPartition::takeIncoming()
+{
+    std::deque<TokenTransfer> incoming;
+    std::lock_guard<std::mutex> lk(m_incomingMtx);
+    incoming.swap(m_incoming);
+    return incoming;
+}
+
+void NetPartition::restoreIncoming(std::deque<TokenTransfer> tokens)
+{
+    std::lock_guard<std::mutex> lk(m_incomingMtx);
+    tokens.insert(tokens.end(), std::make_move_iterator(m_incoming.begin()), std::make_move_iterator(m_incoming.end()));
+    m_incoming.swap(tokens);
+}
+
+std::vector<uint8_t> NetPartition::encodeFrame(Frame const& frame)
+{
+    nlohmann::json payload{{"partition_id", frame.partitionId},
+                           {"session", frame.session},
+                           {"sequence", frame.sequence},
+                           {"tokens", nlohmann::json::array()}};
+    for (auto&& token : frame.tokens)
+    {
+        payload["tokens"].push_back({token.placeId, token.contentBlocks});
+    }
+    return prefixLength(nlohmann::json::to_cbor(payload));
+}
+
+NetPartition::Frame NetPartition::decodePayload(std::vector<uint8_t> const& payload)
+{
+    const auto json = nlohmann::json::from_cbor(payload);
+
+    Frame frame{.partitionId = json.at("partition_id").get<std::string>(),
+                .session = json.at("session").get<uint64_t>(),
+                .sequence = json.at("sequence").get<uint64_t>(),
+                .tokens = {}};
+    for (auto&& token : json.at("tokens"))
+    {
+        frame.tokens.push_back(TokenTransfer{.placeId = token.at(0).get<std::string>(), .contentBlocks = token.at(1)});
+    }
+    return frame;
+}
+
+std::vector<uint8_t> NetPartition::encodeAck(uint64_t sequence)
+{
+    return prefixLength(nlohmann::json::to_cbor(nlohmann::json{{"ack", sequence}}));
+}
+
+uint64_t NetPartition::decodeAck(std::vector<uint8_t> const& payload)
+{
+    return nlohmann::json::from_cbor(payload).at("ack").get<uint64_t>();
+}
+
+void NetPartition::runListener()
+{
+    std::vector<pollfd> fds{pollfd{.fd = m_listenFd, .events = POLLIN, .revents = 0}};
+    while (m_running.load())
+    {
+        if (::poll(fds.data(), fds.size(), LISTENER_POLL_PERIOD_MS) <= 0)
+        {
+            continue;
+        }
+
+        for (size_t i = fds.size(); i-- > 1U;)
+        {
+            if (fds[i].revents != 0 && ((fds[i].revents & POLLIN) == 0 || !receiveFrame(fds[i].fd)))
+            {
+                ::close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+            }
+        }
+
+        if ((fds.front().revents & POLLIN) != 0)
+        {
+            // a peer stalling within a frame then only costs its connection, rather than blocking the listener
+            const int fd = ::accept(m_listenFd, nullptr, nullptr);
+            if (fd >= 0 && !setIoTimeouts(fd, m_ioTimeoutMs))
+            {
+                ::close(fd);
+            }
+            else if (fd >= 0)
+            {
+                fds.push_back(pollfd{.fd = fd, .events = POLLIN, .revents = 0});
+            }
+        }
+    }
+
+    for (size_t i = 1U; i < fds.size(); ++i)
+    {
+        ::close(fds[i].fd);
+    }
+}
+
+bool NetPartition::receiveFrame(int fd)
+{
+    std::vector<uint8_t> payload;
+    if (!readFrame(fd, payload))
+    {
+        return false;
+    }
+
+    uint64_t sequence{0U};
+    try
+    {
+        auto frame = decodePayload(payload);
+        sequence = frame.sequence;
+        auto& received = m_receivedSequences[frame.partitionId];
+        if (received.session != frame.session) // the sender restarted
+        {
+            received = ReceivedSequence{.session = frame.session, .sequence = 0U};
+        }
+        if (frame.sequence > received.sequence) // otherwise, resent after a lost ack
+        {
+            received.sequence = frame.sequence;
+            std::lock_guard<std::mutex> lk(m_incomingMtx);
+            m_incoming.insert(m_incoming.end(), std::make_move_iterator(frame.tokens.begin()),
+                              std::make_move_iterator(frame.tokens.end()));
+        }
+    }
+    catch (nlohmann::json::exception const& e)
+    {
+        LOG(ERROR) << "receiveFrame: invalid frame; closing connection. error = " << e.what() << log::endl;
+        return false;
+    }
+
+    const auto ack = encodeAck(sequence);
+    return writeAll(fd, ack.data(), ack.size());
+}
+
+} // namespace bnet
+} // namespace capybot
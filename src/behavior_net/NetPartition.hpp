@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Place.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// @brief socket endpoint; config: {"address": "127.0.0.1", "port": 9101} (TCP) or {"unix_socket": "/tmp/p1.sock"}
+struct PartitionEndpoint
+{
+    std::string address;
+    int port{0};
+    std::string unixSocket; // if set, `address` and `port` are unused
+
+    static PartitionEndpoint fromConfig(nlohmann::json const& config);
+    std::string str() const;
+};
+
+/**
+ * @brief One partition of a logical net split across several controller processes
+ *
+ * Each partition owns a set of places. Places owned by a peer partition are declared locally as proxy places with the
+ * same id: local transitions output tokens to them, and, once per epoch, the proxy place tokens are moved to the peer,
+ * where they are added to the place they stand for. Proxy places are output only, i.e., they cannot be the input of
+ * a transition nor have an action.
+ *
+ * Transfers are batched, one frame per peer per epoch, over persistent TCP or Unix socket connections. A frame is a
+ * 4-byte big-endian payload length followed by the CBOR encoded payload:
+ *  {"partition_id": "<sender>", "session": <sender run id>, "sequence": <n>, "tokens": [["<place_id>", {...}], ...]}
+ * The receiver answers each frame with an ack frame, {"ack": <n>}. Frames are kept by the sender until acked, and sent
+ * again, in order, over a new connection after a failure; receivers drop the frames of a session they already got.
+ * Hence tokens are neither lost nor duplicated by connection failures or peer restarts, except for the tokens a peer
+ * received but did not add to its net before stopping.
+ *
+ * Socket operations of the sender, i.e., connecting, sending, and reading acks, time out after `io_timeout_ms`, so an
+ * unreachable peer delays an epoch by at most that much per operation. Reads and acks of the listener time out after
+ * it too, and close the connection, so a peer stalling within a frame does not block the other peers.
+ *
+ * Config, `controller/partition`:
+ *  {
+ *    "partition_id": "p1",
+ *    "listen": <PartitionEndpoint>,
+ *    "peers": [{"partition_id": "p2", "endpoint": <PartitionEndpoint>, "places": ["<proxy place id>", ...]}],
+ *    "io_timeout_ms": 100 [optional]
+ *  }
+ */
+class NetPartition
+{
+    static constexpr const char* MODULE_TAG{"NetPartition"};
+
+public:
+    struct TokenTransfer
+    {
+        std::string placeId;
+        nlohmann::json contentBlocks;
+    };
+
+    struct Frame
+    {
+        std::string partitionId; // sender
+        uint64_t session;        // random id of the sender run; sequences restart with it
+        uint64_t sequence;       // per peer, from 1
+        std::vector<TokenTransfer> tokens;
+    };
+
+    NetPartition(nlohmann::json const& partitionConfig, Place::IdMap const& places);
+
+    ~NetPartition() { stop(); }
+
+    /// @brief start accepting peer connections
+    void start();
+    void stop();
+
+    /// @brief [net must not be modified concurrently] move the tokens of proxy places into the outgoing batches
+    void collectOutgoing();
+
+    /// @brief send the outgoing batches, and the unacked ones; may block on the network for up to `io_timeout_ms` per
+    /// peer operation, hence should not be called with the net locked
+    void sendOutgoing();
+
+    /// @return tokens received from peers since the previous call, in arrival order
+    std::deque<TokenTransfer> takeIncoming();
+
+    /// @brief put tokens back in front of the incoming ones, e.g., tokens for places that were full
+    void restoreIncoming(std::deque<TokenTransfer> tokens);
+
+    std::string const& getId() const { return m_id; }
+
+    static std::vector<uint8_t> encodeFrame(Frame const& frame);
+    /// @param payload frame without its length prefix
+    static Frame decodePayload(std::vector<uint8_t> const& payload);
+
+    static std::vector<uint8_t> encodeAck(uint64_t sequence);
+    /// @param payload ack frame without its length prefix
+    static uint64_t decodeAck(std::vector<uint8_t> const& payload);
+
+private:
+    struct PendingFrame
+    {
+        uint64_t sequence;
+        size_t numberTokens;
+        std::vector<uint8_t> frame;
+    };
+
+    struct Peer
+    {
+        std::string id;
+        PartitionEndpoint endpoint;
+        std::vector<Place::SharedPtr> proxyPlaces;
+        std::vector<TokenTransfer> outgoing; // guarded by `m_outgoingMtx`
+        std::deque<PendingFrame> unacked{};  // in sequence order
+        uint64_t lastSequence{0U};
+        uint64_t sentSequence{0U}; // last frame sent over the current connection
+        int fd{-1};
+        bool reachable{true}; // failures are logged once per outage
+    };
+
+    struct ReceivedSequence
+    {
+        uint64_t session{0U};
+        uint64_t sequence{0U};
+    };
+
+    /// @brief read the pending acks, and send the frames not yet sent over the current connection
+    /// @return false on connection failures
+    bool sendPending(Peer& peer);
+    void runListener();
+    /// @return false if the connection was closed or the frame is invalid
+    bool receiveFrame(int fd);
+
+    std::string m_id;
+    const uint64_t m_session;
+    PartitionEndpoint m_listenEndpoint;
+    int m_ioTimeoutMs;
+    std::vector<Peer> m_peers;
+    std::map<std::string, ReceivedSequence> m_receivedSequences{}; // per sender partition; listener thread only
+
+    std::mutex m_outgoingMtx;
+
+    std::mutex m_incomingMtx;
+    std::deque<TokenTransfer> m_incoming;
+
+    int m_listenFd{-1};
+    std::atomic_bool m_running{false};
+    std::thread m_listenerThread;
+};
+
+} // namespace bnet
+} // namespace capybot
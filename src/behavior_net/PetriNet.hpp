@@ -19,10 +19,12 @@
 
 #include <behavior_net/Config.hpp>
 #include <behavior_net/Place.hpp>
+#include <behavior_net/Subnet.hpp>
 #include <behavior_net/Token.hpp>
 #include <behavior_net/Transition.hpp>
 #include <behavior_net/Types.hpp>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
 #include <sstream>
@@ -47,29 +49,45 @@ public:
         : m_config(config)
     {
         m_places = Place::Factory::createPlaces(config);
+        m_subnets = SubnetInstance::Factory::createSubnets(config);
+        createConnectedSubnetPlaces(config);
         m_transitions = Transition::Factory::createTransitions(config, m_places);
     }
 
+    /// @brief thread pool running the actions of subnet instances, which are created as instances are instantiated
+    /// @param caches [optional] result caches of the instance actions; see `ActionRegistry::create`
+    void setActionThreadPool(ThreadPool& tp, ActionResultCacheRegistry* caches = nullptr)
+    {
+        m_actionThreadPool = &tp;
+        m_actionResultCaches = caches;
+    }
+
     /// @param newToken token to be added; will be moved so a token cannot be added more than once as tokens within the
     /// net must be unique
     void addToken(Token::UniquePtr& newToken, std::string_view placeId)
     {
         THROW_ON_NULLPTR(newToken, "PetriNet::addToken");
 
-        bool placeExists{false};
-        for (auto&& [id, placePtr] : m_places)
+        auto it = m_places.find(std::string(placeId));
+        if (it == m_places.end())
         {
-            if (id == placeId)
+            // places of subnet instances not yet instantiated do not exist yet
+            for (auto&& [_, subnet] : m_subnets)
             {
-                placeExists = true;
-                placePtr->insertToken(std::move(newToken));
+                if (!subnet.isInstantiated() && subnet.hasPlace(placeId))
+                {
+                    instantiateSubnet(subnet);
+                    it = m_places.find(std::string(placeId));
+                    break;
+                }
             }
         }
-        if (!placeExists)
+        if (it == m_places.end())
         {
             throw Exception(ExceptionType::RUNTIME_ERROR, "PetriNet::addToken: place with this id does not exist.")
                 .appendMetadata("place_id", placeId);
         }
+        it->second->insertToken(std::move(newToken));
     }
 
     void prettyPrintState() const
@@ -113,34 +131,30 @@ public:
     {
         LOG(DEBUG) << "triggerTransition @ " << id << "; " << (assertIsManual ? "manual" : "auto") << log::endl;
 
-        bool exists{false};
-        for (auto&& transition : m_transitions)
+        // not triggered while iterating: triggering may append the transitions of a subnet instance
+        const auto it = std::find_if(m_transitions.begin(), m_transitions.end(),
+                                     [&id](Transition const& transition) { return transition.getId() == id; });
+        if (it == m_transitions.end())
         {
-            if (transition.getId() == id)
-            {
-                if (assertIsManual && !transition.isManual())
-                {
-                    throw Exception(ExceptionType::RUNTIME_ERROR,
-                                    "PetriNet::triggerTransition: trying to manually trigger an auto transition.")
-                        .appendMetadata("id", id);
-                }
-
-                exists = true;
-                transition.trigger();
-            }
+            throw Exception(ExceptionType::RUNTIME_ERROR,
+                            "PetriNet::triggerTransition: transition with this id does not exist.")
+                .appendMetadata("id", id);
         }
-        if (!exists)
+        if (assertIsManual && !it->isManual())
         {
             throw Exception(ExceptionType::RUNTIME_ERROR,
-                            "PetriNet::triggerTransition: transition with this id does not exist.")
+                            "PetriNet::triggerTransition: trying to manually trigger an auto transition.")
                 .appendMetadata("id", id);
         }
+        it->trigger();
     }
 
+    /// @brief transitions of subnet instances are appended as instances are instantiated; references stay valid
     auto const& getTransitions() const { return m_transitions; }
     auto const& getPlaces() const { return m_places; }
     auto& getTransitions() { return m_transitions; }
     auto& getPlaces() { return m_places; }
+    auto const& getSubnets() const { return m_subnets; }
 
     nlohmann::json getMarking() const
     {
@@ -155,10 +169,45 @@ public:
     }
 
 private:
+    /// @brief create the subnet instance places net transitions connect to; instances are instantiated on their first
+    /// token, through any of their places
+    void createConnectedSubnetPlaces(nlohmann::json const& config)
+    {
+        for (auto&& transitionConfig : config.at("transitions"))
+        {
+            for (auto&& arcConfig : transitionConfig.at("transition_arcs"))
+            {
+                const auto placeId = arcConfig.at("place_id").get<std::string>();
+                if (m_places.count(placeId) != 0U)
+                {
+                    continue;
+                }
+                for (auto&& [_, subnet] : m_subnets)
+                {
+                    if (subnet.hasPlace(placeId))
+                    {
+                        auto place = subnet.createPlace(placeId);
+                        place->setFirstTokenCallback([this, &subnet](Place&) { instantiateSubnet(subnet); });
+                        m_places.emplace(placeId, std::move(place));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void instantiateSubnet(SubnetInstance& subnet)
+    {
+        subnet.instantiate(m_places, m_actionThreadPool, m_transitions, m_actionResultCaches);
+    }
+
     nlohmann::json m_config;
 
     Place::IdMap m_places;
-    std::vector<Transition> m_transitions;
+    Transition::List m_transitions;
+    SubnetInstance::IdMap m_subnets;
+    ThreadPool* m_actionThreadPool{nullptr};
+    ActionResultCacheRegistry* m_actionResultCaches{nullptr};
 };
 
 } // namespace bnet
@@ -50,6 +50,58 @@ bool validatePlacesConfig(nlohmann::json const& netConfig, std::vector<std::stri
                 ids.push_back(id.value());
             }
         }
+
+        if (placeConfig.contains("capacity"))
+        {
+            const auto capacity = getValueAtKey<int64_t>(placeConfig, "capacity", errorMessages);
+            if (capacity.has_value() && (capacity.value() <= 0 || capacity.value() > Place::MAX_CAPACITY))
+            {
+                errorMessages.push_back("Invalid `capacity` for place `" + id.value_or("") +
+                                        "`; expected a positive integer, at most " +
+                                        std::to_string(Place::MAX_CAPACITY) + ".");
+            }
+        }
+
+        if (placeConfig.contains("reserved_tokens"))
+        {
+            const auto reserved = getValueAtKey<int64_t>(placeConfig, "reserved_tokens", errorMessages);
+            if (reserved.has_value() && (reserved.value() < 0 || reserved.value() > Place::MAX_RESERVED_TOKENS))
+            {
+                errorMessages.push_back("Invalid `reserved_tokens` for place `" + id.value_or("") +
+                                        "`; expected at most " + std::to_string(Place::MAX_RESERVED_TOKENS) + ".");
+            }
+        }
+
+        if (placeConfig.contains("token_selection"))
+        {
+            const auto selectionConfig = placeConfig.at("token_selection");
+            const auto policyStrOpt = getValueAtKey<std::string>(selectionConfig, "policy", errorMessages);
+            if (policyStrOpt.has_value())
+            {
+                const auto policyOpt = TokenSelectionPolicy::_from_string_nocase_nothrow(policyStrOpt.value().c_str());
+                if (!policyOpt)
+                {
+                    errorMessages.push_back("Invalid token selection policy `" + policyStrOpt.value() + "`.");
+                }
+                else if (policyOpt.value() == +TokenSelectionPolicy::PRIORITY ||
+                         policyOpt.value() == +TokenSelectionPolicy::DEADLINE)
+                {
+                    // selection key is required and must be a valid content path
+                    const auto keyOpt = getValueAtKey<std::string>(selectionConfig, "key", errorMessages);
+                    if (keyOpt.has_value())
+                    {
+                        try
+                        {
+                            std::ignore = TokenContentPath(keyOpt.value());
+                        }
+                        catch (Exception const& e)
+                        {
+                            errorMessages.push_back("Invalid token selection `key` `" + keyOpt.value() + "`.");
+                        }
+                    }
+                }
+            }
+        }
     }
 
     return errorMessages.empty();
@@ -57,7 +109,9 @@ bool validatePlacesConfig(nlohmann::json const& netConfig, std::vector<std::stri
 
 REGISTER_NET_CONFIG_VALIDATOR(&validatePlacesConfig, "PlacesConfigValidator");
 
-void Place::setAssociatedAction(ThreadPool& tp, std::string const& type, nlohmann::json const& parameters)
+void Place::setAssociatedAction(ThreadPool& tp, std::string const& type, nlohmann::json const& parameters,
+                                std::optional<ThreadPool::LaneId> lane, Action::Options const& options,
+                                ActionResultCacheRegistry* caches)
 {
     if (m_action)
     {
@@ -66,14 +120,32 @@ void Place::setAssociatedAction(ThreadPool& tp, std::string const& type, nlohman
             .appendMetadata("place_id", getId());
     }
 
-    m_action = ActionRegistry::create(tp, type, parameters);
+    m_action = ActionRegistry::create(tp, type, parameters, lane, options, caches);
 }
 
 void Place::insertToken(Token::SharedPtr token)
 {
+    if (m_firstTokenCallback)
+    {
+        auto callback = std::move(m_firstTokenCallback);
+        m_firstTokenCallback = nullptr;
+        callback(*this);
+    }
+
+    if (!hasCapacityFor(1U))
+    {
+        throw Exception(ExceptionType::CAPACITY_EXCEEDED, "Place::insertToken: place is full.")
+            .appendMetadata("place_id", getId())
+            .appendMetadata("capacity", m_capacity.value());
+    }
+    if (m_reservedTokens > 0U)
+    {
+        reserveEntryStorage();
+    }
+
     if (isPassive())
     {
-        m_tokensAvailable.push_back({token, ActionExecutionStatus::SUCCESS});
+        m_tokensAvailable.push(std::move(token), ActionExecutionStatus::SUCCESS);
     }
     else
     {
@@ -83,48 +155,73 @@ void Place::insertToken(Token::SharedPtr token)
 
 Token::SharedPtr Place::consumeToken(ActionExecutionStatusSet resultsAccepted)
 {
-    if (getNumberTokensAvailable(resultsAccepted) == 0U)
+    std::vector<Token::SharedPtr> consumed;
+    consumeTokens(1U, resultsAccepted, consumed);
+    return consumed.front();
+}
+
+void Place::consumeTokens(uint32_t numberTokens, ActionExecutionStatusSet resultsAccepted,
+                          std::vector<Token::SharedPtr>& consumed, TokenGuard const* guard)
+{
+    const auto numberTokensAvailable = guard != nullptr
+                                           ? getNumberTokensAvailable(resultsAccepted, *guard, numberTokens)
+                                           : getNumberTokensAvailable(resultsAccepted);
+    if (numberTokensAvailable < numberTokens)
     {
         throw Exception(ExceptionType::LOGIC_ERROR,
-                        "Place::consumeToken: no tokens available for consumption. `getNumberTokensAvailable()` "
-                        "should have been called beforehand.")
+                        "Place::consumeTokens: not enough tokens available for consumption. "
+                        "`getNumberTokensAvailable()` should have been called beforehand.")
             .appendMetadata("place_id", getId())
+            .appendMetadata("requested tokens", numberTokens)
             .appendMetadata("available tokens", getNumberTokensAvailable())
             .appendMetadata("busy tokens", getNumberTokensBusy())
             .appendMetadata("total tokens", getNumberTokensTotal());
     }
 
-    Token::SharedPtr token{};
-    if (resultsAccepted.any())
+    consumed.reserve(consumed.size() + numberTokens);
+    for (uint32_t i = 0U; i < numberTokens; ++i)
     {
-        for (auto it = m_tokensAvailable.begin(); it != m_tokensAvailable.end(); it++)
-        {
-            if (resultsAccepted.test(it->status))
-            {
-                token = it->tokenPtr;
-                m_tokensAvailable.erase(it);
-                break;
-            }
-        }
+        consumed.push_back(guard != nullptr ? m_tokensAvailable.popIf(resultsAccepted,
+                                                                      [guard](Token const& token) {
+                                                                          return guard->evaluate(token);
+                                                                      })
+                                            : m_tokensAvailable.pop(resultsAccepted));
     }
-    else
+}
+
+void Place::consumeTokens(uint32_t numberTokens, ActionExecutionStatusSet resultsAccepted, size_t keyIndexId,
+                          nlohmann::json const& key, std::vector<Token::SharedPtr>& consumed)
+{
+    if (getNumberTokensAvailable(resultsAccepted, keyIndexId, key) < numberTokens)
     {
-        token = m_tokensAvailable.front().tokenPtr;
-        m_tokensAvailable.pop_front();
+        throw Exception(ExceptionType::LOGIC_ERROR,
+                        "Place::consumeTokens: not enough tokens available for consumption with key.")
+            .appendMetadata("place_id", getId())
+            .appendMetadata("key path", m_tokensAvailable.getKeyIndexPath(keyIndexId).str())
+            .appendMetadata("key", key)
+            .appendMetadata("requested tokens", numberTokens);
+    }
+
+    // the key may be owned by the index, which drops it once its last token is consumed
+    const auto keyCopy = key;
+    consumed.reserve(consumed.size() + numberTokens);
+    for (uint32_t i = 0U; i < numberTokens; ++i)
+    {
+        consumed.push_back(m_tokensAvailable.popKey(keyIndexId, keyCopy, resultsAccepted));
     }
-    return token;
 }
 
-void Place::executeActionAsync()
+void Place::executeActionAsync(ThreadPool::CompletionCounter::SharedPtr const& counter, uint32_t maxDispatch)
 {
     if (!isPassive())
     {
-        m_action->executeAsync(getTokensBusy());
+        m_action->executeAsync(getTokensBusy(), counter, maxDispatch);
     }
 }
 
-void Place::checkActionResults()
+uint32_t Place::checkActionResults(EventTraceRecorder* recorder)
 {
+    uint32_t numberCompleted{0U};
     if (!isPassive())
     {
         const auto actionResults = m_action->getEpochResults();
@@ -140,8 +237,13 @@ void Place::checkActionResults()
             auto it = std::find(m_tokensBusy.begin(), m_tokensBusy.end(), result.tokenPtr);
             if (it != m_tokensBusy.end())
             {
+                if (recorder)
+                {
+                    recorder->recordActionResult(getId(), std::distance(m_tokensBusy.begin(), it), result.status);
+                }
                 m_tokensBusy.erase(it);
-                m_tokensAvailable.push_back(result);
+                m_tokensAvailable.push(result.tokenPtr, result.status);
+                ++numberCompleted;
             }
             else
             {
@@ -152,6 +254,22 @@ void Place::checkActionResults()
             }
         }
     }
+    return numberCompleted;
+}
+
+void Place::applyActionResult(uint32_t busyIndex, ActionExecutionStatus status)
+{
+    if (busyIndex >= getNumberTokensBusy())
+    {
+        throw Exception(ExceptionType::LOGIC_ERROR, "Place::applyActionResult: busy token index out of range.")
+            .appendMetadata("place_id", getId())
+            .appendMetadata("busy index", busyIndex)
+            .appendMetadata("busy tokens", getNumberTokensBusy());
+    }
+
+    auto it = m_tokensBusy.begin() + busyIndex;
+    m_tokensAvailable.push(*it, status);
+    m_tokensBusy.erase(it);
 }
 
 } // namespace bnet
@@ -19,10 +19,16 @@
 
 #include <behavior_net/ActionRegistry.hpp>
 #include <behavior_net/Common.hpp>
+#include <behavior_net/EventTrace.hpp>
 #include <behavior_net/Token.hpp>
+#include <behavior_net/TokenGuard.hpp>
+#include <behavior_net/TokenQueue.hpp>
+
+#include <utils/RingBuffer.hpp>
 
 #include <3rd_party/nlohmann/json.hpp>
-#include <list>
+#include <algorithm>
+#include <functional>
 #include <optional>
 #include <unordered_map>
 
@@ -31,11 +37,19 @@ namespace capybot
 namespace bnet
 {
 
+/// @brief validate `petri_net/places`
+bool validatePlacesConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages);
+
 class Place
 {
     static constexpr const char* MODULE_TAG{"Place"};
 
 public:
+    /// upper bound of the `reserved_tokens` config, and of the storage reserved for a capacity
+    static constexpr uint32_t MAX_RESERVED_TOKENS{1U << 16};
+    /// upper bound of the `capacity` config
+    static constexpr uint32_t MAX_CAPACITY{1U << 24};
+
     using SharedPtr = std::shared_ptr<Place>;
     using IdMap = std::map<std::string, SharedPtr>;
 
@@ -53,11 +67,17 @@ public:
             return placePtrs;
         }
 
-        static void createActions(ThreadPool& tp, nlohmann::json const actionsConfig, IdMap& places)
+        /// @param caches [optional] see `ActionRegistry::create`
+        static void createActions(ThreadPool& tp, nlohmann::json const actionsConfig, IdMap& places,
+                                  ActionResultCacheRegistry* caches = nullptr)
         {
             for (auto&& config : actionsConfig)
             {
-                places.at(config["place_id"])->setAssociatedAction(tp, config["type"], config["params"]);
+                const auto lane = config.contains("lane") ? std::make_optional(tp.getLane(config["lane"]))
+                                                          : std::nullopt;
+                const auto options = Action::Options::fromConfig(config);
+                places.at(config["place_id"])
+                    ->setAssociatedAction(tp, config["type"], config["params"], lane, options, caches);
             }
         }
     };
@@ -65,39 +85,147 @@ public:
     Place(nlohmann::json config)
         : m_id(config.at("place_id").get<std::string>())
         , m_action(nullptr)
+        , m_tokensAvailable(createTokenQueue(config))
     {
+        if (config.contains("capacity"))
+        {
+            m_capacity = config.at("capacity").get<uint32_t>();
+            m_reservedTokens = std::min(m_capacity.value(), MAX_RESERVED_TOKENS);
+        }
+        if (config.contains("reserved_tokens"))
+        {
+            m_reservedTokens = config.at("reserved_tokens").get<uint32_t>();
+        }
     }
 
-    void setAssociatedAction(ThreadPool& tp, std::string const& type, nlohmann::json const& parameters);
+    /// @param lane [optional] thread pool lane of the action; see `ActionRegistry::create`
+    /// @param caches [optional] see `ActionRegistry::create`
+    void setAssociatedAction(ThreadPool& tp, std::string const& type, nlohmann::json const& parameters,
+                             std::optional<ThreadPool::LaneId> lane = std::nullopt,
+                             Action::Options const& options = Action::Options(),
+                             ActionResultCacheRegistry* caches = nullptr);
+    /// @throw Exception CAPACITY_EXCEEDED if the place is full
     void insertToken(Token::SharedPtr token);
     Token::SharedPtr consumeToken(ActionExecutionStatusSet resultsAccepted = 0U);
-    void executeActionAsync();
-    void checkActionResults();
+
+    /// @brief bulk version of `consumeToken`; consumed tokens are appended to `consumed` in selection policy order
+    /// @param guard [optional] only tokens satisfying it are consumed
+    void consumeTokens(uint32_t numberTokens, ActionExecutionStatusSet resultsAccepted,
+                       std::vector<Token::SharedPtr>& consumed, TokenGuard const* guard = nullptr);
+    /// @brief consume tokens whose value at the path of key index `keyIndexId` is `key`; see `addKeyIndex`
+    void consumeTokens(uint32_t numberTokens, ActionExecutionStatusSet resultsAccepted, size_t keyIndexId,
+                       nlohmann::json const& key, std::vector<Token::SharedPtr>& consumed);
+    /// @param counter [optional] group the dispatched action tasks are added to
+    /// @param maxDispatch maximum number of new action executions; see `Action::executeAsync`
+    void executeActionAsync(ThreadPool::CompletionCounter::SharedPtr const& counter = nullptr,
+                            uint32_t maxDispatch = UINT32_MAX);
+    /// @brief number of busy tokens the action would execute next epoch; 0 for passive places
+    uint32_t getNumberAdmissibleTokens() const
+    {
+        return isPassive() ? 0U : m_action->getNumberAdmissible(m_tokensBusy);
+    }
+
+    /// @param recorder [optional] if set, collected action results are recorded to it
+    /// @return number of completed actions
+    uint32_t checkActionResults(EventTraceRecorder* recorder = nullptr);
+
+    /// @brief complete the action of a busy token with a given result, bypassing the action; used for replaying traces
+    /// @param busyIndex index of the token in the busy list, as recorded by `checkActionResults`
+    void applyActionResult(uint32_t busyIndex, ActionExecutionStatus status);
 
     bool isPassive() const { return m_action == nullptr; }
+    /// @return associated action, or nullptr for passive places
+    Action const* getAction() const { return m_action.get(); }
     std::string const& getId() const { return m_id; }
 
+    std::optional<uint32_t> const& getCapacity() const { return m_capacity; }
+    bool hasCapacityFor(uint32_t numberTokens) const
+    {
+        return !m_capacity.has_value() || getNumberTokensTotal() + numberTokens <= m_capacity.value();
+    }
+
     uint32_t getNumberTokensBusy() const { return m_tokensBusy.size(); }
     uint32_t getNumberTokensTotal() const { return m_tokensBusy.size() + m_tokensAvailable.size(); }
     uint32_t getNumberTokensAvailable(ActionExecutionStatusSet status = 0U) const
     {
-        if (status.any())
+        return m_tokensAvailable.size(status);
+    }
+
+    /// @brief number of available tokens satisfying `guard`, counted up to `limit`; O(n), unlike the unguarded count
+    uint32_t getNumberTokensAvailable(ActionExecutionStatusSet status, TokenGuard const& guard, uint32_t limit) const
+    {
+        return m_tokensAvailable.countIf(
+            status, [&guard](Token const& token) { return guard.evaluate(token); }, limit);
+    }
+
+    /// @brief index the available tokens by their value at `path`, e.g., for join transitions; see TokenQueue
+    /// @return key index id
+    size_t addKeyIndex(TokenContentPath const& path) { return m_tokensAvailable.addKeyIndex(path); }
+    TokenQueue::KeyIndex const& getKeyIndex(size_t keyIndexId) const
+    {
+        return m_tokensAvailable.getKeyIndex(keyIndexId);
+    }
+    TokenContentPath const& getKeyIndexPath(size_t keyIndexId) const
+    {
+        return m_tokensAvailable.getKeyIndexPath(keyIndexId);
+    }
+    /// @brief number of available tokens with `key` at the path of key index `keyIndexId`; O(1)
+    uint32_t getNumberTokensAvailable(ActionExecutionStatusSet status, size_t keyIndexId,
+                                      nlohmann::json const& key) const
+    {
+        return m_tokensAvailable.countKey(keyIndexId, key, status);
+    }
+
+    RingBuffer<Token::SharedPtr> const& getTokensBusy() const { return m_tokensBusy; }
+
+    TokenSelectionPolicy getTokenSelectionPolicy() const { return m_tokensAvailable.getPolicy(); }
+
+    /// @brief set a callback invoked once, right before the first token is inserted; e.g., to lazily set up the
+    /// subnet instance the place belongs to
+    void setFirstTokenCallback(std::function<void(Place&)> callback) { m_firstTokenCallback = std::move(callback); }
+
+private:
+    /// @brief from the optional `token_selection` config: {"policy": "<TokenSelectionPolicy>", "key": "<content path>"}
+    static TokenQueue createTokenQueue(nlohmann::json const& config)
+    {
+        if (!config.contains("token_selection"))
         {
-            return std::count_if(m_tokensAvailable.begin(), m_tokensAvailable.end(),
-                                 [&status](ActionExecutionResult const& s) { return status.test(s.status); });
+            return TokenQueue();
         }
-        return m_tokensAvailable.size();
+        auto const& selectionConfig = config.at("token_selection");
+        return TokenQueue(
+            TokenSelectionPolicy::_from_string_nocase(selectionConfig.at("policy").get<std::string>().c_str()),
+            selectionConfig.contains("key")
+                ? std::optional<TokenContentPath>(selectionConfig.at("key").get<std::string>())
+                : std::nullopt);
     }
 
-    std::list<Token::SharedPtr> const& getTokensBusy() const { return m_tokensBusy; }
+    /// @brief preallocate the storage tokens are inserted to, i.e., the busy tokens, or the available ones of passive
+    /// places, to `reserved_tokens`, or to the capacity, up to `MAX_RESERVED_TOKENS`; deferred to the first token, as
+    /// the place action is set after construction
+    void reserveEntryStorage()
+    {
+        if (isPassive())
+        {
+            m_tokensAvailable.reserve(m_reservedTokens, ActionExecutionStatus::SUCCESS);
+        }
+        else
+        {
+            m_tokensBusy.reserve(m_reservedTokens);
+        }
+        m_reservedTokens = 0U;
+    }
 
-private:
     std::string m_id;
     Action::UniquePtr m_action;
+    std::optional<uint32_t> m_capacity{}; // max number of tokens (busy + available); enforced, not preallocated
+    uint32_t m_reservedTokens{0U};        // storage preallocated on the first token; see `reserveEntryStorage()`
+
+    TokenQueue m_tokensAvailable; // ready to be consumed
 
-    std::list<ActionExecutionResult> m_tokensAvailable; // ready to be consumed
+    RingBuffer<Token::SharedPtr> m_tokensBusy; // either in action exec or waiting for exec
 
-    std::list<Token::SharedPtr> m_tokensBusy; // either in action exec or waiting for exec
+    std::function<void(Place&)> m_firstTokenCallback;
 };
 
 } // namespace bnet
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/ShardedTransitionScheduler.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateShardingConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("sharding"))
+    {
+        return true; // not sharded
+    }
+
+    const auto numberShardsOpt =
+        getValueAtPath<uint32_t>(netConfig, {"controller", "sharding", "number_shards"}, errorMessages);
+    if (numberShardsOpt.has_value() && numberShardsOpt.value() == 0U)
+    {
+        errorMessages.push_back("Invalid `number_shards`; expected at least one shard.");
+    }
+    if (netConfig.contains("petri_net") && netConfig.at("petri_net").contains("subnets"))
+    {
+        errorMessages.push_back("Sharding is not supported for nets with subnet instances.");
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateShardingConfig, "ShardingConfigValidator");
+
+std::vector<std::vector<size_t>> ShardedTransitionScheduler::findComponents(Transition::List const& transitions)
+{
+    // union-find over transitions; transitions sharing a place are merged
+    std::vector<size_t> parent(transitions.size());
+    std::iota(parent.begin(), parent.end(), 0U);
+    const auto find = [&parent](size_t i) {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    std::unordered_map<std::string, size_t> placeOwner; // place id -> a transition with an arc to it
+    for (size_t i = 0U; i < transitions.size(); ++i)
+    {
+        for (auto&& placeId : transitions[i].getPlaceIds())
+        {
+            const auto [it, inserted] = placeOwner.emplace(placeId, i);
+            if (!inserted)
+            {
+                parent[find(i)] = find(it->second);
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> components;
+    std::unordered_map<size_t, size_t> componentIdx; // root -> index in `components`
+    for (size_t i = 0U; i < transitions.size(); ++i)
+    {
+        const auto [it, inserted] = componentIdx.emplace(find(i), components.size());
+        if (inserted)
+        {
+            components.emplace_back();
+        }
+        components[it->second].push_back(i);
+    }
+    return components;
+}
+
+ShardedTransitionScheduler::ShardedTransitionScheduler(Transition::List& transitions,
+                                                       nlohmann::json const& controllerConfig)
+{
+    const auto maxNumberShards = controllerConfig.at("sharding").at("number_shards").get<uint32_t>();
+    const auto affinityConfig = controllerConfig.value("cpu_affinity", nlohmann::json::object());
+    m_workerPlacement = affinityConfig.contains("shard_workers")
+                            ? CpuPlacement::fromConfig(affinityConfig, "shard_workers")
+                            : CpuPlacement::fromConfig(affinityConfig, "controller_loop");
+
+    auto components = findComponents(transitions);
+    m_numberComponents = components.size();
+
+    // components with manual transitions only are never fired by the scheduler
+    std::erase_if(components, [&transitions](std::vector<size_t> const& component) {
+        return std::all_of(component.begin(), component.end(),
+                           [&transitions](size_t i) { return transitions[i].isManual(); });
+    });
+
+    // longest processing time first: the largest components go to the least loaded shards
+    std::sort(components.begin(), components.end(),
+              [](auto const& a, auto const& b) { return a.size() > b.size(); });
+    const auto numberShards = std::max<size_t>(1U, std::min<size_t>(maxNumberShards, components.size()));
+    std::vector<std::unordered_set<Transition const*>> shardTransitions(numberShards);
+    std::vector<size_t> shardLoads(numberShards, 0U);
+    for (auto&& component : components)
+    {
+        const auto shardIdx = std::distance(shardLoads.begin(), std::min_element(shardLoads.begin(), shardLoads.end()));
+        for (auto&& i : component)
+        {
+            shardTransitions[shardIdx].insert(&transitions[i]);
+        }
+        shardLoads[shardIdx] += component.size();
+    }
+
+    for (auto&& members : shardTransitions)
+    {
+        auto shard = std::make_unique<Shard>();
+        shard->scheduler = std::make_unique<TransitionScheduler>(
+            transitions, controllerConfig,
+            [members = std::move(members)](Transition const& transition) { return members.count(&transition) != 0U; });
+        m_shards.push_back(std::move(shard));
+    }
+    for (size_t i = 1U; i < m_shards.size(); ++i)
+    {
+        m_shards[i]->worker = std::thread([this, &shard = *m_shards[i]] { runWorker(shard); });
+    }
+
+    LOG(INFO) << "Net partitioned into " << m_numberComponents << " components over " << m_shards.size() << " shards"
+              << log::endl;
+}
+
+ShardedTransitionScheduler::~ShardedTransitionScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_stopped = true;
+    }
+    m_epochStarted.notify_all();
+    for (auto&& shard : m_shards)
+    {
+        if (shard->worker.joinable())
+        {
+            shard->worker.join();
+        }
+    }
+}
+
+void ShardedTransitionScheduler::fireEnabled(std::vector<Transition const*>& fired)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        ++m_epoch;
+        m_numberShardsRunning = m_shards.size() - 1U;
+    }
+    m_epochStarted.notify_all();
+
+    fireShard(*m_shards.front());
+
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_shardDone.wait(lk, [this] { return m_numberShardsRunning == 0U; });
+    }
+
+    fired.clear();
+    for (auto&& shard : m_shards)
+    {
+        if (shard->error)
+        {
+            std::rethrow_exception(std::exchange(shard->error, nullptr));
+        }
+        fired.insert(fired.end(), shard->fired.begin(), shard->fired.end());
+    }
+}
+
+void ShardedTransitionScheduler::runWorker(Shard& shard)
+{
+    // created by the thread constructing the controller, whose placement would be inherited otherwise
+    if (m_workerPlacement.has_value())
+    {
+        m_workerPlacement->applyToCurrentThread("shard worker");
+    }
+
+    uint64_t epoch{0U};
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lk(m_mtx);
+            m_epochStarted.wait(lk, [this, epoch] { return m_stopped || m_epoch != epoch; });
+            if (m_stopped)
+            {
+                return;
+            }
+            epoch = m_epoch;
+        }
+
+        fireShard(shard);
+
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            --m_numberShardsRunning;
+        }
+        m_shardDone.notify_one();
+    }
+}
+
+void ShardedTransitionScheduler::fireShard(Shard& shard)
+{
+    try
+    {
+        shard.scheduler->fireEnabled(shard.fired);
+    }
+    catch (...)
+    {
+        shard.fired.clear();
+        shard.error = std::current_exception();
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+#include <behavior_net/Transition.hpp>
+#include <behavior_net/TransitionScheduler.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Fires the auto transitions of independent parts of the net in parallel
+ *
+ * The net is partitioned into its connected components: places and transitions linked by arcs, manual transitions
+ * included. Components share no places, hence no tokens, so they can fire concurrently and reach the same marking as
+ * when fired one after the other. Components are balanced over the shards by number of transitions. Each shard has its
+ * own `TransitionScheduler`; the first shard fires on the calling thread, the others on dedicated worker threads woken
+ * once per epoch.
+ *
+ * Nets with subnet instances are not sharded, as instantiation adds transitions to the net while firing.
+ *
+ * Config: `controller/sharding/number_shards`; the actual number of shards is at most the number of components with
+ * auto transitions. The workers are pinned to the `shard_workers` placement of `controller/cpu_affinity`, or else to
+ * the `controller_loop` one, as they share its work; see `CpuPlacement`.
+ */
+class ShardedTransitionScheduler
+{
+    static constexpr const char* MODULE_TAG{"ShardedTransitionScheduler"};
+
+public:
+    ShardedTransitionScheduler(Transition::List& transitions, nlohmann::json const& controllerConfig);
+
+    ~ShardedTransitionScheduler();
+
+    /// @brief fire enabled auto transitions of all shards, in parallel; see `TransitionScheduler::fireEnabled`
+    /// @param fired [output] cleared, then filled with the fired transitions, shard after shard
+    void fireEnabled(std::vector<Transition const*>& fired);
+
+    size_t getNumberShards() const { return m_shards.size(); }
+    size_t getNumberComponents() const { return m_numberComponents; }
+
+    /// @return connected components of the net, as lists of transition indexes into `transitions`
+    static std::vector<std::vector<size_t>> findComponents(Transition::List const& transitions);
+
+private:
+    struct Shard
+    {
+        std::unique_ptr<TransitionScheduler> scheduler;
+        std::vector<Transition const*> fired;
+        std::exception_ptr error;
+        std::thread worker; // not joinable for the first shard
+    };
+
+    void runWorker(Shard& shard);
+    static void fireShard(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    size_t m_numberComponents{0U};
+    std::optional<CpuPlacement> m_workerPlacement{};
+
+    std::mutex m_mtx;
+    std::condition_variable m_epochStarted;
+    std::condition_variable m_shardDone;
+    uint64_t m_epoch{0U};             // incremented to wake the workers
+    size_t m_numberShardsRunning{0U}; // workers yet to finish the current epoch
+    bool m_stopped{false};
+};
+
+} // namespace bnet
+} // namespace capybot
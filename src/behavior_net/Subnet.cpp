@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/Subnet.hpp>
+
+#include <algorithm>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+/// @return config of the template with `templateId`, or nullptr
+nlohmann::json const* findTemplateConfig(nlohmann::json const& netConfig, std::string const& templateId)
+{
+    auto const& petriNetConfig = netConfig.at("petri_net");
+    if (!petriNetConfig.contains("subnet_templates") || !petriNetConfig.at("subnet_templates").is_array())
+    {
+        return nullptr;
+    }
+    for (auto&& templateConfig : petriNetConfig.at("subnet_templates"))
+    {
+        if (templateConfig.value("template_id", "") == templateId)
+        {
+            return &templateConfig;
+        }
+    }
+    return nullptr;
+}
+
+nlohmann::json prefixPlaceIds(nlohmann::json configs, std::string const& prefix, char const* key)
+{
+    for (auto&& config : configs)
+    {
+        config[key] = prefix + config.at(key).get<std::string>();
+    }
+    return configs;
+}
+} // namespace
+
+bool validateSubnetsConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    const auto petriNetConfigOpt = getValueAtKey<nlohmann::json const>(netConfig, "petri_net", errorMessages);
+    if (!petriNetConfigOpt.has_value())
+    {
+        return false;
+    }
+    auto const& petriNetConfig = petriNetConfigOpt.value();
+
+    // templates are valid nets of their own
+    std::vector<std::string> templateIds{};
+    if (petriNetConfig.contains("subnet_templates"))
+    {
+        for (auto&& templateConfig : petriNetConfig.at("subnet_templates"))
+        {
+            const auto idOpt = getValueAtKey<std::string>(templateConfig, "template_id", errorMessages);
+            if (!idOpt.has_value())
+            {
+                continue;
+            }
+            if (std::find(templateIds.begin(), templateIds.end(), idOpt.value()) != templateIds.end())
+            {
+                errorMessages.push_back("Repeated `template_id`: " + idOpt.value());
+            }
+            templateIds.push_back(idOpt.value());
+
+            const auto placesOpt = getValueAtKey<nlohmann::json>(templateConfig, "places", errorMessages);
+            const auto transitionsOpt = getValueAtKey<nlohmann::json>(templateConfig, "transitions", errorMessages);
+            if (!placesOpt.has_value() || !transitionsOpt.has_value())
+            {
+                continue;
+            }
+            const nlohmann::json templateNet{
+                {"petri_net", {{"places", placesOpt.value()}, {"transitions", transitionsOpt.value()}}}};
+            for (auto&& validator : {&validatePlacesConfig, &validateTransitionsConfig})
+            {
+                std::vector<std::string> templateErrors{};
+                if (!validator(templateNet, templateErrors))
+                {
+                    for (auto&& error : templateErrors)
+                    {
+                        errorMessages.push_back("Subnet template `" + idOpt.value() + "`: " + error);
+                    }
+                }
+            }
+
+            for (auto&& actionConfig : templateConfig.value("actions", nlohmann::json::array()))
+            {
+                const auto placeIdOpt = getValueAtKey<std::string>(actionConfig, "place_id", errorMessages);
+                std::ignore = getValueAtKey<std::string>(actionConfig, "type", errorMessages);
+                auto const& places = placesOpt.value();
+                if (placeIdOpt.has_value() &&
+                    std::none_of(places.begin(), places.end(), [&placeIdOpt](nlohmann::json const& place) {
+                        return place.value("place_id", "") == placeIdOpt.value();
+                    }))
+                {
+                    errorMessages.push_back("Subnet template `" + idOpt.value() + "`: action place_id `" +
+                                            placeIdOpt.value() + "` not found in template `places`.");
+                }
+            }
+        }
+    }
+
+    // instances refer to existing templates; their places do not collide with the net ones
+    if (petriNetConfig.contains("subnets"))
+    {
+        std::vector<std::string> subnetIds{};
+        for (auto&& subnetConfig : petriNetConfig.at("subnets"))
+        {
+            const auto idOpt = getValueAtKey<std::string>(subnetConfig, "subnet_id", errorMessages);
+            const auto templateIdOpt = getValueAtKey<std::string>(subnetConfig, "template_id", errorMessages);
+            if (idOpt.has_value())
+            {
+                if (idOpt.value().empty() || idOpt.value().find('/') != std::string::npos)
+                {
+                    errorMessages.push_back("Invalid `subnet_id` `" + idOpt.value() + "`; expected a non-empty id "
+                                            "without `/`.");
+                }
+                if (std::find(subnetIds.begin(), subnetIds.end(), idOpt.value()) != subnetIds.end())
+                {
+                    errorMessages.push_back("Repeated `subnet_id`: " + idOpt.value());
+                }
+                subnetIds.push_back(idOpt.value());
+            }
+            if (templateIdOpt.has_value() &&
+                std::find(templateIds.begin(), templateIds.end(), templateIdOpt.value()) == templateIds.end())
+            {
+                errorMessages.push_back("Subnet template `" + templateIdOpt.value() + "` not found.");
+            }
+        }
+
+        for (auto&& placeConfig : getSubnetInstancePlaceConfigs(netConfig))
+        {
+            const auto placeId = placeConfig.at("place_id").get<std::string>();
+            for (auto&& netPlaceConfig : petriNetConfig.value("places", nlohmann::json::array()))
+            {
+                if (netPlaceConfig.value("place_id", "") == placeId)
+                {
+                    errorMessages.push_back("Subnet instance place `" + placeId + "` collides with a net place.");
+                }
+            }
+        }
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateSubnetsConfig, "SubnetsConfigValidator");
+
+nlohmann::json getSubnetInstancePlaceConfigs(nlohmann::json const& netConfig)
+{
+    auto placeConfigs = nlohmann::json::array();
+    try
+    {
+        auto const& petriNetConfig = netConfig.at("petri_net");
+        if (!petriNetConfig.contains("subnets"))
+        {
+            return placeConfigs;
+        }
+        for (auto&& subnetConfig : petriNetConfig.at("subnets"))
+        {
+            const auto templateConfig =
+                findTemplateConfig(netConfig, subnetConfig.at("template_id").get<std::string>());
+            if (templateConfig == nullptr)
+            {
+                continue;
+            }
+            const auto prefix = subnetConfig.at("subnet_id").get<std::string>() + "/";
+            for (auto&& placeConfig : prefixPlaceIds(templateConfig->at("places"), prefix, "place_id"))
+            {
+                placeConfigs.push_back(placeConfig);
+            }
+        }
+    }
+    catch (nlohmann::json::exception const&)
+    {
+        // invalid subnet configs are reported by `validateSubnetsConfig`
+    }
+    return placeConfigs;
+}
+
+nlohmann::json expandSubnets(nlohmann::json const& netConfig)
+{
+    auto expanded = netConfig;
+    auto& petriNetConfig = expanded.at("petri_net");
+    if (!petriNetConfig.contains("subnets"))
+    {
+        return expanded;
+    }
+
+    for (auto&& subnetConfig : netConfig.at("petri_net").at("subnets"))
+    {
+        auto const& templateConfig = *findTemplateConfig(netConfig, subnetConfig.at("template_id").get<std::string>());
+        const auto prefix = subnetConfig.at("subnet_id").get<std::string>() + "/";
+        for (auto&& placeConfig : prefixPlaceIds(templateConfig.at("places"), prefix, "place_id"))
+        {
+            petriNetConfig["places"].push_back(placeConfig);
+        }
+        for (auto transitionConfig : templateConfig.at("transitions"))
+        {
+            transitionConfig["transition_id"] = prefix + transitionConfig.at("transition_id").get<std::string>();
+            transitionConfig["transition_arcs"] =
+                prefixPlaceIds(transitionConfig.at("transition_arcs"), prefix, "place_id");
+            petriNetConfig["transitions"].push_back(transitionConfig);
+        }
+    }
+    petriNetConfig.erase("subnets");
+    petriNetConfig.erase("subnet_templates");
+    return expanded;
+}
+
+SubnetTemplate::SubnetTemplate(nlohmann::json const& config)
+    : m_id(config.at("template_id").get<std::string>())
+    , m_placeConfigs(config.at("places"))
+    , m_actionConfigs(config.value("actions", nlohmann::json::array()))
+{
+    m_prototypePlaces = Place::Factory::createPlaces(config);
+    m_transitions = Transition::Factory::createTransitions(config, m_prototypePlaces);
+}
+
+SubnetInstance::IdMap SubnetInstance::Factory::createSubnets(nlohmann::json const& netConfig)
+{
+    IdMap subnets;
+    if (!netConfig.contains("subnets"))
+    {
+        return subnets;
+    }
+
+    std::map<std::string, SubnetTemplate::ConstSharedPtr> templates;
+    for (auto&& templateConfig : netConfig.at("subnet_templates"))
+    {
+        auto subnetTemplate = std::make_shared<const SubnetTemplate>(templateConfig);
+        templates.emplace(subnetTemplate->getId(), std::move(subnetTemplate));
+    }
+
+    for (auto&& subnetConfig : netConfig.at("subnets"))
+    {
+        auto id = subnetConfig.at("subnet_id").get<std::string>();
+        subnets.emplace(id, SubnetInstance(id, templates.at(subnetConfig.at("template_id").get<std::string>())));
+    }
+
+    LOG(INFO) << "Created " << subnets.size() << " subnet instances of " << templates.size() << " templates"
+              << log::endl;
+    return subnets;
+}
+
+bool SubnetInstance::hasPlace(std::string_view placeId) const
+{
+    if (placeId.size() <= m_id.size() + 1U || placeId.substr(0U, m_id.size()) != m_id || placeId[m_id.size()] != '/')
+    {
+        return false;
+    }
+    const auto localId = placeId.substr(m_id.size() + 1U);
+    auto const& placeConfigs = m_template->getPlaceConfigs();
+    return std::any_of(placeConfigs.begin(), placeConfigs.end(), [&localId](nlohmann::json const& placeConfig) {
+        return placeConfig.at("place_id").get_ref<std::string const&>() == localId;
+    });
+}
+
+Place::SharedPtr SubnetInstance::createPlace(std::string const& placeId) const
+{
+    const auto localId = placeId.substr(m_id.size() + 1U);
+    for (auto placeConfig : m_template->getPlaceConfigs())
+    {
+        if (placeConfig.at("place_id").get_ref<std::string const&>() == localId)
+        {
+            placeConfig["place_id"] = placeId;
+            return std::make_shared<Place>(placeConfig);
+        }
+    }
+    throw Exception(ExceptionType::LOGIC_ERROR, "SubnetInstance::createPlace: place not found in template.")
+        .appendMetadata("subnet_id", m_id)
+        .appendMetadata("place_id", placeId);
+}
+
+void SubnetInstance::instantiate(Place::IdMap& places, ThreadPool* tp, Transition::List& transitions,
+                                 ActionResultCacheRegistry* caches)
+{
+    if (m_instantiated)
+    {
+        throw Exception(ExceptionType::LOGIC_ERROR, "SubnetInstance::instantiate: already instantiated.")
+            .appendMetadata("subnet_id", m_id);
+    }
+    m_instantiated = true;
+
+    const auto prefix = getIdPrefix();
+    for (auto&& placeConfig : m_template->getPlaceConfigs())
+    {
+        const auto placeId = prefix + placeConfig.at("place_id").get<std::string>();
+        auto it = places.find(placeId);
+        if (it == places.end())
+        {
+            it = places.emplace(placeId, createPlace(placeId)).first;
+        }
+        it->second->setFirstTokenCallback(nullptr);
+    }
+
+    if (!m_template->getActionConfigs().empty())
+    {
+        if (tp == nullptr)
+        {
+            throw Exception(ExceptionType::LOGIC_ERROR,
+                            "SubnetInstance::instantiate: template actions require a thread pool.")
+                .appendMetadata("subnet_id", m_id)
+                .appendMetadata("template_id", m_template->getId());
+        }
+        Place::Factory::createActions(*tp, prefixPlaceIds(m_template->getActionConfigs(), prefix, "place_id"), places,
+                                      caches);
+    }
+
+    for (auto&& prototype : m_template->getTransitions())
+    {
+        transitions.push_back(prototype.bind(places, prefix));
+    }
+
+    LOG(DEBUG) << "Instantiated subnet " << m_id << " of template " << m_template->getId() << log::endl;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Place.hpp>
+#include <behavior_net/Transition.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// @return configs of the places of all subnet instances, with instance place ids; best effort on invalid configs
+nlohmann::json getSubnetInstancePlaceConfigs(nlohmann::json const& netConfig);
+
+/// @return copy of `netConfig` in which every subnet instance is expanded into `petri_net/places` and
+/// `petri_net/transitions`; used by the offline analysis tools, which need the whole net
+nlohmann::json expandSubnets(nlohmann::json const& netConfig);
+
+/**
+ * @brief Subnet template, compiled once and shared by all its instances
+ *
+ * Config, within `petri_net/subnet_templates`:
+ *  {"template_id": "workcell", "places": [...], "transitions": [...], "actions": [...]}
+ * where places and transitions have the same format as the net ones, and actions the same format as
+ * `controller/actions`. Template arcs refer to template places only.
+ *
+ * The template transitions are compiled once against prototype places, which never hold tokens; instances bind copies
+ * of them to their own places, sharing compiled filters and guards.
+ */
+class SubnetTemplate
+{
+    static constexpr const char* MODULE_TAG{"SubnetTemplate"};
+
+public:
+    using ConstSharedPtr = std::shared_ptr<const SubnetTemplate>;
+
+    explicit SubnetTemplate(nlohmann::json const& config);
+
+    std::string const& getId() const { return m_id; }
+    nlohmann::json const& getPlaceConfigs() const { return m_placeConfigs; }
+    nlohmann::json const& getActionConfigs() const { return m_actionConfigs; }
+    Transition::List const& getTransitions() const { return m_transitions; }
+
+private:
+    std::string m_id;
+    nlohmann::json m_placeConfigs;
+    nlohmann::json m_actionConfigs;
+    Place::IdMap m_prototypePlaces;
+    Transition::List m_transitions; // bound to `m_prototypePlaces`
+};
+
+/**
+ * @brief Instance of a subnet template, whose places and transitions are allocated on the first token
+ *
+ * Config, within `petri_net/subnets`: {"subnet_id": "cell_0", "template_id": "workcell"}. Instance place and transition
+ * ids are the template ones prefixed by "<subnet_id>/", e.g., `cell_0/Idle`; net transitions connect to instances
+ * through these ids. Until the instance is used, it only holds its id and a pointer to its template, and the places
+ * connected to the net, if any.
+ */
+class SubnetInstance
+{
+    static constexpr const char* MODULE_TAG{"SubnetInstance"};
+
+public:
+    using IdMap = std::map<std::string, SubnetInstance>;
+
+    class Factory
+    {
+    public:
+        /// @return instances of `petri_net/subnets`; templates are compiled once, no matter the number of instances
+        static IdMap createSubnets(nlohmann::json const& netConfig);
+    };
+
+    SubnetInstance(std::string id, SubnetTemplate::ConstSharedPtr subnetTemplate)
+        : m_id(std::move(id))
+        , m_template(std::move(subnetTemplate))
+    {
+    }
+
+    std::string const& getId() const { return m_id; }
+    std::string getIdPrefix() const { return m_id + "/"; }
+    SubnetTemplate const& getTemplate() const { return *m_template; }
+    bool isInstantiated() const { return m_instantiated; }
+
+    /// @return whether `placeId` is the id of one of the instance places
+    bool hasPlace(std::string_view placeId) const;
+
+    /// @brief create one instance place, e.g., a place connected to the net, before the instance is instantiated
+    Place::SharedPtr createPlace(std::string const& placeId) const;
+
+    /**
+     * @brief allocate the instance state: its places, their actions, and its transitions
+     *
+     * @param places [in/out] instance places are added to it; the ones already in it are reused
+     * @param tp [optional] thread pool running the template actions; required if the template has actions
+     * @param transitions [output] instance transitions, bound to `places`, are appended to it
+     * @param caches [optional] result caches of the template actions; see `ActionRegistry::create`
+     */
+    void instantiate(Place::IdMap& places, ThreadPool* tp, Transition::List& transitions,
+                     ActionResultCacheRegistry* caches = nullptr);
+
+private:
+    std::string m_id;
+    SubnetTemplate::ConstSharedPtr m_template;
+    bool m_instantiated{false};
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/ThreadPool.hpp>
+
+#include <algorithm>
+#include <set>
+
+namespace capybot
+{
+namespace bnet
+{
+
+void validateThreadPoolLanesConfig(nlohmann::json const& lanesConfig, std::vector<std::string>& errorMessages)
+{
+    if (!lanesConfig.is_array())
+    {
+        errorMessages.push_back("Invalid `thread_pool_lanes`; expected a list of lanes.");
+        return;
+    }
+
+    std::set<std::string> laneIds{ThreadPool::DEFAULT_LANE_ID, ThreadPool::BLOCKING_IO_LANE_ID};
+    std::set<std::string> actionTypes{};
+    for (auto&& laneConfig : lanesConfig)
+    {
+        const auto laneIdOpt = getValueAtKey<std::string>(laneConfig, "lane_id", errorMessages);
+        if (laneIdOpt.has_value() && !laneIds.insert(laneIdOpt.value()).second)
+        {
+            errorMessages.push_back("Repeated or reserved `lane_id`: " + laneIdOpt.value());
+        }
+
+        const auto workersOpt = getValueAtKey<uint32_t>(laneConfig, "workers", errorMessages);
+        if (workersOpt.has_value() && workersOpt.value() == 0U)
+        {
+            errorMessages.push_back("Invalid `workers` of lane `" + laneIdOpt.value_or("") +
+                                    "`; expected at least one worker.");
+        }
+
+        if (laneConfig.contains("action_types"))
+        {
+            const auto typesOpt = getValueAtKey<std::vector<std::string>>(laneConfig, "action_types", errorMessages);
+            for (auto&& actionType : typesOpt.value_or(std::vector<std::string>{}))
+            {
+                if (!actionTypes.insert(actionType).second)
+                {
+                    errorMessages.push_back("Action type `" + actionType + "` is assigned to more than one lane.");
+                }
+            }
+        }
+    }
+}
+
+bool validateNetThreadPoolLanesConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller"))
+    {
+        return true;
+    }
+    auto const& controllerConfig = netConfig.at("controller");
+
+    std::set<std::string> laneIds{ThreadPool::DEFAULT_LANE_ID, ThreadPool::BLOCKING_IO_LANE_ID};
+    if (controllerConfig.contains("thread_pool_lanes"))
+    {
+        validateThreadPoolLanesConfig(controllerConfig.at("thread_pool_lanes"), errorMessages);
+        if (controllerConfig.at("thread_pool_lanes").is_array())
+        {
+            for (auto&& laneConfig : controllerConfig.at("thread_pool_lanes"))
+            {
+                laneIds.insert(laneConfig.value("lane_id", ""));
+            }
+        }
+
+        // lanes of a net config are only known here if the net is not hosted; hosted nets refer to the host lanes
+        if (controllerConfig.contains("actions"))
+        {
+            for (auto&& actionConfig : controllerConfig.at("actions"))
+            {
+                if (actionConfig.contains("lane") && !laneIds.contains(actionConfig.value("lane", "")))
+                {
+                    errorMessages.push_back("Action of place `" + actionConfig.value("place_id", "") +
+                                            "` refers to an unknown lane: " + actionConfig.at("lane").dump());
+                }
+            }
+        }
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateNetThreadPoolLanesConfig, "ThreadPoolLanesConfigValidator");
+
+} // namespace bnet
+} // namespace capybot
@@ -18,6 +18,9 @@
 #pragma once
 
 #include <3rd_party/taskflow/taskflow.hpp>
+#include <behavior_net/Common.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+#include <behavior_net/ElasticWorkerPool.hpp>
 #include <behavior_net/Types.hpp>
 #include <utils/Logger.hpp>
 
@@ -25,7 +28,10 @@
 #include <condition_variable>
 #include <exception>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace capybot
 {
@@ -35,12 +41,82 @@ namespace bnet
 /**
  * @brief Prototype as a simple thread pool for executing async actions.
  *
+ * Tasks are executed in lanes. Each lane has its own reserved workers, which steal work only from tasks of the same
+ * lane, so a flood of slow tasks in one lane does not delay the tasks of other lanes. The default lane always exists;
+ * further lanes are added from `controller/thread_pool_lanes`, e.g.,
+ *
+ *    "thread_pool_lanes": [
+ *        {"lane_id": "latency_critical", "workers": 1, "action_types": ["TimerAction"]},
+ *        {"lane_id": "bulk", "workers": 4}
+ *    ]
+ *
+ * Actions of the listed types run in the lane, unless an action config selects another lane with `"lane": <lane_id>`.
+ *
+ * The `blocking_io` lane always exists as well, configured by `controller/blocking_io_pool`. It is an elastic pool,
+ * see `ElasticWorkerPool`, for actions that block on external calls; actions declaring
+ * `IActionImpl::performsBlockingIo()` run in it unless configured otherwise.
  */
 class ThreadPool
 {
     static constexpr const char* MODULE_TAG{"ThreadPool"};
 
 public:
+    /**
+     * @brief Tracks a group of tasks, e.g., those dispatched in one epoch, and signals once all of them finished
+     *
+     * The counter starts open; tasks are added while dispatching, and `seal()` closes the group, so a task finishing
+     * during dispatch does not signal early. The group signals only if it has tasks and all of them returned a final
+     * status; a task returning, e.g., IN_PROGRESS is polled again later, so waiting for it would not help.
+     */
+    class CompletionCounter
+    {
+    public:
+        using SharedPtr = std::shared_ptr<CompletionCounter>;
+
+        explicit CompletionCounter(std::function<void()> onAllFinished)
+            : m_onAllFinished(std::move(onAllFinished))
+        {
+        }
+
+        void add()
+        {
+            m_pending.fetch_add(1U);
+            m_numberTasks.fetch_add(1U);
+        }
+
+        /// @brief close the group; no more tasks are added
+        void seal() { done(true); }
+
+        /// @param finished whether the task returned a final status, i.e., SUCCESS, FAILURE or ERROR
+        void done(bool finished)
+        {
+            if (!finished)
+            {
+                m_allFinished.store(false);
+            }
+            if (m_pending.fetch_sub(1U) == 1U && m_numberTasks.load() > 0U && m_allFinished.load() && m_armed.load())
+            {
+                m_onAllFinished();
+            }
+        }
+
+        /// @brief stop signalling, e.g., once nobody waits for the group anymore
+        void disarm() { m_armed.store(false); }
+
+    private:
+        std::atomic<uint32_t> m_pending{1U}; // the open group counts as one pending task, see `seal()`
+        std::atomic<uint32_t> m_numberTasks{0U};
+        std::atomic_bool m_allFinished{true};
+        std::atomic_bool m_armed{true};
+        const std::function<void()> m_onAllFinished;
+    };
+
+    using LaneId = size_t;
+    static constexpr LaneId DEFAULT_LANE{0U};
+    static constexpr const char* DEFAULT_LANE_ID{"default"};
+    static constexpr LaneId BLOCKING_IO_LANE{1U};
+    static constexpr const char* BLOCKING_IO_LANE_ID{"blocking_io"};
+
     /**
      * @brief Task element to be executed by the thread pool.
      *
@@ -50,12 +126,18 @@ public:
         static constexpr const char* MODULE_TAG{"ThreadPool::Task"};
 
     public:
-        Task(std::function<ActionExecutionStatus()> func)
+        /// @param counter [optional] group the task belongs to; notified once the task is done
+        Task(std::function<ActionExecutionStatus()> func, CompletionCounter::SharedPtr counter = nullptr)
             : m_func(func)
             , m_return(ActionExecutionStatus::NOT_STARTED)
             , m_started(false)
             , m_done(false)
+            , m_counter(std::move(counter))
         {
+            if (m_counter)
+            {
+                m_counter->add();
+            }
         }
 
         /// Execute task synchronously - this call will block
@@ -82,11 +164,20 @@ public:
                            << log::endl;
                 m_return = ActionExecutionStatus::ERROR;
             }
+            // the task may be destroyed as soon as it is done, so the counter is kept alive locally
+            const auto counter = m_counter;
+            const bool finished = m_return == +ActionExecutionStatus::SUCCESS ||
+                                  m_return == +ActionExecutionStatus::FAILURE ||
+                                  m_return == +ActionExecutionStatus::ERROR;
             {
                 std::lock_guard<std::mutex> lk(m_mtx);
                 m_done = true;
             }
             m_waitCondition.notify_all();
+            if (counter)
+            {
+                counter->done(finished);
+            }
         }
 
         /// Get return value after completion
@@ -114,35 +205,190 @@ public:
         bool m_done;
         mutable std::condition_variable m_waitCondition;
         mutable std::mutex m_mtx;
+        const CompletionCounter::SharedPtr m_counter;
     };
 
-    ThreadPool(uint32_t numberOfThreads = std::thread::hardware_concurrency())
-        : m_executor(numberOfThreads)
+    /// @param numberOfThreads number of workers of the default lane
+    /// @param blockingIoParams parameters of the blocking IO lane
+    /// @param workerPlacement [optional] cores the workers of all lanes are pinned to
+    ThreadPool(uint32_t numberOfThreads = std::thread::hardware_concurrency(),
+               ElasticWorkerPool::Params blockingIoParams = {},
+               std::optional<CpuPlacement> const& workerPlacement = std::nullopt)
     {
+        if (workerPlacement.has_value())
+        {
+            m_workerInterface = std::make_shared<PinningWorkerInterface>(workerPlacement.value());
+            blockingIoParams.workerPrologue = [placement = workerPlacement.value()] {
+                placement.applyToCurrentThread("blocking IO worker");
+            };
+        }
+
+        addLane(DEFAULT_LANE_ID, numberOfThreads);
+        m_lanes.push_back(
+            Lane{.id = BLOCKING_IO_LANE_ID, .elasticPool = std::make_unique<ElasticWorkerPool>(blockingIoParams)});
+        m_laneIds.emplace(BLOCKING_IO_LANE_ID, BLOCKING_IO_LANE);
     }
 
     ~ThreadPool()
     {
         m_stopped.store(true);
         LOG(DEBUG) << "[ThreadPool::~ThreadPool] Stopping ThreadPoll; waiting for unfinished tasks ..." << log::endl;
-        m_executor.wait_for_all();
+        for (auto&& lane : m_lanes)
+        {
+            if (lane.executor)
+            {
+                lane.executor->wait_for_all();
+            }
+        }
+        m_lanes.clear(); // the elastic pools wait for their tasks on destruction
         LOG(DEBUG) << "[ThreadPool::~ThreadPool] Stopping ThreadPoll ... done." << log::endl;
     }
 
-    /// @brief add task to the thread pool queue for execution
-    void executeAsync(Task& task)
+    /**
+     * @brief add a lane with its own reserved workers; lanes must be added before any task is executed
+     *
+     * @param laneId unique lane id
+     * @param numberOfThreads number of workers reserved for the lane
+     * @param actionTypes action types executed in this lane by default; see `getActionTypeLane`
+     * @return id used to execute tasks in the lane
+     */
+    LaneId addLane(std::string const& laneId, uint32_t numberOfThreads,
+                   std::vector<std::string> const& actionTypes = {})
+    {
+        if (m_laneIds.contains(laneId))
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "ThreadPool::addLane: lane already exists.")
+                .appendMetadata("lane_id", laneId);
+        }
+        if (numberOfThreads == 0U)
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "ThreadPool::addLane: a lane needs at least one worker.")
+                .appendMetadata("lane_id", laneId);
+        }
+
+        const LaneId lane = m_lanes.size();
+        m_lanes.push_back(
+            Lane{.id = laneId, .executor = std::make_unique<tf::Executor>(numberOfThreads, m_workerInterface)});
+        m_laneIds.emplace(laneId, lane);
+        for (auto&& actionType : actionTypes)
+        {
+            m_actionTypeLanes[actionType] = lane;
+        }
+        return lane;
+    }
+
+    /// @brief add the lanes of a `thread_pool_lanes` config; see class description
+    void addLanes(nlohmann::json const& lanesConfig)
+    {
+        for (auto&& laneConfig : lanesConfig)
+        {
+            addLane(laneConfig.at("lane_id").get<std::string>(), laneConfig.at("workers").get<uint32_t>(),
+                    laneConfig.value("action_types", std::vector<std::string>{}));
+        }
+    }
+
+    /// @throw Exception INVALID_VALUE if there is no lane `laneId`
+    LaneId getLane(std::string const& laneId) const
+    {
+        const auto it = m_laneIds.find(laneId);
+        if (it == m_laneIds.end())
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "ThreadPool::getLane: unknown lane.")
+                .appendMetadata("lane_id", laneId);
+        }
+        return it->second;
+    }
+
+    /// @return the lane configured for `actionType`, or the default lane
+    LaneId getActionTypeLane(std::string const& actionType) const
+    {
+        const auto it = m_actionTypeLanes.find(actionType);
+        return it == m_actionTypeLanes.end() ? DEFAULT_LANE : it->second;
+    }
+
+    std::string const& getLaneId(LaneId lane) const { return m_lanes.at(lane).id; }
+
+    /// @return number of workers of a lane; for the blocking IO lane, the number of currently running workers
+    size_t getNumberWorkers(LaneId lane = DEFAULT_LANE) const
+    {
+        auto const& laneRef = m_lanes.at(lane);
+        return laneRef.executor ? laneRef.executor->num_workers() : laneRef.elasticPool->getNumberWorkers();
+    }
+
+    /// @brief add task to the queue of a lane for execution
+    void executeAsync(Task& task, LaneId lane = DEFAULT_LANE)
     {
         if (m_stopped.load()) // ignore new tasks while on destruction
         {
             return;
         }
-        m_executor.silent_async([&task] { task.executeSync(); });
+        auto const& laneRef = m_lanes[lane];
+        if (laneRef.executor)
+        {
+            laneRef.executor->silent_async([&task] { task.executeSync(); });
+        }
+        else
+        {
+            laneRef.elasticPool->execute([&task] { task.executeSync(); });
+        }
+    }
+
+    /// @brief run `func` in a lane, without a task to query; while on destruction, `func` runs on the calling thread,
+    /// as it may be needed to complete other work, e.g., resuming a coroutine
+    void executeDetached(std::function<void()> func, LaneId lane = DEFAULT_LANE)
+    {
+        if (m_stopped.load())
+        {
+            func();
+            return;
+        }
+        auto const& laneRef = m_lanes[lane];
+        if (laneRef.executor)
+        {
+            laneRef.executor->silent_async(std::move(func));
+        }
+        else
+        {
+            laneRef.elasticPool->execute(std::move(func));
+        }
     }
 
 private:
+    class PinningWorkerInterface : public tf::WorkerInterface
+    {
+    public:
+        explicit PinningWorkerInterface(CpuPlacement placement)
+            : m_placement(std::move(placement))
+        {
+        }
+
+        void scheduler_prologue(tf::Worker&) override { m_placement.applyToCurrentThread("thread pool worker"); }
+        void scheduler_epilogue(tf::Worker&, std::exception_ptr) override {}
+
+    private:
+        const CpuPlacement m_placement;
+    };
+
+    struct Lane
+    {
+        std::string id;
+        std::unique_ptr<tf::Executor> executor{};         // null for elastic lanes
+        std::unique_ptr<ElasticWorkerPool> elasticPool{}; // null for work-stealing lanes
+    };
+
     std::atomic_bool m_stopped{false};
-    tf::Executor m_executor;
+    std::shared_ptr<tf::WorkerInterface> m_workerInterface{}; // null if workers are not pinned
+    std::vector<Lane> m_lanes{};
+    std::map<std::string, LaneId> m_laneIds{};
+    std::map<std::string, LaneId> m_actionTypeLanes{};
 };
 
+/**
+ * @brief validate a `thread_pool_lanes` config; see `ThreadPool`
+ *
+ * @param errorMessages [output] found errors are appended to it
+ */
+void validateThreadPoolLanesConfig(nlohmann::json const& lanesConfig, std::vector<std::string>& errorMessages);
+
 } // namespace bnet
 } // namespace capybot
@@ -61,6 +61,24 @@ public:
         return m_contentBlocks.at(key);
     }
 
+    /// @return content block for key, or nullptr if the token has no such block; does not copy the block
+    nlohmann::json const* findContent(std::string const& key) const
+    {
+        const auto it = m_contentBlocks.find(key);
+        return it != m_contentBlocks.end() ? &it->second : nullptr;
+    }
+
+    /// @return all content blocks, as a json object keyed by block key
+    nlohmann::json getContentBlocks() const
+    {
+        nlohmann::json blocks = nlohmann::json::object();
+        for (auto&& [key, block] : m_contentBlocks)
+        {
+            blocks[key] = block;
+        }
+        return blocks;
+    }
+
     void addContentBlock(std::string const& key, nlohmann::json blockContent)
     {
         const auto [it, success] = m_contentBlocks.insert({key, blockContent});
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Token.hpp>
+
+#include <optional>
+#include <string>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Path to a value within a token content, e.g., `order.priority` is the field `priority` of the block `order`
+ *
+ * The path is parsed once; resolving it does not allocate.
+ */
+class TokenContentPath
+{
+    static constexpr const char* MODULE_TAG{"TokenContentPath"};
+
+public:
+    explicit TokenContentPath(std::string const& path)
+        : m_path(path)
+    {
+        const auto blockEnd = path.find('.');
+        m_blockKey = path.substr(0U, blockEnd);
+        if (m_blockKey.empty())
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "TokenContentPath: empty content block key.")
+                .appendMetadata("path", path);
+        }
+
+        std::string pointer;
+        for (auto pos = blockEnd; pos != std::string::npos;)
+        {
+            const auto next = path.find('.', pos + 1U);
+            const auto field = path.substr(pos + 1U, next == std::string::npos ? std::string::npos : next - pos - 1U);
+            if (field.empty())
+            {
+                throw Exception(ExceptionType::INVALID_VALUE, "TokenContentPath: empty field.")
+                    .appendMetadata("path", path);
+            }
+            pointer += "/";
+            for (auto c : field) // JSON pointer escaping
+            {
+                pointer += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1U, c);
+            }
+            pos = next;
+        }
+        m_pointer = nlohmann::json::json_pointer(pointer);
+    }
+
+    std::string const& str() const { return m_path; }
+    std::string const& getBlockKey() const { return m_blockKey; }
+
+    /// @return value at path, or nullptr if the token content does not have it
+    nlohmann::json const* resolve(Token const& token) const
+    {
+        auto block = token.findContent(m_blockKey);
+        if (block == nullptr || !block->contains(m_pointer))
+        {
+            return nullptr;
+        }
+        return &(*block)[m_pointer];
+    }
+
+    /// @return numeric value at path, or std::nullopt if missing or not a number
+    std::optional<double> resolveNumber(Token const& token) const
+    {
+        auto value = resolve(token);
+        if (value == nullptr || !value->is_number())
+        {
+            return std::nullopt;
+        }
+        return value->get<double>();
+    }
+
+private:
+    std::string m_path;
+    std::string m_blockKey;
+    nlohmann::json::json_pointer m_pointer;
+};
+
+} // namespace bnet
+} // namespace capybot
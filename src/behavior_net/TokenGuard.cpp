@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/TokenGuard.hpp>
+
+#include <array>
+#include <cctype>
+#include <limits>
+#include <string_view>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// @brief recursive descent parser emitting postfix bytecode; tracks the kind of each stack slot to type-check
+/// operators
+class TokenGuard::Compiler
+{
+public:
+    explicit Compiler(TokenGuard& guard)
+        : m_guard(guard)
+        , m_input(guard.m_expression)
+    {
+    }
+
+    void compile()
+    {
+        parseOr();
+        toCondition();
+        skipSpaces();
+        if (m_pos != m_input.size())
+        {
+            fail("unexpected trailing characters.");
+        }
+    }
+
+private:
+    enum class Kind
+    {
+        VALUE,
+        CONDITION
+    };
+
+    void parseOr()
+    {
+        parseAnd();
+        while (consume("||"))
+        {
+            toCondition();
+            parseAnd();
+            toCondition();
+            emit(OpCode::OR);
+        }
+    }
+
+    void parseAnd()
+    {
+        parseNot();
+        while (consume("&&"))
+        {
+            toCondition();
+            parseNot();
+            toCondition();
+            emit(OpCode::AND);
+        }
+    }
+
+    void parseNot()
+    {
+        skipSpaces();
+        if (peek() == '!' && peek(1U) != '=')
+        {
+            ++m_pos;
+            parseNot();
+            toCondition();
+            emit(OpCode::NOT);
+            return;
+        }
+        parseComparison();
+    }
+
+    void parseComparison()
+    {
+        parsePrimary();
+
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 6U> operators{{{"==", OpCode::EQ},
+                                                                                          {"!=", OpCode::NE},
+                                                                                          {"<=", OpCode::LE},
+                                                                                          {">=", OpCode::GE},
+                                                                                          {"<", OpCode::LT},
+                                                                                          {">", OpCode::GT}}};
+        for (auto&& [symbol, op] : operators)
+        {
+            if (consume(symbol))
+            {
+                requireValue();
+                parsePrimary();
+                requireValue();
+                emit(op);
+                return;
+            }
+        }
+    }
+
+    void parsePrimary()
+    {
+        skipSpaces();
+        const auto c = peek();
+        if (c == '(')
+        {
+            ++m_pos;
+            parseOr();
+            if (!consume(")"))
+            {
+                fail("expected `)`.");
+            }
+        }
+        else if (consume("@token{"))
+        {
+            const auto end = m_input.find('}', m_pos);
+            if (end == std::string::npos)
+            {
+                fail("expected `}`.");
+            }
+            emitOperand(OpCode::PUSH_PATH, m_guard.m_paths.size());
+            m_guard.m_paths.emplace_back(m_input.substr(m_pos, end - m_pos));
+            m_pos = end + 1U;
+        }
+        else if (c == '\'' || c == '"')
+        {
+            const auto end = m_input.find(c, m_pos + 1U);
+            if (end == std::string::npos)
+            {
+                fail("unterminated string.");
+            }
+            pushConstant(m_input.substr(m_pos + 1U, end - m_pos - 1U));
+            m_pos = end + 1U;
+        }
+        else if (c == '-' || std::isdigit(static_cast<unsigned char>(c)))
+        {
+            const auto start = m_pos++;
+            while (m_pos < m_input.size() && (std::isalnum(static_cast<unsigned char>(m_input[m_pos])) ||
+                                              m_input[m_pos] == '.' || m_input[m_pos] == '+' ||
+                                              (m_input[m_pos] == '-' && std::tolower(m_input[m_pos - 1U]) == 'e')))
+            {
+                ++m_pos;
+            }
+            try
+            {
+                pushConstant(nlohmann::json::parse(m_input.substr(start, m_pos - start)));
+            }
+            catch (nlohmann::json::exception const&)
+            {
+                m_pos = start;
+                fail("invalid number.");
+            }
+        }
+        else if (consumeKeyword("true"))
+        {
+            pushConstant(true);
+        }
+        else if (consumeKeyword("false"))
+        {
+            pushConstant(false);
+        }
+        else if (consumeKeyword("null"))
+        {
+            pushConstant(nullptr);
+        }
+        else
+        {
+            fail("expected operand.");
+        }
+    }
+
+    void pushConstant(nlohmann::json value)
+    {
+        emitOperand(OpCode::PUSH_CONSTANT, m_guard.m_constants.size());
+        m_guard.m_constants.push_back(std::move(value));
+    }
+
+    void emitOperand(OpCode op, size_t operand)
+    {
+        if (operand > std::numeric_limits<uint16_t>::max())
+        {
+            fail("too many operands.");
+        }
+        m_guard.m_code.push_back({op, static_cast<uint16_t>(operand)});
+        m_kinds.push_back(Kind::VALUE);
+        if (m_kinds.size() > MAX_STACK_DEPTH)
+        {
+            fail("expression nested too deep.");
+        }
+    }
+
+    void emit(OpCode op)
+    {
+        m_guard.m_code.push_back({op});
+        if (op != OpCode::IS_TRUE && op != OpCode::NOT) // binary
+        {
+            m_kinds.pop_back();
+        }
+        m_kinds.back() = Kind::CONDITION;
+    }
+
+    void toCondition()
+    {
+        if (m_kinds.back() == Kind::VALUE)
+        {
+            emit(OpCode::IS_TRUE);
+        }
+    }
+
+    void requireValue()
+    {
+        if (m_kinds.back() != Kind::VALUE)
+        {
+            fail("comparison operands must be values, not conditions.");
+        }
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_input.size() && std::isspace(static_cast<unsigned char>(m_input[m_pos])))
+        {
+            ++m_pos;
+        }
+    }
+
+    char peek(size_t offset = 0U) const { return m_pos + offset < m_input.size() ? m_input[m_pos + offset] : '\0'; }
+
+    bool consume(std::string_view symbol)
+    {
+        skipSpaces();
+        if (m_input.compare(m_pos, symbol.size(), symbol) != 0)
+        {
+            return false;
+        }
+        m_pos += symbol.size();
+        return true;
+    }
+
+    bool consumeKeyword(std::string_view keyword)
+    {
+        const auto end = m_pos + keyword.size();
+        if (m_input.compare(m_pos, keyword.size(), keyword) != 0 ||
+            (end < m_input.size() && (std::isalnum(static_cast<unsigned char>(m_input[end])) || m_input[end] == '_')))
+        {
+            return false;
+        }
+        m_pos = end;
+        return true;
+    }
+
+    [[noreturn]] void fail(std::string const& reason) const
+    {
+        throw Exception(ExceptionType::INVALID_VALUE, "TokenGuard: " + reason)
+            .appendMetadata("expression", m_input)
+            .appendMetadata("position", m_pos);
+    }
+
+    TokenGuard& m_guard;
+    std::string const& m_input;
+    size_t m_pos{0U};
+    std::vector<Kind> m_kinds;
+};
+
+TokenGuard::TokenGuard(std::string const& expression)
+    : m_expression(expression)
+{
+    Compiler(*this).compile();
+}
+
+bool TokenGuard::compare(OpCode op, nlohmann::json const* lhs, nlohmann::json const* rhs)
+{
+    if (lhs == nullptr || rhs == nullptr)
+    {
+        return false;
+    }
+
+    const bool comparable = (lhs->is_number() && rhs->is_number()) || lhs->type() == rhs->type();
+    switch (op)
+    {
+    case OpCode::EQ:
+        return comparable && *lhs == *rhs;
+    case OpCode::NE:
+        return !comparable || *lhs != *rhs;
+    default:
+        break;
+    }
+
+    // ordering is only defined for numbers and strings
+    if (!comparable || !(lhs->is_number() || lhs->is_string()))
+    {
+        return false;
+    }
+    switch (op)
+    {
+    case OpCode::LT:
+        return *lhs < *rhs;
+    case OpCode::LE:
+        return *lhs <= *rhs;
+    case OpCode::GT:
+        return *lhs > *rhs;
+    case OpCode::GE:
+        return *lhs >= *rhs;
+    default:
+        return false;
+    }
+}
+
+bool TokenGuard::evaluate(Token const& token) const
+{
+    struct Slot
+    {
+        nlohmann::json const* value;
+        bool condition;
+    };
+    std::array<Slot, MAX_STACK_DEPTH> stack;
+    size_t top{0U}; // number of slots in use
+
+    for (auto&& instruction : m_code)
+    {
+        switch (instruction.op)
+        {
+        case OpCode::PUSH_PATH:
+            stack[top++] = {m_paths[instruction.operand].resolve(token), false};
+            break;
+        case OpCode::PUSH_CONSTANT:
+            stack[top++] = {&m_constants[instruction.operand], false};
+            break;
+        case OpCode::IS_TRUE: {
+            auto& slot = stack[top - 1U];
+            slot.condition = slot.value != nullptr && slot.value->is_boolean() && slot.value->get<bool>();
+            break;
+        }
+        case OpCode::NOT:
+            stack[top - 1U].condition = !stack[top - 1U].condition;
+            break;
+        case OpCode::AND:
+            --top;
+            stack[top - 1U].condition = stack[top - 1U].condition && stack[top].condition;
+            break;
+        case OpCode::OR:
+            --top;
+            stack[top - 1U].condition = stack[top - 1U].condition || stack[top].condition;
+            break;
+        default: // comparisons
+            --top;
+            stack[top - 1U].condition = compare(instruction.op, stack[top - 1U].value, stack[top].value);
+            break;
+        }
+    }
+    return stack[0U].condition;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Token.hpp>
+#include <behavior_net/TokenContentPath.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Predicate over a token content, e.g., `@token{order.qty} > 10 && @token{order.kind} == 'express'`
+ *
+ * Grammar, by increasing precedence:
+ *  - `||`, `&&`, `!`
+ *  - comparisons: `==`, `!=`, `<`, `<=`, `>`, `>=`
+ *  - operands: `@token{block.field}` (same path syntax as ConfigParameter), numbers, 'strings', `true`, `false`,
+ *    `null`, and parenthesized expressions
+ *
+ * An operand used as a condition holds if it is the boolean `true`. Comparisons with a value missing from the token
+ * content do not hold; numbers compare by value, strings lexicographically, and values of different types are never
+ * equal nor ordered.
+ *
+ * The expression is compiled once into postfix bytecode with pre-parsed content paths. Evaluating it does not allocate
+ * nor copy token content, and is thread-safe.
+ */
+class TokenGuard
+{
+    static constexpr const char* MODULE_TAG{"TokenGuard"};
+
+public:
+    static constexpr size_t MAX_STACK_DEPTH{16U};
+
+    /// @throw Exception INVALID_VALUE if the expression is malformed or nested deeper than MAX_STACK_DEPTH
+    explicit TokenGuard(std::string const& expression);
+
+    std::string const& str() const { return m_expression; }
+
+    bool evaluate(Token const& token) const;
+
+private:
+    enum class OpCode : uint8_t
+    {
+        PUSH_PATH,     // push value at `m_paths[operand]`
+        PUSH_CONSTANT, // push `m_constants[operand]`
+        IS_TRUE,       // value -> condition
+        NOT,
+        AND,
+        OR,
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE
+    };
+
+    struct Instruction
+    {
+        OpCode op;
+        uint16_t operand{0U};
+    };
+
+    class Compiler;
+
+    static bool compare(OpCode op, nlohmann::json const* lhs, nlohmann::json const* rhs);
+
+    std::string m_expression;
+    std::vector<Instruction> m_code;
+    std::vector<TokenContentPath> m_paths;
+    std::vector<nlohmann::json> m_constants;
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,651 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Token.hpp>
+#include <behavior_net/TokenContentPath.hpp>
+#include <behavior_net/Types.hpp>
+#include <utils/RingBuffer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// Order in which a place hands out its available tokens - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(TokenSelectionPolicy, uint32_t,
+            FIFO,     // oldest token first
+            LIFO,     // newest token first
+            PRIORITY, // highest numeric value at the selection key first; tokens without it go last
+            DEADLINE  // lowest numeric value (earliest deadline) at the selection key first; tokens without it go last
+)
+
+/**
+ * @brief Available tokens of a place, stored per action result status
+ *
+ * FIFO/LIFO stores are ring buffers; PRIORITY/DEADLINE stores are binary heaps whose key is read from the token
+ * content once, on insertion. Counting tokens is O(1) and taking the next token is O(log n) (O(1) for FIFO/LIFO);
+ * ties are broken by insertion order.
+ *
+ * Key indexes (see `addKeyIndex`) map each value of a content field, e.g., `order.id`, to handles of its tokens, so
+ * join transitions find and take tokens sharing a key with hash lookups instead of scanning the queue. Keys should be
+ * strings or integers; JSON numbers that compare equal but differ in type (1 and 1.0) are different keys.
+ *
+ * Tokens taken out of the middle of a store, i.e., by key or predicate, leave a tombstone behind instead of shifting
+ * the store. Tombstones are dropped once at the ends of the store, and stores, as well as the handles of a key, are
+ * compacted when more than half of them are tombstones; hence taking a token by key is O(1) amortized for FIFO/LIFO,
+ * and O(log k) for PRIORITY/DEADLINE, k being the number of tokens with the key.
+ */
+class TokenQueue
+{
+    static constexpr const char* MODULE_TAG{"TokenQueue"};
+
+public:
+    static constexpr size_t NUMBER_STATUSES{max<ActionExecutionStatus>()._to_integral() + 1};
+
+    /// @brief locates a queued token: its ring buffer position, or its heap slot
+    struct Handle
+    {
+        uint64_t sequence; // insertion order; tells a queued token from a taken one
+        uint64_t position;
+        double key; // PRIORITY/DEADLINE
+    };
+
+    /// @brief tokens with a given key
+    struct KeyEntries
+    {
+        // per status; sorted by sequence for FIFO/LIFO, heaps otherwise. The handles at the front (and back) are of
+        // queued tokens, the others may be of taken ones
+        std::array<std::deque<Handle>, NUMBER_STATUSES> handles{};
+        std::array<uint32_t, NUMBER_STATUSES> counts{};
+        uint32_t total{0U};
+
+        /// @param statuses accepted statuses; all if empty
+        uint32_t count(ActionExecutionStatusSet statuses) const
+        {
+            if (statuses.none())
+            {
+                return total;
+            }
+            uint32_t count{0U};
+            for (size_t s = 0U; s < NUMBER_STATUSES; ++s)
+            {
+                count += statuses.test(s) ? counts[s] : 0U;
+            }
+            return count;
+        }
+    };
+    /// key value -> tokens; keys without tokens are erased
+    using KeyIndex = std::unordered_map<nlohmann::json, KeyEntries>;
+
+    TokenQueue(TokenSelectionPolicy policy = TokenSelectionPolicy::FIFO,
+               std::optional<TokenContentPath> selectionKey = std::nullopt)
+        : m_policy(policy)
+        , m_selectionKey(std::move(selectionKey))
+    {
+        if (isHeapPolicy() && !m_selectionKey.has_value())
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "TokenQueue: selection key required by policy.")
+                .appendMetadata("policy", m_policy._to_string());
+        }
+    }
+
+    TokenSelectionPolicy getPolicy() const { return m_policy; }
+
+    /// @brief preallocate the store of `status` to `size` tokens
+    void reserve(size_t size, ActionExecutionStatus status)
+    {
+        auto& store = m_stores[status];
+        if (isHeapPolicy())
+        {
+            store.slots.reserve(size);
+            store.heap.reserve(size);
+        }
+        else
+        {
+            store.buffer.reserve(size);
+        }
+    }
+
+    void push(Token::SharedPtr token, ActionExecutionStatus status)
+    {
+        const auto key = m_selectionKey.has_value() ? m_selectionKey->resolveNumber(*token) : std::nullopt;
+        auto& store = m_stores[status];
+        Handle handle{.sequence = m_nextSequence++, .position = 0U, .key = key.value_or(missingKey())};
+        if (isHeapPolicy())
+        {
+            handle.position = store.freeSlots.empty() ? store.slots.size() : store.freeSlots.back();
+        }
+        else
+        {
+            handle.position = store.frontPosition + store.buffer.size();
+        }
+        for (auto&& keyIndex : m_keyIndexes)
+        {
+            insertKey(keyIndex, *token, handle, status);
+        }
+
+        Entry entry{.token = std::move(token), .sequence = handle.sequence, .key = handle.key};
+        if (isHeapPolicy())
+        {
+            if (store.freeSlots.empty())
+            {
+                store.slots.push_back(std::move(entry));
+            }
+            else
+            {
+                store.slots[store.freeSlots.back()] = std::move(entry);
+                store.freeSlots.pop_back();
+            }
+            store.heap.push_back(handle);
+            std::push_heap(store.heap.begin(), store.heap.end(), heapCompare());
+        }
+        else
+        {
+            store.buffer.push_back(std::move(entry));
+        }
+        ++store.size;
+        ++m_size;
+    }
+
+    /// @param statuses accepted statuses; all if empty
+    size_t size(ActionExecutionStatusSet statuses = 0U) const
+    {
+        if (statuses.none())
+        {
+            return m_size;
+        }
+        size_t size{0U};
+        for (size_t s = 0U; s < m_stores.size(); ++s)
+        {
+            size += statuses.test(s) ? m_stores[s].size : 0U;
+        }
+        return size;
+    }
+
+    /// @brief take the next token, by policy, among the accepted statuses; `size(statuses)` must be greater than 0
+    Token::SharedPtr pop(ActionExecutionStatusSet statuses = 0U)
+    {
+        Store* selected{nullptr};
+        for (size_t s = 0U; s < m_stores.size(); ++s)
+        {
+            auto& store = m_stores[s];
+            if ((statuses.none() || statuses.test(s)) && store.size > 0U &&
+                (selected == nullptr || isBefore(head(store), head(*selected))))
+            {
+                selected = &store;
+            }
+        }
+        if (selected == nullptr)
+        {
+            throw Exception(ExceptionType::LOGIC_ERROR, "TokenQueue::pop: no tokens available.")
+                .appendMetadata("statuses", statuses.to_string());
+        }
+
+        Entry* entry{nullptr};
+        switch (m_policy)
+        {
+        case TokenSelectionPolicy::FIFO:
+            entry = &selected->buffer.front();
+            break;
+        case TokenSelectionPolicy::LIFO:
+            entry = &selected->buffer.back();
+            break;
+        case TokenSelectionPolicy::PRIORITY:
+        case TokenSelectionPolicy::DEADLINE:
+            entry = &selected->slots[selected->heap.front().position];
+            std::pop_heap(selected->heap.begin(), selected->heap.end(), heapCompare());
+            selected->heap.pop_back();
+            break;
+        }
+        return take(selected - m_stores.data(), *entry);
+    }
+
+    /// @brief count the available tokens satisfying `pred`, stopping at `limit`; O(n) in the number of tokens scanned
+    /// @param pred callable as `bool(Token const&)`
+    template <typename PredT>
+    size_t countIf(ActionExecutionStatusSet statuses, PredT const& pred, size_t limit) const
+    {
+        size_t count{0U};
+        for (size_t s = 0U; s < m_stores.size() && count < limit; ++s)
+        {
+            if (!statuses.none() && !statuses.test(s))
+            {
+                continue;
+            }
+            const auto countStore = [&](auto const& entries) {
+                for (auto it = entries.begin(); it != entries.end() && count < limit; ++it)
+                {
+                    count += it->token != nullptr && pred(std::as_const(*it->token)) ? 1U : 0U;
+                }
+            };
+            isHeapPolicy() ? countStore(m_stores[s].slots) : countStore(m_stores[s].buffer);
+        }
+        return count;
+    }
+
+    /// @brief take the next token, by policy, among the accepted statuses and satisfying `pred`
+    /// @return the token, or nullptr if none satisfies `pred`; O(n)
+    template <typename PredT>
+    Token::SharedPtr popIf(ActionExecutionStatusSet statuses, PredT const& pred)
+    {
+        Entry* selected{nullptr};
+        size_t selectedStatus{0U};
+        const auto select = [&](Entry& entry, size_t status) {
+            if (selected == nullptr || isBefore(entry, *selected))
+            {
+                selected = &entry;
+                selectedStatus = status;
+            }
+        };
+        for (size_t s = 0U; s < m_stores.size(); ++s)
+        {
+            auto& store = m_stores[s];
+            if (!statuses.none() && !statuses.test(s))
+            {
+                continue;
+            }
+            if (isHeapPolicy())
+            {
+                // heap order is partial; the first match by policy requires a full scan
+                for (auto&& entry : store.slots)
+                {
+                    if (entry.token != nullptr && pred(std::as_const(*entry.token)))
+                    {
+                        select(entry, s);
+                    }
+                }
+            }
+            else
+            {
+                // ring buffers are sorted by policy; the first match is the best one within the store
+                const auto n = store.buffer.size();
+                for (size_t k = 0U; k < n; ++k)
+                {
+                    auto& entry = store.buffer[m_policy == +TokenSelectionPolicy::LIFO ? n - 1U - k : k];
+                    if (entry.token != nullptr && pred(std::as_const(*entry.token)))
+                    {
+                        select(entry, s);
+                        break;
+                    }
+                }
+            }
+        }
+        return selected != nullptr ? take(selectedStatus, *selected) : nullptr;
+    }
+
+    /// @brief take the next token, by policy, among the accepted statuses and with `key` at the path of key index `id`
+    /// @return the token, or nullptr if none; O(1) amortized for FIFO/LIFO, O(log k) otherwise, see `TokenQueue`
+    Token::SharedPtr popKey(size_t id, nlohmann::json const& key, ActionExecutionStatusSet statuses = 0U)
+    {
+        auto& keyIndex = m_keyIndexes.at(id);
+        const auto it = keyIndex.entries.find(key);
+        if (it == keyIndex.entries.end())
+        {
+            return nullptr;
+        }
+
+        Entry* selected{nullptr};
+        size_t selectedStatus{0U};
+        for (size_t s = 0U; s < NUMBER_STATUSES; ++s)
+        {
+            if ((!statuses.none() && !statuses.test(s)) || it->second.counts[s] == 0U)
+            {
+                continue;
+            }
+            // the best handle of a status is at its front (back for LIFO), and is of a queued token
+            auto const& handles = it->second.handles[s];
+            auto* entry = find(m_stores[s], m_policy == +TokenSelectionPolicy::LIFO ? handles.back() : handles.front());
+            if (selected == nullptr || isBefore(*entry, *selected))
+            {
+                selected = entry;
+                selectedStatus = s;
+            }
+        }
+        return selected != nullptr ? take(selectedStatus, *selected) : nullptr;
+    }
+
+    /// @brief start indexing tokens per value at `path`; tokens already queued are indexed
+    /// @return index id, to be used with `getKeyIndex`; an existing id if the path is already indexed
+    size_t addKeyIndex(TokenContentPath const& path)
+    {
+        for (size_t id = 0U; id < m_keyIndexes.size(); ++id)
+        {
+            if (m_keyIndexes[id].path.str() == path.str())
+            {
+                return id;
+            }
+        }
+
+        auto& keyIndex = m_keyIndexes.emplace_back(KeyIndexEntry{path, {}});
+        for (size_t s = 0U; s < m_stores.size(); ++s)
+        {
+            forEachQueued(s, [&](Entry const& entry, Handle const& handle) {
+                insertKey(keyIndex, *entry.token, handle, s);
+            });
+        }
+        return m_keyIndexes.size() - 1U;
+    }
+
+    KeyIndex const& getKeyIndex(size_t id) const { return m_keyIndexes.at(id).entries; }
+    TokenContentPath const& getKeyIndexPath(size_t id) const { return m_keyIndexes.at(id).path; }
+
+    /// @return number of available tokens with `key` at the indexed path, among the accepted statuses; O(1)
+    uint32_t countKey(size_t id, nlohmann::json const& key, ActionExecutionStatusSet statuses = 0U) const
+    {
+        auto const& entries = m_keyIndexes.at(id).entries;
+        const auto it = entries.find(key);
+        return it != entries.end() ? it->second.count(statuses) : 0U;
+    }
+
+private:
+    /// @brief stores and key handles are compacted once they hold more tombstones than this and their queued tokens
+    static constexpr size_t MIN_TOMBSTONES_COMPACTED{64U};
+
+    struct Entry
+    {
+        Token::SharedPtr token; // null once taken; a tombstone
+        uint64_t sequence;      // insertion order
+        double key;             // PRIORITY/DEADLINE
+    };
+
+    struct Store
+    {
+        RingBuffer<Entry> buffer;    // FIFO/LIFO; sorted by sequence, with no tombstones at the ends
+        uint64_t frontPosition{0U};  // position of the buffer front
+        std::vector<Entry> slots;    // PRIORITY/DEADLINE
+        std::vector<size_t> freeSlots;
+        std::vector<Handle> heap;    // PRIORITY/DEADLINE, of the slots; the top is of a queued token
+        size_t size{0U};             // queued tokens
+    };
+
+    struct KeyIndexEntry
+    {
+        TokenContentPath path;
+        KeyIndex entries;
+    };
+
+    void insertKey(KeyIndexEntry& keyIndex, Token const& token, Handle const& handle, size_t status) const
+    {
+        if (auto key = keyIndex.path.resolve(token); key != nullptr)
+        {
+            auto& keyEntries = keyIndex.entries[*key];
+            addHandle(keyEntries.handles[status], handle);
+            ++keyEntries.counts[status];
+            ++keyEntries.total;
+        }
+    }
+
+    void addHandle(std::deque<Handle>& handles, Handle const& handle) const
+    {
+        handles.push_back(handle);
+        if (isHeapPolicy())
+        {
+            std::push_heap(handles.begin(), handles.end(), heapCompare());
+        }
+    }
+
+    /// @brief take the token of `entry`, of the store of `status`, leaving a tombstone behind
+    Token::SharedPtr take(size_t status, Entry& entry)
+    {
+        auto& store = m_stores[status];
+        auto token = std::move(entry.token);
+        if (isHeapPolicy())
+        {
+            store.freeSlots.push_back(&entry - store.slots.data());
+        }
+        --store.size;
+        --m_size;
+
+        for (auto&& keyIndex : m_keyIndexes)
+        {
+            auto key = keyIndex.path.resolve(*token);
+            const auto it = key != nullptr ? keyIndex.entries.find(*key) : keyIndex.entries.end();
+            if (it == keyIndex.entries.end())
+            {
+                continue;
+            }
+            --it->second.counts[status];
+            if (--it->second.total == 0U)
+            {
+                keyIndex.entries.erase(it);
+                continue;
+            }
+            trimHandles(store, it->second.handles[status], it->second.counts[status]);
+        }
+        trimStore(status);
+        return token;
+    }
+
+    /// @return the queued entry of `handle`, or nullptr if its token was taken
+    Entry* find(Store& store, Handle const& handle) const
+    {
+        Entry* entry{nullptr};
+        if (isHeapPolicy())
+        {
+            entry = handle.position < store.slots.size() ? &store.slots[handle.position] : nullptr;
+        }
+        else if (handle.position >= store.frontPosition && handle.position - store.frontPosition < store.buffer.size())
+        {
+            entry = &store.buffer[handle.position - store.frontPosition];
+        }
+        return entry != nullptr && entry->token != nullptr && entry->sequence == handle.sequence ? entry : nullptr;
+    }
+
+    /// @brief drop the handles of taken tokens at the front (and back) of `handles`, and compact them if mostly so
+    void trimHandles(Store& store, std::deque<Handle>& handles, size_t count) const
+    {
+        const auto isTaken = [this, &store](Handle const& handle) { return find(store, handle) == nullptr; };
+        if (isHeapPolicy())
+        {
+            while (!handles.empty() && isTaken(handles.front()))
+            {
+                std::pop_heap(handles.begin(), handles.end(), heapCompare());
+                handles.pop_back();
+            }
+        }
+        else
+        {
+            while (!handles.empty() && isTaken(handles.front()))
+            {
+                handles.pop_front();
+            }
+            while (!handles.empty() && isTaken(handles.back()))
+            {
+                handles.pop_back();
+            }
+        }
+        if (handles.size() > 2U * count + MIN_TOMBSTONES_COMPACTED)
+        {
+            std::erase_if(handles, isTaken);
+            if (isHeapPolicy())
+            {
+                std::make_heap(handles.begin(), handles.end(), heapCompare());
+            }
+        }
+    }
+
+    /// @brief drop the tombstones at the ends (heap top) of the store of `status`, and compact it if mostly tombstones
+    void trimStore(size_t status)
+    {
+        auto& store = m_stores[status];
+        if (isHeapPolicy())
+        {
+            const auto isTaken = [this, &store](Handle const& handle) { return find(store, handle) == nullptr; };
+            while (!store.heap.empty() && isTaken(store.heap.front()))
+            {
+                std::pop_heap(store.heap.begin(), store.heap.end(), heapCompare());
+                store.heap.pop_back();
+            }
+            if (store.heap.size() > 2U * store.size + MIN_TOMBSTONES_COMPACTED)
+            {
+                std::erase_if(store.heap, isTaken);
+                std::make_heap(store.heap.begin(), store.heap.end(), heapCompare());
+            }
+            return;
+        }
+
+        while (!store.buffer.empty() && store.buffer.front().token == nullptr)
+        {
+            store.buffer.pop_front();
+            ++store.frontPosition;
+        }
+        while (!store.buffer.empty() && store.buffer.back().token == nullptr)
+        {
+            store.buffer.pop_back();
+        }
+        if (store.buffer.size() > 2U * store.size + MIN_TOMBSTONES_COMPACTED)
+        {
+            compactBuffer(status);
+        }
+    }
+
+    /// @brief drop the tombstones of a ring buffer store; its tokens move, hence their key handles are rebuilt
+    void compactBuffer(size_t status)
+    {
+        auto& store = m_stores[status];
+        RingBuffer<Entry> buffer(store.buffer.capacity());
+        for (auto&& entry : store.buffer)
+        {
+            if (entry.token != nullptr)
+            {
+                buffer.push_back(std::move(entry));
+            }
+        }
+        store.buffer = std::move(buffer);
+
+        for (auto&& keyIndex : m_keyIndexes)
+        {
+            for (auto&& [_, keyEntries] : keyIndex.entries)
+            {
+                keyEntries.handles[status].clear();
+            }
+        }
+        forEachQueued(status, [&](Entry const& entry, Handle const& handle) {
+            for (auto&& keyIndex : m_keyIndexes)
+            {
+                if (auto key = keyIndex.path.resolve(*entry.token); key != nullptr)
+                {
+                    addHandle(keyIndex.entries.at(*key).handles[status], handle);
+                }
+            }
+        });
+    }
+
+    /// @param func callable as `void(Entry const&, Handle const&)`, called for each queued token of the store, in
+    /// sequence order for FIFO/LIFO
+    template <typename FuncT>
+    void forEachQueued(size_t status, FuncT const& func) const
+    {
+        auto const& store = m_stores[status];
+        if (isHeapPolicy())
+        {
+            for (size_t slot = 0U; slot < store.slots.size(); ++slot)
+            {
+                auto const& entry = store.slots[slot];
+                if (entry.token != nullptr)
+                {
+                    func(entry, Handle{.sequence = entry.sequence, .position = slot, .key = entry.key});
+                }
+            }
+            return;
+        }
+        for (size_t i = 0U; i < store.buffer.size(); ++i)
+        {
+            auto const& entry = store.buffer[i];
+            if (entry.token != nullptr)
+            {
+                func(entry, Handle{.sequence = entry.sequence, .position = store.frontPosition + i, .key = entry.key});
+            }
+        }
+    }
+
+    bool isHeapPolicy() const
+    {
+        return m_policy == +TokenSelectionPolicy::PRIORITY || m_policy == +TokenSelectionPolicy::DEADLINE;
+    }
+
+    double missingKey() const
+    {
+        return m_policy == +TokenSelectionPolicy::PRIORITY ? std::numeric_limits<double>::lowest()
+                                                           : std::numeric_limits<double>::max();
+    }
+
+    /// @brief the next token of a store with queued tokens
+    Entry const& head(Store const& store) const
+    {
+        switch (m_policy)
+        {
+        case TokenSelectionPolicy::LIFO:
+            return store.buffer.back();
+        case TokenSelectionPolicy::PRIORITY:
+        case TokenSelectionPolicy::DEADLINE:
+            return store.slots[store.heap.front().position];
+        default:
+            return store.buffer.front();
+        }
+    }
+
+    /// @return `a` is to be handed out before `b`; `a` and `b` are entries or handles
+    template <typename T>
+    bool isBefore(T const& a, T const& b) const
+    {
+        switch (m_policy)
+        {
+        case TokenSelectionPolicy::LIFO:
+            return a.sequence > b.sequence;
+        case TokenSelectionPolicy::PRIORITY:
+            return a.key > b.key || (a.key == b.key && a.sequence < b.sequence);
+        case TokenSelectionPolicy::DEADLINE:
+            return a.key < b.key || (a.key == b.key && a.sequence < b.sequence);
+        default:
+            return a.sequence < b.sequence;
+        }
+    }
+
+    /// @brief std heap functions keep the greatest element first; the greatest is the one to be handed out first
+    struct HeapCompare
+    {
+        TokenQueue const* queue;
+        bool operator()(Handle const& a, Handle const& b) const { return queue->isBefore(b, a); }
+    };
+    HeapCompare heapCompare() const { return HeapCompare{this}; }
+
+    TokenSelectionPolicy m_policy;
+    std::optional<TokenContentPath> m_selectionKey;
+    std::array<Store, NUMBER_STATUSES> m_stores{};
+    std::vector<KeyIndexEntry> m_keyIndexes;
+    size_t m_size{0U};
+    uint64_t m_nextSequence{0U};
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -19,6 +19,7 @@
 #include <string>
 
 #include <behavior_net/Config.hpp>
+#include <behavior_net/Subnet.hpp>
 #include <behavior_net/Transition.hpp>
 #include <behavior_net/Types.hpp>
 
@@ -60,7 +61,17 @@ void validateArcConfig(nlohmann::json const& arcConfig, std::vector<std::string>
         }
     }
 
-    // action_result_filter is only allowed for input arcs
+    // weight is a positive integer
+    if (arcConfig.contains("weight"))
+    {
+        const auto weightOpt = getValueAtKey<int64_t>(arcConfig, "weight", errorMessages);
+        if (weightOpt.has_value() && (weightOpt.value() <= 0 || weightOpt.value() > UINT32_MAX))
+        {
+            errorMessages.push_back("Invalid arc `weight`; expected a positive integer.");
+        }
+    }
+
+    // action_result_filter is only allowed for input and inhibitor arcs
     if (arcConfig.contains("action_result_filter"))
     {
         // is valid
@@ -82,9 +93,57 @@ void validateArcConfig(nlohmann::json const& arcConfig, std::vector<std::string>
             errorMessages.push_back("`action_result_filter` is expected to be an array.");
         }
 
+        if (type != +ArcType::INPUT && type != +ArcType::INHIBITOR)
+        {
+            errorMessages.push_back("`action_result_filter` is only allowed for input and inhibitor arcs.");
+        }
+    }
+
+    // token_guard is a valid expression, only allowed for input and inhibitor arcs
+    if (arcConfig.contains("token_guard"))
+    {
+        const auto guardOpt = getValueAtKey<std::string>(arcConfig, "token_guard", errorMessages);
+        if (guardOpt.has_value())
+        {
+            try
+            {
+                std::ignore = TokenGuard(guardOpt.value());
+            }
+            catch (Exception const& e)
+            {
+                errorMessages.push_back("Invalid `token_guard` `" + guardOpt.value() + "`.");
+            }
+        }
+
+        if (type != +ArcType::INPUT && type != +ArcType::INHIBITOR)
+        {
+            errorMessages.push_back("`token_guard` is only allowed for input and inhibitor arcs.");
+        }
+    }
+
+    // join_key is a valid content path, only allowed for input arcs without a token_guard
+    if (arcConfig.contains("join_key"))
+    {
+        const auto keyOpt = getValueAtKey<std::string>(arcConfig, "join_key", errorMessages);
+        if (keyOpt.has_value())
+        {
+            try
+            {
+                std::ignore = TokenContentPath(keyOpt.value());
+            }
+            catch (Exception const& e)
+            {
+                errorMessages.push_back("Invalid `join_key` `" + keyOpt.value() + "`.");
+            }
+        }
+
         if (type != +ArcType::INPUT)
         {
-            errorMessages.push_back("`action_result_filter` is only allowed for input arcs.");
+            errorMessages.push_back("`join_key` is only allowed for input arcs.");
+        }
+        if (arcConfig.contains("token_guard"))
+        {
+            errorMessages.push_back("`join_key` and `token_guard` cannot be combined in the same arc.");
         }
     }
 
@@ -112,6 +171,16 @@ bool validateTransitionsConfig(nlohmann::json const& netConfig, std::vector<std:
         return false;
     }
 
+    // arcs may refer to the net places and to the places of subnet instances
+    auto placeConfigsOpt = getValueAtPath<nlohmann::json>(netConfig, {"petri_net", "places"}, errorMessages);
+    if (placeConfigsOpt.has_value())
+    {
+        for (auto&& placeConfig : getSubnetInstancePlaceConfigs(netConfig))
+        {
+            placeConfigsOpt->push_back(placeConfig);
+        }
+    }
+
     std::vector<std::string> ids{};
     for (auto&& transitionConfig : transitionConfigsOpt.value())
     {
@@ -142,15 +211,26 @@ bool validateTransitionsConfig(nlohmann::json const& netConfig, std::vector<std:
             }
         }
 
+        // scheduling
+        if (transitionConfig.contains("priority"))
+        {
+            std::ignore = getValueAtKey<int32_t>(transitionConfig, "priority", errorMessages);
+        }
+        if (transitionConfig.contains("scheduling_weight"))
+        {
+            const auto weightOpt = getValueAtKey<int64_t>(transitionConfig, "scheduling_weight", errorMessages);
+            if (weightOpt.has_value() && (weightOpt.value() <= 0 || weightOpt.value() > UINT32_MAX))
+            {
+                errorMessages.push_back("Invalid `scheduling_weight`; expected a positive integer.");
+            }
+        }
+
         // arcs
         {
             const auto arcConfigsOpt =
                 getValueAtKey<nlohmann::json const>(transitionConfig, "transition_arcs", errorMessages);
             if (arcConfigsOpt.has_value())
             {
-
-                const auto placeConfigsOpt =
-                    getValueAtPath<nlohmann::json const>(netConfig, {"petri_net", "places"}, errorMessages);
                 for (auto&& arcConfig : arcConfigsOpt.value())
                 {
                     validateArcConfig(arcConfig, errorMessages, placeConfigsOpt);
@@ -167,6 +247,8 @@ REGISTER_NET_CONFIG_VALIDATOR(&validateTransitionsConfig, "TransitionsConfigVali
 Transition::Transition(nlohmann::json config, Place::IdMap const& places)
     : m_id(config.at("transition_id").get<std::string>())
     , m_type(TransitionType::UNDEFINED)
+    , m_priority(config.value("priority", 0))
+    , m_schedulingWeight(config.value("scheduling_weight", 1U))
 {
     /**
      * From here on, the config is assumed to be valid. See `validateTransitionsConfig`
@@ -193,6 +275,7 @@ Transition::Transition(nlohmann::json config, Place::IdMap const& places)
         Arc arc;
         const auto placeId = arcConfig.at("place_id").get<std::string>();
         arc.place = places.at(placeId);
+        arc.weight = arcConfig.value("weight", 1U);
 
         if (arcConfig.contains("action_result_filter"))
         {
@@ -209,7 +292,13 @@ Transition::Transition(nlohmann::json config, Place::IdMap const& places)
 
         if (arcConfig.contains("token_content_filter"))
         {
-            arc.contentBlockFilter = RegexFilter(arcConfig.at("token_content_filter").get<std::string>());
+            arc.contentBlockFilter =
+                std::make_shared<const RegexFilter>(arcConfig.at("token_content_filter").get<std::string>());
+        }
+
+        if (arcConfig.contains("token_guard"))
+        {
+            arc.tokenGuard = std::make_shared<const TokenGuard>(arcConfig.at("token_guard").get<std::string>());
         }
 
         const auto type = ArcType::_from_string_nocase(arcConfig.at("type").get<std::string>().c_str());
@@ -217,10 +306,19 @@ Transition::Transition(nlohmann::json config, Place::IdMap const& places)
         {
             m_outputArcs.push_back(arc);
         }
+        else if (type == +ArcType::INPUT && arcConfig.contains("join_key"))
+        {
+            arc.keyIndexId = arc.place->addKeyIndex(TokenContentPath(arcConfig.at("join_key").get<std::string>()));
+            m_joinArcs.push_back(arc);
+        }
         else if (type == +ArcType::INPUT)
         {
             m_inputArcs.push_back(arc);
         }
+        else if (type == +ArcType::INHIBITOR)
+        {
+            m_inhibitorArcs.push_back(arc);
+        }
         else
         {
             throw Exception(ExceptionType::INVALID_CONFIG_FILE, "Transition::Transition: invalid arc type.")
@@ -228,6 +326,105 @@ Transition::Transition(nlohmann::json config, Place::IdMap const& places)
                 .appendMetadata("arc type", arcConfig.at("type").get<std::string>());
         }
     }
+
+    for (auto&& outputArc : m_outputArcs)
+    {
+        auto const& place = outputArc.place;
+        const auto isSamePlace = [&place](Arc const& arc) { return arc.place == place; };
+        if (!place->getCapacity().has_value() ||
+            std::any_of(m_capacityDemands.begin(), m_capacityDemands.end(),
+                        [&place](CapacityDemand const& demand) { return demand.place == place; }))
+        {
+            continue;
+        }
+
+        // tokens consumed from the same place free room for the produced ones
+        const auto sumWeights = [&isSamePlace](std::vector<Arc> const& arcs) {
+            int64_t sum{0};
+            for (auto&& arc : arcs)
+            {
+                sum += isSamePlace(arc) ? arc.weight : 0U;
+            }
+            return sum;
+        };
+        const auto produced = sumWeights(m_outputArcs);
+        const auto consumed = sumWeights(m_inputArcs) + sumWeights(m_joinArcs);
+        if (produced > consumed)
+        {
+            m_capacityDemands.push_back({place, static_cast<uint32_t>(produced - consumed)});
+        }
+    }
+}
+
+Transition Transition::bind(Place::IdMap const& places, std::string const& idPrefix) const
+{
+    Transition bound(*this);
+    bound.m_id = idPrefix + m_id;
+
+    const auto bindPlace = [&places, &idPrefix](Place::SharedPtr const& place) {
+        return places.at(idPrefix + place->getId());
+    };
+    for (auto* arcs : {&bound.m_inputArcs, &bound.m_outputArcs, &bound.m_inhibitorArcs})
+    {
+        for (auto&& arc : *arcs)
+        {
+            arc.place = bindPlace(arc.place);
+        }
+    }
+    for (auto&& arc : bound.m_joinArcs)
+    {
+        auto place = bindPlace(arc.place);
+        arc.keyIndexId = place->addKeyIndex(arc.place->getKeyIndexPath(arc.keyIndexId.value()));
+        arc.place = std::move(place);
+    }
+    for (auto&& demand : bound.m_capacityDemands)
+    {
+        demand.place = bindPlace(demand.place);
+    }
+    return bound;
+}
+
+std::vector<std::string> Transition::getPlaceIds() const
+{
+    std::vector<std::string> placeIds;
+    for (auto* arcs : {&m_inputArcs, &m_outputArcs, &m_inhibitorArcs, &m_joinArcs})
+    {
+        for (auto&& arc : *arcs)
+        {
+            placeIds.push_back(arc.place->getId());
+        }
+    }
+    return placeIds;
+}
+
+nlohmann::json const* Transition::findJoinKey() const
+{
+    auto const* pivot = &m_joinArcs.front();
+    for (auto&& arc : m_joinArcs)
+    {
+        if (arc.place->getKeyIndex(arc.keyIndexId.value()).size() <
+            pivot->place->getKeyIndex(pivot->keyIndexId.value()).size())
+        {
+            pivot = &arc;
+        }
+    }
+
+    for (auto&& [key, keyEntries] : pivot->place->getKeyIndex(pivot->keyIndexId.value()))
+    {
+        if (keyEntries.count(pivot->resultStatusFilter) < pivot->weight)
+        {
+            continue;
+        }
+        const auto hasEnoughTokens = [&key](Arc const& arc) {
+            return arc.place->getNumberTokensAvailable(arc.resultStatusFilter, arc.keyIndexId.value(), key) >=
+                   arc.weight;
+        };
+        if (std::all_of(m_joinArcs.begin(), m_joinArcs.end(), hasEnoughTokens))
+        {
+            return &key;
+        }
+    }
+    return nullptr;
 }
 
 void Transition::trigger()
@@ -242,7 +439,16 @@ void Transition::trigger()
     std::vector<Token::SharedPtr> consumedTokens;
     for (auto&& arc : m_inputArcs)
     {
-        consumedTokens.push_back(arc.place->consumeToken(arc.resultStatusFilter));
+        arc.place->consumeTokens(arc.weight, arc.resultStatusFilter, consumedTokens, arc.tokenGuard.get());
+    }
+    if (!m_joinArcs.empty())
+    {
+        const auto joinKey = *findJoinKey(); // copy; index entries are erased as their tokens are consumed
+        for (auto&& arc : m_joinArcs)
+        {
+            arc.place->consumeTokens(arc.weight, arc.resultStatusFilter, arc.keyIndexId.value(), joinKey,
+                                     consumedTokens);
+        }
     }
 
     auto outToken = Token::makeShared();
@@ -251,18 +457,26 @@ void Transition::trigger()
         outToken->mergeContentBlocks(t);
     }
 
+    const auto copyToken = [](Token::SharedPtr token) {
+        auto copy = Token::makeShared();
+        copy->mergeContentBlocks(token);
+        return copy;
+    };
+
     for (auto&& arc : m_outputArcs)
     {
-        if (arc.contentBlockFilter.has_value())
+        auto arcToken = outToken;
+        if (arc.contentBlockFilter)
         {
-            auto filteredToken = Token::makeShared();
-            filteredToken->mergeContentBlocks(outToken);
-            filteredToken->filterContentBlocks(arc.contentBlockFilter.value().getFilterFunc());
-            arc.place->insertToken(filteredToken);
+            arcToken = copyToken(outToken);
+            arcToken->filterContentBlocks(arc.contentBlockFilter->getFilterFunc());
         }
-        else
+
+        // weighted arcs produce independent copies, as tokens are tracked by pointer within places
+        arc.place->insertToken(arcToken);
+        for (uint32_t i = 1U; i < arc.weight; ++i)
         {
-            arc.place->insertToken(outToken);
+            arc.place->insertToken(copyToken(arcToken));
         }
     }
 }
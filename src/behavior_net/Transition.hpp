@@ -20,9 +20,12 @@
 #include <behavior_net/Common.hpp>
 #include <behavior_net/Place.hpp>
 #include <behavior_net/Token.hpp>
+#include <behavior_net/TokenGuard.hpp>
 #include <behavior_net/Types.hpp>
 
 #include <3rd_party/nlohmann/json.hpp>
+#include <deque>
+#include <memory>
 #include <regex>
 #include <string>
 #include <vector>
@@ -52,19 +55,30 @@ private:
     std::regex m_filter;
 };
 
+/// @brief validate the config of a transition arc
+/// @param placeConfigsOpt [optional] configs of the places the arc may refer to
+void validateArcConfig(nlohmann::json const& arcConfig, std::vector<std::string>& errorMessages,
+                       std::optional<nlohmann::json const> placeConfigsOpt);
+
+/// @brief validate `petri_net/transitions`; arcs may refer to `petri_net/places` and to subnet instance places
+bool validateTransitionsConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages);
+
 class Transition
 {
     static constexpr const char* MODULE_TAG{"Transition"};
 
 public:
+    /// references to transitions are stable as transitions are appended, e.g., by subnet instantiation
+    using List = std::deque<Transition>;
+
     class Factory
     {
     public:
-        static std::vector<Transition> createTransitions(nlohmann::json const& netConfig, Place::IdMap const& places)
+        static List createTransitions(nlohmann::json const& netConfig, Place::IdMap const& places)
         {
             auto transitionConfigs = netConfig.at("transitions");
 
-            std::vector<Transition> transitions;
+            List transitions;
             for (auto&& transitionConfig : transitionConfigs)
             {
                 transitions.emplace_back(transitionConfig, places);
@@ -77,21 +91,68 @@ public:
     struct Arc
     {
         Place::SharedPtr place;
+        uint32_t weight{1U}; // tokens consumed/produced per firing; inhibitor threshold
         ActionExecutionStatusSet resultStatusFilter{0U};
-        std::optional<RegexFilter> contentBlockFilter;
+        // compiled filters are immutable, hence shared by bound copies of a transition; see `bind`
+        std::shared_ptr<const RegexFilter> contentBlockFilter;
+        std::shared_ptr<const TokenGuard> tokenGuard; // input/inhibitor arcs: only tokens satisfying it are considered
+        std::optional<size_t> keyIndexId;     // join arcs: key index of `place` on the join key
     };
 
     Transition(nlohmann::json config, Place::IdMap const& places);
 
+    /**
+     * @brief copy of this transition with its arcs bound to other places, e.g., an instance of a subnet template
+     *
+     * Each arc place is replaced by `places.at(idPrefix + <place id>)`, and the copy id is `idPrefix + <id>`.
+     * Compiled filters and guards are shared with this transition.
+     */
+    Transition bind(Place::IdMap const& places, std::string const& idPrefix) const;
+
     std::string const& getId() const { return m_id; }
 
     bool isManual() const { return m_type == +TransitionType::MANUAL; }
 
+    /// @brief higher priority transitions are fired first when competing for the same tokens; see TransitionScheduler
+    int32_t getPriority() const { return m_priority; }
+    uint32_t getSchedulingWeight() const { return m_schedulingWeight; }
+
+    /// @return ids of the places of all arcs, i.e., the places firing this transition reads or modifies; may repeat
+    std::vector<std::string> getPlaceIds() const;
+
     bool isEnabled() const
     {
         for (auto&& arc : m_inputArcs)
         {
-            if (arc.place->getNumberTokensAvailable(arc.resultStatusFilter) == 0)
+            auto const& place = *arc.place;
+            const auto numberTokens =
+                arc.tokenGuard ? place.getNumberTokensAvailable(arc.resultStatusFilter, *arc.tokenGuard, arc.weight)
+                               : place.getNumberTokensAvailable(arc.resultStatusFilter);
+            if (numberTokens < arc.weight)
+            {
+                return false;
+            }
+        }
+        for (auto&& arc : m_inhibitorArcs)
+        {
+            auto const& place = *arc.place;
+            const auto numberTokens =
+                arc.tokenGuard ? place.getNumberTokensAvailable(arc.resultStatusFilter, *arc.tokenGuard, arc.weight)
+                : arc.resultStatusFilter.any() ? place.getNumberTokensAvailable(arc.resultStatusFilter)
+                                               : place.getNumberTokensTotal();
+            if (numberTokens >= arc.weight)
+            {
+                return false;
+            }
+        }
+        if (!m_joinArcs.empty() && findJoinKey() == nullptr)
+        {
+            return false;
+        }
+        // capacity arcs: output places must have room for the tokens
+        for (auto&& demand : m_capacityDemands)
+        {
+            if (!demand.place->hasCapacityFor(demand.numberTokens))
             {
                 return false;
             }
@@ -102,11 +163,32 @@ public:
     void trigger();
 
 private:
+    /**
+     * @brief find a key value shared by enough available tokens in every join arc place
+     *
+     * Iterates the keys of the join place with fewest distinct keys, looking each one up in the other places' key
+     * indexes, i.e., O(1) per candidate key regardless of queue depths.
+     *
+     * @return the key, owned by a place key index, or nullptr if none
+     */
+    nlohmann::json const* findJoinKey() const;
+
+    struct CapacityDemand
+    {
+        Place::SharedPtr place;
+        uint32_t numberTokens; // net number of tokens added to the place by one firing
+    };
+
     std::vector<Arc> m_inputArcs;
     std::vector<Arc> m_outputArcs;
+    std::vector<Arc> m_inhibitorArcs;
+    std::vector<Arc> m_joinArcs; // input arcs with a join key; consumed tokens share the same key value
+    std::vector<CapacityDemand> m_capacityDemands; // output places with a capacity only
     std::string m_id;
 
     TransitionType m_type;
+    int32_t m_priority{0};
+    uint32_t m_schedulingWeight{1U}; // share among transitions with the same priority
 };
 
 } // namespace bnet
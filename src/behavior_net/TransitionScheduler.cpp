@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/TransitionScheduler.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateTransitionSchedulerConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("transition_scheduler"))
+    {
+        return true; // default scheduler
+    }
+    auto schedulerConfig =
+        getValueAtPath<nlohmann::json>(netConfig, {"controller", "transition_scheduler"}, errorMessages).value();
+
+    const auto policyStrOpt = getValueAtKey<std::string>(schedulerConfig, "policy", errorMessages);
+    if (policyStrOpt.has_value() && !SchedulingPolicy::_from_string_nocase_nothrow(policyStrOpt.value().c_str()))
+    {
+        errorMessages.push_back("Invalid transition scheduling policy `" + policyStrOpt.value() + "`.");
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateTransitionSchedulerConfig, "TransitionSchedulerConfigValidator");
+
+namespace
+{
+// fair share virtual time advanced by one firing of a weight 1 transition
+constexpr uint64_t VIRTUAL_TIME_UNIT{1U << 20U};
+} // namespace
+
+TransitionScheduler::TransitionScheduler(Transition::List& transitions, nlohmann::json const& controllerConfig,
+                                         Filter filter)
+    : m_transitions(transitions)
+    , m_filter(std::move(filter))
+{
+    if (controllerConfig.contains("transition_scheduler"))
+    {
+        m_policy = SchedulingPolicy::_from_string_nocase(
+            controllerConfig.at("transition_scheduler").at("policy").get<std::string>().c_str());
+    }
+
+    addNewTransitions();
+
+    LOG(DEBUG) << "TransitionScheduler: policy = " << m_policy._to_string()
+               << "; priority buckets = " << m_buckets.size() << log::endl;
+}
+
+void TransitionScheduler::addNewTransitions()
+{
+    for (; m_numberTransitions < m_transitions.size(); ++m_numberTransitions)
+    {
+        auto& transition = m_transitions[m_numberTransitions];
+        if (transition.isManual() || (m_filter && !m_filter(transition)))
+        {
+            continue;
+        }
+
+        auto it = std::lower_bound(m_buckets.begin(), m_buckets.end(), transition.getPriority(),
+                                   [](Bucket const& b, int32_t priority) { return b.priority > priority; });
+        if (it == m_buckets.end() || it->priority != transition.getPriority())
+        {
+            it = m_buckets.insert(it, Bucket{.priority = transition.getPriority()});
+        }
+        it->entries.push_back(Entry{.transition = &transition, .weight = transition.getSchedulingWeight()});
+        it->totalWeight += transition.getSchedulingWeight();
+    }
+
+    for (auto&& bucket : m_buckets)
+    {
+        bucket.order.resize(bucket.entries.size());
+        std::iota(bucket.order.begin(), bucket.order.end(), 0U);
+    }
+}
+
+void TransitionScheduler::fireEnabled(std::vector<Transition const*>& fired)
+{
+    if (m_numberTransitions < m_transitions.size())
+    {
+        addNewTransitions();
+    }
+
+    fired.clear();
+    for (auto&& bucket : m_buckets)
+    {
+        computeOrder(bucket);
+        for (auto&& entryIdx : bucket.order)
+        {
+            auto& transition = *bucket.entries[entryIdx].transition;
+            if (transition.isEnabled())
+            {
+                transition.trigger();
+                fired.push_back(&transition);
+                onFired(bucket, entryIdx);
+            }
+        }
+    }
+}
+
+void TransitionScheduler::computeOrder(Bucket& bucket)
+{
+    auto& entries = bucket.entries;
+    auto& order = bucket.order;
+    switch (m_policy)
+    {
+    case SchedulingPolicy::ORDERED:
+        break;
+    case SchedulingPolicy::ROUND_ROBIN:
+        for (uint32_t i = 0U; i < order.size(); ++i)
+        {
+            order[i] = (bucket.next + i) % order.size();
+        }
+        break;
+    case SchedulingPolicy::WEIGHTED_ROUND_ROBIN:
+        // credits are capped so that transitions disabled for a while do not burst once enabled
+        for (auto&& entry : entries)
+        {
+            entry.credit = std::min(entry.credit + entry.weight, bucket.totalWeight);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&entries](uint32_t a, uint32_t b) { return entries[a].credit > entries[b].credit; });
+        break;
+    case SchedulingPolicy::FAIR_SHARE:
+        // idle transitions rejoin at the current virtual time instead of the one they left at
+        for (auto&& entry : entries)
+        {
+            entry.virtualTime = std::max(entry.virtualTime, bucket.systemVirtualTime);
+        }
+        std::stable_sort(order.begin(), order.end(), [&entries](uint32_t a, uint32_t b) {
+            return entries[a].virtualTime < entries[b].virtualTime;
+        });
+        break;
+    }
+}
+
+void TransitionScheduler::onFired(Bucket& bucket, uint32_t entryIdx)
+{
+    auto& entry = bucket.entries[entryIdx];
+    switch (m_policy)
+    {
+    case SchedulingPolicy::ORDERED:
+        break;
+    case SchedulingPolicy::ROUND_ROBIN:
+        bucket.next = (entryIdx + 1U) % bucket.entries.size();
+        break;
+    case SchedulingPolicy::WEIGHTED_ROUND_ROBIN:
+        entry.credit -= bucket.totalWeight;
+        break;
+    case SchedulingPolicy::FAIR_SHARE:
+        bucket.systemVirtualTime = entry.virtualTime;
+        entry.virtualTime += VIRTUAL_TIME_UNIT / entry.weight;
+        break;
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
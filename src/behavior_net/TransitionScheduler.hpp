@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Transition.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// Ordering of auto transitions sharing the same priority - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(SchedulingPolicy, uint32_t,
+            ORDERED,              // config order; the first enabled transition always wins conflicts
+            ROUND_ROBIN,          // the order rotates past the last fired transition
+            WEIGHTED_ROUND_ROBIN, // smooth weighted round-robin on `scheduling_weight`
+            FAIR_SHARE            // start-time fair queueing on `scheduling_weight`; idle transitions bank no credit
+)
+
+/**
+ * @brief Decides the order in which enabled auto transitions fire within an epoch
+ *
+ * Transitions are grouped in buckets by `priority`. Buckets are visited from the highest priority to the lowest, so a
+ * higher priority transition always takes the contended tokens first, no matter the load of lower priority ones. Within
+ * a bucket, the order follows the configured `SchedulingPolicy`. Each auto transition fires at most once per epoch.
+ *
+ * Config: `controller/transition_scheduler/policy`; defaults to `ORDERED`.
+ */
+class TransitionScheduler
+{
+    static constexpr const char* MODULE_TAG{"TransitionScheduler"};
+
+public:
+    /// @brief transitions for which `filter(transition)` is false are not scheduled
+    using Filter = std::function<bool(Transition const&)>;
+
+    /// @param filter [optional] schedule only a subset of the transitions, e.g., the ones of a net shard
+    TransitionScheduler(Transition::List& transitions, nlohmann::json const& controllerConfig, Filter filter = {});
+
+    /// @brief fire enabled auto transitions in scheduling order; transitions appended to the list since the previous
+    /// call, e.g., by subnet instantiation, join the schedule first
+    /// @param fired [output] cleared, then filled with the fired transitions, in firing order
+    void fireEnabled(std::vector<Transition const*>& fired);
+
+    SchedulingPolicy getPolicy() const { return m_policy; }
+
+private:
+    struct Entry
+    {
+        Transition* transition;
+        uint32_t weight;
+        int64_t credit{0};        // WEIGHTED_ROUND_ROBIN
+        uint64_t virtualTime{0U}; // FAIR_SHARE
+    };
+
+    struct Bucket
+    {
+        int32_t priority;
+        std::vector<Entry> entries{};   // config order
+        std::vector<uint32_t> order{};  // scratch: entry indexes in this epoch firing order
+        int64_t totalWeight{0};         // WEIGHTED_ROUND_ROBIN
+        uint32_t next{0U};              // ROUND_ROBIN: first entry of the next epoch
+        uint64_t systemVirtualTime{0U}; // FAIR_SHARE: start tag of the last fired entry
+    };
+
+    /// @brief add the transitions appended to `m_transitions` to their buckets
+    void addNewTransitions();
+    void computeOrder(Bucket& bucket);
+    void onFired(Bucket& bucket, uint32_t entryIdx);
+
+    Transition::List& m_transitions;
+    Filter m_filter;
+    size_t m_numberTransitions{0U}; // already in buckets
+    SchedulingPolicy m_policy{SchedulingPolicy::ORDERED};
+    std::vector<Bucket> m_buckets; // decreasing priority
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -63,16 +63,18 @@ BETTER_ENUM(TransitionType, uint32_t, UNDEFINED = 0,
 
 /// Arc type (from transition perspective) - using BETTER_ENUM for helper str member functions
 BETTER_ENUM(ArcType, uint32_t, UNDEFINED = 0,
-            INPUT, // input to transition
-            OUTPUT // output to transition
+            INPUT,    // input to transition
+            OUTPUT,   // output to transition
+            INHIBITOR // transition only enabled while the place has less tokens than the arc weight
 )
 
 BETTER_ENUM(ExceptionType, uint32_t, NONE = 0,
-            RUNTIME_ERROR,      //
-            LOGIC_ERROR,        //
-            INVALID_VALUE,      // bad parameter or bad argument
-            NOT_IMPLEMENTED,    //
-            INVALID_CONFIG_FILE // there is an issue with a config file, e.g., missing param, invalid param, ...
+            RUNTIME_ERROR,       //
+            LOGIC_ERROR,         //
+            INVALID_VALUE,       // bad parameter or bad argument
+            NOT_IMPLEMENTED,     //
+            INVALID_CONFIG_FILE, // there is an issue with a config file, e.g., missing param, invalid param, ...
+            CAPACITY_EXCEEDED    // a place is full; the caller should back off and retry later
 )
 
 } // namespace bnet
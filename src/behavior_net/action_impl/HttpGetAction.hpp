@@ -23,7 +23,9 @@
 
 #include <3rd_party/cpp-httplib/httplib.h>
 
+#include <chrono>
 #include <list>
+#include <memory>
 #include <utils/Logger.hpp>
 
 namespace capybot
@@ -38,11 +40,16 @@ namespace bnet
  * requests to query the action status. These two types of requests can have different paths, e.g.,
  * <host>:<port>/execute/action/abc and <host>:<port>/status/action/abc.
  *
+ * Requests time out after `request_timeout_ms` while connecting, or without progress while sending or receiving; a
+ * cancelled execution, e.g., on the action `timeout_ms`, interrupts its request. Either way, the token gets the ERROR
+ * status, and a hung client entity does not hold the worker.
+ *
  * Config parameters:
- *     "host"            [string] request host address
- *     "port"            [int] request port
- *     "execute_path"    [string] request path for starting execution, e.g., <host>:<port></execute/path>
- *     "get_status_path" [string] request path for getting execution status, e.g., <host>:<port></status/path>
+ *     "host"               [string] request host address
+ *     "port"               [int] request port
+ *     "execute_path"       [string] request path for starting execution, e.g., <host>:<port></execute/path>
+ *     "get_status_path"    [string] request path for getting execution status, e.g., <host>:<port></status/path>
+ *     "request_timeout_ms" [uint32_t][default: 5000] connection, read and write timeout of each request
  */
 class HttpGetAction : public IActionImpl
 {
@@ -54,12 +61,19 @@ public:
         , m_port(config.at("port"))
         , m_executePath(config.at("execute_path"))
         , m_getStatusPath(config.at("get_status_path"))
+        , m_requestTimeout(config.value("request_timeout_ms", 5000U))
     {
     }
 
     std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
     {
-        return [token, this]() -> ActionExecutionStatus {
+        return createCancellableCallable(token, CancellationToken());
+    }
+
+    std::function<ActionExecutionStatus()> createCancellableCallable(Token::ConstSharedPtr token,
+                                                                     CancellationToken const& cancellation) override
+    {
+        return [token, cancellation, this]() -> ActionExecutionStatus {
             auto host = m_host.get(token);
             auto port = m_port.get(token);
             auto executePath = m_executePath.get(token);
@@ -71,7 +85,7 @@ public:
             ActionExecutionStatus retStatus{ActionExecutionStatus::NOT_STARTED};
             if (isInExecution)
             {
-                retStatus = request(host, port, getStatusPath);
+                retStatus = request(host, port, getStatusPath, cancellation);
                 if (retStatus._value != ActionExecutionStatus::IN_PROGRESS)
                 {
                     m_inExec.remove(actionId);
@@ -79,7 +93,7 @@ public:
             }
             else
             {
-                retStatus = request(host, port, executePath);
+                retStatus = request(host, port, executePath, cancellation);
                 if (retStatus == +ActionExecutionStatus::IN_PROGRESS)
                 {
                     m_inExec.push_back(actionId);
@@ -89,11 +103,29 @@ public:
         };
     }
 
+    bool performsBlockingIo() const override { return true; }
+
 private:
-    ActionExecutionStatus request(std::string const& host, int port, std::string const& path)
+    ActionExecutionStatus request(std::string const& host, int port, std::string const& path,
+                                  CancellationToken const& cancellation)
     {
-        httplib::Client client(host, port);
-        httplib::Result res = client.Get(path);
+        auto client = std::make_shared<httplib::Client>(host, port);
+        client->set_connection_timeout(m_requestTimeout);
+        client->set_read_timeout(m_requestTimeout);
+        client->set_write_timeout(m_requestTimeout);
+        // shutting down the socket is the only thread safe way of interrupting an in-flight request
+        cancellation.onCancel([weakClient = std::weak_ptr<httplib::Client>(client)] {
+            if (auto client = weakClient.lock())
+            {
+                client->stop();
+            }
+        });
+        if (cancellation.isCancelled())
+        {
+            LOG(ERROR) << "HttpGetAction :: request @ " << host << ":" << port << path << " cancelled" << log::endl;
+            return ActionExecutionStatus::ERROR;
+        }
+        httplib::Result res = client->Get(path);
 
         std::stringstream logMsg;
         logMsg << "HttpGetAction :: requesting @ " << host << ":" << port << path << " ... ";
@@ -138,6 +170,7 @@ private:
     const ConfigParameter<int> m_port;
     const ConfigParameter<std::string> m_executePath;
     const ConfigParameter<std::string> m_getStatusPath;
+    const std::chrono::milliseconds m_requestTimeout;
 
     std::list<std::string> m_inExec; // to keep track of actions in execution so we know which request type to send
 };
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/action_impl/ShellAction.hpp>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace capybot
+{
+namespace bnet
+{
+
+REGISTER_ACTION_TYPE(ShellAction);
+
+namespace
+{
+constexpr int POLL_PERIOD_MS{10}; // how often a blocked read checks for cancellation
+} // namespace
+
+ShellAction::ShellAction(nlohmann::json const config)
+    : m_command(config.at("command").get<std::string>())
+    , m_responseTimeout(config.value("response_timeout_ms", 10000U))
+    , m_workers(config.value("number_workers", 2U))
+{
+    if (m_workers.empty())
+    {
+        throw Exception(ExceptionType::INVALID_CONFIG_FILE, "ShellAction: `number_workers` must be positive.")
+            .appendMetadata("command", m_command);
+    }
+}
+
+ShellAction::~ShellAction()
+{
+    std::unique_lock<std::mutex> lk(m_mtx);
+    // in flight requests end with their action, as the thread pool tasks refer to it
+    m_workerReleased.wait(lk, [this] {
+        return std::none_of(m_workers.begin(), m_workers.end(), [](Worker const& worker) { return worker.busy; });
+    });
+    for (auto&& worker : m_workers)
+    {
+        stopWorker(worker);
+    }
+}
+
+uint32_t ShellAction::getNumberWorkersStarted() const
+{
+    std::lock_guard<std::mutex> lk(m_mtx);
+    return m_numberWorkersStarted;
+}
+
+ActionExecutionStatus ShellAction::request(Token::ConstSharedPtr const& token, CancellationToken const& cancellation)
+{
+    const auto content = token->getContentBlocks().dump(); // single line, as control characters are escaped
+
+    auto* const idleWorker = acquireWorker(std::chrono::steady_clock::now() + m_responseTimeout, cancellation);
+    if (!idleWorker)
+    {
+        LOG(ERROR) << "request: cancelled, or no idle worker within the response timeout" << log::endl;
+        return ActionExecutionStatus::ERROR;
+    }
+    auto& worker = *idleWorker;
+    const auto deadline = std::chrono::steady_clock::now() + m_responseTimeout;
+    if (worker.pid < 0 || cancellation.isCancelled())
+    {
+        releaseWorker(worker);
+        return ActionExecutionStatus::ERROR;
+    }
+
+    uint64_t requestId;
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        requestId = m_nextRequestId++;
+    }
+    const auto requestIdStr = std::to_string(requestId);
+    const auto requestLine = requestIdStr + " " + content + "\n";
+
+    if (!writeLine(worker, requestLine, deadline, cancellation))
+    {
+        LOG(ERROR) << "request: failed to write to worker " << worker.pid << "; restarting it" << log::endl;
+        stopWorker(worker);
+        releaseWorker(worker);
+        return ActionExecutionStatus::ERROR;
+    }
+
+    while (true)
+    {
+        const auto lineOpt = readLine(worker, deadline, cancellation);
+        if (!lineOpt.has_value())
+        {
+            LOG(ERROR) << "request: no response from worker " << worker.pid << "; restarting it" << log::endl;
+            stopWorker(worker);
+            releaseWorker(worker);
+            return ActionExecutionStatus::ERROR;
+        }
+
+        const auto& line = lineOpt.value();
+        if (line.size() <= requestIdStr.size() || line.compare(0, requestIdStr.size(), requestIdStr) != 0 ||
+            line[requestIdStr.size()] != ' ')
+        {
+            continue; // not a response, e.g., a worker log
+        }
+
+        releaseWorker(worker);
+        const auto statusStr = line.substr(requestIdStr.size() + 1U);
+        const auto statusOpt = ActionExecutionStatus::_from_string_nothrow(statusStr.c_str());
+        if (!statusOpt)
+        {
+            LOG(ERROR) << "request: unrecognized status `" << statusStr << "`" << log::endl;
+            return ActionExecutionStatus::ERROR;
+        }
+        return statusOpt.value();
+    }
+}
+
+ShellAction::Worker* ShellAction::acquireWorker(std::chrono::steady_clock::time_point deadline,
+                                                CancellationToken const& cancellation)
+{
+    const auto hasIdleWorker = [this] {
+        return std::any_of(m_workers.begin(), m_workers.end(), [](Worker const& worker) { return !worker.busy; });
+    };
+
+    std::unique_lock<std::mutex> lk(m_mtx);
+    while (!hasIdleWorker())
+    {
+        if (cancellation.isCancelled() || std::chrono::steady_clock::now() >= deadline)
+        {
+            return nullptr;
+        }
+        m_workerReleased.wait_until(lk, std::min(deadline, std::chrono::steady_clock::now() +
+                                                               std::chrono::milliseconds(POLL_PERIOD_MS)));
+    }
+
+    // prefer running workers; the others are started on demand
+    auto it = std::find_if(m_workers.begin(), m_workers.end(),
+                           [](Worker const& worker) { return !worker.busy && worker.pid >= 0; });
+    if (it == m_workers.end())
+    {
+        it = std::find_if(m_workers.begin(), m_workers.end(), [](Worker const& worker) { return !worker.busy; });
+    }
+    auto& worker = *it;
+    worker.busy = true;
+
+    // a worker which exited while idle is replaced
+    if (worker.pid >= 0 && ::waitpid(worker.pid, nullptr, WNOHANG) != 0)
+    {
+        LOG(WARN) << "acquireWorker: worker " << worker.pid << " exited; restarting it" << log::endl;
+        ::kill(-worker.pid, SIGKILL); // the programs it started, if any
+        worker.pid = -1;
+        stopWorker(worker);
+    }
+    if (worker.pid < 0 && startWorker(worker))
+    {
+        ++m_numberWorkersStarted;
+    }
+    return &worker;
+}
+
+void ShellAction::releaseWorker(Worker& worker)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        worker.busy = false;
+    }
+    m_workerReleased.notify_all();
+}
+
+bool ShellAction::startWorker(Worker& worker)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+        LOG(ERROR) << "startWorker: socketpair failed; errno " << errno << log::endl;
+        return false;
+    }
+
+    const pid_t pid = ::fork();
+    if (pid < 0)
+    {
+        LOG(ERROR) << "startWorker: fork failed; errno " << errno << log::endl;
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    if (pid == 0)
+    {
+        // child; only async-signal-safe calls until exec
+        ::setpgid(0, 0); // own process group, so stopping the worker stops the programs it starts too
+        ::dup2(fds[1], STDIN_FILENO);
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::execl("/bin/sh", "sh", "-c", m_command.c_str(), static_cast<char*>(nullptr));
+        ::_exit(127);
+    }
+
+    ::setpgid(pid, pid); // also set by the child; whichever runs first
+    ::close(fds[1]);
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.readBuffer.clear();
+    return true;
+}
+
+void ShellAction::stopWorker(Worker& worker)
+{
+    if (worker.fd >= 0)
+    {
+        ::close(worker.fd); // workers reading their stdin see the end of file
+        worker.fd = -1;
+    }
+    if (worker.pid >= 0)
+    {
+        ::kill(-worker.pid, SIGKILL);
+        ::waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    }
+    worker.readBuffer.clear();
+}
+
+bool ShellAction::writeLine(Worker& worker, std::string const& line, std::chrono::steady_clock::time_point deadline,
+                            CancellationToken const& cancellation)
+{
+    size_t written{0U};
+    while (written < line.size())
+    {
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || cancellation.isCancelled())
+        {
+            return false;
+        }
+
+        // a worker which stopped reading fills the socket buffer; poll rather than block in `send`
+        pollfd pfd{.fd = worker.fd, .events = POLLOUT, .revents = 0};
+        const auto ret = ::poll(&pfd, 1, std::min<int>(remaining.count(), POLL_PERIOD_MS));
+        if (ret < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        if (ret <= 0)
+        {
+            continue;
+        }
+
+        // the worker only reads requests sent to its socket, so a worker which exited does not raise SIGPIPE
+        const auto numberWritten =
+            ::send(worker.fd, line.data() + written, line.size() - written, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (numberWritten < 0 && errno != EINTR && errno != EAGAIN)
+        {
+            return false;
+        }
+        written += numberWritten > 0 ? numberWritten : 0;
+    }
+    return true;
+}
+
+std::optional<std::string> ShellAction::readLine(Worker& worker, std::chrono::steady_clock::time_point deadline,
+                                                 CancellationToken const& cancellation)
+{
+    while (true)
+    {
+        const auto lineEnd = worker.readBuffer.find('\n');
+        if (lineEnd != std::string::npos)
+        {
+            auto line = worker.readBuffer.substr(0U, lineEnd);
+            worker.readBuffer.erase(0U, lineEnd + 1U);
+            return line;
+        }
+
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || cancellation.isCancelled())
+        {
+            return std::nullopt;
+        }
+
+        pollfd pfd{.fd = worker.fd, .events = POLLIN, .revents = 0};
+        const auto ret = ::poll(&pfd, 1, std::min<int>(remaining.count(), POLL_PERIOD_MS));
+        if (ret < 0 && errno != EINTR)
+        {
+            return std::nullopt;
+        }
+        if (ret <= 0)
+        {
+            continue;
+        }
+
+        char buffer[4096];
+        const auto numberRead = ::read(worker.fd, buffer, sizeof(buffer));
+        if (numberRead == 0 || (numberRead < 0 && errno != EINTR && errno != EAGAIN))
+        {
+            return std::nullopt; // the worker exited
+        }
+        if (numberRead > 0)
+        {
+            worker.readBuffer.append(buffer, numberRead);
+        }
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
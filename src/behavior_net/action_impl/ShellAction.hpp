@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/Action.hpp>
+#include <behavior_net/ActionRegistry.hpp>
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief This action runs an external program, kept alive as a pool of persistent worker subprocesses
+ *
+ * Each worker is started with `/bin/sh -c <command>` and handles one request at a time over its stdin/stdout, with a
+ * line protocol:
+ *     request:  <request id> <token content blocks, as single line JSON>\n
+ *     response: <request id> <action execution status, e.g., SUCCESS>\n
+ * Output lines without the request id are ignored, e.g., worker logs. A worker returning IN_PROGRESS is sent the same
+ * token again in a later epoch. Workers which exit, or do not read their request or respond in time, are killed along
+ * with the programs they started, and replaced on their next use; the token gets the ERROR status. Requests waiting
+ * for an idle worker longer than the response timeout get the ERROR status as well, without affecting the workers.
+ *
+ * Config parameters:
+ *     "command"             [string] worker command line
+ *     "number_workers"      [uint32_t][default: 2] maximum number of worker subprocesses
+ *     "response_timeout_ms" [uint32_t][default: 10000] maximum time to wait for a response
+ */
+class ShellAction : public IActionImpl
+{
+    static constexpr const char* MODULE_TAG{"ShellAction"};
+
+public:
+    ShellAction(nlohmann::json const config);
+    ~ShellAction() override;
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
+    {
+        return createCancellableCallable(token, CancellationToken());
+    }
+
+    std::function<ActionExecutionStatus()> createCancellableCallable(Token::ConstSharedPtr token,
+                                                                     CancellationToken const& cancellation) override
+    {
+        return [this, token, cancellation]() -> ActionExecutionStatus { return request(token, cancellation); };
+    }
+
+    bool performsBlockingIo() const override { return true; }
+
+    /// @brief number of workers started so far, incl. restarts
+    uint32_t getNumberWorkersStarted() const;
+
+private:
+    struct Worker
+    {
+        pid_t pid{-1}; // -1 if not running
+        int fd{-1};    // socket connected to the worker stdin and stdout
+        std::string readBuffer{};
+        bool busy{false};
+    };
+
+    ActionExecutionStatus request(Token::ConstSharedPtr const& token, CancellationToken const& cancellation);
+
+    /// @brief wait for an idle worker, and start it if not running
+    /// @return nullptr if no worker was idle before `deadline`, or on cancellation
+    Worker* acquireWorker(std::chrono::steady_clock::time_point deadline, CancellationToken const& cancellation);
+    void releaseWorker(Worker& worker);
+
+    /// @return false if the worker could not be started
+    bool startWorker(Worker& worker);
+    static void stopWorker(Worker& worker);
+
+    /// @return false on timeout, cancellation or worker exit
+    bool writeLine(Worker& worker, std::string const& line, std::chrono::steady_clock::time_point deadline,
+                   CancellationToken const& cancellation);
+    /// @return the next line written by the worker, or nullopt on timeout, cancellation or worker exit
+    std::optional<std::string> readLine(Worker& worker, std::chrono::steady_clock::time_point deadline,
+                                        CancellationToken const& cancellation);
+
+    const std::string m_command;
+    const std::chrono::milliseconds m_responseTimeout;
+
+    std::vector<Worker> m_workers;
+    uint64_t m_nextRequestId{0U};
+    uint32_t m_numberWorkersStarted{0U};
+    mutable std::mutex m_mtx;
+    std::condition_variable m_workerReleased;
+};
+
+} // namespace bnet
+} // namespace capybot
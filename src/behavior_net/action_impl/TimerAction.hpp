@@ -26,6 +26,7 @@
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace capybot
 {
@@ -39,6 +40,7 @@ namespace bnet
  *     "duration_ms"  [uint32_t] how long to hold the token for
  *     "failure_rate" [float][range: 0.0, 1.0][default: 0.0] rate in which the action should result in failure
  *     "error_rate"   [float][range: 0.0, 1.0][default: 0.0] rate in which the action should result in error
+ *     "batch"        [bool][default: false] check all the timers of an epoch in one task
  */
 class TimerAction : public IActionImpl
 {
@@ -49,6 +51,7 @@ public:
         : m_durationMs(config.at("duration_ms"))
         , m_failureRate(config.contains("failure_rate") ? config.at("failure_rate") : nlohmann::json(0.f))
         , m_errorRate(config.contains("error_rate") ? config.at("error_rate") : nlohmann::json(0.f))
+        , m_batch(config.value("batch", false))
         , m_rd()
         , m_gen(m_rd())
     {
@@ -56,39 +59,81 @@ public:
 
     std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
     {
-        float failureRate = m_failureRate.get(token);
-        float errorRate = m_errorRate.get(token);
-        float successRate = 1.f - failureRate - errorRate;
-
-        std::discrete_distribution<> d({successRate, failureRate, errorRate});
-        const auto result = ActionExecutionStatus::_from_integral(d(m_gen));
-
-        const auto durationMs = m_durationMs.get(token);
-
-        return [this, token, durationMs, result]() -> ActionExecutionStatus {
+        const auto timer = createTimer(token);
+        return [this, timer]() -> ActionExecutionStatus {
             const auto now = std::chrono::system_clock::now();
-
             std::unique_lock<std::mutex> lk(m_mtx);
+            return checkTimer(timer, now);
+        };
+    }
 
-            if (m_tokenIdToFinishTime.find(token.get()) == m_tokenIdToFinishTime.end()) // new timer
-            {
-                m_tokenIdToFinishTime[token.get()] = now + std::chrono::milliseconds(durationMs);
-            }
+    bool supportsBatches() const override { return m_batch; }
+
+    std::function<std::vector<ActionExecutionStatus>()>
+    createBatchCallable(std::vector<Token::ConstSharedPtr> const& tokens) override
+    {
+        std::vector<Timer> timers;
+        timers.reserve(tokens.size());
+        for (auto&& token : tokens)
+        {
+            timers.push_back(createTimer(token));
+        }
+
+        return [this, timers]() -> std::vector<ActionExecutionStatus> {
+            const auto now = std::chrono::system_clock::now();
+            std::vector<ActionExecutionStatus> results;
+            results.reserve(timers.size());
 
-            if (now > m_tokenIdToFinishTime[token.get()]) // timer is done
+            std::unique_lock<std::mutex> lk(m_mtx); // locked once for the whole batch
+            for (auto&& timer : timers)
             {
-                m_tokenIdToFinishTime.erase(token.get());
-                return result;
+                results.push_back(checkTimer(timer, now));
             }
-
-            return ActionExecutionStatus::IN_PROGRESS; // timer is not done
+            return results;
         };
     }
 
 private:
+    struct Timer
+    {
+        Token::ConstSharedPtr token;
+        uint32_t durationMs;
+        ActionExecutionStatus result;
+    };
+
+    Timer createTimer(Token::ConstSharedPtr const& token)
+    {
+        float failureRate = m_failureRate.get(token);
+        float errorRate = m_errorRate.get(token);
+        float successRate = 1.f - failureRate - errorRate;
+
+        std::discrete_distribution<> d({successRate, failureRate, errorRate});
+        const auto result = ActionExecutionStatus::_from_integral(d(m_gen));
+
+        return Timer{.token = token, .durationMs = m_durationMs.get(token), .result = result};
+    }
+
+    /// @brief m_mtx must be held
+    ActionExecutionStatus checkTimer(Timer const& timer, std::chrono::time_point<std::chrono::system_clock> now)
+    {
+        if (m_tokenIdToFinishTime.find(timer.token.get()) == m_tokenIdToFinishTime.end()) // new timer
+        {
+            m_tokenIdToFinishTime[timer.token.get()] = now + std::chrono::milliseconds(timer.durationMs);
+        }
+
+        if (now > m_tokenIdToFinishTime[timer.token.get()]) // timer is done
+        {
+            m_tokenIdToFinishTime.erase(timer.token.get());
+            return timer.result;
+        }
+
+        return ActionExecutionStatus::IN_PROGRESS; // timer is not done
+    }
+
     const ConfigParameter<uint32_t> m_durationMs;
     const ConfigParameter<float> m_failureRate;
     const ConfigParameter<float> m_errorRate;
+    const bool m_batch;
 
     std::unordered_map<const Token*, std::chrono::time_point<std::chrono::system_clock>> m_tokenIdToFinishTime;
     std::mutex m_mtx;
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <behavior_net/analysis/Invariants.hpp>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+namespace capybot
+{
+namespace bnet
+{
+
+namespace
+{
+using SparseVector = InvariantAnalyzer::SparseVector;
+
+int64_t coefficientAt(SparseVector const& v, uint32_t index)
+{
+    const auto it = std::lower_bound(v.begin(), v.end(), index, [](auto const& e, uint32_t i) { return e.first < i; });
+    return it != v.end() && it->first == index ? it->second : 0;
+}
+
+/// @return a * u + b * v
+SparseVector combine(int64_t a, SparseVector const& u, int64_t b, SparseVector const& v)
+{
+    SparseVector result;
+    result.reserve(u.size() + v.size());
+    auto itU = u.begin();
+    auto itV = v.begin();
+    while (itU != u.end() || itV != v.end())
+    {
+        uint32_t index;
+        int64_t value;
+        if (itV == v.end() || (itU != u.end() && itU->first < itV->first))
+        {
+            index = itU->first;
+            value = a * (itU++)->second;
+        }
+        else if (itU == u.end() || itV->first < itU->first)
+        {
+            index = itV->first;
+            value = b * (itV++)->second;
+        }
+        else
+        {
+            index = itU->first;
+            value = a * (itU++)->second + b * (itV++)->second;
+        }
+        if (value != 0)
+        {
+            result.emplace_back(index, value);
+        }
+    }
+    return result;
+}
+
+int64_t gcd(SparseVector const& v, int64_t g = 0)
+{
+    for (auto&& [index, value] : v)
+    {
+        g = std::gcd(g, value);
+    }
+    return g;
+}
+
+void divide(SparseVector& v, int64_t d)
+{
+    for (auto&& e : v)
+    {
+        e.second /= d;
+    }
+}
+
+/// @return support(a) is a subset of support(b)
+bool isSupportSubset(SparseVector const& a, SparseVector const& b)
+{
+    auto itB = b.begin();
+    for (auto&& [index, value] : a)
+    {
+        itB = std::find_if(itB, b.end(), [index = index](auto const& e) { return e.first >= index; });
+        if (itB == b.end() || itB->first != index)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+bool InvariantAnalyzer::Result::isConservative() const
+{
+    return std::all_of(placeBounds.begin(), placeBounds.end(), [](auto const& bound) { return bound.has_value(); });
+}
+
+nlohmann::json InvariantAnalyzer::Result::toJson(NetStructure const& net) const
+{
+    const auto toNamedJson = [](SparseVector const& v, auto const& getName) {
+        nlohmann::json json = nlohmann::json::object();
+        for (auto&& [index, value] : v)
+        {
+            json[getName(index)] = value;
+        }
+        return json;
+    };
+    const auto placeName = [&net](uint32_t i) { return net.placeIds[i]; };
+    const auto transitionName = [&net](uint32_t i) { return net.transitions[i].id; };
+
+    nlohmann::json json;
+    json["complete"] = complete;
+    json["conservative"] = isConservative();
+    json["p_invariants"] = nlohmann::json::array();
+    for (auto&& invariant : pInvariants)
+    {
+        json["p_invariants"].push_back(toNamedJson(invariant, placeName));
+    }
+    json["t_invariants"] = nlohmann::json::array();
+    for (auto&& invariant : tInvariants)
+    {
+        json["t_invariants"].push_back(toNamedJson(invariant, transitionName));
+    }
+    json["place_bounds"] = nlohmann::json::object();
+    for (uint32_t p = 0U; p < placeBounds.size(); ++p)
+    {
+        json["place_bounds"][net.placeIds[p]] = placeBounds[p].has_value() ? nlohmann::json(*placeBounds[p]) : nullptr;
+    }
+    return json;
+}
+
+InvariantAnalyzer::InvariantAnalyzer(NetStructure net, size_t maxRows)
+    : m_net(std::move(net))
+    , m_maxRows(maxRows)
+{
+    for (auto&& transition : m_net.transitions)
+    {
+        std::map<uint32_t, int64_t> column;
+        for (auto&& arc : transition.inputArcs)
+            column[arc.place] -= arc.weight;
+        for (auto&& arc : transition.outputArcs)
+            column[arc.place] += arc.weight;
+
+        auto& sparseColumn = m_incidence.emplace_back();
+        for (auto&& [place, value] : column)
+        {
+            if (value != 0) // self-loops do not change the marking
+            {
+                sparseColumn.emplace_back(place, value);
+            }
+        }
+    }
+}
+
+std::optional<std::vector<SparseVector>> InvariantAnalyzer::farkas(std::vector<SparseVector> const& rows) const
+{
+    struct Row
+    {
+        SparseVector a; // remaining columns of A
+        SparseVector y; // combination of the original rows
+    };
+
+    std::vector<Row> working;
+    std::vector<uint32_t> columns;
+    for (uint32_t i = 0U; i < rows.size(); ++i)
+    {
+        working.push_back(Row{.a = rows[i], .y = {{i, 1}}});
+        for (auto&& [column, value] : rows[i])
+        {
+            columns.push_back(column);
+        }
+    }
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+
+    for (auto&& column : columns)
+    {
+        std::vector<Row> next;
+        std::vector<Row const*> positive;
+        std::vector<Row const*> negative;
+        for (auto&& row : working)
+        {
+            const auto value = coefficientAt(row.a, column);
+            if (value == 0)
+                next.push_back(row);
+            else
+                (value > 0 ? positive : negative).push_back(&row);
+        }
+
+        // non-negative combinations of rows with opposite signs cancel the column
+        for (auto&& p : positive)
+        {
+            for (auto&& n : negative)
+            {
+                const auto cp = coefficientAt(p->a, column);
+                const auto cn = -coefficientAt(n->a, column);
+                Row row{.a = combine(cn, p->a, cp, n->a), .y = combine(cn, p->y, cp, n->y)};
+                const auto g = gcd(row.y, gcd(row.a));
+                divide(row.a, g);
+                divide(row.y, g);
+                next.push_back(std::move(row));
+            }
+            if (next.size() > m_maxRows)
+            {
+                LOG(WARN) << "farkas: reached the maximum number of rows (" << m_maxRows << ")" << log::endl;
+                return std::nullopt;
+            }
+        }
+
+        // keep minimal supports only; the other rows are combinations of those
+        const auto bySupportSize = [](auto const& a, auto const& b) { return a.y.size() < b.y.size(); };
+        std::stable_sort(next.begin(), next.end(), bySupportSize);
+        working.clear();
+        for (auto&& row : next)
+        {
+            if (std::none_of(working.begin(), working.end(),
+                             [&row](auto const& kept) { return isSupportSubset(kept.y, row.y); }))
+            {
+                working.push_back(std::move(row));
+            }
+        }
+    }
+
+    std::vector<SparseVector> invariants;
+    for (auto&& row : working)
+    {
+        invariants.push_back(std::move(row.y));
+    }
+    std::sort(invariants.begin(), invariants.end());
+    return invariants;
+}
+
+InvariantAnalyzer::Result InvariantAnalyzer::analyze(std::vector<uint32_t> const& initialMarking) const
+{
+    SCOPED_LOG_TRACER("analyze");
+
+    const uint32_t numberPlaces = m_net.placeIds.size();
+    if (initialMarking.size() != numberPlaces)
+    {
+        throw Exception(ExceptionType::INVALID_VALUE, "InvariantAnalyzer::analyze: invalid initial marking size.")
+            .appendMetadata("expected", numberPlaces)
+            .appendMetadata("actual", initialMarking.size());
+    }
+
+    // P-invariants: y^T C = 0, i.e., A = C with one row per place
+    std::vector<SparseVector> placeRows(numberPlaces);
+    for (uint32_t t = 0U; t < m_incidence.size(); ++t)
+    {
+        for (auto&& [place, value] : m_incidence[t])
+        {
+            placeRows[place].emplace_back(t, value);
+        }
+    }
+    auto pInvariants = farkas(placeRows);
+
+    // T-invariants: C x = 0, i.e., A = C^T with one row per transition
+    auto tInvariants = farkas(m_incidence);
+
+    Result result;
+    result.complete = pInvariants.has_value() && tInvariants.has_value();
+    result.pInvariants = std::move(pInvariants).value_or(std::vector<SparseVector>{});
+    result.tInvariants = std::move(tInvariants).value_or(std::vector<SparseVector>{});
+
+    // y . M = y . M0 for any reachable M, hence M[p] <= (y . M0) / y[p]
+    result.placeBounds.resize(numberPlaces);
+    for (auto&& invariant : result.pInvariants)
+    {
+        uint64_t weightedSum{0U};
+        for (auto&& [place, value] : invariant)
+        {
+            weightedSum += static_cast<uint64_t>(value) * initialMarking[place];
+        }
+        for (auto&& [place, value] : invariant)
+        {
+            const uint64_t bound = weightedSum / static_cast<uint64_t>(value);
+            auto& placeBound = result.placeBounds[place];
+            placeBound = placeBound.has_value() ? std::min(*placeBound, bound) : bound;
+        }
+    }
+
+    // a capacity is equivalent to a complementary place, which adds the P-invariant p + p' = capacity
+    for (uint32_t p = 0U; p < numberPlaces; ++p)
+    {
+        if (const auto capacity = m_net.getCapacity(p); capacity.has_value())
+        {
+            const auto bound = result.placeBounds[p].value_or(capacity.value());
+            result.placeBounds[p] = std::min<uint64_t>(bound, capacity.value());
+        }
+    }
+    return result;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <behavior_net/analysis/NetStructure.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Structural analysis of a net based on its incidence matrix
+ *
+ * P-invariants (weightings of places whose weighted token sum no transition changes) and T-invariants (firing count
+ * vectors that reproduce a marking) are computed with the Farkas algorithm over sparse integer rows. Only minimal
+ * support invariants are kept and each one is normalized by the gcd of its coefficients.
+ *
+ * A place covered by a P-invariant `y` is bounded by `(y . M0) / y[p]`, for any marking reachable from `M0`. Note that
+ * tokens added externally (e.g., through `/add_token`) are not part of `M0`, so such bounds only hold for places not
+ * reachable from entry places, or if `M0` accounts for the expected external tokens. Place capacities are bounds on
+ * their own, regardless of external tokens.
+ */
+class InvariantAnalyzer
+{
+    static constexpr const char* MODULE_TAG{"InvariantAnalyzer"};
+
+public:
+    /// sparse integer vector: (index, coefficient) pairs sorted by index, no zero coefficients
+    using SparseVector = std::vector<std::pair<uint32_t, int64_t>>;
+
+    struct Result
+    {
+        std::vector<SparseVector> pInvariants; // indexes are places
+        std::vector<SparseVector> tInvariants; // indexes are transitions
+        /// std::nullopt if the place is neither covered by a P-invariant nor has a capacity
+        std::vector<std::optional<uint64_t>> placeBounds;
+        bool complete{true}; // false if `maxRows` was reached; invariants found so far are then dropped
+
+        bool isConservative() const; // all places are bounded
+        nlohmann::json toJson(NetStructure const& net) const;
+    };
+
+    /// @param maxRows limit on intermediate Farkas rows, which can grow exponentially with the net size
+    explicit InvariantAnalyzer(NetStructure net, size_t maxRows = 100'000U);
+
+    /// @return incidence matrix columns, one per transition: (place, output weight - input weight)
+    std::vector<SparseVector> const& getIncidence() const { return m_incidence; }
+
+    Result analyze(std::vector<uint32_t> const& initialMarking) const;
+
+private:
+    /// @return minimal support semi-positive solutions `y` of `y^T A = 0`, with A given as sparse rows
+    std::optional<std::vector<SparseVector>> farkas(std::vector<SparseVector> const& rows) const;
+
+    NetStructure m_net;
+    size_t m_maxRows;
+    std::vector<SparseVector> m_incidence;
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Subnet.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <3rd_party/nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Token-count abstraction of a net config, used by the offline analysis tools
+ *
+ * Token content and action results are abstracted away: a token in a place can be consumed by any input arc of that
+ * place, regardless of `action_result_filter`, `token_guard` and `join_key`. Likewise, inhibitor arcs consider all the
+ * tokens in their place.
+ */
+struct NetStructure
+{
+    struct Arc
+    {
+        uint32_t place; // index in `placeIds`
+        uint32_t weight;
+    };
+
+    struct Transition
+    {
+        std::string id;
+        bool isManual;
+        std::vector<Arc> inputArcs{};
+        std::vector<Arc> outputArcs{};
+        std::vector<Arc> inhibitorArcs{}; // enabled while the place has less than `weight` tokens
+    };
+
+    std::vector<std::string> placeIds;
+    std::vector<std::optional<uint32_t>> capacities; // same size as `placeIds`
+    std::vector<Transition> transitions;
+
+    /// @param netConfig full net config, i.e., `NetConfig::get()`; assumed to be valid; subnet instances are expanded
+    static NetStructure fromConfig(nlohmann::json const& netConfig)
+    {
+        const auto expandedConfig = expandSubnets(netConfig);
+
+        NetStructure net;
+        for (auto&& placeConfig : expandedConfig.at("petri_net").at("places"))
+        {
+            net.placeIds.push_back(placeConfig.at("place_id").get<std::string>());
+            net.capacities.push_back(placeConfig.contains("capacity")
+                                         ? std::optional<uint32_t>(placeConfig.at("capacity").get<uint32_t>())
+                                         : std::nullopt);
+        }
+
+        for (auto&& transitionConfig : expandedConfig.at("petri_net").at("transitions"))
+        {
+            Transition transition{.id = transitionConfig.at("transition_id").get<std::string>(),
+                                  .isManual = transitionConfig.contains("transition_type") &&
+                                              TransitionType::_from_string_nocase(
+                                                  transitionConfig.at("transition_type").get<std::string>().c_str()) ==
+                                                  +TransitionType::MANUAL};
+            for (auto&& arcConfig : transitionConfig.at("transition_arcs"))
+            {
+                const Arc arc{.place = net.getPlaceIndex(arcConfig.at("place_id").get<std::string>()),
+                              .weight = arcConfig.value("weight", 1U)};
+                const auto type = ArcType::_from_string_nocase(arcConfig.at("type").get<std::string>().c_str());
+                if (type == +ArcType::INPUT)
+                {
+                    transition.inputArcs.push_back(arc);
+                }
+                else if (type == +ArcType::INHIBITOR)
+                {
+                    transition.inhibitorArcs.push_back(arc);
+                }
+                else
+                {
+                    transition.outputArcs.push_back(arc);
+                }
+            }
+            net.transitions.push_back(std::move(transition));
+        }
+        return net;
+    }
+
+    uint32_t getPlaceIndex(std::string const& placeId) const
+    {
+        const auto it = std::find(placeIds.begin(), placeIds.end(), placeId);
+        if (it == placeIds.end())
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "NetStructure::getPlaceIndex: place does not exist.")
+                .appendMetadata("place_id", placeId);
+        }
+        return std::distance(placeIds.begin(), it);
+    }
+
+    std::optional<uint32_t> getCapacity(uint32_t place) const
+    {
+        return place < capacities.size() ? capacities[place] : std::nullopt;
+    }
+
+    /// @return initial marking from the config `initial_marking` list; places not listed start empty
+    /// @throw Exception INVALID_VALUE if the config has no `initial_marking`; the controller does not load one, as its
+    /// tokens are added at runtime, so an empty marking would not describe the net
+    std::vector<uint32_t> getInitialMarking(nlohmann::json const& netConfig) const
+    {
+        if (!netConfig.contains("initial_marking"))
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "NetStructure::getInitialMarking: no `initial_marking`.");
+        }
+        return getMarking(netConfig.at("initial_marking"));
+    }
+
+    /// @param markingConfig [{"place_id": .., "number_tokens": ..}] list; places not listed are empty
+    std::vector<uint32_t> getMarking(nlohmann::json const& markingConfig) const
+    {
+        std::vector<uint32_t> marking(placeIds.size(), 0U);
+        for (auto&& entry : markingConfig)
+        {
+            marking.at(getPlaceIndex(entry.at("place_id").get<std::string>())) +=
+                entry.at("number_tokens").get<uint32_t>();
+        }
+        return marking;
+    }
+};
+
+} // namespace bnet
+} // namespace capybot
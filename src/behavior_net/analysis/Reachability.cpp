@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <behavior_net/analysis/Reachability.hpp>
+
+#include <3rd_party/taskflow/algorithm/for_each.hpp>
+#include <3rd_party/taskflow/taskflow.hpp>
+
+#include <algorithm>
+#include <map>
+
+namespace capybot
+{
+namespace bnet
+{
+
+MarkingStore::MarkingStore(uint32_t numberPlaces, uint64_t maxStates, uint32_t numberShards)
+    : m_numberPlaces(numberPlaces)
+    , m_recordSize(HEADER_SIZE + numberPlaces)
+    , m_maxStates(maxStates)
+    , m_shards(std::max(1U, numberShards))
+{
+}
+
+uint64_t MarkingStore::hash(uint32_t const* marking) const
+{
+    uint64_t h{0x9E3779B97F4A7C15ULL};
+    for (uint32_t i = 0U; i < m_numberPlaces; ++i)
+    {
+        h ^= marking[i] + 0x9E3779B97F4A7C15ULL + (h << 6U) + (h >> 2U);
+    }
+    return h;
+}
+
+uint32_t const* MarkingStore::record(StateId id) const
+{
+    auto const& shard = m_shards[id % m_shards.size()];
+    const auto [chunk, index] = locate(id / m_shards.size());
+    return shard.chunks[chunk].get() + index * m_recordSize;
+}
+
+std::pair<MarkingStore::StateId, bool> MarkingStore::insert(uint32_t const* marking, StateId parent,
+                                                            uint32_t transition)
+{
+    const auto h = hash(marking);
+    const auto shardIdx = h % m_shards.size();
+    auto& shard = m_shards[shardIdx];
+
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    const auto [begin, end] = shard.index.equal_range(h);
+    for (auto it = begin; it != end; ++it)
+    {
+        const StateId id = static_cast<StateId>(it->second) * m_shards.size() + shardIdx;
+        if (std::equal(marking, marking + m_numberPlaces, getMarking(id)))
+        {
+            return {id, false};
+        }
+    }
+
+    if (m_size.load() >= m_maxStates)
+    {
+        return {INVALID_STATE, false};
+    }
+    ++m_size;
+
+    const uint32_t local = shard.size++;
+    const auto [chunkIdx, index] = locate(local);
+    auto& chunk = shard.chunks[chunkIdx];
+    if (!chunk)
+    {
+        const size_t chunkSize = size_t{1U} << (chunkIdx + FIRST_CHUNK_SIZE_LOG2);
+        chunk = std::make_unique<uint32_t[]>(chunkSize * m_recordSize);
+    }
+    uint32_t* r = chunk.get() + index * m_recordSize;
+    r[0] = static_cast<uint32_t>(parent);
+    r[1] = static_cast<uint32_t>(parent >> 32U);
+    r[2] = transition;
+    std::copy(marking, marking + m_numberPlaces, r + HEADER_SIZE);
+
+    shard.index.emplace(h, local);
+    return {static_cast<StateId>(local) * m_shards.size() + shardIdx, true};
+}
+
+nlohmann::json ReachabilityAnalyzer::Result::toJson() const
+{
+    nlohmann::json json;
+    json["states_explored"] = statesExplored;
+    json["complete"] = complete;
+    json["number_deadlocks"] = numberDeadlocks;
+    json["deadlocks"] = nlohmann::json::array();
+    for (auto&& deadlock : deadlocks)
+    {
+        json["deadlocks"].push_back({{"marking", deadlock.marking}, {"firing_sequence", deadlock.firingSequence}});
+    }
+    json["unbounded_places"] = unboundedPlaces;
+    json["dead_transitions"] = deadTransitions;
+    return json;
+}
+
+ReachabilityAnalyzer::ReachabilityAnalyzer(NetStructure net, Options options)
+    : m_net(std::move(net))
+    , m_options(std::move(options))
+    , m_isTerminalPlace(m_net.placeIds.size(), false)
+{
+    for (uint32_t i = 0U; i < m_net.transitions.size(); ++i)
+    {
+        if (m_options.includeManualTransitions || !m_net.transitions[i].isManual)
+        {
+            m_transitions.push_back(i);
+        }
+    }
+    for (auto&& placeId : m_options.terminalPlaces)
+    {
+        m_isTerminalPlace[m_net.getPlaceIndex(placeId)] = true;
+    }
+
+    for (auto&& transition : m_net.transitions)
+    {
+        std::map<uint32_t, int64_t> effect;
+        for (auto&& arc : transition.inputArcs)
+            effect[arc.place] -= arc.weight;
+        for (auto&& arc : transition.outputArcs)
+            effect[arc.place] += arc.weight;
+
+        auto& demands = m_capacityDemands.emplace_back();
+        for (auto&& [place, tokens] : effect)
+        {
+            if (tokens > 0 && m_net.getCapacity(place).has_value())
+            {
+                demands.push_back({.place = place, .weight = static_cast<uint32_t>(tokens)});
+            }
+        }
+    }
+}
+
+bool ReachabilityAnalyzer::isEnabled(uint32_t transition, uint32_t const* marking) const
+{
+    auto const& inputArcs = m_net.transitions[transition].inputArcs;
+    auto const& inhibitorArcs = m_net.transitions[transition].inhibitorArcs;
+    auto const& demands = m_capacityDemands[transition];
+    return std::all_of(inputArcs.begin(), inputArcs.end(),
+                       [marking](auto const& arc) {
+                           return marking[arc.place] == MarkingStore::OMEGA || marking[arc.place] >= arc.weight;
+                       }) &&
+           std::all_of(inhibitorArcs.begin(), inhibitorArcs.end(),
+                       [marking](auto const& arc) { return marking[arc.place] < arc.weight; }) &&
+           std::all_of(demands.begin(), demands.end(), [this, marking](auto const& demand) {
+               return marking[demand.place] + demand.weight <= m_net.getCapacity(demand.place).value();
+           });
+}
+
+bool ReachabilityAnalyzer::isDeadlockCandidate(uint32_t const* marking) const
+{
+    // tokens stuck outside terminal places; the empty marking is a proper termination
+    for (uint32_t p = 0U; p < m_net.placeIds.size(); ++p)
+    {
+        if (marking[p] != 0U && !m_isTerminalPlace[p])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+ReachabilityAnalyzer::Result ReachabilityAnalyzer::analyze(std::vector<uint32_t> const& initialMarking) const
+{
+    SCOPED_LOG_TRACER("analyze");
+
+    const uint32_t numberPlaces = m_net.placeIds.size();
+    if (initialMarking.size() != numberPlaces)
+    {
+        throw Exception(ExceptionType::INVALID_VALUE, "ReachabilityAnalyzer::analyze: invalid initial marking size.")
+            .appendMetadata("expected", numberPlaces)
+            .appendMetadata("actual", initialMarking.size());
+    }
+
+    // a transition only needs the Karp-Miller check if it can increase the number of tokens of some place
+    std::vector<bool> canIncreaseMarking(m_net.transitions.size(), false);
+    for (uint32_t t = 0U; t < m_net.transitions.size(); ++t)
+    {
+        std::vector<int64_t> effect(numberPlaces, 0);
+        for (auto&& arc : m_net.transitions[t].inputArcs)
+            effect[arc.place] -= arc.weight;
+        for (auto&& arc : m_net.transitions[t].outputArcs)
+            effect[arc.place] += arc.weight;
+        canIncreaseMarking[t] = std::any_of(effect.begin(), effect.end(), [](int64_t e) { return e > 0; });
+    }
+
+    MarkingStore store(numberPlaces, m_options.maxStates, m_options.numberThreads);
+    std::vector<std::atomic_bool> wasEnabled(m_net.transitions.size());
+    std::vector<std::atomic_bool> isUnbounded(numberPlaces);
+    std::atomic_bool storeFull{false};
+    std::atomic_uint64_t numberDeadlocks{0U};
+    std::mutex deadlocksMtx;
+    std::vector<MarkingStore::StateId> deadlockStates;
+
+    tf::Executor executor(std::max(1U, m_options.numberThreads));
+    std::vector<std::vector<MarkingStore::StateId>> nextFrontiers(executor.num_workers());
+
+    const auto expand = [&](MarkingStore::StateId id) {
+        thread_local std::vector<uint32_t> successor;
+        successor.resize(numberPlaces);
+
+        uint32_t const* marking = store.getMarking(id);
+        bool anyEnabled{false};
+        for (auto&& t : m_transitions)
+        {
+            auto const& transition = m_net.transitions[t];
+            if (!isEnabled(t, marking))
+            {
+                continue;
+            }
+            anyEnabled = true;
+            wasEnabled[t].store(true, std::memory_order_relaxed);
+
+            std::copy(marking, marking + numberPlaces, successor.begin());
+            for (auto&& arc : transition.inputArcs)
+            {
+                if (successor[arc.place] != MarkingStore::OMEGA)
+                    successor[arc.place] -= arc.weight;
+            }
+            for (auto&& arc : transition.outputArcs)
+            {
+                if (successor[arc.place] != MarkingStore::OMEGA)
+                    successor[arc.place] = std::min<uint64_t>(static_cast<uint64_t>(successor[arc.place]) + arc.weight,
+                                                              MarkingStore::OMEGA - 1U);
+            }
+
+            // Karp-Miller acceleration: places growing w.r.t. a covered ancestor are unbounded
+            if (canIncreaseMarking[t])
+            {
+                for (auto ancestor = id; ancestor != MarkingStore::INVALID_STATE; ancestor = store.getParent(ancestor))
+                {
+                    uint32_t const* a = store.getMarking(ancestor);
+                    const auto covers = [](uint32_t s, uint32_t m) { return s >= m; };
+                    if (std::equal(successor.begin(), successor.end(), a, covers))
+                    {
+                        for (uint32_t p = 0U; p < numberPlaces; ++p)
+                        {
+                            if (successor[p] > a[p] && successor[p] != MarkingStore::OMEGA &&
+                                !m_net.getCapacity(p).has_value())
+                            {
+                                successor[p] = MarkingStore::OMEGA;
+                                isUnbounded[p].store(true, std::memory_order_relaxed);
+                            }
+                        }
+                    }
+                }
+            }
+
+            const auto [successorId, inserted] = store.insert(successor.data(), id, t);
+            if (successorId == MarkingStore::INVALID_STATE)
+            {
+                storeFull.store(true);
+            }
+            else if (inserted)
+            {
+                nextFrontiers[executor.this_worker_id()].push_back(successorId);
+            }
+        }
+
+        if (!anyEnabled && isDeadlockCandidate(marking))
+        {
+            ++numberDeadlocks;
+            std::lock_guard<std::mutex> lk(deadlocksMtx);
+            if (deadlockStates.size() < m_options.maxReportedDeadlocks)
+            {
+                deadlockStates.push_back(id);
+            }
+        }
+    };
+
+    std::vector<MarkingStore::StateId> frontier{
+        store.insert(initialMarking.data(), MarkingStore::INVALID_STATE, 0U).first};
+    uint32_t depth{0U};
+    while (!frontier.empty())
+    {
+        LOG(DEBUG) << "analyze: depth " << depth++ << "; frontier size = " << frontier.size()
+                   << "; states = " << store.size() << log::endl;
+
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(size_t{0U}, frontier.size(), size_t{1U}, [&](size_t i) { expand(frontier[i]); });
+        executor.run(taskflow).wait();
+
+        frontier.clear();
+        for (auto&& next : nextFrontiers)
+        {
+            frontier.insert(frontier.end(), next.begin(), next.end());
+            next.clear();
+        }
+    }
+
+    Result result;
+    result.statesExplored = store.size();
+    result.complete = !storeFull.load();
+    result.numberDeadlocks = numberDeadlocks.load();
+    for (auto&& id : deadlockStates)
+    {
+        Deadlock deadlock;
+        uint32_t const* marking = store.getMarking(id);
+        for (uint32_t p = 0U; p < numberPlaces; ++p)
+        {
+            if (marking[p] == MarkingStore::OMEGA)
+                deadlock.marking[m_net.placeIds[p]] = "omega";
+            else if (marking[p] != 0U)
+                deadlock.marking[m_net.placeIds[p]] = marking[p];
+        }
+        for (auto s = id; store.getParent(s) != MarkingStore::INVALID_STATE; s = store.getParent(s))
+        {
+            deadlock.firingSequence.push_back(m_net.transitions[store.getTransition(s)].id);
+        }
+        std::reverse(deadlock.firingSequence.begin(), deadlock.firingSequence.end());
+        result.deadlocks.push_back(std::move(deadlock));
+    }
+    std::stable_sort(result.deadlocks.begin(), result.deadlocks.end(), [](auto const& a, auto const& b) {
+        return a.firingSequence.size() < b.firingSequence.size();
+    });
+    for (uint32_t p = 0U; p < numberPlaces; ++p)
+    {
+        if (isUnbounded[p].load())
+            result.unboundedPlaces.push_back(m_net.placeIds[p]);
+    }
+    for (auto&& t : m_transitions)
+    {
+        if (!wasEnabled[t].load())
+            result.deadTransitions.push_back(m_net.transitions[t].id);
+    }
+    return result;
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <behavior_net/analysis/NetStructure.hpp>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Concurrent hashed store of explored markings
+ *
+ * Markings are kept in flat, chunked arenas (one per shard) next to the id of the state they were reached from and the
+ * transition fired to reach them. Chunks are never moved, so published markings can be read without locking. Each
+ * chunk of a shard holds twice the records of the previous one, so memory follows the number of stored markings.
+ */
+class MarkingStore
+{
+    static constexpr const char* MODULE_TAG{"MarkingStore"};
+
+public:
+    using StateId = uint64_t;
+
+    static constexpr uint32_t OMEGA{std::numeric_limits<uint32_t>::max()}; // unbounded number of tokens
+    static constexpr StateId INVALID_STATE{std::numeric_limits<StateId>::max()};
+
+    /// @param numberShards e.g., the number of threads inserting markings
+    MarkingStore(uint32_t numberPlaces, uint64_t maxStates, uint32_t numberShards);
+
+    /// @return id of the marking and whether it was inserted; `INVALID_STATE` if the store is full
+    std::pair<StateId, bool> insert(uint32_t const* marking, StateId parent, uint32_t transition);
+
+    uint32_t const* getMarking(StateId id) const { return record(id) + HEADER_SIZE; }
+    StateId getParent(StateId id) const
+    {
+        auto r = record(id);
+        return (static_cast<StateId>(r[1]) << 32U) | r[0];
+    }
+    uint32_t getTransition(StateId id) const { return record(id)[2]; }
+
+    uint64_t size() const { return m_size.load(); }
+    uint32_t getNumberPlaces() const { return m_numberPlaces; }
+
+private:
+    static constexpr uint32_t HEADER_SIZE{3U}; // parent (2 words), transition
+    static constexpr uint32_t FIRST_CHUNK_SIZE_LOG2{6U}; // records of the first chunk of a shard
+    static constexpr uint32_t MAX_NUMBER_CHUNKS{33U};     // enough for 2^32 records per shard
+
+    struct Shard
+    {
+        std::mutex mtx;
+        std::unordered_multimap<uint64_t, uint32_t> index{}; // hash -> local state index
+        std::array<std::unique_ptr<uint32_t[]>, MAX_NUMBER_CHUNKS> chunks{};
+        uint32_t size{0U};
+    };
+
+    /// @return chunk of a local state index, and its index in the chunk
+    static std::pair<uint32_t, uint64_t> locate(uint64_t local)
+    {
+        const uint64_t biased = local + (1U << FIRST_CHUNK_SIZE_LOG2);
+        const uint32_t chunk = std::bit_width(biased) - 1U - FIRST_CHUNK_SIZE_LOG2;
+        return {chunk, biased - (uint64_t{1U} << (chunk + FIRST_CHUNK_SIZE_LOG2))};
+    }
+
+    uint64_t hash(uint32_t const* marking) const;
+    uint32_t const* record(StateId id) const;
+
+    const uint32_t m_numberPlaces;
+    const uint32_t m_recordSize;
+    const uint64_t m_maxStates;
+    std::vector<Shard> m_shards;
+    std::atomic_uint64_t m_size{0U};
+};
+
+/**
+ * @brief Explores the reachability (coverability) graph of a net looking for deadlocks, unbounded places and dead
+ * transitions
+ *
+ * Exploration is a level-synchronous BFS whose frontier is expanded in parallel on a work-stealing executor. Places
+ * are detected as unbounded with the Karp-Miller acceleration: when a marking strictly covers one of its ancestors,
+ * the growing places are set to `MarkingStore::OMEGA`, which keeps the graph finite. Places with a `capacity` are never
+ * accelerated, and transitions are disabled while their output places are full, as in the controller. With inhibitor
+ * arcs, coverability is no longer monotonic: an omega place keeps its inhibited transitions disabled, so results are an
+ * approximation for such nets.
+ */
+class ReachabilityAnalyzer
+{
+    static constexpr const char* MODULE_TAG{"ReachabilityAnalyzer"};
+
+public:
+    struct Options
+    {
+        uint64_t maxStates{1'000'000U};
+        uint32_t numberThreads{std::thread::hardware_concurrency()};
+        bool includeManualTransitions{true};
+        std::vector<std::string> terminalPlaces{}; // markings with tokens only in these places are not deadlocks
+        uint32_t maxReportedDeadlocks{5U};
+    };
+
+    struct Deadlock
+    {
+        nlohmann::json marking;                // non-empty places only
+        std::vector<std::string> firingSequence; // from the initial marking
+    };
+
+    struct Result
+    {
+        uint64_t statesExplored{0U};
+        bool complete{true}; // false if `maxStates` was reached
+        uint64_t numberDeadlocks{0U};
+        std::vector<Deadlock> deadlocks; // up to `maxReportedDeadlocks`, shortest firing sequences first
+        std::vector<std::string> unboundedPlaces;
+        std::vector<std::string> deadTransitions; // never enabled
+
+        nlohmann::json toJson() const;
+    };
+
+    ReachabilityAnalyzer(NetStructure net, Options options);
+
+    Result analyze(std::vector<uint32_t> const& initialMarking) const;
+
+private:
+    bool isEnabled(uint32_t transition, uint32_t const* marking) const;
+    bool isDeadlockCandidate(uint32_t const* marking) const;
+
+    NetStructure m_net;
+    Options m_options;
+    std::vector<uint32_t> m_transitions; // indexes of the analyzed transitions
+    std::vector<std::vector<NetStructure::Arc>> m_capacityDemands; // per transition: net tokens added to bounded places
+    std::vector<bool> m_isTerminalPlace;
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -44,17 +44,35 @@ bool validateHttpServerConfig(nlohmann::json const& netConfig, std::vector<std::
 
 REGISTER_NET_CONFIG_VALIDATOR(&validateHttpServerConfig, "HttpServerConfigValidator");
 
-HttpServer::HttpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs)
-    : m_controllerCbs(controllerCbs)
+HttpServer::HttpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs,
+                       std::optional<CpuPlacement> placement)
+    : m_netCbs{{"", controllerCbs}}
     , m_addr(config.at("address").get<std::string>())
     , m_port(config.at("port").get<int>())
+    , m_placement(std::move(placement))
 {
     LOG(INFO) << "Running @ http://" << m_addr << ":" << m_port << log::endl;
 }
 
+HttpServer::HttpServer(nlohmann::json const& config, std::map<std::string, ControllerCallbacks> const& netCbs,
+                       std::optional<CpuPlacement> placement)
+    : m_netCbs(netCbs)
+    , m_routedByNetId(true)
+    , m_addr(config.at("address").get<std::string>())
+    , m_port(config.at("port").get<int>())
+    , m_placement(std::move(placement))
+{
+    LOG(INFO) << "Running @ http://" << m_addr << ":" << m_port << "; hosting " << m_netCbs.size() << " nets"
+              << log::endl;
+}
+
 void HttpServer::runServer()
 {
     LOG(DEBUG) << "runServer: starting HTTP server..." << log::endl;
+    if (m_placement)
+    {
+        m_placement->applyToCurrentThread("HTTP server"); // inherited by the request handling threads
+    }
     httplib::Server server;
     m_server = &server;
 
@@ -82,14 +100,20 @@ void HttpServer::runServer()
         LOG(ERROR) << "Exception caught while handling request: " << buf << log::endl;
     });
 
-    server.set_error_handler([](const auto& req, auto& res) {
+    server.set_error_handler(httplib::Server::HandlerWithResponse([](const auto& req, auto& res) {
+        if (!res.body.empty()) // content already set by the route handler
+        {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+
         auto fmt = "<p>Error Status: <span style='color:red;'>%d</span></p>";
         char buf[BUFSIZ];
         snprintf(buf, sizeof(buf), fmt, res.status);
         res.set_content(buf, "text/html");
 
         LOG(ERROR) << "Error caught while handling request: " << buf << log::endl;
-    });
+        return httplib::Server::HandlerResponse::Handled;
+    }));
 
     server.listen(m_addr, m_port);
     LOG(DEBUG) << "runServer: exiting..." << log::endl;
@@ -100,23 +124,78 @@ void HttpServer::setCallbacks(httplib::Server& server)
     server.Get("/", [](const httplib::Request& req, httplib::Response& res) {
         res.set_content("You have reached bnet::capybot::HttpServer.", "text/plain");
     });
-    server.Post("/add_token", [this](const httplib::Request& req, httplib::Response& res) {
-        nlohmann::json payload = nlohmann::json::parse(req.body);
-        m_controllerCbs.addToken(payload.at("content_blocks"), payload.at("place_id").get<std::string>());
-    });
-    server.Get("/get_config", [this](const httplib::Request& req, httplib::Response& res) {
-        nlohmann::json marking = m_controllerCbs.getNetMarking();
-        res.set_content(marking.at("config").dump(), "application/json");
-    });
-    server.Get("/get_marking", [this](const httplib::Request& req, httplib::Response& res) {
-        nlohmann::json marking = m_controllerCbs.getNetMarking();
-        res.set_content(marking.at("marking").dump(), "application/json");
+
+    if (!m_routedByNetId)
+    {
+        auto const* cbs = &m_netCbs.begin()->second;
+        setNetCallbacks(server, "", [cbs](const httplib::Request&) { return cbs; });
+        return;
+    }
+
+    server.Get("/nets", [this](const httplib::Request& req, httplib::Response& res) {
+        nlohmann::json netIds = nlohmann::json::array();
+        for (auto&& [id, _] : m_netCbs)
+        {
+            netIds.push_back(id);
+        }
+        res.set_content(netIds.dump(), "application/json");
     });
-    server.Post("/trigger_manual_transition/(.*)", [this](const httplib::Request& req, httplib::Response& res) {
-        auto id = req.matches[1];
-        m_controllerCbs.triggerManualTransition(id.str());
+    setNetCallbacks(server, "/nets/([^/]+)", [this](const httplib::Request& req) -> ControllerCallbacks const* {
+        const auto it = m_netCbs.find(req.matches[1].str());
+        return it == m_netCbs.end() ? nullptr : &it->second;
     });
 }
 
+void HttpServer::setNetCallbacks(httplib::Server& server, std::string const& prefixPattern,
+                                 std::function<ControllerCallbacks const*(httplib::Request const&)> getNetCbs)
+{
+    // wraps a route handler, answering 404 to requests to unknown nets
+    const auto withNet = [getNetCbs](auto handler) {
+        return [getNetCbs, handler](const httplib::Request& req, httplib::Response& res) {
+            auto const* cbs = getNetCbs(req);
+            if (cbs == nullptr)
+            {
+                res.status = 404;
+                res.set_content("Net not found.", "text/plain");
+                return;
+            }
+            handler(*cbs, req, res);
+        };
+    };
+
+    server.Post(prefixPattern + "/add_token",
+                withNet([](ControllerCallbacks const& cbs, const httplib::Request& req, httplib::Response& res) {
+                    nlohmann::json payload = nlohmann::json::parse(req.body);
+                    try
+                    {
+                        cbs.addToken(payload.at("content_blocks"), payload.at("place_id").get<std::string>());
+                    }
+                    catch (Exception const& e)
+                    {
+                        if (e.type() != +ExceptionType::CAPACITY_EXCEEDED)
+                        {
+                            throw;
+                        }
+                        res.status = 429; // Too Many Requests: backpressure from a full place
+                        res.set_content(e.what(), "text/plain");
+                    }
+                }));
+    server.Get(prefixPattern + "/get_config",
+               withNet([](ControllerCallbacks const& cbs, const httplib::Request& req, httplib::Response& res) {
+                   nlohmann::json marking = cbs.getNetMarking();
+                   res.set_content(marking.at("config").dump(), "application/json");
+               }));
+    server.Get(prefixPattern + "/get_marking",
+               withNet([](ControllerCallbacks const& cbs, const httplib::Request& req, httplib::Response& res) {
+                   nlohmann::json marking = cbs.getNetMarking();
+                   res.set_content(marking.at("marking").dump(), "application/json");
+               }));
+    server.Post(prefixPattern + "/trigger_manual_transition/(.*)",
+                withNet([](ControllerCallbacks const& cbs, const httplib::Request& req, httplib::Response& res) {
+                    auto id = req.matches[req.matches.size() - 1];
+                    cbs.triggerManualTransition(id.str());
+                }));
+}
+
 } // namespace bnet
 } // namespace capybot
@@ -18,6 +18,9 @@
 #pragma once
 
 #include <behavior_net/Controller.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+#include <functional>
+#include <map>
 #include <memory>
 
 namespace capybot
@@ -30,7 +33,14 @@ class HttpServer : public IServer
     static constexpr const char* MODULE_TAG{"HttpServer"};
 
 public:
-    HttpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs);
+    /// @param placement [optional] cores the server threads are pinned to
+    HttpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs,
+               std::optional<CpuPlacement> placement = std::nullopt);
+
+    /// @brief server hosting several nets; requests to a net are prefixed by `/nets/<net_id>`, and `/nets` lists the
+    /// hosted net ids
+    HttpServer(nlohmann::json const& config, std::map<std::string, ControllerCallbacks> const& netCbs,
+               std::optional<CpuPlacement> placement = std::nullopt);
 
     ~HttpServer() { stop(); }
 
@@ -53,11 +63,18 @@ private:
 
     void setCallbacks(httplib::Server& server);
 
+    /// @brief set the net routes under `prefixPattern`; `getNetCbs` resolves the net a request refers to, returning
+    /// null if it does not exist
+    void setNetCallbacks(httplib::Server& server, std::string const& prefixPattern,
+                         std::function<ControllerCallbacks const*(httplib::Request const&)> getNetCbs);
+
     httplib::Server* m_server{nullptr};
-    ControllerCallbacks m_controllerCbs;
+    std::map<std::string, ControllerCallbacks> m_netCbs;
+    bool m_routedByNetId{false}; // if false, `m_netCbs` holds a single net, served at the root
 
     std::string m_addr;
     int m_port;
+    const std::optional<CpuPlacement> m_placement;
 
     std::thread m_executionThread;
 };
@@ -17,6 +17,7 @@
 
 #include <behavior_net/Common.hpp>
 #include <behavior_net/Controller.hpp>
+#include <behavior_net/CpuAffinity.hpp>
 #include <behavior_net/Types.hpp>
 #include <behavior_net/server_impl/HttpServer.hpp>
 
@@ -25,17 +26,38 @@ namespace capybot
 namespace bnet
 {
 
+namespace
+{
+std::optional<CpuPlacement> getServerPlacement(nlohmann::json const& config)
+{
+    return CpuPlacement::fromConfig(config.value("cpu_affinity", nlohmann::json::object()), "http_server");
+}
+} // namespace
+
 std::unique_ptr<IServer> IServer::create(nlohmann::json const& controllerConfig,
                                          ControllerCallbacks const& controllerCbs)
 {
     if (controllerConfig.contains("http_server"))
     {
-        return std::make_unique<HttpServer>(controllerConfig.at("http_server"), controllerCbs);
+        return std::make_unique<HttpServer>(controllerConfig.at("http_server"), controllerCbs,
+                                            getServerPlacement(controllerConfig));
     }
 
     LOG_TAGGED(INFO, "IServer::create") << "No server in config file - running serverless." << log::endl;
     return nullptr;
 }
 
+std::unique_ptr<IServer> IServer::create(nlohmann::json const& hostConfig,
+                                         std::map<std::string, ControllerCallbacks> const& netCbs)
+{
+    if (hostConfig.contains("http_server"))
+    {
+        return std::make_unique<HttpServer>(hostConfig.at("http_server"), netCbs, getServerPlacement(hostConfig));
+    }
+
+    LOG_TAGGED(INFO, "IServer::create") << "No server in host config file - running serverless." << log::endl;
+    return nullptr;
+}
+
 } // namespace bnet
 } // namespace capybot
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace capybot
+{
+
+/**
+ * @brief Double-ended FIFO over a single contiguous allocation
+ *
+ * Storage is allocated on `reserve` or on the first insertion, and only grows (doubling) when an insertion finds the
+ * buffer full, so a buffer reserved to its maximum size never reallocates. Iterators are random access and are
+ * invalidated by any insertion or removal.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    template <bool IS_CONST>
+    class Iterator
+    {
+        using BufferT = std::conditional_t<IS_CONST, RingBuffer const, RingBuffer>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IS_CONST, T const*, T*>;
+        using reference = std::conditional_t<IS_CONST, T const&, T&>;
+
+        Iterator() = default;
+        Iterator(BufferT* buffer, size_t index)
+            : m_buffer(buffer)
+            , m_index(index)
+        {
+        }
+        operator Iterator<true>() const { return Iterator<true>(m_buffer, m_index); }
+
+        reference operator*() const { return (*m_buffer)[m_index]; }
+        pointer operator->() const { return &(*m_buffer)[m_index]; }
+        reference operator[](difference_type n) const { return (*m_buffer)[m_index + n]; }
+
+        Iterator& operator++() { return ++m_index, *this; }
+        Iterator& operator--() { return --m_index, *this; }
+        Iterator operator++(int) { return Iterator(m_buffer, m_index++); }
+        Iterator operator--(int) { return Iterator(m_buffer, m_index--); }
+        Iterator& operator+=(difference_type n) { return m_index += n, *this; }
+        Iterator& operator-=(difference_type n) { return m_index -= n, *this; }
+        Iterator operator+(difference_type n) const { return Iterator(m_buffer, m_index + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_buffer, m_index - n); }
+        friend Iterator operator+(difference_type n, Iterator const& it) { return it + n; }
+        difference_type operator-(Iterator const& other) const
+        {
+            return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+        }
+
+        bool operator==(Iterator const& other) const { return m_index == other.m_index; }
+        auto operator<=>(Iterator const& other) const { return m_index <=> other.m_index; }
+
+        size_t index() const { return m_index; }
+
+    private:
+        BufferT* m_buffer{nullptr};
+        size_t m_index{0U};
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    RingBuffer() = default;
+    explicit RingBuffer(size_t capacity) { reserve(capacity); }
+    ~RingBuffer()
+    {
+        clear();
+        m_allocator.deallocate(m_data, m_capacity);
+    }
+
+    RingBuffer(RingBuffer const&) = delete;
+    RingBuffer& operator=(RingBuffer const&) = delete;
+    RingBuffer(RingBuffer&& other) noexcept { swap(other); }
+    RingBuffer& operator=(RingBuffer&& other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0U; }
+    size_t capacity() const { return m_capacity; }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_capacity)
+        {
+            reallocate(capacity);
+        }
+    }
+
+    T& operator[](size_t i) { return m_data[physicalIndex(i)]; }
+    T const& operator[](size_t i) const { return m_data[physicalIndex(i)]; }
+    T& front() { return (*this)[0U]; }
+    T const& front() const { return (*this)[0U]; }
+    T& back() { return (*this)[m_size - 1U]; }
+    T const& back() const { return (*this)[m_size - 1U]; }
+
+    iterator begin() { return iterator(this, 0U); }
+    iterator end() { return iterator(this, m_size); }
+    const_iterator begin() const { return const_iterator(this, 0U); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_size == m_capacity)
+        {
+            reallocate(m_capacity == 0U ? MIN_CAPACITY : 2U * m_capacity);
+        }
+        T* slot = m_data + physicalIndex(m_size);
+        std::construct_at(slot, std::forward<Args>(args)...);
+        ++m_size;
+        return *slot;
+    }
+
+    void push_back(T value) { emplace_back(std::move(value)); }
+
+    void pop_front()
+    {
+        std::destroy_at(m_data + m_head);
+        m_head = m_head + 1U == m_capacity ? 0U : m_head + 1U;
+        --m_size;
+    }
+
+    void pop_back()
+    {
+        std::destroy_at(m_data + physicalIndex(m_size - 1U));
+        --m_size;
+    }
+
+    /// @brief O(min(i, size - i)); shifts the elements on the shorter side of the erased one
+    /// @return iterator to the element following the erased one
+    iterator erase(const_iterator pos)
+    {
+        const auto i = pos.index();
+        if (i < m_size / 2U)
+        {
+            for (size_t j = i; j > 0U; --j)
+            {
+                (*this)[j] = std::move((*this)[j - 1U]);
+            }
+            pop_front();
+        }
+        else
+        {
+            for (size_t j = i; j + 1U < m_size; ++j)
+            {
+                (*this)[j] = std::move((*this)[j + 1U]);
+            }
+            pop_back();
+        }
+        return iterator(this, i);
+    }
+
+    /**
+     * @brief move out, in a single pass, up to `maxCount` elements matching `pred`; the order of the remaining elements
+     * is kept
+     *
+     * @param consumer called with each extracted element, as an rvalue, in order
+     * @return number of elements extracted
+     */
+    template <typename PredT, typename ConsumerT>
+    size_t extract_if(PredT pred, size_t maxCount, ConsumerT consumer)
+    {
+        size_t extracted{0U};
+        size_t write{0U};
+        for (size_t read = 0U; read < m_size; ++read)
+        {
+            auto& element = (*this)[read];
+            if (extracted < maxCount && pred(std::as_const(element)))
+            {
+                consumer(std::move(element));
+                ++extracted;
+            }
+            else
+            {
+                if (write != read)
+                {
+                    (*this)[write] = std::move(element);
+                }
+                ++write;
+            }
+        }
+        while (m_size > write)
+        {
+            pop_back();
+        }
+        return extracted;
+    }
+
+    void clear()
+    {
+        while (!empty())
+        {
+            pop_back();
+        }
+        m_head = 0U;
+    }
+
+    void swap(RingBuffer& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_head, other.m_head);
+        std::swap(m_size, other.m_size);
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY{8U};
+
+    size_t physicalIndex(size_t i) const
+    {
+        const auto index = m_head + i;
+        return index >= m_capacity ? index - m_capacity : index;
+    }
+
+    void reallocate(size_t capacity)
+    {
+        T* data = m_allocator.allocate(capacity);
+        for (size_t i = 0U; i < m_size; ++i)
+        {
+            std::construct_at(data + i, std::move((*this)[i]));
+            std::destroy_at(&(*this)[i]);
+        }
+        m_allocator.deallocate(m_data, m_capacity);
+        m_data = data;
+        m_capacity = capacity;
+        m_head = 0U;
+    }
+
+    [[no_unique_address]] std::allocator<T> m_allocator{};
+    T* m_data{nullptr};
+    size_t m_capacity{0U};
+    size_t m_head{0U};
+    size_t m_size{0U};
+};
+
+} // namespace capybot
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/ActionAdmission.hpp>
+#include <behavior_net/ActionRegistry.hpp>
+#include <behavior_net/Config.hpp>
+#include <behavior_net/Place.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <thread>
+
+using namespace capybot::bnet;
+
+namespace
+{
+/// @brief action blocking until `release` is set
+class GatedAction : public IActionImpl
+{
+public:
+    inline static std::atomic<uint32_t> numberStarted{0U};
+    inline static std::shared_future<void> released{};
+
+    GatedAction(nlohmann::json const) {}
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr) override
+    {
+        return [] {
+            ++numberStarted;
+            released.wait();
+            return ActionExecutionStatus(ActionExecutionStatus::SUCCESS);
+        };
+    }
+};
+REGISTER_ACTION_TYPE(GatedAction);
+
+void runEpoch(Place& place)
+{
+    place.executeActionAsync();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    place.checkActionResults();
+}
+} // namespace
+
+TEST_CASE("Global action concurrency is shared fairly between places.", "[PetriNet/ActionAdmission]")
+{
+    REQUIRE(shareFairly({}, 10U, 0U).empty());
+    REQUIRE(shareFairly({3U, 50000U, 4U}, 100U, 0U) == std::vector<uint32_t>{3U, 93U, 4U});
+    REQUIRE(shareFairly({50000U, 50000U}, 100U, 0U) == std::vector<uint32_t>{50U, 50U});
+    REQUIRE(shareFairly({1U, 2U}, 100U, 0U) == std::vector<uint32_t>{1U, 2U}); // budget left over
+
+    // places with equal demands take turns for the slots left by the integer division
+    REQUIRE(shareFairly({10U, 10U, 10U}, 2U, 0U) == std::vector<uint32_t>{0U, 1U, 1U});
+    REQUIRE(shareFairly({10U, 10U, 10U}, 2U, 1U) == std::vector<uint32_t>{1U, 0U, 1U});
+    REQUIRE(shareFairly({10U, 10U, 10U}, 2U, 2U) == std::vector<uint32_t>{1U, 1U, 0U});
+    REQUIRE(shareFairly({10U, 10U, 10U}, 0U, 2U) == std::vector<uint32_t>{0U, 0U, 0U});
+}
+
+TEST_CASE("Busy tokens over the action concurrency limit wait in the place.", "[PetriNet/ActionAdmission]")
+{
+    std::promise<void> release;
+    GatedAction::released = release.get_future().share();
+
+    ThreadPool tp(4);
+    Place place(nlohmann::json{{"place_id", "A"}});
+    place.setAssociatedAction(tp, "GatedAction", nlohmann::json::object(), std::nullopt,
+                              Action::Options{.maxConcurrency = 2U});
+    constexpr uint32_t NUMBER_TOKENS = 5U;
+    for (uint32_t i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        place.insertToken(Token::makeShared());
+    }
+    REQUIRE(place.getNumberAdmissibleTokens() == 2U);
+
+    runEpoch(place);
+    REQUIRE(GatedAction::numberStarted.load() == 2U);
+    REQUIRE(place.getAction()->getNumberInFlight() == 2U);
+    REQUIRE(place.getNumberAdmissibleTokens() == 0U);
+    runEpoch(place);
+    REQUIRE(GatedAction::numberStarted.load() == 2U); // nothing dispatched over the limit
+
+    release.set_value();
+    runEpoch(place); // collects the first two
+    REQUIRE(place.getNumberTokensAvailable() == 2U);
+    REQUIRE(place.getNumberAdmissibleTokens() == 2U);
+    runEpoch(place);
+    runEpoch(place);
+    REQUIRE(GatedAction::numberStarted.load() == NUMBER_TOKENS);
+    REQUIRE(place.getNumberTokensAvailable() == NUMBER_TOKENS);
+}
+
+TEST_CASE("Invalid action admission configs are rejected.", "[PetriNet/ActionAdmission]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+    configJson["controller"]["max_concurrent_actions"] = 64;
+    configJson["controller"]["actions"][0]["max_concurrency"] = 8;
+    std::ignore = NetConfig::fromJson(configJson);
+    REQUIRE(getMaxConcurrentActions(configJson.at("controller")) == 64U);
+
+    auto invalid = configJson;
+    invalid["controller"]["max_concurrent_actions"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["actions"][0]["max_concurrency"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+}
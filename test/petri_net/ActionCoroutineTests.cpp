@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/ActionCoroutine.hpp>
+#include <behavior_net/action_impl/TimerAction.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace capybot::bnet;
+using namespace std::chrono_literals;
+
+namespace
+{
+class StepsAction : public CoroutineActionImpl
+{
+public:
+    ~StepsAction() override { waitForCoroutines(); }
+
+    std::atomic<uint32_t> numberRuns{0U};
+    std::atomic<uint32_t> numberSteps{0U};
+
+protected:
+    ActionCoroutine run(Token::ConstSharedPtr token) override
+    {
+        ++numberRuns;
+        ++numberSteps;
+        co_await sleepFor(20ms);
+        ++numberSteps;
+        const auto value = co_await runBlocking<int>([] { return 2; });
+        if (value != 2)
+        {
+            co_return ActionExecutionStatus::FAILURE;
+        }
+        co_return co_await awaitAction(m_timer, token);
+    }
+
+private:
+    TimerAction m_timer{nlohmann::json{{"duration_ms", 5}}};
+};
+
+class ThrowingAction : public CoroutineActionImpl
+{
+protected:
+    ActionCoroutine run(Token::ConstSharedPtr) override
+    {
+        co_await sleepFor(1ms);
+        throw std::runtime_error("failed after resuming");
+        co_return ActionExecutionStatus::SUCCESS;
+    }
+};
+
+class ThreadIdAction : public CoroutineActionImpl
+{
+public:
+    ~ThreadIdAction() override { waitForCoroutines(); }
+
+    std::thread::id blockingCallThread{};
+
+protected:
+    ActionCoroutine run(Token::ConstSharedPtr) override
+    {
+        blockingCallThread = co_await runBlocking<std::thread::id>([] { return std::this_thread::get_id(); });
+        co_return ActionExecutionStatus::SUCCESS;
+    }
+};
+
+ActionExecutionStatus pollUntilDone(std::function<ActionExecutionStatus()> const& callable)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    auto status = callable();
+    while (status == +ActionExecutionStatus::IN_PROGRESS && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+        status = callable();
+    }
+    return status;
+}
+} // namespace
+
+TEST_CASE("Coroutine actions run until done without holding a worker.", "[PetriNet/ActionCoroutine]")
+{
+    StepsAction action;
+    auto token = Token::makeShared();
+    auto callable = action.createCallable(token);
+
+    // the first callable starts the coroutine, which suspends on the sleep
+    REQUIRE(callable() == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(action.numberSteps.load() == 1U);
+    REQUIRE(callable() == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(action.numberSteps.load() == 1U); // not started again
+
+    REQUIRE(pollUntilDone(callable) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(action.numberSteps.load() == 2U);
+
+    // the next callable of the token starts a new run
+    REQUIRE(callable() == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(action.numberSteps.load() == 3U);
+}
+
+TEST_CASE("Suspended coroutine actions share the timer thread.", "[PetriNet/ActionCoroutine]")
+{
+    StepsAction action;
+    constexpr size_t NUMBER_TOKENS{200U};
+    std::vector<std::function<ActionExecutionStatus()>> callables;
+    for (size_t i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        callables.push_back(action.createCallable(Token::makeShared()));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto&& callable : callables)
+    {
+        REQUIRE(callable() == +ActionExecutionStatus::IN_PROGRESS);
+    }
+    for (auto&& callable : callables)
+    {
+        REQUIRE(pollUntilDone(callable) == +ActionExecutionStatus::SUCCESS);
+    }
+    REQUIRE(std::chrono::steady_clock::now() - start < NUMBER_TOKENS * 20ms / 4U); // the sleeps overlap
+}
+
+TEST_CASE("Exceptions in coroutine actions result in errors.", "[PetriNet/ActionCoroutine]")
+{
+    ThrowingAction action;
+    auto callable = action.createCallable(Token::makeShared());
+    REQUIRE(pollUntilDone(callable) == +ActionExecutionStatus::ERROR);
+}
+
+TEST_CASE("Coroutine blocking calls run in the blocking IO lane of the action thread pool.",
+          "[PetriNet/ActionCoroutine]")
+{
+    SECTION("Standalone actions run them on the calling thread.")
+    {
+        ThreadIdAction action;
+        REQUIRE(pollUntilDone(action.createCallable(Token::makeShared())) == +ActionExecutionStatus::SUCCESS);
+        REQUIRE(action.blockingCallThread == std::this_thread::get_id());
+    }
+
+    SECTION("Actions with a thread pool run them in its blocking IO lane.")
+    {
+        ThreadPool tp(1);
+        ThreadIdAction action;
+        action.setThreadPool(tp);
+        REQUIRE(pollUntilDone(action.createCallable(Token::makeShared())) == +ActionExecutionStatus::SUCCESS);
+        REQUIRE(action.blockingCallThread != std::thread::id{});
+        REQUIRE(action.blockingCallThread != std::this_thread::get_id());
+    }
+}
+
+TEST_CASE("Cancelled coroutine action executions drop their coroutine.", "[PetriNet/ActionCoroutine]")
+{
+    StepsAction action;
+    auto token = Token::makeShared();
+
+    // cancelled before the first call, e.g., while queued
+    const auto cancelled = CancellationToken::create();
+    cancelled.cancel();
+    REQUIRE(action.createCancellableCallable(token, cancelled)() == +ActionExecutionStatus::ERROR);
+    REQUIRE(action.numberRuns.load() == 0U);
+
+    const auto cancellation = CancellationToken::create();
+    auto callable = action.createCancellableCallable(token, cancellation);
+    REQUIRE(callable() == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(action.numberRuns.load() == 1U);
+
+    cancellation.cancel(); // e.g., on timeout
+    REQUIRE(callable() == +ActionExecutionStatus::ERROR);
+
+    // the next execution of the token starts a new run rather than resuming the cancelled one
+    auto next = action.createCallable(token);
+    REQUIRE(next() == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(action.numberRuns.load() == 2U);
+    REQUIRE(pollUntilDone(next) == +ActionExecutionStatus::SUCCESS);
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/ActionRegistry.hpp>
+#include <behavior_net/ActionResultCache.hpp>
+#include <behavior_net/Config.hpp>
+#include <behavior_net/Place.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace capybot::bnet;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// @brief action counting its executions; succeeds for even `input.value`s and fails for odd ones
+class CountingPureAction : public IActionImpl
+{
+public:
+    inline static std::atomic<uint32_t> numberExecutions{0U};
+
+    CountingPureAction(nlohmann::json const params)
+        : m_value(params.at("value"))
+    {
+    }
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
+    {
+        return [this, token] {
+            ++numberExecutions;
+            return m_value.get(token) % 2 == 0 ? ActionExecutionStatus(ActionExecutionStatus::SUCCESS)
+                                               : ActionExecutionStatus(ActionExecutionStatus::FAILURE);
+        };
+    }
+
+private:
+    const ConfigParameter<int> m_value;
+};
+REGISTER_ACTION_TYPE(CountingPureAction);
+
+Token::SharedPtr makeToken(int value)
+{
+    auto token = Token::makeShared();
+    token->addContentBlock("input", {{"value", value}});
+    return token;
+}
+
+void runEpoch(Place& place)
+{
+    place.executeActionAsync();
+    std::this_thread::sleep_for(20ms);
+    place.checkActionResults();
+}
+} // namespace
+
+TEST_CASE("Action result caches evict the least recently used and expired entries.", "[PetriNet/ActionResultCache]")
+{
+    ActionResultCache cache(ActionResultCache::Params{.maxEntries = 2U, .ttl = 30ms, .numberShards = 1U});
+    cache.put("1", ActionExecutionStatus::SUCCESS);
+    cache.put("2", ActionExecutionStatus::FAILURE);
+    REQUIRE(cache.get("1") == +ActionExecutionStatus::SUCCESS); // 2 is now the least recently used
+    cache.put("3", ActionExecutionStatus::SUCCESS);
+    REQUIRE(cache.size() == 2U);
+    REQUIRE_FALSE(cache.get("2").has_value());
+    REQUIRE(cache.get("3") == +ActionExecutionStatus::SUCCESS);
+
+    // transient results are not cached
+    cache.put("4", ActionExecutionStatus::ERROR);
+    cache.put("5", ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE_FALSE(cache.get("4").has_value());
+    REQUIRE_FALSE(cache.get("5").has_value());
+
+    std::this_thread::sleep_for(40ms);
+    REQUIRE_FALSE(cache.get("1").has_value());
+    REQUIRE_FALSE(cache.get("3").has_value());
+    REQUIRE(cache.size() == 0U);
+}
+
+TEST_CASE("Action result cache keys depend on the params and the token content they refer to.",
+          "[PetriNet/ActionResultCache]")
+{
+    const ActionResultCacheKey key(nlohmann::json{{"value", "@token{input.value}"}, {"mode", "fast"}});
+    const ActionResultCacheKey otherKey(nlohmann::json{{"value", "@token{input.value}"}, {"mode", "slow"}});
+
+    REQUIRE(key.get(makeToken(1)) == key.get(makeToken(1)));
+    REQUIRE(key.get(makeToken(1)) != key.get(makeToken(2)));
+    REQUIRE(key.get(makeToken(1)) != otherKey.get(makeToken(1)));
+    REQUIRE_FALSE(key.get(Token::makeShared()).has_value()); // missing content is not cached
+
+    // keys are compared as a whole, not by their hash
+    ActionResultCache cache(ActionResultCache::Params{});
+    cache.put(key.get(makeToken(1)).value(), ActionExecutionStatus::SUCCESS);
+    REQUIRE(cache.get(key.get(makeToken(1)).value()) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE_FALSE(cache.get(key.get(makeToken(2)).value()).has_value());
+    REQUIRE_FALSE(cache.get(otherKey.get(makeToken(1)).value()).has_value());
+}
+
+TEST_CASE("Action result caches are shared by the actions of a type within their owner only.",
+          "[PetriNet/ActionResultCache]")
+{
+    ActionResultCacheRegistry caches;
+    ActionResultCacheRegistry otherCaches;
+    const ActionResultCache::Params params{.maxEntries = 100U, .ttl = 1000ms, .numberShards = 4U};
+
+    const auto cache = caches.get("CountingPureAction", params);
+    REQUIRE(caches.get("CountingPureAction", params) == cache);
+    REQUIRE(caches.get("OtherAction", params) != cache);
+    REQUIRE(otherCaches.get("CountingPureAction", params) != cache);
+    REQUIRE_THROWS_AS(caches.get("CountingPureAction", ActionResultCache::Params{}), Exception);
+
+    // actions created without an owner get their own cache
+    ThreadPool tp(1);
+    const auto options = Action::Options{.cache = params};
+    const auto action = ActionRegistry::create(tp, "CountingPureAction", nlohmann::json{{"value", 1}}, std::nullopt,
+                                               options);
+    const auto sharingAction = ActionRegistry::create(tp, "CountingPureAction", nlohmann::json{{"value", 2}},
+                                                      std::nullopt, options, &caches);
+    REQUIRE(action->getResultCache() != cache);
+    REQUIRE(sharingAction->getResultCache() == cache);
+}
+
+TEST_CASE("Cached action results complete without execution.", "[PetriNet/ActionResultCache]")
+{
+    ThreadPool tp(2);
+    Place place(nlohmann::json{{"place_id", "A"}});
+    place.setAssociatedAction(tp, "CountingPureAction", nlohmann::json{{"value", "@token{input.value}"}}, std::nullopt,
+                              Action::Options{.cache = ActionResultCache::Params{}});
+    REQUIRE(place.getAction()->getResultCache() != nullptr);
+
+    place.insertToken(makeToken(2));
+    place.insertToken(makeToken(3));
+    runEpoch(place);
+    REQUIRE(CountingPureAction::numberExecutions.load() == 2U);
+    REQUIRE(place.getAction()->getResultCache()->size() == 2U);
+
+    for (int value : {2, 3, 2, 3})
+    {
+        place.insertToken(makeToken(value));
+    }
+    place.executeActionAsync();
+    place.checkActionResults(); // no waiting; the cached results are collected right away
+    REQUIRE(CountingPureAction::numberExecutions.load() == 2U);
+    REQUIRE(place.getNumberTokensBusy() == 0U);
+    REQUIRE(place.getNumberTokensAvailable(ActionExecutionStatusSet{1U << ActionExecutionStatus::SUCCESS}) == 3U);
+    REQUIRE(place.getNumberTokensAvailable(ActionExecutionStatusSet{1U << ActionExecutionStatus::FAILURE}) == 3U);
+
+    // tokens without the referenced content are executed
+    place.insertToken(Token::makeShared());
+    runEpoch(place);
+    REQUIRE(CountingPureAction::numberExecutions.load() == 3U);
+}
+
+TEST_CASE("Invalid action result cache configs are rejected.", "[PetriNet/ActionResultCache]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+    configJson["controller"]["actions"][0]["cache"] = {{"max_entries", 100}, {"ttl_ms", 1000}};
+    std::ignore = NetConfig::fromJson(configJson);
+    const auto options = Action::Options::fromConfig(configJson["controller"]["actions"][0]);
+    REQUIRE(options.cache.has_value());
+    REQUIRE(options.cache->maxEntries == 100U);
+    REQUIRE(options.cache->ttl == 1000ms);
+    REQUIRE(options.cache->numberShards == 16U);
+
+    auto invalid = configJson;
+    invalid["controller"]["actions"][0]["cache"] = true;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["actions"][0]["cache"]["number_shards"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    // actions of the same type share their cache, so they must agree on its config
+    auto sameType = configJson["controller"]["actions"][0];
+    sameType["place_id"] = "C";
+    invalid = configJson;
+    invalid["controller"]["actions"][1] = sameType;
+    std::ignore = NetConfig::fromJson(invalid);
+    invalid["controller"]["actions"][1]["cache"]["ttl_ms"] = 2000;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/CpuAffinity.hpp>
+#include <behavior_net/ThreadPool.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <fstream>
+#include <thread>
+
+#include <sched.h>
+
+using namespace capybot::bnet;
+
+namespace
+{
+std::vector<uint32_t> getCurrentThreadCpus()
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet);
+    std::vector<uint32_t> cpus;
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &cpuSet))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+} // namespace
+
+TEST_CASE("Cpu lists are parsed as in sysfs.", "[PetriNet/CpuAffinity]")
+{
+    REQUIRE(parseCpuList("0") == std::vector<uint32_t>{0U});
+    REQUIRE(parseCpuList("0-3,8") == std::vector<uint32_t>{0U, 1U, 2U, 3U, 8U});
+    REQUIRE(parseCpuList("2,4-5") == std::vector<uint32_t>{2U, 4U, 5U});
+    REQUIRE_FALSE(parseCpuList("").has_value());
+    REQUIRE_FALSE(parseCpuList("3-1").has_value());
+    REQUIRE_FALSE(parseCpuList("a").has_value());
+    REQUIRE_FALSE(parseCpuList("1,").has_value());
+    REQUIRE_FALSE(parseCpuList("100000").has_value());
+}
+
+TEST_CASE("Threads are pinned to their configured cores.", "[PetriNet/CpuAffinity]")
+{
+    const auto affinityConfig =
+        nlohmann::json::parse(R"({"controller_loop": {"cpus": "0"}, "thread_pool_workers": {"cpus": "0"}})");
+    REQUIRE_FALSE(CpuPlacement::fromConfig(affinityConfig, "http_server").has_value());
+    const auto placement = CpuPlacement::fromConfig(affinityConfig, "controller_loop");
+    REQUIRE(placement.has_value());
+    REQUIRE(placement->cpus == std::vector<uint32_t>{0U});
+
+    bool pinned{false};
+    std::vector<uint32_t> pinnedCpus;
+    std::thread([&] {
+        pinned = placement->applyToCurrentThread("test");
+        pinnedCpus = getCurrentThreadCpus();
+    }).join();
+    REQUIRE(pinned);
+    REQUIRE(pinnedCpus == std::vector<uint32_t>{0U});
+
+    // workers of all lanes
+    ThreadPool tp(2, {}, CpuPlacement::fromConfig(affinityConfig, "thread_pool_workers"));
+    for (auto&& lane : {ThreadPool::DEFAULT_LANE, ThreadPool::BLOCKING_IO_LANE})
+    {
+        std::vector<uint32_t> workerCpus;
+        ThreadPool::Task task([&workerCpus] {
+            workerCpus = getCurrentThreadCpus();
+            return ActionExecutionStatus(ActionExecutionStatus::SUCCESS);
+        });
+        tp.executeAsync(task, lane);
+        while (task.getStatus(1000U) != +ActionExecutionStatus::SUCCESS)
+        {
+            std::this_thread::yield();
+        }
+        REQUIRE(workerCpus == std::vector<uint32_t>{0U});
+    }
+
+    const auto unknownNode = nlohmann::json::parse(R"({"controller_loop": {"numa_node": 1000}})");
+    REQUIRE_BNET_THROW_AS(CpuPlacement::fromConfig(unknownNode, "controller_loop"),
+                          ExceptionType::INVALID_CONFIG_FILE);
+}
+
+TEST_CASE("Invalid cpu affinity configs are rejected.", "[PetriNet/CpuAffinity]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+
+    auto valid = configJson;
+    valid["controller"]["cpu_affinity"] = {{"controller_loop", {{"cpus", "0"}}}, {"http_server", {{"numa_node", 0}}}};
+    std::ignore = NetConfig::fromJson(valid);
+
+    auto invalid = configJson;
+    invalid["controller"]["cpu_affinity"] = {{"unknown_thread", {{"cpus", "0"}}}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid["controller"]["cpu_affinity"] = {{"controller_loop", {{"cpus", "0"}, {"numa_node", 0}}}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid["controller"]["cpu_affinity"] = {{"controller_loop", {{"cpus", "0-"}}}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/EpochClock.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <fstream>
+#include <thread>
+
+using namespace capybot::bnet;
+using namespace std::chrono_literals;
+
+TEST_CASE("Epoch deadlines do not drift with the epoch work.", "[PetriNet/EpochClock]")
+{
+    EpochClock clock(10ms);
+    const auto start = EpochClock::Clock::now();
+    clock.restart();
+
+    constexpr uint32_t NUMBER_EPOCHS{10U};
+    for (uint32_t i = 0; i < NUMBER_EPOCHS; ++i)
+    {
+        std::this_thread::sleep_for(3ms); // epoch work
+        REQUIRE(clock.sleepUntilNextDeadline());
+    }
+    const auto elapsed = EpochClock::Clock::now() - start;
+
+    REQUIRE(elapsed >= NUMBER_EPOCHS * 10ms);
+    REQUIRE(elapsed < NUMBER_EPOCHS * 10ms + 20ms); // a relative sleep would take NUMBER_EPOCHS * 13ms
+
+    const auto stats = clock.getStats();
+    REQUIRE(stats.deadlines == NUMBER_EPOCHS);
+    REQUIRE(stats.overruns == 0U);
+    REQUIRE(stats.p99Lateness <= stats.maxLateness);
+}
+
+TEST_CASE("Epoch overruns follow the overrun policy.", "[PetriNet/EpochClock]")
+{
+    SECTION("skip")
+    {
+        EpochClock clock(20ms, EpochOverrunPolicy::SKIP);
+        clock.restart();
+        std::this_thread::sleep_for(50ms); // overruns the first deadline by 30ms, i.e., the second deadline is missed
+        REQUIRE_FALSE(clock.sleepUntilNextDeadline());
+        REQUIRE(clock.sleepUntilNextDeadline()); // the schedule continues at the third period boundary
+        REQUIRE(clock.getStats().overruns == 1U);
+        REQUIRE(clock.getStats().skippedDeadlines == 1U);
+    }
+    SECTION("catch up")
+    {
+        EpochClock clock(20ms, EpochOverrunPolicy::CATCH_UP);
+        clock.restart();
+        std::this_thread::sleep_for(50ms);
+        REQUIRE_FALSE(clock.sleepUntilNextDeadline());
+        REQUIRE_FALSE(clock.sleepUntilNextDeadline()); // the missed epoch runs right away
+        REQUIRE(clock.sleepUntilNextDeadline());
+        REQUIRE(clock.getStats().overruns == 2U);
+        REQUIRE(clock.getStats().skippedDeadlines == 0U);
+    }
+    SECTION("reset")
+    {
+        EpochClock clock(20ms, EpochOverrunPolicy::RESET);
+        clock.restart();
+        std::this_thread::sleep_for(50ms);
+        REQUIRE_FALSE(clock.sleepUntilNextDeadline());
+        const auto reset = EpochClock::Clock::now();
+        REQUIRE(clock.sleepUntilNextDeadline());
+        REQUIRE(EpochClock::Clock::now() - reset >= 19ms); // one full period after the overrun
+        REQUIRE(clock.getStats().overruns == 1U);
+    }
+}
+
+TEST_CASE("Epoch scheduling is read from the controller config.", "[PetriNet/EpochClock]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+
+    const EpochClock defaultClock(configJson.at("controller"));
+    REQUIRE(defaultClock.getPeriod() == 100ms);
+    REQUIRE(defaultClock.getOverrunPolicy() == +EpochOverrunPolicy::SKIP);
+    REQUIRE_FALSE(defaultClock.getRealtimePriority().has_value());
+
+    configJson["controller"]["epoch_scheduling"] = {{"overrun_policy", "catch_up"}, {"realtime_priority", 10}};
+    std::ignore = NetConfig::fromJson(configJson);
+    const EpochClock clock(configJson.at("controller"));
+    REQUIRE(clock.getOverrunPolicy() == +EpochOverrunPolicy::CATCH_UP);
+    REQUIRE(clock.getRealtimePriority() == 10);
+
+    auto invalid = configJson;
+    invalid["controller"]["epoch_scheduling"]["overrun_policy"] = "unknown";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["epoch_scheduling"]["realtime_priority"] = 100;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+}
+
+TEST_CASE("Adaptive epoch periods back off when idle and shrink when active.", "[PetriNet/EpochClock]")
+{
+    EpochClock fixedClock(8ms);
+    fixedClock.adaptPeriod(false);
+    REQUIRE(fixedClock.getPeriod() == 8ms);
+
+    EpochClock clock(8ms, EpochOverrunPolicy::SKIP, EpochClock::AdaptiveParams{.minPeriod = 1ms, .maxPeriod = 50ms});
+    REQUIRE(clock.isAdaptive());
+    clock.adaptPeriod(false);
+    REQUIRE(clock.getPeriod() == 16ms);
+    clock.adaptPeriod(false);
+    clock.adaptPeriod(false);
+    REQUIRE(clock.getPeriod() == 50ms); // bounded
+    clock.adaptPeriod(true);
+    REQUIRE(clock.getPeriod() == 25ms);
+    for (uint32_t i = 0; i < 10U; ++i)
+    {
+        clock.adaptPeriod(true);
+    }
+    REQUIRE(clock.getPeriod() == 1ms);
+
+    // external inputs end a backed off wait
+    for (uint32_t i = 0; i < 10U; ++i)
+    {
+        clock.adaptPeriod(false);
+    }
+    clock.restart();
+    std::thread waker([&clock] {
+        std::this_thread::sleep_for(5ms);
+        clock.wakeUp();
+    });
+    const auto start = EpochClock::Clock::now();
+    REQUIRE(clock.sleepUntilNextDeadline());
+    const auto waited = EpochClock::Clock::now() - start;
+    waker.join();
+    REQUIRE(waited < 40ms);
+    REQUIRE(clock.getPeriod() == 1ms);
+    REQUIRE(clock.getStats().wakeUps == 1U);
+}
+
+TEST_CASE("Epoch waits end once the epoch results are ready.", "[PetriNet/EpochClock]")
+{
+    EpochClock fixedClock(10ms);
+    fixedClock.endWait(fixedClock.getWaitGeneration()); // no-op without early result collection
+    fixedClock.restart();
+    REQUIRE(fixedClock.sleepUntilNextDeadline());
+    REQUIRE(fixedClock.getStats().earlyCollections == 0U);
+
+    EpochClock clock(200ms, EpochOverrunPolicy::SKIP, std::nullopt, true);
+    REQUIRE(clock.hasEarlyResultCollection());
+    clock.restart();
+    std::thread collector([&clock, generation = clock.getWaitGeneration()] {
+        std::this_thread::sleep_for(5ms);
+        clock.endWait(generation);
+    });
+    const auto start = EpochClock::Clock::now();
+    REQUIRE(clock.sleepUntilNextDeadline());
+    const auto waited = EpochClock::Clock::now() - start;
+    collector.join();
+    REQUIRE(waited < 150ms);
+    REQUIRE(clock.getPeriod() == 200ms);
+    REQUIRE(clock.getStats().earlyCollections == 1U);
+
+    // late requests do not end the next wait
+    const auto lateGeneration = clock.getWaitGeneration() - 1U;
+    clock.endWait(lateGeneration);
+    const auto nextStart = EpochClock::Clock::now();
+    clock.restart();
+    REQUIRE(clock.sleepUntilNextDeadline());
+    REQUIRE(EpochClock::Clock::now() - nextStart >= 190ms);
+    REQUIRE(clock.getStats().earlyCollections == 1U);
+
+    // requests made before the wait starts end it
+    clock.restart();
+    clock.endWait(clock.getWaitGeneration());
+    const auto earlyStart = EpochClock::Clock::now();
+    REQUIRE(clock.sleepUntilNextDeadline());
+    REQUIRE(EpochClock::Clock::now() - earlyStart < 150ms);
+    REQUIRE(clock.getStats().earlyCollections == 2U);
+
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+    configJson["controller"]["epoch_scheduling"]["early_result_collection"] = true;
+    std::ignore = NetConfig::fromJson(configJson);
+    REQUIRE(EpochClock(configJson.at("controller")).hasEarlyResultCollection());
+    configJson["controller"]["epoch_scheduling"]["early_result_collection"] = "yes";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
+
+TEST_CASE("Invalid adaptive epoch configs are rejected.", "[PetriNet/EpochClock]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+
+    configJson["controller"]["epoch_scheduling"]["adaptive"] = {{"min_period_ms", 10}, {"max_period_ms", 1000}};
+    std::ignore = NetConfig::fromJson(configJson);
+    REQUIRE(EpochClock(configJson.at("controller")).isAdaptive());
+
+    auto invalid = configJson;
+    invalid["controller"]["epoch_scheduling"]["adaptive"]["min_period_ms"] = 200; // above `epoch_period_ms`
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["epoch_scheduling"]["adaptive"]["min_period_ms"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["epoch_scheduling"]["adaptive"]["backoff_factor"] = 1.0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+}
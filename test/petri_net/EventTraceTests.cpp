@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/EventTrace.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace capybot::bnet;
+
+TEST_CASE("A recorded event trace replays to the same marking.", "[PetriNet/EventTrace]")
+{
+    const auto tracePath = (std::filesystem::temp_directory_path() / "bnet_event_trace_test.jsonl").string();
+
+    nlohmann::json configJson;
+    std::ifstream("test/petri_net/config/event_trace.json") >> configJson;
+
+    // record
+    nlohmann::json recordedMarking;
+    {
+        configJson["controller"]["event_trace"]["record_path"] = tracePath;
+        const auto config = NetConfig::fromJson(configJson);
+        Controller controller(config, PetriNet::create(config));
+
+        controller.addToken(createRobotTokenContent(), "A"); // before running
+        controller.runDetached();
+        for (int i = 0; i < 10; ++i)
+        {
+            controller.addToken(createRobotTokenContent(), i % 2 ? "A" : "M");
+            if (i % 2 == 0)
+            {
+                controller.triggerManualTransition("T4");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        controller.stop();
+
+        recordedMarking = controller.getNet().getMarking().at("marking");
+    }
+
+    // replay
+    {
+        configJson["controller"].erase("event_trace");
+        const auto config = NetConfig::fromJson(configJson);
+        Controller controller(config, PetriNet::create(config));
+
+        const auto trace = EventTrace::load(tracePath);
+        REQUIRE(trace.getEpochPeriodMs() == 5U);
+        REQUIRE(trace.getNumberEvents() > 0U);
+
+        const auto report = controller.replay(trace);
+        REQUIRE(report.divergentEpochs == 0U);
+        REQUIRE(report.transitionsFired > 0U);
+        REQUIRE(controller.getNet().getMarking().at("marking") == recordedMarking);
+    }
+
+    std::filesystem::remove(tracePath);
+}
+
+TEST_CASE("Invalid event traces are rejected.", "[PetriNet/EventTrace]")
+{
+    const auto tracePath = (std::filesystem::temp_directory_path() / "bnet_event_trace_invalid.jsonl").string();
+
+    std::ofstream(tracePath) << "{\"epoch_period_ms\": 5}\n";
+    REQUIRE_BNET_THROW_AS(EventTrace::load(tracePath), ExceptionType::INVALID_VALUE);
+
+    std::ofstream(tracePath) << "{\"bnet_event_trace\": 1, \"epoch_period_ms\": 5}\n{\"epoch\": 0, \"type\": \"?\"}\n";
+    REQUIRE_BNET_THROW_AS(EventTrace::load(tracePath), ExceptionType::INVALID_VALUE);
+
+    REQUIRE_BNET_THROW_AS(EventTrace::load("does/not/exist.jsonl"), ExceptionType::RUNTIME_ERROR);
+
+    std::filesystem::remove(tracePath);
+}
+
+TEST_CASE("Event traces record adaptive epoch periods for the replay virtual time.", "[PetriNet/EventTrace]")
+{
+    const auto tracePath = (std::filesystem::temp_directory_path() / "bnet_event_trace_periods.jsonl").string();
+    {
+        EventTraceRecorder recorder(tracePath, 5U);
+        recorder.recordEpochPeriod(1U, std::chrono::milliseconds(5)); // unchanged, not recorded
+        recorder.recordEpochPeriod(2U, std::chrono::microseconds(2500));
+        recorder.recordEpochPeriod(4U, std::chrono::milliseconds(10));
+        recorder.setPosition(5U, EpochPhase::IDLE);
+        recorder.recordManualTrigger("T4");
+    }
+
+    const auto trace = EventTrace::load(tracePath);
+    REQUIRE(trace.getEpochPeriodMs() == 5U);
+    REQUIRE(trace.getNumberEvents() == 3U);
+    REQUIRE(trace.getLastEpoch() == 5U); // period changes do not add epochs to replay
+    REQUIRE(trace.getVirtualTime(0U) == std::chrono::nanoseconds(0));
+    REQUIRE(trace.getVirtualTime(2U) == std::chrono::milliseconds(10));
+    REQUIRE(trace.getVirtualTime(3U) == std::chrono::microseconds(12500));
+    REQUIRE(trace.getVirtualTime(6U) == std::chrono::milliseconds(35));
+
+    std::filesystem::remove(tracePath);
+}
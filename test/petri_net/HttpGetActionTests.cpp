@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/action_impl/HttpGetAction.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace capybot::bnet;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// @brief listening socket whose connections are never answered, e.g., a hung robot
+class SilentServer
+{
+public:
+    SilentServer()
+        : m_fd(::socket(AF_INET, SOCK_STREAM, 0))
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length{sizeof(addr)};
+        REQUIRE(::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        REQUIRE(::listen(m_fd, 8) == 0);
+        REQUIRE(::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &length) == 0);
+        m_port = ntohs(addr.sin_port);
+    }
+    ~SilentServer() { ::close(m_fd); }
+
+    int getPort() const { return m_port; }
+
+private:
+    int m_fd;
+    int m_port{0};
+};
+
+nlohmann::json createConfig(int port, uint32_t requestTimeoutMs)
+{
+    return {{"host", "127.0.0.1"},
+            {"port", port},
+            {"execute_path", "/execute"},
+            {"get_status_path", "/status"},
+            {"request_timeout_ms", requestTimeoutMs}};
+}
+} // namespace
+
+TEST_CASE("Http get actions time out on clients that never answer.", "[PetriNet/HttpGetAction]")
+{
+    SilentServer server;
+    HttpGetAction action(createConfig(server.getPort(), 100U));
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(action.createCallable(Token::makeShared())() == +ActionExecutionStatus::ERROR);
+    REQUIRE(std::chrono::steady_clock::now() - start < 2s);
+}
+
+TEST_CASE("Cancelled http get action executions interrupt their request.", "[PetriNet/HttpGetAction]")
+{
+    SilentServer server;
+    HttpGetAction action(createConfig(server.getPort(), 60'000U));
+
+    const auto cancellation = CancellationToken::create();
+    auto callable = action.createCancellableCallable(Token::makeShared(), cancellation);
+    std::thread canceller([&cancellation] {
+        std::this_thread::sleep_for(100ms);
+        cancellation.cancel(); // e.g., on the action timeout
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(callable() == +ActionExecutionStatus::ERROR);
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+    canceller.join();
+
+    // already cancelled executions do not send requests
+    REQUIRE(callable() == +ActionExecutionStatus::ERROR);
+}
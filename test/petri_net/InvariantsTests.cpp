@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/analysis/Invariants.hpp>
+
+using namespace capybot::bnet;
+
+namespace
+{
+using SparseVector = InvariantAnalyzer::SparseVector;
+
+NetStructure::Transition transition(std::string id, std::vector<NetStructure::Arc> inputs,
+                                    std::vector<NetStructure::Arc> outputs)
+{
+    return NetStructure::Transition{.id = std::move(id),
+                                    .isManual = false,
+                                    .inputArcs = std::move(inputs),
+                                    .outputArcs = std::move(outputs),
+                                    .inhibitorArcs = {}};
+}
+
+/// workers (Idle/Busy) sharing a resource pool
+NetStructure createResourcePoolNet()
+{
+    NetStructure net;
+    net.placeIds = {"Idle", "Busy", "Pool"};
+    net.transitions = {transition("acquire", {{0U, 1U}, {2U, 1U}}, {{1U, 1U}}),
+                       transition("release", {{1U, 1U}}, {{0U, 1U}, {2U, 1U}})};
+    return net;
+}
+} // namespace
+
+TEST_CASE("The incidence matrix is built from the transition arcs.", "[PetriNet/Invariants]")
+{
+    auto net = createResourcePoolNet();
+    net.transitions.push_back(transition("self_loop", {{2U, 1U}}, {{2U, 1U}}));
+
+    const InvariantAnalyzer analyzer(net);
+    REQUIRE(analyzer.getIncidence().size() == 3U);
+    REQUIRE(analyzer.getIncidence()[0] == SparseVector{{0U, -1}, {1U, 1}, {2U, -1}});
+    REQUIRE(analyzer.getIncidence()[1] == SparseVector{{0U, 1}, {1U, -1}, {2U, 1}});
+    REQUIRE(analyzer.getIncidence()[2].empty());
+}
+
+TEST_CASE("P-invariants bound the places of a resource pool.", "[PetriNet/Invariants]")
+{
+    const auto net = createResourcePoolNet();
+    const auto result = InvariantAnalyzer(net).analyze({3U, 0U, 2U});
+
+    REQUIRE(result.complete);
+    REQUIRE(result.pInvariants == std::vector<SparseVector>{{{0U, 1}, {1U, 1}}, {{1U, 1}, {2U, 1}}});
+    REQUIRE(result.tInvariants == std::vector<SparseVector>{{{0U, 1}, {1U, 1}}});
+    REQUIRE(result.isConservative());
+    REQUIRE(result.placeBounds[0] == 3U);
+    REQUIRE(result.placeBounds[1] == 2U);
+    REQUIRE(result.placeBounds[2] == 2U);
+
+    const auto json = result.toJson(net);
+    REQUIRE(json.at("p_invariants").at(0) == nlohmann::json{{"Idle", 1}, {"Busy", 1}});
+    REQUIRE(json.at("t_invariants").at(0) == nlohmann::json{{"acquire", 1}, {"release", 1}});
+    REQUIRE(json.at("place_bounds").at("Busy") == 2);
+}
+
+TEST_CASE("P-invariants are normalized for weighted arcs.", "[PetriNet/Invariants]")
+{
+    // T1: A -> 2B; T2: 2B -> A
+    NetStructure net;
+    net.placeIds = {"A", "B"};
+    net.transitions = {transition("T1", {{0U, 1U}}, {{1U, 2U}}), transition("T2", {{1U, 2U}}, {{0U, 1U}})};
+
+    const auto result = InvariantAnalyzer(net).analyze({1U, 1U});
+    REQUIRE(result.pInvariants == std::vector<SparseVector>{{{0U, 2}, {1U, 1}}});
+    REQUIRE(result.tInvariants == std::vector<SparseVector>{{{0U, 1}, {1U, 1}}});
+    REQUIRE(result.placeBounds[0] == 1U);
+    REQUIRE(result.placeBounds[1] == 3U);
+}
+
+TEST_CASE("Places not covered by P-invariants have no structural bound.", "[PetriNet/Invariants]")
+{
+    // T1: A -> A + B
+    NetStructure net;
+    net.placeIds = {"A", "B"};
+    net.transitions = {transition("T1", {{0U, 1U}}, {{0U, 1U}, {1U, 1U}})};
+
+    const auto result = InvariantAnalyzer(net).analyze({1U, 0U});
+    REQUIRE(result.complete);
+    REQUIRE_FALSE(result.isConservative());
+    REQUIRE(result.placeBounds[0] == 1U);
+    REQUIRE_FALSE(result.placeBounds[1].has_value());
+    REQUIRE(result.tInvariants.empty());
+    REQUIRE(result.toJson(net).at("place_bounds").at("B").is_null());
+
+    net.capacities = {std::nullopt, 4U};
+    const auto bounded = InvariantAnalyzer(net).analyze({1U, 0U});
+    REQUIRE(bounded.placeBounds[1] == 4U);
+    REQUIRE(bounded.isConservative());
+}
+
+TEST_CASE("Invariant analysis is aborted when the maximum number of rows is reached.", "[PetriNet/Invariants]")
+{
+    const auto result = InvariantAnalyzer(createResourcePoolNet(), 1U).analyze({3U, 0U, 2U});
+    REQUIRE_FALSE(result.complete);
+    REQUIRE(result.pInvariants.empty());
+    REQUIRE_FALSE(result.isConservative());
+
+    REQUIRE_THROWS_AS(InvariantAnalyzer(createResourcePoolNet()).analyze({1U}), Exception);
+}
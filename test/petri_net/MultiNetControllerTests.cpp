@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/MultiNetController.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace capybot::bnet;
+
+namespace
+{
+nlohmann::json createHostConfig()
+{
+    nlohmann::json netConfig;
+    std::ifstream("test/petri_net/config/event_trace.json") >> netConfig;
+
+    auto slowNetConfig = netConfig;
+    slowNetConfig["controller"]["epoch_period_ms"] = 20;
+
+    return {{"thread_pool_workers", 2},
+            {"nets",
+             {{{"net_id", "fast"}, {"config", netConfig}},
+              {{"net_id", "slow"}, {"config", slowNetConfig}},
+              {{"net_id", "sample"}, {"config_path", "config_samples/config.json"}}}}};
+}
+} // namespace
+
+TEST_CASE("Nets hosted by one controller are isolated from each other.", "[BehaviorController/MultiNetController]")
+{
+    MultiNetController host(createHostConfig());
+    REQUIRE(host.getNetIds() == std::vector<std::string>{"fast", "sample", "slow"});
+    REQUIRE_BNET_THROW_AS(host.getController("unknown"), ExceptionType::RUNTIME_ERROR);
+
+    host.getController("fast").addToken(createRobotTokenContent(), "A");
+    host.getController("slow").addToken(createRobotTokenContent(), "M");
+
+    host.runDetached();
+    host.getController("slow").triggerManualTransition("T4");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    host.stop();
+
+    // both nets ran their epochs; tokens stay within their own net
+    for (auto&& netId : {"fast", "slow"})
+    {
+        const auto marking = host.getController(netId).getNet().getMarking().at("marking");
+        REQUIRE(marking.at("A") == 0);
+        REQUIRE(marking.at("B") == 0);
+        REQUIRE(marking.at("C").get<int>() + marking.at("D").get<int>() == 1);
+    }
+    REQUIRE(host.getController("sample").getNet().getMarking().at("marking").at("A") == 0);
+}
+
+TEST_CASE("Invalid multi-net host configs are rejected.", "[BehaviorController/MultiNetController]")
+{
+    auto config = createHostConfig();
+    config["nets"][1]["net_id"] = "fast";
+    REQUIRE_BNET_THROW_AS(MultiNetController{config}, ExceptionType::INVALID_CONFIG_FILE);
+
+    config = createHostConfig();
+    config["nets"][2]["config"] = config["nets"][0]["config"];
+    REQUIRE_BNET_THROW_AS(MultiNetController{config}, ExceptionType::INVALID_CONFIG_FILE);
+
+    config = createHostConfig();
+    config.erase("thread_pool_workers");
+    REQUIRE_BNET_THROW_AS(MultiNetController{config}, ExceptionType::INVALID_CONFIG_FILE);
+
+    // net configs are validated as well
+    config = createHostConfig();
+    config["nets"][0]["config"].erase("petri_net");
+    REQUIRE_BNET_THROW_AS(MultiNetController{config}, ExceptionType::INVALID_CONFIG_FILE);
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/NetPartition.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+using namespace capybot::bnet;
+
+namespace
+{
+nlohmann::json arc(std::string const& placeId, std::string const& type)
+{
+    return {{"place_id", placeId}, {"type", type}};
+}
+
+int connectTo(std::string const& socketPath)
+{
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1U);
+    if (::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+uint64_t receiveAck(int fd)
+{
+    uint32_t size{0U};
+    REQUIRE(::recv(fd, &size, sizeof(size), MSG_WAITALL) == sizeof(size));
+    std::vector<uint8_t> payload(ntohl(size));
+    REQUIRE(::recv(fd, payload.data(), payload.size(), MSG_WAITALL) == static_cast<ssize_t>(payload.size()));
+    return NetPartition::decodeAck(payload);
+}
+
+/// @return config of the `p1` partition: `In -> T1 -> Remote`, where `Remote` is owned by `p2`
+nlohmann::json createProducerConfig(std::string const& socketDir)
+{
+    return {{"petri_net",
+             {{"places", {{{"place_id", "In"}}, {{"place_id", "Remote"}}}},
+              {"transitions",
+               {{{"transition_id", "T1"},
+                 {"transition_type", "auto"},
+                 {"transition_arcs", {arc("In", "input"), arc("Remote", "output")}}}}}}},
+            {"controller",
+             {{"thread_poll_workers", 1},
+              {"epoch_period_ms", 5},
+              {"actions", nlohmann::json::array()},
+              {"partition",
+               {{"partition_id", "p1"},
+                {"listen", {{"unix_socket", socketDir + "/p1.sock"}}},
+                {"peers",
+                 {{{"partition_id", "p2"},
+                   {"endpoint", {{"unix_socket", socketDir + "/p2.sock"}}},
+                   {"places", {"Remote"}}}}}}}}}};
+}
+
+/// @return config of the `p2` partition: `Remote -> T2 -> Done`
+nlohmann::json createConsumerConfig(std::string const& socketDir)
+{
+    return {{"petri_net",
+             {{"places", {{{"place_id", "Remote"}}, {{"place_id", "Done"}}}},
+              {"transitions",
+               {{{"transition_id", "T2"},
+                 {"transition_type", "auto"},
+                 {"transition_arcs", {arc("Remote", "input"), arc("Done", "output")}}}}}}},
+            {"controller",
+             {{"thread_poll_workers", 1},
+              {"epoch_period_ms", 5},
+              {"actions", nlohmann::json::array()},
+              {"partition",
+               {{"partition_id", "p2"},
+                {"listen", {{"unix_socket", socketDir + "/p2.sock"}}},
+                {"peers", nlohmann::json::array()}}}}}};
+}
+} // namespace
+
+TEST_CASE("Token transfer frames are decoded to the encoded tokens.", "[PetriNet/NetPartition]")
+{
+    const std::vector<NetPartition::TokenTransfer> tokens{
+        {.placeId = "A", .contentBlocks = createRobotTokenContent()},
+        {.placeId = "B", .contentBlocks = nlohmann::json::object()}};
+
+    const auto frame = NetPartition::encodeFrame(
+        NetPartition::Frame{.partitionId = "p1", .session = 7U, .sequence = 3U, .tokens = tokens});
+    const uint32_t payloadSize = (frame[0] << 24U) | (frame[1] << 16U) | (frame[2] << 8U) | frame[3];
+    REQUIRE(payloadSize + 4U == frame.size());
+
+    const auto decoded = NetPartition::decodePayload(std::vector<uint8_t>(frame.begin() + 4, frame.end()));
+    REQUIRE(decoded.partitionId == "p1");
+    REQUIRE(decoded.session == 7U);
+    REQUIRE(decoded.sequence == 3U);
+    REQUIRE(decoded.tokens.size() == 2U);
+    REQUIRE(decoded.tokens[0].placeId == "A");
+    REQUIRE(decoded.tokens[0].contentBlocks == createRobotTokenContent());
+    REQUIRE(decoded.tokens[1].placeId == "B");
+
+    const auto ack = NetPartition::encodeAck(3U);
+    REQUIRE(NetPartition::decodeAck(std::vector<uint8_t>(ack.begin() + 4, ack.end())) == 3U);
+}
+
+TEST_CASE("Partitions ack every frame and drop the frames they already received.", "[PetriNet/NetPartition]")
+{
+    const auto socketDir = std::filesystem::temp_directory_path().string();
+    const auto consumerConfig = createConsumerConfig(socketDir);
+    NetPartition consumer(consumerConfig.at("controller").at("partition"), Place::IdMap{});
+    consumer.start();
+
+    const int fd = connectTo(socketDir + "/p2.sock");
+    REQUIRE(fd >= 0);
+    const std::vector<NetPartition::TokenTransfer> tokens{{.placeId = "Remote", .contentBlocks = {}}};
+    const auto sendFrame = [&](uint64_t session, uint64_t sequence) {
+        const auto frame = NetPartition::encodeFrame(
+            NetPartition::Frame{.partitionId = "p1", .session = session, .sequence = sequence, .tokens = tokens});
+        REQUIRE(::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(frame.size()));
+        return receiveAck(fd);
+    };
+
+    REQUIRE(sendFrame(1U, 1U) == 1U);
+    REQUIRE(sendFrame(1U, 2U) == 2U);
+    REQUIRE(sendFrame(1U, 2U) == 2U); // resent, e.g., after a lost ack
+    REQUIRE(consumer.takeIncoming().size() == 2U);
+
+    REQUIRE(sendFrame(2U, 1U) == 1U); // the sender restarted
+    REQUIRE(consumer.takeIncoming().size() == 1U);
+
+    ::close(fd);
+    consumer.stop();
+}
+
+TEST_CASE("Partitions drop the connections of peers stalling within a frame.", "[PetriNet/NetPartition]")
+{
+    const auto socketDir = std::filesystem::temp_directory_path().string();
+    auto consumerConfig = createConsumerConfig(socketDir);
+    consumerConfig["controller"]["partition"]["io_timeout_ms"] = 50;
+    NetPartition consumer(consumerConfig.at("controller").at("partition"), Place::IdMap{});
+    consumer.start();
+
+    // e.g., a peer stopped right after writing the length prefix
+    const int stalled = connectTo(socketDir + "/p2.sock");
+    REQUIRE(stalled >= 0);
+    const uint32_t size = htonl(64U);
+    REQUIRE(::send(stalled, &size, sizeof(size), MSG_NOSIGNAL) == sizeof(size));
+
+    const int fd = connectTo(socketDir + "/p2.sock");
+    REQUIRE(fd >= 0);
+    const auto frame = NetPartition::encodeFrame(NetPartition::Frame{
+        .partitionId = "p1", .session = 1U, .sequence = 1U, .tokens = {{.placeId = "Remote", .contentBlocks = {}}}});
+    REQUIRE(::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(frame.size()));
+    REQUIRE(receiveAck(fd) == 1U);
+    REQUIRE(consumer.takeIncoming().size() == 1U);
+
+    char byte{0};
+    REQUIRE(::recv(stalled, &byte, 1U, 0) == 0); // closed by the partition
+
+    ::close(stalled);
+    ::close(fd);
+    consumer.stop();
+}
+
+TEST_CASE("Tokens flow across net partitions through proxy places.", "[PetriNet/NetPartition]")
+{
+    const auto socketDir = std::filesystem::temp_directory_path().string();
+
+    const auto consumerConfig = NetConfig::fromJson(createConsumerConfig(socketDir));
+    Controller consumer(consumerConfig, PetriNet::create(consumerConfig));
+    const auto producerConfig = NetConfig::fromJson(createProducerConfig(socketDir));
+    Controller producer(producerConfig, PetriNet::create(producerConfig));
+
+    constexpr int NUMBER_TOKENS{5};
+    for (int i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        producer.addToken(createRobotTokenContent("robot_" + std::to_string(i)), "In");
+    }
+
+    // the producer starts first: batches are kept until the consumer is reachable
+    producer.runDetached();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    consumer.runDetached();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    producer.stop();
+    consumer.stop();
+
+    const auto producerMarking = producer.getNet().getMarking().at("marking");
+    REQUIRE(producerMarking.at("In") == 0);
+    REQUIRE(producerMarking.at("Remote") == 0);
+    REQUIRE(consumer.getNet().getMarking().at("marking").at("Done") == NUMBER_TOKENS);
+}
+
+TEST_CASE("Unacked token transfers are sent again to restarted peers.", "[PetriNet/NetPartition]")
+{
+    const auto socketDir = std::filesystem::temp_directory_path().string();
+    const auto producerConfig = NetConfig::fromJson(createProducerConfig(socketDir));
+    Controller producer(producerConfig, PetriNet::create(producerConfig));
+    constexpr int NUMBER_TOKENS{5};
+    for (int i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        producer.addToken(createRobotTokenContent("robot_" + std::to_string(i)), "In");
+    }
+
+    // a consumer stopping after receiving the first frame, without adding its tokens nor acking it
+    const auto socketPath = socketDir + "/p2.sock";
+    ::unlink(socketPath.c_str());
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1U);
+    REQUIRE(::bind(listenFd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(::listen(listenFd, 1) == 0);
+
+    producer.runDetached();
+    const int fd = ::accept(listenFd, nullptr, nullptr);
+    REQUIRE(fd >= 0);
+    uint32_t size{0U};
+    REQUIRE(::recv(fd, &size, sizeof(size), MSG_WAITALL) == sizeof(size));
+    ::close(fd);
+    ::close(listenFd);
+    ::unlink(socketPath.c_str());
+
+    const auto consumerConfig = NetConfig::fromJson(createConsumerConfig(socketDir));
+    Controller consumer(consumerConfig, PetriNet::create(consumerConfig));
+    consumer.runDetached();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    producer.stop();
+    consumer.stop();
+
+    REQUIRE(consumer.getNet().getMarking().at("marking").at("Done") == NUMBER_TOKENS);
+}
+
+TEST_CASE("Invalid partition configs are rejected.", "[PetriNet/NetPartition]")
+{
+    const auto socketDir = std::filesystem::temp_directory_path().string();
+    std::ignore = NetConfig::fromJson(createProducerConfig(socketDir));
+
+    // proxy places are output only
+    auto configJson = createProducerConfig(socketDir);
+    configJson["controller"]["partition"]["peers"][0]["places"] = {"In"};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    configJson = createProducerConfig(socketDir);
+    configJson["controller"]["partition"]["peers"][0]["places"] = {"Unknown"};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    configJson = createProducerConfig(socketDir);
+    configJson["controller"]["partition"]["peers"][0]["endpoint"] = {{"address", "localhost"}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
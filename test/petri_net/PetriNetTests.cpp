@@ -23,6 +23,9 @@
 
 #include "TestsCommon.hpp"
 
+#include <algorithm>
+#include <fstream>
+
 using namespace capybot::bnet;
 
 std::unique_ptr<PetriNet> createFromSampleConfig()
@@ -80,6 +83,25 @@ TEST_CASE("NeConfig validators work as expected.", "[PetriNet/NeConfig]")
                               ExceptionType::INVALID_CONFIG_FILE);
     }
 
+    // Place token selection
+    {
+        nlohmann::json configJson;
+        std::ifstream("test/petri_net/config/place_capacity.json") >> configJson;
+        auto& placeConfig = configJson["petri_net"]["places"][0];
+
+        placeConfig["token_selection"] = {{"policy", "lifo"}};
+        std::ignore = NetConfig::fromJson(configJson);
+        placeConfig["token_selection"] = {{"policy", "deadline"}, {"key", "order.due"}};
+        std::ignore = NetConfig::fromJson(configJson);
+
+        placeConfig["token_selection"] = {{"policy", "deadline"}};
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception); // missing key
+        placeConfig["token_selection"] = {{"policy", "priority"}, {"key", ".due"}};
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+        placeConfig["token_selection"] = {{"policy", "random"}};
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+    }
+
     // Transition
     {
         std::ignore = NetConfig("test/petri_net/config/transition_valid.json"); // valid config
@@ -91,3 +113,196 @@ TEST_CASE("NeConfig validators work as expected.", "[PetriNet/NeConfig]")
                               ExceptionType::INVALID_CONFIG_FILE);
     }
 }
+
+TEST_CASE("Place capacities disable transitions and reject new tokens.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/place_capacity.json"));
+    auto const& transitions = net->getTransitions();
+    const auto isEnabled = [&transitions](std::string const& id) {
+        return std::find_if(transitions.begin(), transitions.end(),
+                            [&id](auto const& t) { return t.getId() == id; })
+            ->isEnabled();
+    };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        auto token = Token::makeUnique();
+        net->addToken(token, "A");
+    }
+
+    net->triggerTransition("T1");
+    REQUIRE(net->getMarking()["marking"]["B"] == 1);
+    REQUIRE_FALSE(isEnabled("T1")); // B is full
+
+    // backpressure on new tokens
+    {
+        auto token = Token::makeUnique();
+        REQUIRE_THROWS_AS(net->addToken(token, "B"), Exception);
+        token = Token::makeUnique();
+        REQUIRE_BNET_THROW_AS(net->addToken(token, "B"), ExceptionType::CAPACITY_EXCEEDED);
+    }
+
+    net->triggerTransition("T2", true);
+    REQUIRE(isEnabled("T1"));
+    net->triggerTransition("T1");
+    net->triggerTransition("T2", true);
+    net->triggerTransition("T1");
+    REQUIRE(net->getMarking()["marking"] == nlohmann::json{{"A", 0}, {"B", 1}, {"C", 2}});
+    REQUIRE_FALSE(isEnabled("T2")); // C is full
+    REQUIRE_BNET_THROW_AS(net->triggerTransition("T2", true), ExceptionType::LOGIC_ERROR);
+
+    // invalid capacity
+    {
+        nlohmann::json configJson;
+        std::ifstream("test/petri_net/config/place_capacity.json") >> configJson;
+        configJson["petri_net"]["places"][1]["capacity"] = 0;
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+        configJson["petri_net"]["places"][1]["capacity"] = 4'000'000'000U;
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+        configJson["petri_net"]["places"][1]["capacity"] = 2;
+        configJson["petri_net"]["places"][1]["reserved_tokens"] = Place::MAX_RESERVED_TOKENS + 1U;
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+    }
+}
+
+TEST_CASE("Weighted arcs move several tokens and inhibitor arcs block transitions.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/weighted_inhibitor_arcs.json"));
+    auto const& t1 = net->getTransitions().at(0);
+    REQUIRE(t1.getId() == "T1");
+
+    const auto addTokens = [&net](std::string const& placeId, int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            auto token = Token::makeUnique();
+            net->addToken(token, placeId);
+        }
+    };
+
+    addTokens("A", 1);
+    REQUIRE_FALSE(t1.isEnabled()); // weight 2
+    addTokens("A", 2);
+    REQUIRE(t1.isEnabled());
+
+    addTokens("Lock", 1);
+    REQUIRE_FALSE(t1.isEnabled()); // inhibited
+    net->triggerTransition("T2", true);
+    REQUIRE(t1.isEnabled());
+
+    net->triggerTransition("T1");
+    REQUIRE(net->getMarking()["marking"] == nlohmann::json{{"A", 1}, {"B", 1}, {"C", 3}, {"Lock", 0}});
+    REQUIRE_FALSE(t1.isEnabled());
+
+    // invalid weight
+    {
+        nlohmann::json configJson;
+        std::ifstream("test/petri_net/config/weighted_inhibitor_arcs.json") >> configJson;
+        configJson["petri_net"]["transitions"][0]["transition_arcs"][0]["weight"] = 0;
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+    }
+}
+
+TEST_CASE("Token guards route tokens by content.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/token_guard_routing.json"));
+    auto const& toExpress = net->getTransitions().at(0);
+    auto const& toRegular = net->getTransitions().at(1);
+    REQUIRE(toExpress.getId() == "ToExpress");
+
+    const auto addToken = [&net](std::string const& placeId, std::string const& key, nlohmann::json const& content) {
+        auto token = Token::makeUnique();
+        token->addContentBlock(key, content);
+        net->addToken(token, placeId);
+    };
+
+    addToken("Orders", "order", {{"qty", 3}});
+    addToken("Orders", "order", {{"qty", 2}, {"kind", "express"}});
+    addToken("Orders", "order", {{"qty", 20}});
+    addToken("Orders", "order", {{"kind", "unknown"}}); // matches no guard
+    REQUIRE(toExpress.isEnabled());
+    REQUIRE(toRegular.isEnabled());
+
+    net->triggerTransition("ToExpress");
+    net->triggerTransition("ToExpress");
+    REQUIRE_FALSE(toExpress.isEnabled());
+    net->triggerTransition("ToRegular");
+    REQUIRE_FALSE(toRegular.isEnabled());
+    REQUIRE(net->getMarking()["marking"] == nlohmann::json{{"Orders", 1}, {"Express", 2}, {"Regular", 1}, {"Hold", 0}});
+
+    // inhibited only by tokens satisfying the inhibitor guard
+    addToken("Orders", "order", {{"qty", 11}});
+    addToken("Hold", "hold", {{"express", false}});
+    REQUIRE(toExpress.isEnabled());
+    addToken("Hold", "hold", {{"express", true}});
+    REQUIRE_FALSE(toExpress.isEnabled());
+
+    // invalid guards
+    {
+        nlohmann::json configJson;
+        std::ifstream("test/petri_net/config/token_guard_routing.json") >> configJson;
+        auto& arcConfig = configJson["petri_net"]["transitions"][0]["transition_arcs"][0];
+
+        arcConfig["token_guard"] = "@token{order.qty} >";
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+        arcConfig["token_guard"] = "true";
+        arcConfig["type"] = "output";
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+    }
+}
+
+TEST_CASE("Join arcs pair tokens by key across places.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/join_by_key.json"));
+    auto const& join = net->getTransitions().at(0);
+
+    const auto addToken = [&net](std::string const& placeId, std::string const& key, nlohmann::json const& content) {
+        auto token = Token::makeUnique();
+        token->addContentBlock(key, content);
+        net->addToken(token, placeId);
+    };
+
+    addToken("Orders", "order", {{"id", "a"}});
+    addToken("Orders", "order", {{"id", "b"}});
+    addToken("Payments", "payment", {{"order_id", "c"}});
+    addToken("Payments", "payment", {{"amount", 1}}); // no key, never joined
+    REQUIRE_FALSE(join.isEnabled());
+
+    addToken("Payments", "payment", {{"order_id", "b"}, {"amount", 2}});
+    REQUIRE(join.isEnabled());
+    net->triggerTransition("Join");
+    REQUIRE_FALSE(join.isEnabled());
+    REQUIRE(net->getMarking()["marking"] == nlohmann::json{{"Orders", 1}, {"Payments", 2}, {"Shipments", 1}});
+
+    // deep queues, keys arriving in opposite orders
+    constexpr int NUMBER_ORDERS{10000};
+    for (int i = 0; i < NUMBER_ORDERS; ++i)
+    {
+        addToken("Orders", "order", {{"id", i}});
+        addToken("Payments", "payment", {{"order_id", NUMBER_ORDERS - 1 - i}});
+    }
+    for (int i = 0; i < NUMBER_ORDERS; ++i)
+    {
+        REQUIRE(join.isEnabled());
+        net->triggerTransition("Join");
+    }
+    REQUIRE_FALSE(join.isEnabled());
+    REQUIRE(net->getMarking()["marking"] ==
+            nlohmann::json{{"Orders", 1}, {"Payments", 2}, {"Shipments", NUMBER_ORDERS + 1}});
+
+    // invalid join keys
+    {
+        nlohmann::json configJson;
+        std::ifstream("test/petri_net/config/join_by_key.json") >> configJson;
+        auto& arcConfigs = configJson["petri_net"]["transitions"][0]["transition_arcs"];
+
+        arcConfigs[0]["join_key"] = "order.";
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+        arcConfigs[0]["join_key"] = "order.id";
+        arcConfigs[0]["token_guard"] = "true";
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+        arcConfigs[0].erase("token_guard");
+        arcConfigs[2]["join_key"] = "order.id"; // output arc
+        REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+    }
+}
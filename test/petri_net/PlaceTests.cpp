@@ -18,10 +18,14 @@
 #include <behavior_net/Types.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <behavior_net/ActionRegistry.hpp>
 #include <behavior_net/Common.hpp>
+#include <behavior_net/Config.hpp>
 #include <behavior_net/Place.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <fstream>
 #include <string_view>
 #include <thread>
 
@@ -97,3 +101,238 @@ TEST_CASE("A place can have tokens, execute action on them, and get those consum
 
     REQUIRE_BNET_THROW_AS(place->consumeToken(), ExceptionType::LOGIC_ERROR); // no tokens to consume
 }
+
+namespace
+{
+/// @brief batch action keeping the last token of its first batch in progress
+class CountingBatchAction : public IActionImpl
+{
+public:
+    inline static std::atomic<uint32_t> numberBatches{0U};
+    inline static std::atomic<size_t> lastBatchSize{0U};
+
+    CountingBatchAction(nlohmann::json const) {}
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr) override
+    {
+        return [] { return ActionExecutionStatus(ActionExecutionStatus::ERROR); }; // not used for batch actions
+    }
+
+    bool supportsBatches() const override { return true; }
+
+    std::function<std::vector<ActionExecutionStatus>()>
+    createBatchCallable(std::vector<Token::ConstSharedPtr> const& tokens) override
+    {
+        const auto numberTokens = tokens.size();
+        return [numberTokens] {
+            const bool firstBatch = numberBatches.fetch_add(1U) == 0U;
+            lastBatchSize.store(numberTokens);
+            std::vector<ActionExecutionStatus> results(numberTokens, ActionExecutionStatus::SUCCESS);
+            if (firstBatch)
+            {
+                results.back() = ActionExecutionStatus::IN_PROGRESS;
+            }
+            return results;
+        };
+    }
+};
+REGISTER_ACTION_TYPE(CountingBatchAction);
+
+/// @brief action which only returns once cancelled
+class HangingAction : public IActionImpl
+{
+public:
+    HangingAction(nlohmann::json const) {}
+
+    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr) override
+    {
+        return [] { return ActionExecutionStatus(ActionExecutionStatus::IN_PROGRESS); };
+    }
+
+    std::function<ActionExecutionStatus()> createCancellableCallable(Token::ConstSharedPtr,
+                                                                     CancellationToken const& cancellation) override
+    {
+        return [cancellation] {
+            while (!cancellation.isCancelled())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return ActionExecutionStatus(ActionExecutionStatus::SUCCESS);
+        };
+    }
+};
+REGISTER_ACTION_TYPE(HangingAction);
+} // namespace
+
+TEST_CASE("A place executes batch actions on all its busy tokens in one task", "[PetriNet/Place]")
+{
+    ThreadPool tp;
+    Place place(nlohmann::json{{"place_id", "A"}});
+    place.setAssociatedAction(tp, "CountingBatchAction", nlohmann::json::object());
+
+    constexpr uint32_t NUMBER_TOKENS = 5U;
+    for (uint32_t i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        place.insertToken(Token::makeShared());
+    }
+
+    constexpr auto epochDuration = std::chrono::milliseconds(50);
+    place.executeActionAsync();
+    std::this_thread::sleep_for(epochDuration);
+    REQUIRE(place.checkActionResults() == NUMBER_TOKENS - 1U);
+    REQUIRE(CountingBatchAction::numberBatches.load() == 1U);
+    REQUIRE(CountingBatchAction::lastBatchSize.load() == NUMBER_TOKENS);
+    REQUIRE(place.getNumberTokensBusy() == 1U);
+
+    place.executeActionAsync();
+    std::this_thread::sleep_for(epochDuration);
+    REQUIRE(place.checkActionResults() == 1U);
+    REQUIRE(CountingBatchAction::numberBatches.load() == 2U);
+    REQUIRE(CountingBatchAction::lastBatchSize.load() == 1U);
+    REQUIRE(place.getNumberTokensAvailable() == NUMBER_TOKENS);
+
+    // the timer action has an optional batch mode
+    Place timerPlace(nlohmann::json{{"place_id", "B"}});
+    timerPlace.setAssociatedAction(tp, "TimerAction", nlohmann::json{{"duration_ms", 10}, {"batch", true}});
+    for (uint32_t i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        timerPlace.insertToken(Token::makeShared());
+    }
+    for (uint32_t epoch = 0; epoch < 2U; ++epoch)
+    {
+        timerPlace.executeActionAsync();
+        std::this_thread::sleep_for(epochDuration);
+        timerPlace.checkActionResults();
+    }
+    REQUIRE(timerPlace.getNumberTokensAvailable() == NUMBER_TOKENS);
+}
+
+TEST_CASE("Action executions time out and free their worker", "[PetriNet/Place]")
+{
+    ThreadPool tp(1);
+    Place place(nlohmann::json{{"place_id", "A"}});
+    place.setAssociatedAction(tp, "HangingAction", nlohmann::json::object(), std::nullopt,
+                              Action::Options{.timeout = std::chrono::milliseconds(30)});
+    place.insertToken(Token::makeShared()); // hangs in the only worker
+    place.insertToken(Token::makeShared()); // queued behind it
+
+    place.executeActionAsync();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    REQUIRE(place.checkActionResults() == 0U);
+    REQUIRE(place.getAction()->getNumberDelayedTasks() == 2U);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    place.executeActionAsync();
+    REQUIRE(place.checkActionResults() == 2U);
+    REQUIRE(place.getNumberTokensBusy() == 0U);
+    REQUIRE(place.getAction()->getNumberDelayedTasks() == 0U);
+    std::vector<Token::SharedPtr> consumed;
+    place.consumeTokens(2U, 1U << ActionExecutionStatus::ERROR, consumed);
+
+    // the cancelled execution returns, and the queued one is skipped
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (place.getAction()->getNumberExpiredTasks() > 0U && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        place.executeActionAsync();
+        place.checkActionResults();
+    }
+    REQUIRE(place.getAction()->getNumberExpiredTasks() == 0U);
+
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+    configJson["controller"]["actions"][0]["timeout_ms"] = 100;
+    std::ignore = NetConfig::fromJson(configJson);
+    REQUIRE(Action::Options::fromConfig(configJson["controller"]["actions"][0]).timeout ==
+            std::chrono::milliseconds(100));
+    configJson["controller"]["actions"][0]["timeout_ms"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
+
+TEST_CASE("A place with capacity rejects tokens when full", "[PetriNet/Place]")
+{
+    Place place(nlohmann::json{{"place_id", "A"}, {"capacity", 2}});
+    REQUIRE(place.getCapacity() == 2U);
+    REQUIRE(place.hasCapacityFor(2U));
+    REQUIRE_FALSE(place.hasCapacityFor(3U));
+
+    place.insertToken(Token::makeShared());
+    place.insertToken(Token::makeShared());
+    REQUIRE_FALSE(place.hasCapacityFor(1U));
+    REQUIRE_THROWS_AS(place.insertToken(Token::makeShared()), Exception);
+    REQUIRE(place.getNumberTokensTotal() == 2U);
+
+    place.consumeToken();
+    REQUIRE(place.hasCapacityFor(1U));
+    place.insertToken(Token::makeShared());
+    REQUIRE(place.getNumberTokensAvailable() == 2U);
+
+    // large capacities are enforced, not preallocated
+    auto config = readJSONFile("test/petri_net/config/timer_place.json");
+    config["places"][0]["capacity"] = Place::MAX_CAPACITY;
+    auto places = Place::Factory::createPlaces(config);
+    ThreadPool tp;
+    Place::Factory::createActions(tp, config["actions"], places);
+    places.at("A")->insertToken(Token::makeShared());
+    REQUIRE(places.at("A")->getTokensBusy().capacity() == Place::MAX_RESERVED_TOKENS);
+}
+
+TEST_CASE("A place preallocates its reserved token storage on its first token", "[PetriNet/Place]")
+{
+    auto config = readJSONFile("test/petri_net/config/timer_place.json");
+    config["places"][0]["reserved_tokens"] = 16;
+    auto places = Place::Factory::createPlaces(config);
+    ThreadPool tp;
+    Place::Factory::createActions(tp, config["actions"], places);
+
+    auto place = places.at("A");
+    REQUIRE(place->getTokensBusy().capacity() == 0U);
+    for (int i = 0; i < 16; ++i)
+    {
+        place->insertToken(Token::makeShared());
+        REQUIRE(place->getTokensBusy().capacity() == 16U); // no growth reallocation
+    }
+    place->insertToken(Token::makeShared());
+    REQUIRE(place->getTokensBusy().capacity() > 16U); // a size hint, not a capacity
+}
+
+TEST_CASE("A place can consume several tokens at once", "[PetriNet/Place]")
+{
+    Place place(nlohmann::json{{"place_id", "A"}});
+    std::vector<Token::SharedPtr> inserted;
+    for (int i = 0; i < 5; ++i)
+    {
+        inserted.push_back(Token::makeShared());
+        place.insertToken(inserted.back());
+    }
+
+    std::vector<Token::SharedPtr> consumed;
+    place.consumeTokens(3U, 0U, consumed);
+    place.consumeTokens(1U, 1U << ActionExecutionStatus::SUCCESS, consumed); // passive places tokens are SUCCESS
+    REQUIRE(consumed == std::vector<Token::SharedPtr>(inserted.begin(), inserted.begin() + 4));
+    REQUIRE(place.getNumberTokensAvailable() == 1U);
+
+    REQUIRE_BNET_THROW_AS(place.consumeTokens(2U, 0U, consumed), ExceptionType::LOGIC_ERROR);
+    REQUIRE_BNET_THROW_AS(place.consumeTokens(1U, 1U << ActionExecutionStatus::FAILURE, consumed),
+                          ExceptionType::LOGIC_ERROR);
+    REQUIRE(consumed.size() == 4U);
+}
+
+TEST_CASE("A place hands out tokens by its token selection policy", "[PetriNet/Place]")
+{
+    Place place(
+        nlohmann::json{{"place_id", "A"}, {"token_selection", {{"policy", "priority"}, {"key", "order.priority"}}}});
+    REQUIRE(place.getTokenSelectionPolicy() == +TokenSelectionPolicy::PRIORITY);
+
+    std::vector<Token::SharedPtr> tokens;
+    for (int priority : {1, 3, 2})
+    {
+        tokens.push_back(Token::makeShared());
+        tokens.back()->addContentBlock("order", {{"priority", priority}});
+        place.insertToken(tokens.back());
+    }
+
+    std::vector<Token::SharedPtr> consumed;
+    place.consumeTokens(3U, 0U, consumed);
+    REQUIRE(consumed == std::vector<Token::SharedPtr>{tokens[1], tokens[2], tokens[0]});
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/analysis/Reachability.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <fstream>
+
+using namespace capybot::bnet;
+
+namespace
+{
+NetStructure::Transition transition(std::string id, std::vector<uint32_t> inputs, std::vector<uint32_t> outputs)
+{
+    NetStructure::Transition t{.id = std::move(id), .isManual = false};
+    for (auto&& p : inputs)
+        t.inputArcs.push_back({.place = p, .weight = 1U});
+    for (auto&& p : outputs)
+        t.outputArcs.push_back({.place = p, .weight = 1U});
+    return t;
+}
+} // namespace
+
+TEST_CASE("MarkingStore deduplicates markings and keeps their parents.", "[PetriNet/Reachability]")
+{
+    MarkingStore store(3U, 10U, 4U);
+
+    const std::vector<uint32_t> m0{1U, 0U, 0U};
+    const std::vector<uint32_t> m1{0U, 1U, 0U};
+    const auto [id0, inserted0] = store.insert(m0.data(), MarkingStore::INVALID_STATE, 0U);
+    const auto [id1, inserted1] = store.insert(m1.data(), id0, 7U);
+    const auto [id2, inserted2] = store.insert(m1.data(), id0, 3U);
+
+    REQUIRE(inserted0);
+    REQUIRE(inserted1);
+    REQUIRE_FALSE(inserted2);
+    REQUIRE(id1 == id2);
+    REQUIRE(store.size() == 2U);
+    REQUIRE(std::equal(m1.begin(), m1.end(), store.getMarking(id1)));
+    REQUIRE(store.getParent(id1) == id0);
+    REQUIRE(store.getParent(id0) == MarkingStore::INVALID_STATE);
+    REQUIRE(store.getTransition(id1) == 7U);
+}
+
+TEST_CASE("MarkingStore keeps markings across its growing chunks.", "[PetriNet/Reachability]")
+{
+    constexpr uint32_t NUMBER_MARKINGS{1000U}; // several chunks per shard
+    MarkingStore store(2U, NUMBER_MARKINGS, 2U);
+
+    std::vector<MarkingStore::StateId> ids;
+    for (uint32_t i = 0U; i < NUMBER_MARKINGS; ++i)
+    {
+        const std::vector<uint32_t> marking{i, 2U * i};
+        const auto parent = ids.empty() ? MarkingStore::INVALID_STATE : ids.back();
+        const auto [id, inserted] = store.insert(marking.data(), parent, i);
+        REQUIRE(inserted);
+        ids.push_back(id);
+    }
+    const std::vector<uint32_t> overflow{NUMBER_MARKINGS, 0U};
+    REQUIRE(store.insert(overflow.data(), ids.back(), 0U).first == MarkingStore::INVALID_STATE);
+
+    for (uint32_t i = 0U; i < NUMBER_MARKINGS; ++i)
+    {
+        REQUIRE(store.getMarking(ids[i])[0] == i);
+        REQUIRE(store.getMarking(ids[i])[1] == 2U * i);
+        REQUIRE(store.getTransition(ids[i]) == i);
+        REQUIRE(store.getParent(ids[i]) == (i == 0U ? MarkingStore::INVALID_STATE : ids[i - 1U]));
+    }
+}
+
+TEST_CASE("Reachability analysis reports deadlocks with their firing sequence.", "[PetriNet/Reachability]")
+{
+    // A -T1-> B; T2: B + C -> A, but C is never marked
+    NetStructure net;
+    net.placeIds = {"A", "B", "C"};
+    net.transitions = {transition("T1", {0U}, {1U}), transition("T2", {1U, 2U}, {0U})};
+
+    SECTION("deadlock")
+    {
+        const auto result = ReachabilityAnalyzer(net, {.numberThreads = 2U}).analyze({1U, 0U, 0U});
+        REQUIRE(result.complete);
+        REQUIRE(result.statesExplored == 2U);
+        REQUIRE(result.numberDeadlocks == 1U);
+        REQUIRE(result.deadlocks.size() == 1U);
+        REQUIRE(result.deadlocks[0].marking == nlohmann::json{{"B", 1}});
+        REQUIRE(result.deadlocks[0].firingSequence == std::vector<std::string>{"T1"});
+        REQUIRE(result.deadTransitions == std::vector<std::string>{"T2"});
+        REQUIRE(result.unboundedPlaces.empty());
+    }
+
+    SECTION("terminal places are not deadlocks")
+    {
+        const auto result =
+            ReachabilityAnalyzer(net, {.numberThreads = 2U, .terminalPlaces = {"B"}}).analyze({1U, 0U, 0U});
+        REQUIRE(result.numberDeadlocks == 0U);
+    }
+
+    SECTION("invalid initial marking")
+    {
+        REQUIRE_THROWS_AS(ReachabilityAnalyzer(net, {}).analyze({1U}), Exception);
+    }
+}
+
+TEST_CASE("Reachability analysis detects unbounded places.", "[PetriNet/Reachability]")
+{
+    // T1: A -> A + B; T2: B -> C
+    NetStructure net;
+    net.placeIds = {"A", "B", "C"};
+    net.transitions = {transition("T1", {0U}, {0U, 1U}), transition("T2", {1U}, {2U})};
+
+    const auto result = ReachabilityAnalyzer(net, {.numberThreads = 4U}).analyze({1U, 0U, 0U});
+    REQUIRE(result.complete);
+    REQUIRE(result.unboundedPlaces == std::vector<std::string>{"B", "C"});
+    REQUIRE(result.deadTransitions.empty());
+    REQUIRE(result.numberDeadlocks == 0U);
+}
+
+TEST_CASE("Reachability analysis stops at the maximum number of states.", "[PetriNet/Reachability]")
+{
+    NetStructure net;
+    net.placeIds = {"A", "B"};
+    net.transitions = {transition("T1", {0U}, {1U})};
+
+    const auto full = ReachabilityAnalyzer(net, {.numberThreads = 2U}).analyze({1000U, 0U});
+    REQUIRE(full.complete);
+    REQUIRE(full.statesExplored == 1001U);
+
+    const auto partial = ReachabilityAnalyzer(net, {.maxStates = 100U, .numberThreads = 2U}).analyze({1000U, 0U});
+    REQUIRE_FALSE(partial.complete);
+    REQUIRE(partial.statesExplored == 100U);
+}
+
+TEST_CASE("Parallel reachability analysis is deterministic.", "[PetriNet/Reachability]")
+{
+    // independent two-state cycles (2^N states); one extra transition leads to a deadlock
+    constexpr uint32_t N{12U};
+    NetStructure net;
+    std::vector<uint32_t> initialMarking;
+    for (uint32_t i = 0U; i < N; ++i)
+    {
+        net.placeIds.push_back("A" + std::to_string(i));
+        net.placeIds.push_back("B" + std::to_string(i));
+        net.transitions.push_back(transition("T" + std::to_string(i) + "_ab", {2U * i}, {2U * i + 1U}));
+        net.transitions.push_back(transition("T" + std::to_string(i) + "_ba", {2U * i + 1U}, {2U * i}));
+        initialMarking.insert(initialMarking.end(), {1U, 0U});
+    }
+
+    const auto sequential = ReachabilityAnalyzer(net, {.numberThreads = 1U}).analyze(initialMarking);
+    const auto parallel = ReachabilityAnalyzer(net, {.numberThreads = 8U}).analyze(initialMarking);
+    REQUIRE(sequential.statesExplored == (1U << N));
+    REQUIRE(sequential.toJson() == parallel.toJson());
+}
+
+TEST_CASE("Reachability analysis from a net config.", "[PetriNet/Reachability]")
+{
+    nlohmann::json configJson;
+    std::ifstream("test/petri_net/config/event_trace.json") >> configJson;
+    configJson["initial_marking"] = {{{"place_id", "A"}, {"number_tokens", 1}}};
+    const auto config = NetConfig::fromJson(configJson);
+
+    const auto net = NetStructure::fromConfig(config.get());
+    REQUIRE(net.placeIds.size() == 5U);
+    REQUIRE(net.transitions.size() == 4U);
+    REQUIRE(net.transitions[3].isManual);
+
+    // action results are abstracted away: the token can end in either C or D
+    const auto result = ReachabilityAnalyzer(net, {.numberThreads = 2U}).analyze(net.getInitialMarking(config.get()));
+    REQUIRE(result.numberDeadlocks == 2U);
+    REQUIRE(result.deadTransitions == std::vector<std::string>{"T4"});
+
+    const ReachabilityAnalyzer::Options terminalOptions{
+        .numberThreads = 2U, .includeManualTransitions = false, .terminalPlaces = {"C", "D"}};
+    const auto withTerminals = ReachabilityAnalyzer(net, terminalOptions).analyze(net.getInitialMarking(config.get()));
+    REQUIRE(withTerminals.numberDeadlocks == 0U);
+    REQUIRE(withTerminals.deadTransitions.empty());
+}
+
+TEST_CASE("Reachability analysis honors place capacities.", "[PetriNet/Reachability]")
+{
+    const auto config = NetConfig("test/petri_net/config/place_capacity.json");
+    const auto net = NetStructure::fromConfig(config.get());
+    REQUIRE(net.getCapacity(1U) == 1U);
+
+    // the config has no initial marking, which is not taken as an empty one
+    REQUIRE_BNET_THROW_AS(net.getInitialMarking(config.get()), ExceptionType::INVALID_VALUE);
+    const auto initialMarking = net.getMarking(nlohmann::json{{{"place_id", "A"}, {"number_tokens", 5}}});
+    REQUIRE(initialMarking == std::vector<uint32_t>{5U, 0U, 0U});
+
+    // A -T1-> B(1) -T2-> C(2): at most 3 tokens leave A
+    const auto result = ReachabilityAnalyzer(net, {.numberThreads = 2U}).analyze(initialMarking);
+    REQUIRE(result.complete);
+    REQUIRE(result.unboundedPlaces.empty());
+    REQUIRE(result.numberDeadlocks == 1U);
+    REQUIRE(result.deadlocks[0].marking == nlohmann::json{{"A", 2}, {"B", 1}, {"C", 2}});
+}
+
+TEST_CASE("Reachability analysis handles weighted and inhibitor arcs.", "[PetriNet/Reachability]")
+{
+    const auto config = NetConfig("test/petri_net/config/weighted_inhibitor_arcs.json");
+    const auto net = NetStructure::fromConfig(config.get());
+    REQUIRE(net.transitions[0].inputArcs[0].weight == 2U);
+    REQUIRE(net.transitions[0].inhibitorArcs.size() == 1U);
+
+    const auto result = ReachabilityAnalyzer(net, {.numberThreads = 2U}).analyze({5U, 0U, 0U, 1U});
+    REQUIRE(result.complete);
+    // T1 only fires after T2 removed the lock: A = 5 -> 3 -> 1
+    REQUIRE(result.statesExplored == 4U);
+    REQUIRE(result.deadlocks.at(0).marking == nlohmann::json{{"A", 1}, {"B", 2}, {"C", 6}});
+    REQUIRE(result.deadlocks.at(0).firingSequence == std::vector<std::string>{"T2", "T1", "T1"});
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/PetriNet.hpp>
+#include <behavior_net/ShardedTransitionScheduler.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace capybot::bnet;
+
+namespace
+{
+/// @return net with `numberLines` independent lines `L<i>_P0 -> ... -> L<i>_P<lineLength - 1>` and one manual
+/// transition per line feeding it from `L<i>_In`
+nlohmann::json createLinesConfig(uint32_t numberLines, uint32_t lineLength, std::optional<uint32_t> numberShards)
+{
+    nlohmann::json places = nlohmann::json::array();
+    nlohmann::json transitions = nlohmann::json::array();
+    const auto arc = [](std::string const& placeId, std::string const& type) {
+        return nlohmann::json{{"place_id", placeId}, {"type", type}};
+    };
+    for (uint32_t line = 0U; line < numberLines; ++line)
+    {
+        const auto prefix = "L" + std::to_string(line) + "_";
+        places.push_back({{"place_id", prefix + "In"}});
+        transitions.push_back({{"transition_id", prefix + "Feed"},
+                               {"transition_type", "manual"},
+                               {"transition_arcs", {arc(prefix + "In", "input"), arc(prefix + "P0", "output")}}});
+        for (uint32_t i = 0U; i < lineLength; ++i)
+        {
+            places.push_back({{"place_id", prefix + "P" + std::to_string(i)}});
+            if (i + 1U < lineLength)
+            {
+                transitions.push_back({{"transition_id", prefix + "T" + std::to_string(i)},
+                                       {"transition_type", "auto"},
+                                       {"transition_arcs",
+                                        {arc(prefix + "P" + std::to_string(i), "input"),
+                                         arc(prefix + "P" + std::to_string(i + 1U), "output")}}});
+            }
+        }
+    }
+
+    nlohmann::json config{{"petri_net", {{"places", places}, {"transitions", transitions}}},
+                          {"controller", {{"epoch_period_ms", 1}}}};
+    if (numberShards.has_value())
+    {
+        config["controller"]["sharding"]["number_shards"] = numberShards.value();
+    }
+    return config;
+}
+
+std::set<std::string> getThreadIds()
+{
+    std::set<std::string> ids;
+    for (auto&& entry : std::filesystem::directory_iterator("/proc/self/task"))
+    {
+        ids.insert(entry.path().filename().string());
+    }
+    return ids;
+}
+
+/// @return the `Cpus_allowed_list` of a thread of this process, e.g., "0-3"
+std::string getThreadCpuList(std::string const& threadId)
+{
+    std::ifstream status("/proc/self/task/" + threadId + "/status");
+    const std::string prefix{"Cpus_allowed_list:"};
+    for (std::string line; std::getline(status, line);)
+    {
+        if (line.rfind(prefix, 0U) == 0U)
+        {
+            return line.substr(line.find_first_not_of(" \t", prefix.size()));
+        }
+    }
+    return "";
+}
+} // namespace
+
+TEST_CASE("Independent parts of the net are found as connected components.", "[PetriNet/ShardedTransitionScheduler]")
+{
+    const auto config = NetConfig::fromJson(createLinesConfig(5U, 4U, 3U));
+    auto net = PetriNet::create(config);
+
+    const auto components = ShardedTransitionScheduler::findComponents(net->getTransitions());
+    REQUIRE(components.size() == 5U);
+    for (auto&& component : components)
+    {
+        REQUIRE(component.size() == 4U); // one manual and three auto transitions
+    }
+
+    ShardedTransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+    REQUIRE(scheduler.getNumberComponents() == 5U);
+    REQUIRE(scheduler.getNumberShards() == 3U);
+
+    // at most one shard per component
+    const auto singleLineConfig = NetConfig::fromJson(createLinesConfig(1U, 4U, 8U));
+    auto singleLineNet = PetriNet::create(singleLineConfig);
+    ShardedTransitionScheduler singleLineScheduler(singleLineNet->getTransitions(),
+                                                   singleLineConfig.get().at("controller"));
+    REQUIRE(singleLineScheduler.getNumberShards() == 1U);
+}
+
+TEST_CASE("Sharded nets fire the same transitions as unsharded ones.", "[PetriNet/ShardedTransitionScheduler]")
+{
+    constexpr uint32_t NUMBER_LINES{16U};
+    constexpr uint32_t LINE_LENGTH{8U};
+
+    const auto config = NetConfig::fromJson(createLinesConfig(NUMBER_LINES, LINE_LENGTH, std::nullopt));
+    auto net = PetriNet::create(config);
+    TransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+
+    const auto shardedConfig = NetConfig::fromJson(createLinesConfig(NUMBER_LINES, LINE_LENGTH, 4U));
+    auto shardedNet = PetriNet::create(shardedConfig);
+    ShardedTransitionScheduler shardedScheduler(shardedNet->getTransitions(), shardedConfig.get().at("controller"));
+    REQUIRE(shardedScheduler.getNumberShards() == 4U);
+
+    const auto toIds = [](std::vector<Transition const*> const& transitions) {
+        std::vector<std::string> ids;
+        for (auto&& t : transitions)
+        {
+            ids.push_back(t->getId());
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    std::vector<Transition const*> fired;
+    std::vector<Transition const*> shardedFired;
+    for (uint32_t epoch = 0U; epoch < 2U * LINE_LENGTH; ++epoch)
+    {
+        for (uint32_t line = epoch % 3U; line < NUMBER_LINES; line += 3U)
+        {
+            const auto placeId = "L" + std::to_string(line) + "_P0";
+            auto token = Token::makeUnique();
+            net->addToken(token, placeId);
+            token = Token::makeUnique();
+            shardedNet->addToken(token, placeId);
+        }
+        scheduler.fireEnabled(fired);
+        shardedScheduler.fireEnabled(shardedFired);
+        REQUIRE(toIds(fired) == toIds(shardedFired));
+        REQUIRE(net->getMarking().at("marking") == shardedNet->getMarking().at("marking"));
+    }
+}
+
+TEST_CASE("Invalid sharding configs are rejected.", "[PetriNet/ShardedTransitionScheduler]")
+{
+    auto configJson = createLinesConfig(2U, 2U, 0U);
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    configJson = createLinesConfig(2U, 2U, 2U);
+    configJson["petri_net"]["subnets"] = nlohmann::json::array();
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
+
+TEST_CASE("Shard workers are pinned to their configured cores.", "[PetriNet/ShardedTransitionScheduler]")
+{
+    auto configJson = createLinesConfig(4U, 2U, 4U);
+    configJson["controller"]["cpu_affinity"] = {{"shard_workers", {{"cpus", "0"}}}};
+    const auto config = NetConfig::fromJson(configJson);
+    auto net = PetriNet::create(config);
+
+    const auto threadsBefore = getThreadIds();
+    ShardedTransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+    REQUIRE(scheduler.getNumberShards() == 4U);
+
+    std::vector<std::string> workers;
+    for (auto&& id : getThreadIds())
+    {
+        if (threadsBefore.count(id) == 0U)
+        {
+            workers.push_back(id);
+        }
+    }
+    REQUIRE(workers.size() == 3U); // the first shard fires on the calling thread
+
+    // pinned once started
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    const auto isPinned = [](std::string const& id) { return getThreadCpuList(id) == "0"; };
+    while (!std::all_of(workers.begin(), workers.end(), isPinned) && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(std::all_of(workers.begin(), workers.end(), isPinned));
+
+    configJson["controller"]["cpu_affinity"] = {{"shard_workers", {{"cpus", "0-"}}}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/ActionRegistry.hpp>
+#include <behavior_net/Place.hpp>
+#include <behavior_net/action_impl/ShellAction.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+using namespace capybot::bnet;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// @brief stub worker; answers with the `result` of the token content, or exits if the result is `crash`
+constexpr const char* STUB_WORKER_COMMAND =
+    "echo 'stub worker started'; "
+    "while read -r id content; do "
+    "  case \"$content\" in "
+    "    *crash*) exit 1 ;; "
+    "    *hang*) sleep 5 ;; "
+    "    *FAILURE*) echo \"$id FAILURE\" ;; "
+    "    *) echo \"$id SUCCESS\" ;; "
+    "  esac; "
+    "done";
+
+Token::SharedPtr makeToken(std::string const& result)
+{
+    auto token = Token::makeShared();
+    token->addContentBlock("stub", {{"result", result}});
+    return token;
+}
+
+ActionExecutionStatus execute(IActionImpl& action, Token::ConstSharedPtr const& token)
+{
+    return action.createCallable(token)();
+}
+} // namespace
+
+TEST_CASE("Shell actions reuse their worker subprocesses.", "[PetriNet/ShellAction]")
+{
+    ShellAction action(nlohmann::json{{"command", STUB_WORKER_COMMAND}, {"number_workers", 2}});
+    REQUIRE(action.performsBlockingIo());
+
+    REQUIRE(execute(action, makeToken("SUCCESS")) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(execute(action, makeToken("FAILURE")) == +ActionExecutionStatus::FAILURE);
+    REQUIRE(action.getNumberWorkersStarted() == 1U);
+
+    // concurrent requests use the whole pool
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> numberSucceeded{0U};
+    for (uint32_t i = 0; i < 8U; ++i)
+    {
+        threads.emplace_back([&] {
+            if (execute(action, makeToken("SUCCESS")) == +ActionExecutionStatus::SUCCESS)
+            {
+                ++numberSucceeded;
+            }
+        });
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(numberSucceeded.load() == 8U);
+    REQUIRE(action.getNumberWorkersStarted() <= 2U);
+}
+
+TEST_CASE("Shell action workers are restarted after crashing or timing out.", "[PetriNet/ShellAction]")
+{
+    ShellAction action(
+        nlohmann::json{{"command", STUB_WORKER_COMMAND}, {"number_workers", 1}, {"response_timeout_ms", 100}});
+
+    REQUIRE(execute(action, makeToken("crash")) == +ActionExecutionStatus::ERROR);
+    REQUIRE(execute(action, makeToken("SUCCESS")) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(action.getNumberWorkersStarted() == 2U);
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(execute(action, makeToken("hang")) == +ActionExecutionStatus::ERROR);
+    REQUIRE(std::chrono::steady_clock::now() - start < 2s);
+    REQUIRE(execute(action, makeToken("FAILURE")) == +ActionExecutionStatus::FAILURE);
+    REQUIRE(action.getNumberWorkersStarted() == 3U);
+
+    // cancelled requests end early too
+    const auto cancellation = CancellationToken::create();
+    cancellation.cancel();
+    REQUIRE(action.createCancellableCallable(makeToken("hang"), cancellation)() == +ActionExecutionStatus::ERROR);
+
+    ShellAction missingProgram(nlohmann::json{{"command", "/nonexistent/worker"}, {"number_workers", 1}});
+    REQUIRE(execute(missingProgram, makeToken("SUCCESS")) == +ActionExecutionStatus::ERROR);
+}
+
+TEST_CASE("Shell action requests queued for a worker do not time out its response.", "[PetriNet/ShellAction]")
+{
+    // each response takes ~30ms; the last of the queued requests waits longer than the response timeout
+    const std::string command{"while read -r id content; do sleep 0.03; echo \"$id SUCCESS\"; done"};
+    ShellAction action(nlohmann::json{{"command", command},
+                                      {"number_workers", 1},
+                                      {"response_timeout_ms", 150}});
+
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> numberSucceeded{0U};
+    for (uint32_t i = 0; i < 8U; ++i)
+    {
+        threads.emplace_back([&] {
+            if (execute(action, makeToken("SUCCESS")) == +ActionExecutionStatus::SUCCESS)
+            {
+                ++numberSucceeded;
+            }
+        });
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+    // requests waiting too long for the worker fail without killing it
+    REQUIRE(numberSucceeded.load() >= 2U);
+    REQUIRE(action.getNumberWorkersStarted() == 1U);
+
+    // cancelled requests stop waiting for the worker
+    std::thread busy([&action] { std::ignore = execute(action, makeToken("SUCCESS")); });
+    std::this_thread::sleep_for(5ms);
+    const auto cancellation = CancellationToken::create();
+    cancellation.cancel();
+    REQUIRE(action.createCancellableCallable(makeToken("SUCCESS"), cancellation)() == +ActionExecutionStatus::ERROR);
+    busy.join();
+    REQUIRE(action.getNumberWorkersStarted() == 1U);
+}
+
+TEST_CASE("Shell action requests time out on workers which stop reading their requests.", "[PetriNet/ShellAction]")
+{
+    const auto start = std::chrono::steady_clock::now();
+    {
+        ShellAction action(
+            nlohmann::json{{"command", "sleep 30"}, {"number_workers", 1}, {"response_timeout_ms", 200}});
+        auto token = makeToken("SUCCESS");
+        token->addContentBlock("payload", {{"data", std::string(4U << 20U, 'x')}}); // larger than the socket buffer
+        REQUIRE(execute(action, token) == +ActionExecutionStatus::ERROR);
+
+        const auto cancellation = CancellationToken::create();
+        cancellation.cancel();
+        REQUIRE(action.createCancellableCallable(token, cancellation)() == +ActionExecutionStatus::ERROR);
+    }
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s); // incl. stopping the worker
+}
+
+TEST_CASE("Stopped shell action workers take the programs they started along.", "[PetriNet/ShellAction]")
+{
+    const auto marker = "/tmp/shell_action_test_" + std::to_string(::getpid());
+    {
+        ShellAction action(nlohmann::json{{"command", "while read -r id content; do (sleep 0.3; touch " + marker +
+                                                          ") & echo \"$id SUCCESS\"; done"},
+                                          {"number_workers", 1}});
+        REQUIRE(execute(action, makeToken("SUCCESS")) == +ActionExecutionStatus::SUCCESS);
+    }
+    std::this_thread::sleep_for(500ms);
+    REQUIRE_FALSE(std::filesystem::exists(marker));
+}
+
+TEST_CASE("Shell actions run token content through the place actions.", "[PetriNet/ShellAction]")
+{
+    ThreadPool tp(2);
+    Place place(nlohmann::json{{"place_id", "A"}});
+    place.setAssociatedAction(tp, "ShellAction", nlohmann::json{{"command", STUB_WORKER_COMMAND}});
+    REQUIRE(place.getAction()->getLane() == ThreadPool::BLOCKING_IO_LANE);
+
+    place.insertToken(makeToken("SUCCESS"));
+    place.insertToken(makeToken("FAILURE"));
+    for (uint32_t i = 0; i < 50U && place.getNumberTokensBusy() > 0U; ++i)
+    {
+        place.executeActionAsync();
+        std::this_thread::sleep_for(20ms);
+        place.checkActionResults();
+    }
+    REQUIRE(place.getNumberTokensAvailable(ActionExecutionStatusSet{1U << ActionExecutionStatus::SUCCESS}) == 1U);
+    REQUIRE(place.getNumberTokensAvailable(ActionExecutionStatusSet{1U << ActionExecutionStatus::FAILURE}) == 1U);
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/PetriNet.hpp>
+#include <behavior_net/Subnet.hpp>
+#include <behavior_net/TransitionScheduler.hpp>
+#include <behavior_net/analysis/NetStructure.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <fstream>
+
+using namespace capybot::bnet;
+
+namespace
+{
+nlohmann::json readWorkcellsConfig()
+{
+    nlohmann::json configJson;
+    std::ifstream("test/petri_net/config/subnet_workcells.json") >> configJson;
+    return configJson;
+}
+} // namespace
+
+TEST_CASE("Subnet instances are instantiated on their first token.", "[PetriNet/Subnet]")
+{
+    const auto config = NetConfig::fromJson(readWorkcellsConfig());
+    auto net = PetriNet::create(config);
+    TransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+    std::vector<Transition const*> fired;
+
+    // only the places connected to the net exist
+    REQUIRE(net->getSubnets().size() == 3U);
+    REQUIRE(net->getPlaces().size() == 4U);
+    REQUIRE(net->getPlaces().count("cell_0/Queue") == 1U);
+    REQUIRE(net->getPlaces().count("cell_0/Working") == 0U);
+    REQUIRE(net->getTransitions().size() == 2U);
+    for (auto&& [_, subnet] : net->getSubnets())
+    {
+        REQUIRE_FALSE(subnet.isInstantiated());
+    }
+
+    // through a net transition
+    auto token = Token::makeUnique();
+    net->addToken(token, "Jobs");
+    net->triggerTransition("Dispatch", true);
+    REQUIRE(net->getSubnets().at("cell_0").isInstantiated());
+    REQUIRE(net->getPlaces().size() == 5U);
+    REQUIRE(net->getTransitions().size() == 4U);
+    REQUIRE(net->getTransitions().at(2).getId() == "cell_0/Start");
+
+    scheduler.fireEnabled(fired);
+    REQUIRE(fired.size() == 1U);
+    REQUIRE(fired.front()->getId() == "cell_0/Start");
+    net->triggerTransition("cell_0/Finish", true);
+    net->triggerTransition("Collect", true);
+    REQUIRE(net->getMarking()["marking"]["Done"] == 1);
+
+    // through an external token to any instance place
+    token = Token::makeUnique();
+    net->addToken(token, "cell_2/Queue");
+    REQUIRE(net->getSubnets().at("cell_2").isInstantiated());
+    REQUIRE_FALSE(net->getSubnets().at("cell_1").isInstantiated());
+    REQUIRE(net->getPlaces().size() == 8U);
+
+    // instances share the template but not their state
+    token = Token::makeUnique();
+    net->addToken(token, "cell_2/Queue");
+    scheduler.fireEnabled(fired);
+    REQUIRE(fired.size() == 1U);
+    REQUIRE(fired.front()->getId() == "cell_2/Start");
+    scheduler.fireEnabled(fired);
+    REQUIRE(fired.empty()); // cell_2/Working is full
+    REQUIRE(net->getMarking()["marking"]["cell_2/Queue"] == 1);
+    REQUIRE(net->getMarking()["marking"]["cell_0/Working"] == 0);
+
+    token = Token::makeUnique();
+    REQUIRE_BNET_THROW_AS(net->addToken(token, "cell_3/Queue"), ExceptionType::RUNTIME_ERROR);
+    REQUIRE_THROWS_AS(net->addToken(token, "cell_1/Unknown"), Exception);
+}
+
+TEST_CASE("Subnet instances are expanded for the offline analysis.", "[PetriNet/Subnet]")
+{
+    const auto config = NetConfig::fromJson(readWorkcellsConfig());
+    const auto expanded = expandSubnets(config.get());
+    REQUIRE_FALSE(expanded.at("petri_net").contains("subnets"));
+    REQUIRE(expanded.at("petri_net").at("transitions").at(4).at("transition_id") == "cell_1/Start");
+    REQUIRE(expanded.at("petri_net").at("transitions").at(4).at("transition_arcs").at(0).at("place_id") ==
+            "cell_1/Queue");
+
+    const auto net = NetStructure::fromConfig(config.get());
+    REQUIRE(net.placeIds.size() == 2U + 3U * 3U);
+    REQUIRE(net.transitions.size() == 2U + 3U * 2U);
+    REQUIRE(net.getCapacity(net.getPlaceIndex("cell_2/Working")) == 1U);
+}
+
+TEST_CASE("Invalid subnet configs are rejected.", "[PetriNet/Subnet]")
+{
+    std::ignore = NetConfig::fromJson(readWorkcellsConfig());
+
+    auto configJson = readWorkcellsConfig();
+    configJson["petri_net"]["subnets"][1]["template_id"] = "unknown";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    configJson = readWorkcellsConfig();
+    configJson["petri_net"]["subnets"][1]["subnet_id"] = "cell_0";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    configJson = readWorkcellsConfig();
+    configJson["petri_net"]["subnets"][1]["subnet_id"] = "cell/1";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    // template arcs only refer to template places
+    configJson = readWorkcellsConfig();
+    configJson["petri_net"]["subnet_templates"][0]["transitions"][0]["transition_arcs"][0]["place_id"] = "Jobs";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    // net arcs only refer to places of existing instances
+    configJson = readWorkcellsConfig();
+    configJson["petri_net"]["transitions"][0]["transition_arcs"][1]["place_id"] = "cell_3/Queue";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+
+    // template actions refer to template places
+    configJson = readWorkcellsConfig();
+    configJson["petri_net"]["subnet_templates"][0]["actions"] = {
+        {{"place_id", "Done"}, {"type", "TimerAction"}, {"params", {{"duration_ms", 1}}}}};
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
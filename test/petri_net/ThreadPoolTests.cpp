@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/Place.hpp>
+#include <behavior_net/ThreadPool.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <thread>
+
+using namespace capybot::bnet;
+
+namespace
+{
+ActionExecutionStatus waitForStatus(ThreadPool::Task const& task)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    auto status = task.getStatus();
+    while (status == +ActionExecutionStatus::NOT_STARTED && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        status = task.getStatus();
+    }
+    constexpr uint32_t TIMEOUT_US{1000000U};
+    return task.getStatus(TIMEOUT_US);
+}
+} // namespace
+
+TEST_CASE("Thread pool lanes have reserved workers.", "[PetriNet/ThreadPool]")
+{
+    ThreadPool tp(1);
+    const auto fastLane = tp.addLane("latency_critical", 1, {"TimerAction"});
+    REQUIRE(tp.getLane("latency_critical") == fastLane);
+    REQUIRE(tp.getLane(ThreadPool::DEFAULT_LANE_ID) == ThreadPool::DEFAULT_LANE);
+    REQUIRE(tp.getActionTypeLane("TimerAction") == fastLane);
+    REQUIRE(tp.getActionTypeLane("HttpGetAction") == ThreadPool::DEFAULT_LANE);
+    REQUIRE(tp.getNumberWorkers(fastLane) == 1U);
+    REQUIRE_BNET_THROW_AS(tp.getLane("unknown"), ExceptionType::INVALID_VALUE);
+    REQUIRE_BNET_THROW_AS(tp.addLane("latency_critical", 1), ExceptionType::INVALID_VALUE);
+    REQUIRE_BNET_THROW_AS(tp.addLane("bulk", 0), ExceptionType::INVALID_VALUE);
+
+    // the only default lane worker is blocked; tasks in other lanes still run
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    ThreadPool::Task blocking([released] {
+        released.wait();
+        return ActionExecutionStatus(ActionExecutionStatus::SUCCESS);
+    });
+    ThreadPool::Task queued([] { return ActionExecutionStatus(ActionExecutionStatus::SUCCESS); });
+    ThreadPool::Task fast([] { return ActionExecutionStatus(ActionExecutionStatus::SUCCESS); });
+    tp.executeAsync(blocking);
+    tp.executeAsync(queued);
+    tp.executeAsync(fast, fastLane);
+
+    const auto fastStatus = waitForStatus(fast);
+    const auto queuedStatus = queued.getStatus();
+    release.set_value();
+    REQUIRE(fastStatus == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(queuedStatus == +ActionExecutionStatus::NOT_STARTED);
+    REQUIRE(waitForStatus(blocking) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(waitForStatus(queued) == +ActionExecutionStatus::SUCCESS);
+}
+
+TEST_CASE("Actions are assigned to the lane of their type or config.", "[PetriNet/ThreadPool]")
+{
+    nlohmann::json config;
+    std::ifstream("test/petri_net/config/timer_place.json") >> config;
+    config["places"].push_back({{"place_id", "B"}});
+    config["actions"].push_back(
+        {{"place_id", "B"}, {"type", "TimerAction"}, {"lane", "bulk"}, {"params", {{"duration_ms", 10}}}});
+
+    ThreadPool tp(1);
+    tp.addLanes(nlohmann::json::parse(R"([
+        {"lane_id": "latency_critical", "workers": 1, "action_types": ["TimerAction"]},
+        {"lane_id": "bulk", "workers": 2}])"));
+    auto places = Place::Factory::createPlaces(config);
+    Place::Factory::createActions(tp, config["actions"], places);
+    REQUIRE(places.at("A")->getAction()->getLane() == tp.getLane("latency_critical"));
+    REQUIRE(places.at("B")->getAction()->getLane() == tp.getLane("bulk"));
+    REQUIRE(tp.getNumberWorkers(tp.getLane("bulk")) == 2U);
+
+    config["actions"][1]["lane"] = "unknown";
+    places = Place::Factory::createPlaces(config);
+    REQUIRE_BNET_THROW_AS(Place::Factory::createActions(tp, config["actions"], places), ExceptionType::INVALID_VALUE);
+}
+
+TEST_CASE("Invalid thread pool lane configs are rejected.", "[PetriNet/ThreadPool]")
+{
+    nlohmann::json configJson;
+    std::ifstream("config_samples/config.json") >> configJson;
+    std::ignore = NetConfig::fromJson(configJson);
+
+    auto invalid = configJson;
+    invalid["controller"]["thread_pool_lanes"][0]["lane_id"] = ThreadPool::DEFAULT_LANE_ID;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["thread_pool_lanes"][0]["workers"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["thread_pool_lanes"][0]["lane_id"] = ThreadPool::BLOCKING_IO_LANE_ID;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["thread_pool_lanes"].push_back(
+        {{"lane_id", "other"}, {"workers", 1}, {"action_types", {"TimerAction"}}});
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["actions"][0]["lane"] = "unknown";
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    invalid = configJson;
+    invalid["controller"]["blocking_io_pool"]["max_workers"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(invalid), Exception);
+
+    auto valid = configJson;
+    valid["controller"]["actions"][0]["lane"] = "timers";
+    valid["controller"]["actions"][1]["lane"] = ThreadPool::BLOCKING_IO_LANE_ID;
+    std::ignore = NetConfig::fromJson(valid);
+}
+
+TEST_CASE("The blocking IO lane grows under load and shrinks when idle.", "[PetriNet/ThreadPool]")
+{
+    ThreadPool tp(1, ElasticWorkerPool::Params{.maxWorkers = 4U, .idleTimeout = std::chrono::milliseconds(20)});
+    REQUIRE(tp.getLane(ThreadPool::BLOCKING_IO_LANE_ID) == ThreadPool::BLOCKING_IO_LANE);
+    REQUIRE(tp.getNumberWorkers(ThreadPool::BLOCKING_IO_LANE) == 0U);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    constexpr size_t NUMBER_TASKS{6U};
+    std::vector<std::unique_ptr<ThreadPool::Task>> tasks;
+    for (size_t i = 0; i < NUMBER_TASKS; ++i)
+    {
+        tasks.push_back(std::make_unique<ThreadPool::Task>([released] {
+            released.wait();
+            return ActionExecutionStatus(ActionExecutionStatus::SUCCESS);
+        }));
+        tp.executeAsync(*tasks.back(), ThreadPool::BLOCKING_IO_LANE);
+    }
+    const auto numberWorkersUnderLoad = tp.getNumberWorkers(ThreadPool::BLOCKING_IO_LANE);
+
+    // the compute lane is not affected by the blocked workers
+    ThreadPool::Task compute([] { return ActionExecutionStatus(ActionExecutionStatus::SUCCESS); });
+    tp.executeAsync(compute);
+    const auto computeStatus = waitForStatus(compute);
+
+    release.set_value();
+    REQUIRE(numberWorkersUnderLoad == 4U);
+    REQUIRE(computeStatus == +ActionExecutionStatus::SUCCESS);
+    for (auto&& task : tasks)
+    {
+        REQUIRE(waitForStatus(*task) == +ActionExecutionStatus::SUCCESS);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (tp.getNumberWorkers(ThreadPool::BLOCKING_IO_LANE) > 0U && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(tp.getNumberWorkers(ThreadPool::BLOCKING_IO_LANE) == 0U);
+}
+
+TEST_CASE("Blocking IO actions run in the blocking IO lane.", "[PetriNet/ThreadPool]")
+{
+    nlohmann::json config;
+    std::ifstream("config_samples/config.json") >> config;
+    auto places = Place::Factory::createPlaces(config.at("petri_net"));
+
+    ThreadPool tp(1);
+    tp.addLanes(config.at("controller").at("thread_pool_lanes"));
+    Place::Factory::createActions(tp, config.at("controller").at("actions"), places);
+    REQUIRE(places.at("B")->getAction()->getLane() == tp.getLane("timers"));
+    REQUIRE(places.at("C")->getAction()->getLane() == ThreadPool::BLOCKING_IO_LANE);
+
+    // explicit lanes take precedence
+    config["controller"]["actions"][1]["lane"] = ThreadPool::DEFAULT_LANE_ID;
+    places = Place::Factory::createPlaces(config.at("petri_net"));
+    Place::Factory::createActions(tp, config.at("controller").at("actions"), places);
+    REQUIRE(places.at("C")->getAction()->getLane() == ThreadPool::DEFAULT_LANE);
+}
+
+TEST_CASE("Completion counters signal once all their tasks finished.", "[PetriNet/ThreadPool]")
+{
+    ThreadPool tp(2);
+    std::atomic<uint32_t> numberSignals{0U};
+    const auto onAllFinished = [&numberSignals] { ++numberSignals; };
+
+    // the group stays open until sealed
+    auto counter = std::make_shared<ThreadPool::CompletionCounter>(onAllFinished);
+    ThreadPool::Task first([] { return ActionExecutionStatus(ActionExecutionStatus::SUCCESS); }, counter);
+    ThreadPool::Task second([] { return ActionExecutionStatus(ActionExecutionStatus::FAILURE); }, counter);
+    tp.executeAsync(first);
+    tp.executeAsync(second);
+    REQUIRE(waitForStatus(first) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(waitForStatus(second) == +ActionExecutionStatus::FAILURE);
+    REQUIRE(numberSignals.load() == 0U);
+    counter->seal();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (numberSignals.load() == 0U && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // the last task may notify after its status is set
+    }
+    REQUIRE(numberSignals.load() == 1U);
+
+    // tasks still in progress are polled again later; they do not signal
+    counter = std::make_shared<ThreadPool::CompletionCounter>(onAllFinished);
+    ThreadPool::Task inProgress([] { return ActionExecutionStatus(ActionExecutionStatus::IN_PROGRESS); }, counter);
+    counter->seal();
+    tp.executeAsync(inProgress);
+    REQUIRE(waitForStatus(inProgress) == +ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(numberSignals.load() == 1U);
+
+    // nor do empty or disarmed groups
+    std::make_shared<ThreadPool::CompletionCounter>(onAllFinished)->seal();
+    counter = std::make_shared<ThreadPool::CompletionCounter>(onAllFinished);
+    ThreadPool::Task late([] { return ActionExecutionStatus(ActionExecutionStatus::SUCCESS); }, counter);
+    counter->seal();
+    counter->disarm();
+    tp.executeAsync(late);
+    REQUIRE(waitForStatus(late) == +ActionExecutionStatus::SUCCESS);
+    REQUIRE(numberSignals.load() == 1U);
+}
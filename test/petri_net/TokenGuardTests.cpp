@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/TokenGuard.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <string>
+#include <tuple>
+
+using namespace capybot::bnet;
+
+namespace
+{
+Token createOrder(nlohmann::json const& order)
+{
+    Token token;
+    token.addContentBlock("order", order);
+    return token;
+}
+} // namespace
+
+TEST_CASE("Token guards evaluate comparisons over token content", "[PetriNet/TokenGuard]")
+{
+    const auto token = createOrder({{"qty", 12}, {"price", 2.5}, {"kind", "express"}, {"paid", true}, {"tags", {"a"}}});
+    const auto holds = [&token](std::string const& expression) { return TokenGuard(expression).evaluate(token); };
+
+    REQUIRE(holds("@token{order.qty} > 10"));
+    REQUIRE(holds("@token{order.qty} >= 12"));
+    REQUIRE_FALSE(holds("@token{order.qty} < 12"));
+    REQUIRE(holds("@token{order.qty} == 12.0")); // integers and floats compare by value
+    REQUIRE(holds("@token{order.price} <= -1e-3 || @token{order.price} < 1e1"));
+    REQUIRE(holds("@token{order.kind} == 'express' && @token{order.kind} != \"standard\""));
+    REQUIRE(holds("@token{order.kind} < 'z'"));
+    REQUIRE(holds("@token{order.tags.0} == 'a'"));
+
+    // operands as conditions, precedence and grouping
+    REQUIRE(holds("@token{order.paid}"));
+    REQUIRE_FALSE(holds("!@token{order.paid}"));
+    REQUIRE_FALSE(holds("@token{order.qty}")); // not a boolean
+    REQUIRE(holds("false && true || true"));
+    REQUIRE_FALSE(holds("false && (true || true)"));
+    REQUIRE(holds("!(@token{order.qty} < 5) && @token{order.paid} == true"));
+
+    // missing values and mismatched types
+    REQUIRE_FALSE(holds("@token{order.missing} == null"));
+    REQUIRE_FALSE(holds("@token{order.missing} != 1"));
+    REQUIRE_FALSE(holds("@token{other.qty} > 0"));
+    REQUIRE_FALSE(holds("@token{order.kind} > 1"));
+    REQUIRE(holds("@token{order.kind} != 1"));
+    REQUIRE_FALSE(holds("@token{order.paid} > false"));
+}
+
+TEST_CASE("Malformed token guards are rejected at compile time", "[PetriNet/TokenGuard]")
+{
+    for (auto&& expression :
+         {"", "@token{order.qty} >", "@token{order.qty > 1", "@token{.qty} > 1", "(@token{order.qty} > 1",
+          "@token{order.qty} > 1 extra", "'unterminated", "1 > 2 > 3", "(1 > 2) == true", "-", "truex",
+          "@token{a} = 1"})
+    {
+        INFO(expression);
+        REQUIRE_THROWS_AS(std::ignore = TokenGuard(expression), Exception);
+        REQUIRE_BNET_THROW_AS(std::ignore = TokenGuard(expression), ExceptionType::INVALID_VALUE);
+    }
+
+    std::string deep;
+    for (size_t i = 0U; i <= TokenGuard::MAX_STACK_DEPTH; ++i)
+    {
+        deep += "(1 == 1 && ";
+    }
+    deep += "true" + std::string(TokenGuard::MAX_STACK_DEPTH + 1U, ')');
+    REQUIRE_THROWS_AS(std::ignore = TokenGuard(deep), Exception);
+}
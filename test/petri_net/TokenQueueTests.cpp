@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/TokenQueue.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+using namespace capybot::bnet;
+
+namespace
+{
+Token::SharedPtr createOrder(std::optional<double> value)
+{
+    auto token = Token::makeShared();
+    token->addContentBlock("order", value.has_value() ? nlohmann::json{{"value", *value}} : nlohmann::json::object());
+    return token;
+}
+
+std::vector<Token::SharedPtr> popAll(TokenQueue& queue, ActionExecutionStatusSet statuses = 0U)
+{
+    std::vector<Token::SharedPtr> tokens;
+    while (queue.size(statuses) > 0U)
+    {
+        tokens.push_back(queue.pop(statuses));
+    }
+    return tokens;
+}
+} // namespace
+
+TEST_CASE("Token queues hand out tokens by selection policy", "[PetriNet/TokenQueue]")
+{
+    const std::vector<Token::SharedPtr> tokens{createOrder(2.), createOrder(std::nullopt), createOrder(5.),
+                                               createOrder(1.), createOrder(5.)};
+    const auto fill = [&tokens](TokenQueue& queue) {
+        for (auto&& token : tokens)
+        {
+            queue.push(token, ActionExecutionStatus::SUCCESS);
+        }
+        REQUIRE(queue.size() == tokens.size());
+    };
+    const auto inOrder = [&tokens](std::vector<size_t> indexes) {
+        std::vector<Token::SharedPtr> ordered;
+        for (auto&& i : indexes)
+        {
+            ordered.push_back(tokens[i]);
+        }
+        return ordered;
+    };
+
+    TokenQueue fifo;
+    fill(fifo);
+    REQUIRE(popAll(fifo) == tokens);
+
+    TokenQueue lifo(TokenSelectionPolicy::LIFO);
+    fill(lifo);
+    REQUIRE(popAll(lifo) == inOrder({4, 3, 2, 1, 0}));
+
+    // ties keep insertion order; tokens without key go last
+    TokenQueue priority(TokenSelectionPolicy::PRIORITY, TokenContentPath("order.value"));
+    fill(priority);
+    REQUIRE(popAll(priority) == inOrder({2, 4, 0, 3, 1}));
+
+    TokenQueue deadline(TokenSelectionPolicy::DEADLINE, TokenContentPath("order.value"));
+    fill(deadline);
+    REQUIRE(popAll(deadline) == inOrder({3, 0, 2, 4, 1}));
+
+    REQUIRE_BNET_THROW_AS(TokenQueue(TokenSelectionPolicy::PRIORITY), ExceptionType::INVALID_VALUE);
+    REQUIRE_BNET_THROW_AS(deadline.pop(), ExceptionType::LOGIC_ERROR);
+}
+
+TEST_CASE("Token queues count and select tokens per action result", "[PetriNet/TokenQueue]")
+{
+    const ActionExecutionStatusSet success{1U << ActionExecutionStatus::SUCCESS};
+    const ActionExecutionStatusSet failure{1U << ActionExecutionStatus::FAILURE};
+
+    TokenQueue queue(TokenSelectionPolicy::PRIORITY, TokenContentPath("order.value"));
+    auto low = createOrder(1.);
+    auto mid = createOrder(2.);
+    auto high = createOrder(3.);
+    queue.push(mid, ActionExecutionStatus::SUCCESS);
+    queue.push(high, ActionExecutionStatus::FAILURE);
+    queue.push(low, ActionExecutionStatus::SUCCESS);
+
+    REQUIRE(queue.size() == 3U);
+    REQUIRE(queue.size(success) == 2U);
+    REQUIRE(queue.size(failure) == 1U);
+    REQUIRE(queue.size(success | failure) == 3U);
+
+    REQUIRE(queue.pop(success) == mid);     // best among SUCCESS only
+    REQUIRE(queue.pop(success | failure) == high); // best across statuses
+    REQUIRE(queue.size(failure) == 0U);
+    REQUIRE(queue.pop() == low);
+}
+
+TEST_CASE("Token queues select tokens satisfying a predicate", "[PetriNet/TokenQueue]")
+{
+    const auto isEven = [](Token const& token) {
+        const auto value = token.findContent("order")->value("value", 1.);
+        return static_cast<int>(value) % 2 == 0;
+    };
+    const auto valueOf = [](Token::SharedPtr const& token) {
+        return token->getContent("order")["value"].get<double>();
+    };
+
+    for (auto policy : {+TokenSelectionPolicy::FIFO, +TokenSelectionPolicy::LIFO, +TokenSelectionPolicy::PRIORITY})
+    {
+        INFO(policy._to_string());
+        TokenQueue queue(policy, policy == +TokenSelectionPolicy::PRIORITY
+                                     ? std::optional<TokenContentPath>("order.value")
+                                     : std::nullopt);
+        for (auto value : {1., 2., 3., 4., 6.})
+        {
+            queue.push(createOrder(value), ActionExecutionStatus::SUCCESS);
+        }
+        queue.push(createOrder(8.), ActionExecutionStatus::FAILURE);
+
+        REQUIRE(queue.countIf(0U, isEven, 10U) == 4U);
+        REQUIRE(queue.countIf(0U, isEven, 2U) == 2U);
+        REQUIRE(queue.countIf(ActionExecutionStatusSet{1U << ActionExecutionStatus::SUCCESS}, isEven, 10U) == 3U);
+
+        const auto first = queue.popIf(0U, isEven);
+        REQUIRE(valueOf(first) == (policy == +TokenSelectionPolicy::FIFO ? 2. : 8.));
+        REQUIRE(queue.size() == 5U);
+        REQUIRE(queue.countIf(0U, isEven, 10U) == 3U);
+    }
+
+    TokenQueue queue;
+    queue.push(createOrder(1.), ActionExecutionStatus::SUCCESS);
+    REQUIRE(queue.popIf(0U, isEven) == nullptr);
+    REQUIRE(queue.size() == 1U);
+}
+
+TEST_CASE("Token queue key indexes count tokens per key", "[PetriNet/TokenQueue]")
+{
+    TokenQueue queue;
+    queue.push(createOrder(1.), ActionExecutionStatus::SUCCESS);
+
+    const auto id = queue.addKeyIndex(TokenContentPath("order.value"));
+    REQUIRE(queue.addKeyIndex(TokenContentPath("order.value")) == id);
+    REQUIRE(queue.countKey(id, 1.) == 1U); // indexed on creation
+
+    queue.push(createOrder(2.), ActionExecutionStatus::SUCCESS);
+    queue.push(createOrder(2.), ActionExecutionStatus::FAILURE);
+    queue.push(createOrder(std::nullopt), ActionExecutionStatus::SUCCESS);
+    REQUIRE(queue.getKeyIndex(id).size() == 2U);
+    REQUIRE(queue.countKey(id, 2.) == 2U);
+    REQUIRE(queue.countKey(id, 2., ActionExecutionStatusSet{1U << ActionExecutionStatus::FAILURE}) == 1U);
+    REQUIRE(queue.countKey(id, 3.) == 0U);
+
+    std::ignore = queue.pop();
+    REQUIRE(queue.countKey(id, 1.) == 0U);
+    REQUIRE(queue.getKeyIndex(id).size() == 1U); // empty keys are dropped
+    std::ignore = queue.popIf(0U, [](Token const& token) { return token.findContent("order")->contains("value"); });
+    REQUIRE(queue.countKey(id, 2.) == 1U);
+}
+
+TEST_CASE("Token queues take tokens by key", "[PetriNet/TokenQueue]")
+{
+    const auto createKeyed = [](int key, int value) {
+        auto token = Token::makeShared();
+        token->addContentBlock("order", {{"id", key}, {"value", value}});
+        return token;
+    };
+    const auto valueOf = [](Token::SharedPtr const& token) { return token->getContent("order")["value"].get<int>(); };
+
+    for (auto policy : {+TokenSelectionPolicy::FIFO, +TokenSelectionPolicy::LIFO, +TokenSelectionPolicy::PRIORITY})
+    {
+        INFO(policy._to_string());
+        TokenQueue queue(policy, policy == +TokenSelectionPolicy::PRIORITY
+                                     ? std::optional<TokenContentPath>("order.value")
+                                     : std::nullopt);
+        const auto id = queue.addKeyIndex(TokenContentPath("order.id"));
+        queue.push(createKeyed(1, 10), ActionExecutionStatus::SUCCESS);
+        queue.push(createKeyed(2, 20), ActionExecutionStatus::SUCCESS);
+        queue.push(createKeyed(1, 30), ActionExecutionStatus::FAILURE);
+        queue.push(createKeyed(1, 40), ActionExecutionStatus::SUCCESS);
+
+        REQUIRE(queue.popKey(id, 3) == nullptr);
+        REQUIRE(valueOf(queue.popKey(id, 1)) == (policy == +TokenSelectionPolicy::FIFO ? 10 : 40));
+        REQUIRE(valueOf(queue.popKey(id, 1, ActionExecutionStatusSet{1U << ActionExecutionStatus::FAILURE})) == 30);
+        REQUIRE(queue.countKey(id, 1) == 1U);
+        REQUIRE(queue.size() == 2U);
+
+        // the remaining tokens are still handed out in policy order
+        REQUIRE(valueOf(queue.pop()) == 20);
+        REQUIRE(queue.countKey(id, 2) == 0U);
+    }
+}
+
+TEST_CASE("Deep token queues take tokens by key in policy order", "[PetriNet/TokenQueue]")
+{
+    constexpr int NUMBER_TOKENS{10000};
+    constexpr int NUMBER_KEYS{100};
+    struct Queued
+    {
+        int key;
+        int value;
+    };
+    const auto createKeyed = [](Queued const& queued) {
+        auto token = Token::makeShared();
+        token->addContentBlock("order", {{"id", queued.key}, {"value", queued.value}});
+        return token;
+    };
+    const auto valueOf = [](Token::SharedPtr const& token) {
+        return token != nullptr ? token->getContent("order")["value"].get<int>() : -1;
+    };
+
+    for (auto policy : {+TokenSelectionPolicy::FIFO, +TokenSelectionPolicy::LIFO, +TokenSelectionPolicy::DEADLINE})
+    {
+        INFO(policy._to_string());
+        TokenQueue queue(policy, policy == +TokenSelectionPolicy::DEADLINE
+                                     ? std::optional<TokenContentPath>("order.value")
+                                     : std::nullopt);
+        const auto id = queue.addKeyIndex(TokenContentPath("order.id"));
+
+        // reference: queued tokens in insertion order, with unique values
+        std::vector<Queued> reference;
+        int nextValue{0};
+        const auto push = [&](int key) {
+            reference.push_back(Queued{.key = key, .value = (nextValue++ * 7919) % (2 * NUMBER_TOKENS)});
+            queue.push(createKeyed(reference.back()), ActionExecutionStatus::SUCCESS);
+        };
+        const auto expectedPop = [&](std::optional<int> key) {
+            auto selected = reference.end();
+            for (auto it = reference.begin(); it != reference.end(); ++it)
+            {
+                if (key.has_value() && it->key != *key)
+                {
+                    continue;
+                }
+                if (selected == reference.end() || policy == +TokenSelectionPolicy::LIFO ||
+                    (policy == +TokenSelectionPolicy::DEADLINE && it->value < selected->value))
+                {
+                    selected = it;
+                }
+            }
+            if (selected == reference.end())
+            {
+                return -1;
+            }
+            const auto value = selected->value;
+            reference.erase(selected);
+            return value;
+        };
+
+        for (int i = 0; i < NUMBER_TOKENS; ++i)
+        {
+            push(i % NUMBER_KEYS);
+        }
+        for (int step = 0; step < NUMBER_TOKENS; ++step)
+        {
+            if (step % 5 == 0)
+            {
+                push((step * 7) % NUMBER_KEYS); // reuses the positions and slots of taken tokens
+            }
+            if (step % 3 == 0)
+            {
+                REQUIRE(valueOf(queue.pop()) == expectedPop(std::nullopt));
+                continue;
+            }
+            const auto key = (step * 31) % NUMBER_KEYS;
+            REQUIRE(valueOf(queue.popKey(id, key)) == expectedPop(key));
+            const auto hasKey = [key](Queued const& queued) { return queued.key == key; };
+            REQUIRE(queue.countKey(id, key) ==
+                    static_cast<uint32_t>(std::count_if(reference.begin(), reference.end(), hasKey)));
+        }
+        REQUIRE(queue.size() == reference.size());
+        for (auto&& queued : popAll(queue))
+        {
+            REQUIRE(valueOf(queued) == expectedPop(std::nullopt));
+        }
+    }
+}
+
+TEST_CASE("Token queues compact the tombstones of tokens taken by key", "[PetriNet/TokenQueue]")
+{
+    const auto createKeyed = [](int key, int value) {
+        auto token = Token::makeShared();
+        token->addContentBlock("order", {{"id", key}, {"value", value}});
+        return token;
+    };
+    const auto valueOf = [](Token::SharedPtr const& token) { return token->getContent("order")["value"].get<int>(); };
+
+    for (auto policy : {+TokenSelectionPolicy::FIFO, +TokenSelectionPolicy::DEADLINE})
+    {
+        INFO(policy._to_string());
+        TokenQueue queue(policy, policy == +TokenSelectionPolicy::DEADLINE
+                                     ? std::optional<TokenContentPath>("order.value")
+                                     : std::nullopt);
+        const auto id = queue.addKeyIndex(TokenContentPath("order.id"));
+
+        // the first and last tokens stay queued, so the tokens taken in between leave tombstones behind
+        queue.push(createKeyed(0, -1), ActionExecutionStatus::SUCCESS);
+        queue.push(createKeyed(2, 0), ActionExecutionStatus::SUCCESS);
+        for (int i = 1; i < 1000; ++i)
+        {
+            queue.push(createKeyed(1, 2 * i - 1), ActionExecutionStatus::SUCCESS);
+            queue.push(createKeyed(2, 2 * i), ActionExecutionStatus::SUCCESS);
+            REQUIRE(valueOf(queue.popKey(id, 1)) == 2 * i - 1);
+            REQUIRE(valueOf(queue.popKey(id, 2)) == 2 * i - 2);
+            REQUIRE(queue.size() == 2U);
+        }
+        REQUIRE(valueOf(queue.pop()) == -1);
+        REQUIRE(valueOf(queue.popKey(id, 2)) == 1998);
+        REQUIRE(queue.size() == 0U);
+        REQUIRE(queue.getKeyIndex(id).empty());
+    }
+}
@@ -19,6 +19,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <behavior_net/Token.hpp>
+#include <behavior_net/TokenContentPath.hpp>
 
 #include "TestsCommon.hpp"
 
@@ -73,3 +74,25 @@ TEST_CASE("We can manage token content", "[PetriNet/Token]")
         REQUIRE_BNET_THROW_AS(token->mergeContentBlocks(tokenNull), ExceptionType::RUNTIME_ERROR);
     }
 }
+
+TEST_CASE("We can resolve paths within token content", "[PetriNet/Token]")
+{
+    auto token = Token::makeUnique();
+    token->addContentBlock("order", {{"qty", 12}, {"customer", {{"tier", "gold"}}}, {"items", {"a", "b"}}});
+
+    REQUIRE(token->findContent("order") != nullptr);
+    REQUIRE(token->findContent("robot") == nullptr);
+
+    REQUIRE(TokenContentPath("order.qty").resolveNumber(*token) == 12.);
+    REQUIRE(*TokenContentPath("order.customer.tier").resolve(*token) == "gold");
+    REQUIRE(*TokenContentPath("order.items.1").resolve(*token) == "b");
+    REQUIRE(TokenContentPath("order").resolve(*token)->contains("qty"));
+
+    REQUIRE(TokenContentPath("order.price").resolve(*token) == nullptr);
+    REQUIRE(TokenContentPath("robot.host").resolve(*token) == nullptr);
+    REQUIRE_FALSE(TokenContentPath("order.customer").resolveNumber(*token).has_value());
+
+    REQUIRE_THROWS_AS(TokenContentPath(""), Exception);
+    REQUIRE_THROWS_AS(TokenContentPath("order..qty"), Exception);
+    REQUIRE_THROWS_AS(TokenContentPath("order."), Exception);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/PetriNet.hpp>
+#include <behavior_net/TransitionScheduler.hpp>
+
+#include "TestsCommon.hpp"
+
+#include <fstream>
+#include <map>
+
+using namespace capybot::bnet;
+
+namespace
+{
+nlohmann::json readSchedulingConfig(std::string const& policy)
+{
+    nlohmann::json configJson;
+    std::ifstream("test/petri_net/config/transition_scheduling.json") >> configJson;
+    configJson["controller"]["transition_scheduler"]["policy"] = policy;
+    return configJson;
+}
+
+/// @return number of firings per transition, adding one contended `Src` token per epoch
+std::map<std::string, uint32_t> runEpochs(std::string const& policy, uint32_t numberEpochs)
+{
+    const auto config = NetConfig::fromJson(readSchedulingConfig(policy));
+    auto net = PetriNet::create(config);
+    TransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+
+    std::map<std::string, uint32_t> firings;
+    std::vector<Transition const*> fired;
+    for (uint32_t epoch = 0U; epoch < numberEpochs; ++epoch)
+    {
+        auto token = Token::makeUnique();
+        net->addToken(token, "Src");
+        scheduler.fireEnabled(fired);
+        REQUIRE(fired.size() == 1U);
+        ++firings[fired.front()->getId()];
+    }
+    return firings;
+}
+} // namespace
+
+TEST_CASE("Higher priority transitions win contended tokens.", "[PetriNet/TransitionScheduler]")
+{
+    for (auto&& policy : {"ordered", "round_robin", "weighted_round_robin", "fair_share"})
+    {
+        const auto config = NetConfig::fromJson(readSchedulingConfig(policy));
+        auto net = PetriNet::create(config);
+        TransitionScheduler scheduler(net->getTransitions(), config.get().at("controller"));
+
+        std::vector<Transition const*> fired;
+        for (int i = 0; i < 10; ++i)
+        {
+            auto src = Token::makeUnique();
+            auto req = Token::makeUnique();
+            net->addToken(src, "Src");
+            net->addToken(req, "Req");
+            scheduler.fireEnabled(fired);
+            REQUIRE(fired.size() == 1U);
+            REQUIRE(fired.front()->getId() == "TU");
+        }
+    }
+}
+
+TEST_CASE("Scheduling policies share contended tokens among same priority transitions.",
+          "[PetriNet/TransitionScheduler]")
+{
+    constexpr uint32_t NUMBER_EPOCHS{400U};
+
+    // config order: TA always wins
+    REQUIRE(runEpochs("ordered", NUMBER_EPOCHS)["TA"] == NUMBER_EPOCHS);
+
+    auto firings = runEpochs("round_robin", NUMBER_EPOCHS);
+    REQUIRE(firings["TA"] == NUMBER_EPOCHS / 2U);
+    REQUIRE(firings["TB"] == NUMBER_EPOCHS / 2U);
+
+    // TA has scheduling_weight 3; TB 1
+    firings = runEpochs("weighted_round_robin", NUMBER_EPOCHS);
+    REQUIRE(firings["TA"] == 3U * NUMBER_EPOCHS / 4U);
+    REQUIRE(firings["TB"] == NUMBER_EPOCHS / 4U);
+
+    firings = runEpochs("fair_share", NUMBER_EPOCHS);
+    REQUIRE(firings["TA"] >= 3U * NUMBER_EPOCHS / 4U - 2U);
+    REQUIRE(firings["TA"] <= 3U * NUMBER_EPOCHS / 4U + 2U);
+    REQUIRE(firings["TA"] + firings["TB"] == NUMBER_EPOCHS);
+}
+
+TEST_CASE("Invalid scheduler configs are rejected.", "[PetriNet/TransitionScheduler]")
+{
+    REQUIRE_BNET_THROW_AS(NetConfig::fromJson(readSchedulingConfig("lottery")), ExceptionType::INVALID_CONFIG_FILE);
+    REQUIRE_THROWS_AS(NetConfig::fromJson(readSchedulingConfig("lottery")), Exception);
+
+    auto configJson = readSchedulingConfig("fair_share");
+    configJson["petri_net"]["transitions"][0]["scheduling_weight"] = 0;
+    REQUIRE_THROWS_AS(NetConfig::fromJson(configJson), Exception);
+}
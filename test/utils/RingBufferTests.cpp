@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/RingBuffer.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+template <typename T>
+std::vector<T> toVector(capybot::RingBuffer<T> const& buffer)
+{
+    return std::vector<T>(buffer.begin(), buffer.end());
+}
+} // namespace
+
+TEST_CASE("RingBuffer is a FIFO that wraps around its storage", "[CapybotUtils/RingBuffer]")
+{
+    capybot::RingBuffer<int> buffer(4U);
+    REQUIRE(buffer.empty());
+    REQUIRE(buffer.capacity() == 4U);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        buffer.push_back(i);
+        if (buffer.size() == 3U)
+        {
+            buffer.pop_front();
+        }
+    }
+    REQUIRE(buffer.capacity() == 4U); // never grown
+    REQUIRE(toVector(buffer) == std::vector<int>{8, 9});
+    REQUIRE(buffer.front() == 8);
+    REQUIRE(buffer.back() == 9);
+}
+
+TEST_CASE("RingBuffer grows only when full", "[CapybotUtils/RingBuffer]")
+{
+    capybot::RingBuffer<std::string> buffer;
+    REQUIRE(buffer.capacity() == 0U); // lazy allocation
+
+    for (int i = 0; i < 20; ++i)
+    {
+        buffer.push_back(std::to_string(i));
+        if (i % 3 == 0)
+        {
+            buffer.pop_front();
+        }
+    }
+    REQUIRE(buffer.size() == 13U);
+    REQUIRE(buffer.capacity() >= 13U);
+    REQUIRE(buffer.front() == "7");
+    REQUIRE(buffer.back() == "19");
+
+    buffer.clear();
+    REQUIRE(buffer.empty());
+}
+
+TEST_CASE("RingBuffer supports erasing and standard algorithms", "[CapybotUtils/RingBuffer]")
+{
+    capybot::RingBuffer<std::unique_ptr<int>> buffer(8U);
+    for (int i = 0; i < 8; ++i)
+    {
+        buffer.emplace_back(std::make_unique<int>(i));
+    }
+    buffer.pop_front();
+    buffer.emplace_back(std::make_unique<int>(8)); // wrapped: 1..8
+
+    const auto find = [&buffer](int value) {
+        return std::find_if(buffer.begin(), buffer.end(), [value](auto const& p) { return *p == value; });
+    };
+
+    auto it = buffer.erase(find(2)); // front side
+    REQUIRE(**it == 3);
+    it = buffer.erase(find(7)); // back side
+    REQUIRE(**it == 8);
+    REQUIRE(std::distance(buffer.begin(), find(5)) == 3);
+    REQUIRE(std::count_if(buffer.begin(), buffer.end(), [](auto const& p) { return *p % 2 == 0; }) == 3);
+
+    std::vector<int> values;
+    for (auto&& p : buffer)
+    {
+        values.push_back(*p);
+    }
+    REQUIRE(values == std::vector<int>{1, 3, 4, 5, 6, 8});
+    REQUIRE(buffer.capacity() == 8U);
+}
+
+TEST_CASE("RingBuffer extracts matching elements in a single pass", "[CapybotUtils/RingBuffer]")
+{
+    capybot::RingBuffer<int> buffer(8U);
+    for (int i = 0; i < 10; ++i)
+    {
+        buffer.push_back(i);
+        if (i < 2)
+        {
+            buffer.pop_front(); // start wrapped
+        }
+    }
+
+    std::vector<int> extracted;
+    const auto isEven = [](int v) { return v % 2 == 0; };
+    REQUIRE(buffer.extract_if(isEven, 3U, [&extracted](int&& v) { extracted.push_back(v); }) == 3U);
+    REQUIRE(extracted == std::vector<int>{2, 4, 6});
+    REQUIRE(toVector(buffer) == std::vector<int>{3, 5, 7, 8, 9});
+
+    REQUIRE(buffer.extract_if(isEven, 10U, [&extracted](int&& v) { extracted.push_back(v); }) == 1U);
+    REQUIRE(toVector(buffer) == std::vector<int>{3, 5, 7, 9});
+}